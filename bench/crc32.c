@@ -0,0 +1,31 @@
+
+#include "caffeine.h"
+#include <stdint.h>
+
+/**
+ * Hash function benchmark. The CRC is computed without branches so there is
+ * only a single path and nearly all of the time is spent within the solver
+ * trying to invert the hash.
+ */
+
+#define LEN 4
+
+uint32_t crc32(const uint8_t* data, uint32_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+
+  for (uint32_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int j = 0; j < 8; ++j)
+      crc = (crc >> 1) ^ (UINT32_C(0xEDB88320) & -(crc & 1));
+  }
+
+  return ~crc;
+}
+
+int main(int argc, char* argv[]) {
+  uint8_t data[LEN];
+  caffeine_make_symbolic(data, sizeof(data), "data");
+
+  // This is the CRC of "abcd"
+  caffeine_assert(crc32(data, LEN) != UINT32_C(0xED82CD11));
+}
@@ -0,0 +1,47 @@
+
+#include "caffeine.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Pointer-chasing benchmark. Builds a linked list out of separate heap
+ * allocations and then follows symbolic links through a table of node
+ * pointers. Every dereference has to be resolved against all of the nodes
+ * that the pointer could refer to.
+ */
+
+#define NODES 6
+#define STEPS 4
+
+struct node {
+  struct node* next;
+  uint32_t value;
+};
+
+int main(int argc, char* argv[]) {
+  struct node* nodes[NODES];
+  for (uint32_t i = 0; i < NODES; ++i) {
+    nodes[i] = malloc(sizeof(struct node));
+    nodes[i]->value = i * 7 + 3;
+  }
+
+  uint8_t links[NODES];
+  caffeine_make_symbolic(links, sizeof(links), "links");
+
+  for (uint32_t i = 0; i < NODES; ++i) {
+    caffeine_assume(links[i] < NODES);
+    nodes[i]->next = nodes[links[i]];
+  }
+
+  struct node* node = nodes[0];
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < STEPS; ++i) {
+    sum += node->value;
+    node = node->next;
+  }
+
+  caffeine_assert(sum != 3 + 38 + 10 + 31);
+
+  for (uint32_t i = 0; i < NODES; ++i)
+    free(nodes[i]);
+}
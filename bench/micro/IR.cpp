@@ -0,0 +1,91 @@
+#include "caffeine/IR/Operation.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+
+using namespace caffeine;
+
+/**
+ * Build the same set of expressions from multiple threads at once. Every
+ * thread creates the same nodes so nearly every Create call after the first
+ * thread has to go through the cache lock and find an existing entry.
+ */
+static void BM_OperationCache_Intern(benchmark::State& state) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < 64; ++i) {
+      auto expr =
+          BinaryOp::CreateAdd(x, ConstantInt::Create(llvm::APInt(32, i)));
+      benchmark::DoNotOptimize(expr);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_OperationCache_Intern)->ThreadRange(1, 8)->UseRealTime();
+
+/**
+ * Same as above but each thread builds distinct expressions so every Create
+ * call inserts a new entry into the cache.
+ */
+static void BM_OperationCache_InternUnique(benchmark::State& state) {
+  // Each thread gets its own symbolic constant so that the expressions it
+  // builds are distinct from those of every other thread.
+  static std::atomic<uint64_t> next_symbol = 0;
+  auto x = Constant::Create(Type::int_ty(32), next_symbol.fetch_add(1));
+  uint32_t value = 0;
+
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < 64; ++i) {
+      auto expr = BinaryOp::CreateAdd(
+          x, ConstantInt::Create(llvm::APInt(32, value++)));
+      benchmark::DoNotOptimize(expr);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_OperationCache_InternUnique)->ThreadRange(1, 8)->UseRealTime();
+
+/**
+ * Create operations whose operands are all constants so that they are
+ * immediately folded away by the ConstantFolder.
+ */
+static void BM_ConstantFolder_Constants(benchmark::State& state) {
+  auto a = ConstantInt::Create(llvm::APInt(64, 0x12345678));
+  auto b = ConstantInt::Create(llvm::APInt(64, 0x9ABCDEF));
+
+  for (auto _ : state) {
+    auto sum = BinaryOp::CreateAdd(a, b);
+    auto prod = BinaryOp::CreateMul(sum, b);
+    auto cmp = ICmpOp::CreateICmp(ICmpOpcode::ULT, prod, a);
+    auto sel = SelectOp::Create(cmp, sum, prod);
+    benchmark::DoNotOptimize(sel);
+  }
+
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(BM_ConstantFolder_Constants);
+
+/**
+ * Create operations which match the identity rules within the ConstantFolder
+ * (x + 0, x * 1, x & x, etc.) and fold to one of their operands.
+ */
+static void BM_ConstantFolder_Identities(benchmark::State& state) {
+  auto x = Constant::Create(Type::int_ty(64), "x");
+  auto zero = ConstantInt::CreateZero(64);
+  auto one = ConstantInt::Create(llvm::APInt(64, 1));
+
+  for (auto _ : state) {
+    auto expr = BinaryOp::CreateAdd(x, zero);
+    expr = BinaryOp::CreateMul(expr, one);
+    expr = BinaryOp::CreateAnd(expr, expr);
+    expr = BinaryOp::CreateOr(expr, zero);
+    benchmark::DoNotOptimize(expr);
+  }
+
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(BM_ConstantFolder_Identities);
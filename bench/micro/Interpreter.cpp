@@ -0,0 +1,97 @@
+#include "caffeine/Interpreter/AssertionList.h"
+#include "caffeine/Interpreter/Context.h"
+
+#include <benchmark/benchmark.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+
+#include <memory>
+#include <vector>
+
+using namespace caffeine;
+
+static std::unique_ptr<llvm::Function> empty_function(llvm::LLVMContext& llvm) {
+  auto function = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(llvm), false),
+      llvm::GlobalValue::LinkageTypes::PrivateLinkage,
+      0 // addrspace
+  );
+
+  llvm::BasicBlock::Create(llvm, "entry", function);
+
+  return std::unique_ptr<llvm::Function>(function);
+}
+
+static std::vector<Assertion> make_assertions(size_t count) {
+  std::vector<Assertion> assertions;
+  assertions.reserve(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    auto x = Constant::Create(Type::int_ty(32), i);
+    assertions.emplace_back(
+        ICmpOp::CreateICmpULT(x, ConstantInt::Create(llvm::APInt(32, i + 1))));
+  }
+
+  return assertions;
+}
+
+/**
+ * Fork a context whose state (number of assertions and heap allocations) is
+ * given by the argument.
+ */
+static void BM_Context_Fork(benchmark::State& state) {
+  llvm::LLVMContext llvm;
+  auto function = empty_function(llvm);
+  Context context{function.get()};
+
+  auto size = ConstantInt::Create(llvm::APInt(64, 64));
+  auto align = ConstantInt::Create(llvm::APInt(64, 16));
+  auto data = AllocOp::Create(size, ConstantInt::Create(llvm::APInt(8, 0)));
+
+  for (const auto& assertion : make_assertions(state.range(0)))
+    context.add(assertion);
+  for (int64_t i = 0; i < state.range(0); ++i)
+    context.heaps[0].allocate(size, align, data, AllocationKind::Malloc,
+                              AllocationPermissions::ReadWrite, context);
+
+  for (auto _ : state) {
+    Context forked = context.fork_once();
+    benchmark::DoNotOptimize(forked);
+  }
+}
+BENCHMARK(BM_Context_Fork)->Range(1, 4096);
+
+/**
+ * Insert distinct assertions into an empty AssertionList.
+ */
+static void BM_AssertionList_Insert(benchmark::State& state) {
+  auto assertions = make_assertions(state.range(0));
+
+  for (auto _ : state) {
+    AssertionList list;
+    for (const auto& assertion : assertions)
+      list.insert(assertion);
+    benchmark::DoNotOptimize(list);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AssertionList_Insert)->Range(8, 4096);
+
+/**
+ * Insert assertions which are all already present within the list so that
+ * every insert is rejected as a duplicate.
+ */
+static void BM_AssertionList_InsertDuplicate(benchmark::State& state) {
+  auto assertions = make_assertions(state.range(0));
+  AssertionList list{assertions};
+
+  for (auto _ : state) {
+    for (const auto& assertion : assertions)
+      list.insert(assertion);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AssertionList_InsertDuplicate)->Range(8, 4096);
@@ -0,0 +1,119 @@
+#include "caffeine/Memory/Allocator.h"
+#include "caffeine/Memory/MemHeap.h"
+
+#include <benchmark/benchmark.h>
+#include <llvm/IR/DataLayout.h>
+
+#include <vector>
+
+using namespace caffeine;
+
+// LLVM data layout string for x64_64-pc-linux-gnu
+static const char* const X86_64_LINUX =
+    "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128";
+
+static Allocation make_allocation(uint64_t size) {
+  auto size_op = ConstantInt::Create(llvm::APInt(64, size));
+  auto data = AllocOp::Create(size_op, ConstantInt::Create(llvm::APInt(8, 0)));
+
+  return Allocation(ConstantInt::Create(llvm::APInt(64, 0x1000)), size_op,
+                    data, AllocationKind::Malloc,
+                    AllocationPermissions::ReadWrite);
+}
+
+/**
+ * Write a sequence of i32 values into a fresh allocation. The argument is the
+ * number of writes which is also the length of the resulting store chain.
+ */
+static void BM_Allocation_Write(benchmark::State& state) {
+  llvm::DataLayout layout{X86_64_LINUX};
+  const Allocation base = make_allocation(1024);
+  auto value = Constant::Create(Type::int_ty(32), "value");
+
+  for (auto _ : state) {
+    Allocation alloc = base;
+    for (int64_t i = 0; i < state.range(0); ++i)
+      alloc.write(ConstantInt::Create(llvm::APInt(64, (i * 4) % 1024)), value,
+                  layout);
+    benchmark::DoNotOptimize(alloc.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Allocation_Write)->Range(1, 256);
+
+/**
+ * Read i32 values from an allocation which has had a number of symbolic
+ * values written to it at concrete offsets.
+ */
+static void BM_Allocation_Read(benchmark::State& state) {
+  llvm::DataLayout layout{X86_64_LINUX};
+  Allocation alloc = make_allocation(1024);
+
+  for (int64_t i = 0; i < state.range(0); ++i)
+    alloc.write(ConstantInt::Create(llvm::APInt(64, (i * 4) % 1024)),
+                Constant::Create(Type::int_ty(32), i), layout);
+
+  int64_t offset = 0;
+  for (auto _ : state) {
+    auto value =
+        alloc.read(ConstantInt::Create(llvm::APInt(64, offset)),
+                   Type::int_ty(32), layout);
+    benchmark::DoNotOptimize(value);
+    offset = (offset + 4) % 1024;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Allocation_Read)->Range(1, 256);
+
+/**
+ * Read from an allocation at a symbolic offset. The resulting expression has
+ * to cover every byte that could be read.
+ */
+static void BM_Allocation_ReadSymbolic(benchmark::State& state) {
+  llvm::DataLayout layout{X86_64_LINUX};
+  Allocation alloc = make_allocation(1024);
+  auto offset = Constant::Create(Type::int_ty(64), "offset");
+
+  for (int64_t i = 0; i < state.range(0); ++i)
+    alloc.write(ConstantInt::Create(llvm::APInt(64, (i * 4) % 1024)),
+                Constant::Create(Type::int_ty(32), i), layout);
+
+  for (auto _ : state) {
+    auto value = alloc.read(offset, Type::int_ty(32), layout);
+    benchmark::DoNotOptimize(value);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Allocation_ReadSymbolic)->Range(1, 256);
+
+/**
+ * Allocate a number of differently-sized blocks from a BuddyAllocator and then
+ * free them all again.
+ */
+static void BM_BuddyAllocator_Allocate(benchmark::State& state) {
+  llvm::APInt align(64, 16);
+  std::vector<llvm::APInt> sizes;
+  for (int64_t i = 0; i < state.range(0); ++i)
+    sizes.emplace_back(64, 16 << (i % 8));
+
+  std::vector<llvm::APInt> addrs;
+  addrs.reserve(sizes.size());
+
+  for (auto _ : state) {
+    BuddyAllocator allocator{llvm::APInt(64, 0x10000),
+                             llvm::APInt(64, UINT64_C(1) << 32)};
+
+    for (const auto& size : sizes)
+      addrs.push_back(*allocator.allocate(size, align));
+    for (const auto& addr : addrs)
+      allocator.deallocate(addr);
+
+    addrs.clear();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuddyAllocator_Allocate)->Range(8, 1024);
@@ -0,0 +1,92 @@
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/Interpreter/AssertionList.h"
+#include "caffeine/Query/ConstraintSlicer.h"
+#include "src/Solver/Z3Solver.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace caffeine;
+
+/**
+ * Slice an assertion list made up of many independent groups of assertions.
+ * Only the assertions sharing symbols with the unproven assertion should be
+ * kept.
+ */
+static void BM_ConstraintSlicer_Slice(benchmark::State& state) {
+  AssertionList assertions;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    // Assertions are arranged in groups of 4 that share a symbol.
+    auto x = Constant::Create(Type::int_ty(32), i / 4);
+    auto y = Constant::Create(Type::int_ty(32), i);
+    assertions.insert(Assertion(ICmpOp::CreateICmpULT(x, y)));
+  }
+  assertions.mark_sat();
+  assertions.insert(Assertion(ICmpOp::CreateICmpNE(
+      Constant::Create(Type::int_ty(32), (uint64_t)0),
+      ConstantInt::Create(llvm::APInt(32, 5)))));
+
+  ConstraintSlicer slicer;
+  for (auto _ : state) {
+    auto sliced = slicer.slice(assertions, Assertion::constant(true));
+    benchmark::DoNotOptimize(sliced);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ConstraintSlicer_Slice)->Range(8, 4096);
+
+static OpRef make_translate_expr(int64_t size) {
+  auto expr = Constant::Create(Type::int_ty(32), "x");
+  for (int64_t i = 0; i < size; ++i) {
+    auto c = ConstantInt::Create(llvm::APInt(32, i + 1));
+    auto y = Constant::Create(Type::int_ty(32), i);
+    expr = i % 2 == 0 ? BinaryOp::CreateMul(BinaryOp::CreateAdd(expr, y), c)
+                      : BinaryOp::CreateXor(BinaryOp::CreateSub(expr, c), y);
+  }
+  return expr;
+}
+
+/**
+ * Translate an expression into a z3 expression. The argument is the number
+ * of nodes within the expression. The translation cache is recreated every
+ * iteration so that nothing is cached between iterations.
+ */
+static void BM_Z3OpVisitor_Translate(benchmark::State& state) {
+  auto expr = make_translate_expr(state.range(0));
+  z3::context ctx;
+
+  for (auto _ : state) {
+    Z3TranslationCache cache{ctx};
+    Z3OpVisitor visitor{cache};
+    auto result = visitor.visit(*expr);
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Z3OpVisitor_Translate)->Range(8, 1024);
+
+/**
+ * Translate an expression that differs from the previous one by only a single
+ * new node, as happens when the same path is queried repeatedly with one more
+ * constraint each time. Only the new node needs to be translated since the
+ * rest is already in the translation cache.
+ */
+static void BM_Z3OpVisitor_TranslateCached(benchmark::State& state) {
+  auto expr = make_translate_expr(state.range(0));
+  z3::context ctx;
+  Z3TranslationCache cache{ctx};
+  Z3OpVisitor{cache}.visit(*expr);
+
+  uint32_t i = 0;
+  for (auto _ : state) {
+    auto query = BinaryOp::CreateAdd(
+        expr, ConstantInt::Create(llvm::APInt(32, ++i)));
+    Z3OpVisitor visitor{cache};
+    auto result = visitor.visit(*query);
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Z3OpVisitor_TranslateCached)->Range(8, 1024);
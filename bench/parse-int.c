@@ -0,0 +1,48 @@
+
+#include "caffeine.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Parser benchmark. Parses a decimal integer with an optional sign and
+ * overflow checking out of a symbolic string. Every character can either end
+ * the number or continue it so the number of paths grows with the length of
+ * the input.
+ */
+
+#define LEN 8
+
+static bool parse_int(const char* str, int32_t* out) {
+  bool negative = false;
+  int64_t value = 0;
+  int i = 0;
+
+  if (str[i] == '-' || str[i] == '+') {
+    negative = str[i] == '-';
+    i++;
+  }
+
+  if (str[i] < '0' || str[i] > '9')
+    return false;
+
+  for (; i < LEN && str[i] != '\0'; ++i) {
+    if (str[i] < '0' || str[i] > '9')
+      return false;
+
+    value = value * 10 + (str[i] - '0');
+    if (value > INT32_MAX + (int64_t)negative)
+      return false;
+  }
+
+  *out = negative ? (int32_t)-value : (int32_t)value;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  char str[LEN];
+  caffeine_make_symbolic(str, sizeof(str), "str");
+
+  int32_t value;
+  if (parse_int(str, &value))
+    caffeine_assert(value != -4096);
+}
@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+"""
+Runs caffeine over a set of benchmark programs and records how it performed.
+
+Each benchmark is run once for every combination of thread count and context
+store. For each run we record the wall time, the number of paths explored, the
+time spent in the solver, and the peak RSS of the caffeine process. The results
+are written out as a JSON report which can be compared against a baseline
+report from an earlier run to see how a change affected performance.
+
+Usage:
+  run-benchmarks.py --caffeine <path> [options] <benchmark.ll>...
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+REPORT_VERSION = 1
+
+# Metrics where a larger value is worse. Paths explored is recorded but is not
+# compared since exploring more paths in the same time is not a regression.
+COMPARED_METRICS = ["wall_time_s", "solver_time_s", "peak_rss_kb"]
+
+
+def stderr(*args):
+    print(*args, file=sys.stderr)
+
+
+def split_list(value):
+    """Split a list given as either a CMake list or a comma-separated list."""
+    return [item for item in value.replace(";", ",").split(",") if item]
+
+
+def benchmark_name(path):
+    name = os.path.splitext(os.path.basename(path))[0]
+    if name.startswith("bench-"):
+        name = name[len("bench-"):]
+    return name
+
+
+def stat_value(stats, name, field=None):
+    value = stats.get(name)
+    if value is None:
+        return 0
+    if field is not None:
+        return value.get(field, 0)
+    return value
+
+
+def run_once(args, benchmark, threads, store):
+    """Run caffeine once and return the measurements for that run."""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        stats_file = os.path.join(tmpdir, "stats.json")
+        command = [
+            args.caffeine,
+            "-t", str(threads),
+            "--store", store,
+            "--stats", stats_file,
+            "--stats-interval", "0",
+            benchmark,
+        ]
+
+        with open(os.devnull, "w") as devnull:
+            start = time.perf_counter()
+            proc = subprocess.Popen(command, stdout=devnull, stderr=devnull)
+
+            timed_out = False
+            while True:
+                pid, status, rusage = os.wait4(proc.pid, os.WNOHANG)
+                if pid != 0:
+                    break
+                if args.timeout and time.perf_counter() - start > args.timeout:
+                    proc.kill()
+                    pid, status, rusage = os.wait4(proc.pid, 0)
+                    timed_out = True
+                    break
+                time.sleep(0.005)
+            wall_time = time.perf_counter() - start
+
+        # Prevent Popen from trying to reap the process again.
+        if os.WIFSIGNALED(status):
+            proc.returncode = -os.WTERMSIG(status)
+        else:
+            proc.returncode = os.WEXITSTATUS(status)
+
+        stats = {}
+        if os.path.exists(stats_file):
+            with open(stats_file) as file:
+                stats = json.load(file)
+
+    # Exit codes 0 and 1 mean that caffeine finished and did or didn't find a
+    # failure. Anything else is a crash or an internal error.
+    ok = not timed_out and proc.returncode in (0, 1)
+
+    return {
+        "ok": ok,
+        "timed_out": timed_out,
+        "exit_code": proc.returncode,
+        "wall_time_s": wall_time,
+        "paths": stat_value(stats, "executor.paths_started"),
+        "instructions": stat_value(stats, "interpreter.instructions"),
+        "solver_queries": stat_value(stats, "solver.z3.queries"),
+        "solver_time_s": stat_value(stats, "solver.z3.time_ns", "sum") / 1e9,
+        # ru_maxrss is in kilobytes on Linux
+        "peak_rss_kb": rusage.ru_maxrss,
+    }
+
+
+def run_benchmark(args, benchmark, threads, store):
+    """Run a configuration repeatedly and combine the results."""
+    runs = [run_once(args, benchmark, threads, store)
+            for _ in range(args.repeat)]
+
+    failed = [run for run in runs if not run["ok"]]
+    if failed:
+        result = dict(failed[0])
+    else:
+        # Use the median to reduce the impact of noise from other processes.
+        result = {}
+        for key in runs[0]:
+            values = [run[key] for run in runs]
+            if isinstance(values[0], bool):
+                result[key] = all(values)
+            elif key == "exit_code":
+                result[key] = values[0]
+            else:
+                result[key] = statistics.median(values)
+
+    result.update({
+        "benchmark": benchmark_name(benchmark),
+        "threads": threads,
+        "store": store,
+        "repeat": args.repeat,
+    })
+    return result
+
+
+def result_key(result):
+    return (result["benchmark"], result["threads"], result["store"])
+
+
+def format_delta(old, new):
+    if old == 0:
+        return "n/a" if new == 0 else "new"
+    return "{:+.1f}%".format((new - old) / old * 100.0)
+
+
+def compare(results, baseline, threshold):
+    """
+    Print a table comparing results to the baseline and return the list of
+    regressions that exceed the threshold.
+    """
+    base = {result_key(result): result for result in baseline["results"]}
+    regressions = []
+
+    header = "{:<24} {:>3} {:<13} {:>10} {:>9} {:>10} {:>9} {:>10} {:>9}"
+    row = "{:<24} {:>3} {:<13} {:>10.3f} {:>9} {:>10.3f} {:>9} {:>10} {:>9}"
+    print(header.format("benchmark", "t", "store", "wall (s)", "delta",
+                        "solver (s)", "delta", "rss (KB)", "delta"))
+
+    for result in results:
+        old = base.get(result_key(result))
+        if old is None or not old["ok"] or not result["ok"]:
+            print(row.format(result["benchmark"], result["threads"],
+                             result["store"], result["wall_time_s"], "-",
+                             result["solver_time_s"], "-",
+                             int(result["peak_rss_kb"]), "-"))
+            continue
+
+        print(row.format(
+            result["benchmark"], result["threads"], result["store"],
+            result["wall_time_s"],
+            format_delta(old["wall_time_s"], result["wall_time_s"]),
+            result["solver_time_s"],
+            format_delta(old["solver_time_s"], result["solver_time_s"]),
+            int(result["peak_rss_kb"]),
+            format_delta(old["peak_rss_kb"], result["peak_rss_kb"])))
+
+        for metric in COMPARED_METRICS:
+            if old[metric] > 0 and \
+                    result[metric] > old[metric] * (1.0 + threshold):
+                regressions.append((result_key(result), metric,
+                                    old[metric], result[metric]))
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Run caffeine benchmarks and compare them to a baseline")
+    parser.add_argument("benchmarks", nargs="+", metavar="benchmark.ll",
+                        help="benchmark programs to run")
+    parser.add_argument("--caffeine", required=True,
+                        help="path to the caffeine executable")
+    parser.add_argument("--threads", default="1",
+                        help="comma-separated thread counts [default = 1]")
+    parser.add_argument("--stores", default="thread-queue",
+                        help="comma-separated context stores "
+                             "[default = thread-queue]")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="number of times to run each configuration. "
+                             "The median is reported. [default = 3]")
+    parser.add_argument("--timeout", type=float, default=600,
+                        help="seconds before a run is killed. 0 means no "
+                             "limit. [default = 600]")
+    parser.add_argument("--output", default="bench-report.json",
+                        help="file to write the report to "
+                             "[default = bench-report.json]")
+    parser.add_argument("--baseline",
+                        help="report to compare the results against")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative increase that counts as a regression "
+                             "[default = 0.10]")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="overwrite the baseline with the new results")
+    parser.add_argument("--fail-on-regression", action="store_true",
+                        help="exit with an error if there are regressions")
+    args = parser.parse_args()
+
+    results = []
+    for benchmark in args.benchmarks:
+        for threads in split_list(args.threads):
+            for store in split_list(args.stores):
+                stderr("Running {} (threads = {}, store = {})".format(
+                    benchmark_name(benchmark), threads, store))
+                result = run_benchmark(args, benchmark, int(threads), store)
+                if not result["ok"]:
+                    stderr("  failed with exit code {}{}".format(
+                        result["exit_code"],
+                        " (timed out)" if result["timed_out"] else ""))
+                results.append(result)
+
+    report = {"version": REPORT_VERSION, "results": results}
+    with open(args.output, "w") as file:
+        json.dump(report, file, indent=2)
+        file.write("\n")
+    stderr("Wrote report to {}".format(args.output))
+
+    status = 0 if all(result["ok"] for result in results) else 1
+
+    if args.baseline and os.path.exists(args.baseline):
+        with open(args.baseline) as file:
+            baseline = json.load(file)
+
+        if baseline.get("version") != REPORT_VERSION:
+            stderr("Baseline has an unsupported version, skipping comparison")
+        else:
+            regressions = compare(results, baseline, args.threshold)
+            for key, metric, old, new in regressions:
+                stderr("Regression in {} ({} threads, {}): {} went from {:.3f} "
+                       "to {:.3f}".format(key[0], key[1], key[2], metric, old,
+                                          new))
+            if regressions and args.fail_on_regression:
+                status = 1
+
+    if args.update_baseline:
+        if not args.baseline:
+            stderr("--update-baseline requires --baseline")
+            return 2
+        with open(args.baseline, "w") as file:
+            json.dump(report, file, indent=2)
+            file.write("\n")
+        stderr("Updated baseline {}".format(args.baseline))
+
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,54 @@
+
+#include "caffeine.h"
+#include <stdint.h>
+
+/**
+ * State machine benchmark. Runs a symbolic input through a small tokenizer
+ * for the start of an HTTP request line. Most inputs get stuck in the error
+ * state early so exploration is dominated by the switch dispatch and the
+ * forks at each transition.
+ */
+
+#define LEN 12
+
+enum state {
+  START,
+  METHOD,
+  SPACE,
+  PATH,
+  VERSION,
+  ACCEPT,
+  ERROR,
+};
+
+static enum state step(enum state state, char c) {
+  switch (state) {
+  case START:
+    return c >= 'A' && c <= 'Z' ? METHOD : ERROR;
+  case METHOD:
+    if (c >= 'A' && c <= 'Z')
+      return METHOD;
+    return c == ' ' ? SPACE : ERROR;
+  case SPACE:
+    return c == '/' ? PATH : ERROR;
+  case PATH:
+    if (c == ' ')
+      return VERSION;
+    return c > ' ' && c < 127 ? PATH : ERROR;
+  case VERSION:
+    return c == 'H' ? ACCEPT : ERROR;
+  default:
+    return state;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  char input[LEN];
+  caffeine_make_symbolic(input, sizeof(input), "input");
+
+  enum state state = START;
+  for (int i = 0; i < LEN && state != ERROR; ++i)
+    state = step(state, input[i]);
+
+  caffeine_assert(state != ACCEPT);
+}
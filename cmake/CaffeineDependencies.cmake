@@ -141,3 +141,16 @@ caffeine_dependency(
     "${CMAKE_SOURCE_DIR}/cmake/AFLplusplus.patch"
     -P "${CMAKE_SOURCE_DIR}/cmake/CaffeinePatch.cmake"
 )
+
+if (CAFFEINE_ENABLE_MICROBENCHMARKS)
+  caffeine_dependency(
+    benchmark      1.5
+    GIT_REPOSITORY https://github.com/google/benchmark
+    GIT_TAG        v1.5.5
+    GIT_SHALLOW    TRUE
+    CMAKE_CACHE_ARGS
+      -DBENCHMARK_ENABLE_TESTING:BOOL=FALSE
+      -DBENCHMARK_ENABLE_GTEST_TESTS:BOOL=FALSE
+      -DBENCHMARK_ENABLE_INSTALL:BOOL=TRUE
+  )
+endif()
@@ -395,6 +395,31 @@ public:
     return const_iterator(this, index);
   }
 
+  /**
+   * Find the value stored in the slot at index, whatever the generation of
+   * that slot currently is. Returns end() if the slot is empty.
+   *
+   * Together with slot() this allows a key to be recorded as just its index
+   * when it is known that the slot has not been reused in the meantime.
+   */
+  iterator find_slot(size_t index) {
+    if (index >= entries_.size() || !entries_[index].has_value)
+      return end();
+    return iterator(this, index);
+  }
+  const_iterator find_slot(size_t index) const {
+    if (index >= entries_.size() || !entries_[index].has_value)
+      return end();
+    return const_iterator(this, index);
+  }
+
+  /**
+   * The index of the slot that key refers to.
+   */
+  static constexpr size_t slot(const key_type& key) {
+    return unpack_key(key).first;
+  }
+
 private:
   size_t next_slot() {
     if (head == no_head) {
@@ -207,7 +207,10 @@ protected:
                              FixedData, ConstantData, llvm::Function*>;
 
   uint16_t opcode_;
-  uint16_t dummy_ = 0; // Unused, used for padding
+  // Saturating depth and tree size of the expression rooted at this node.
+  // These fit within what would otherwise be padding before type_.
+  uint16_t depth_ = 1;
+  uint32_t tree_size_ = 1;
 
   Type type_;
   Inner inner_;
@@ -230,6 +233,9 @@ protected:
 
   using CopyVTable::copy_vtable;
 
+private:
+  void compute_metrics();
+
 public:
   /**
    * Indicate whether this Operation instance is valid.
@@ -247,9 +253,30 @@ public:
   std::string_view opcode_name() const;
   static std::string_view opcode_name(Opcode op);
 
+  // The number of new operations that have been created on the current thread,
+  // not counting those that were already present in the operation cache.
+  static uint64_t num_created_on_thread();
+
   // The type of this operation node.
   Type type() const;
 
+  /**
+   * The depth of the expression tree rooted at this node. Nodes without any
+   * operands have a depth of 1. Saturates at UINT16_MAX.
+   */
+  uint16_t depth() const;
+
+  /**
+   * The number of nodes within the expression tree rooted at this node.
+   * Subexpressions that are shared are counted once for every time they are
+   * used so this is an upper bound on the number of distinct nodes. Saturates
+   * at UINT32_MAX.
+   *
+   * Together with depth this is a cheap estimate of how expensive an
+   * expression will be to work with.
+   */
+  uint32_t tree_size() const;
+
   /**
    * Go from a pointer/cpp reference to a ref.
    *
@@ -676,8 +703,23 @@ public:
   const OpRef& data() const;
   const OpRef& offset() const;
 
+  /**
+   * Creating a load folds it through any stores that it provably doesn't
+   * overlap with (see compare_offsets). If it reaches a store to the same
+   * offset then the stored value is returned instead.
+   */
   static OpRef Create(const OpRef& data, const OpRef& offset);
 
+  enum class Alias { Equal, Distinct, Unknown };
+
+  /**
+   * Check whether two offsets into an array are provably equal, provably
+   * distinct, or neither. This is purely syntactic: it handles offsets that
+   * are both constants or that are the same expression plus different
+   * constants.
+   */
+  static Alias compare_offsets(const OpRef& a, const OpRef& b);
+
   static bool classof(const Operation* op);
 };
 
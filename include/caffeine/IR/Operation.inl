@@ -163,6 +163,13 @@ inline Type Operation::type() const {
   return type_;
 }
 
+inline uint16_t Operation::depth() const {
+  return depth_;
+}
+inline uint32_t Operation::tree_size() const {
+  return tree_size_;
+}
+
 inline bool Operation::is_constant() const {
   return detail::opcode_base(opcode_) == 1;
 }
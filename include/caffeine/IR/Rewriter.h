@@ -0,0 +1,101 @@
+#pragma once
+
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Transforms.h"
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace caffeine::transforms {
+
+/**
+ * A single rewrite rule.
+ *
+ * A rule looks at one expression node (whose operands are assumed to already
+ * be fully rewritten) and either returns an equivalent expression that is
+ * simpler in some way or a null reference if it doesn't apply. Rules must
+ * preserve the value of the expression for every possible model.
+ *
+ * Rules are dispatched on the opcode of the node. Rules for integer
+ * comparisons should use Operation::ICmpEq; they are tried for every
+ * comparison predicate. Rules with an opcode of Operation::Invalid are tried
+ * on every node.
+ */
+struct RewriteRule {
+  std::string_view name;
+  Operation::Opcode opcode;
+  OpRef (*apply)(const OpRef& expr);
+};
+
+/**
+ * Rule-based expression rewriter.
+ *
+ * The rewriter applies its rules bottom-up over an expression DAG until no
+ * more rules apply. Every distinct node is only rewritten once per rewriter
+ * so it is cheap to rewrite a set of expressions that share a lot of structure
+ * (e.g. all the assertions within a context) with the same rewriter.
+ *
+ * There are two ways to use it:
+ * - rewrite takes an arbitrary expression and rewrites the whole DAG.
+ * - rewrite_node only rewrites the root node. This is meant to be used on
+ *   freshly created nodes whose operands are already in rewritten form so
+ *   that expressions can be kept simplified as they are being built up.
+ *
+ * The default rule set (see default_rules) covers bitvector identities that
+ * show up when values round-trip through memory: byte extraction and
+ * reassembly via shifts and masks, zext/trunc chains, and comparison
+ * normalization. Loads through stores are already resolved when the load is
+ * created (see LoadOp::Create).
+ */
+class Rewriter {
+public:
+  Rewriter();
+  explicit Rewriter(llvm::ArrayRef<RewriteRule> rules);
+
+  OpRef rewrite(const OpRef& expr);
+  OpRef rewrite_node(const OpRef& expr);
+
+  /**
+   * Rewrite all the assertions within the list that haven't been proven yet.
+   * Proven assertions will have already been rewritten when they were added.
+   *
+   * Returns whether any assertions were changed.
+   */
+  bool rewrite(AssertionList& assertions);
+
+  // Forget all the memoized results.
+  void clear() {
+    cache_.clear();
+  }
+  // The number of memoized results.
+  size_t cache_size() const {
+    return cache_.size();
+  }
+
+  static llvm::ArrayRef<RewriteRule> default_rules();
+
+  OpRef operator()(const OpRef& expr) {
+    return rewrite_node(expr);
+  }
+
+private:
+  // Rules grouped by the opcode they apply to. This is immutable once built
+  // so rewriters with the same rules can share one.
+  struct RuleTable {
+    std::vector<std::vector<RewriteRule>> by_opcode;
+    std::vector<RewriteRule> generic;
+
+    explicit RuleTable(llvm::ArrayRef<RewriteRule> rules);
+  };
+
+  OpRef apply_rules(const OpRef& expr) const;
+
+  std::shared_ptr<const RuleTable> rules_;
+  RebuildCache cache_;
+  size_t depth_ = 0;
+};
+
+} // namespace caffeine::transforms
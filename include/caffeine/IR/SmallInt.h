@@ -0,0 +1,179 @@
+#pragma once
+
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Support/Assert.h"
+
+#include <llvm/ADT/APInt.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+namespace caffeine {
+
+/**
+ * An integer of at most 64 bits stored inline along with its bitwidth.
+ *
+ * llvm::APInt keeps values of up to 64 bits inline as well but every
+ * operation on it still needs to check which representation is in use and
+ * many of them (comparisons, division, shifting by another APInt) end up as
+ * out-of-line calls. Almost all the constants we see are at most 64 bits wide
+ * so the hot paths (constant folding and compiled model evaluation) use
+ * SmallInt whenever all of their operands fit and only fall back to APInt for
+ * wider values.
+ *
+ * The value is always kept zero-extended to 64 bits. Operations that would
+ * fault or are undefined in C++ (division by zero, signed division overflow,
+ * oversized shifts) give the same results as the corresponding methods on
+ * Value.
+ */
+class SmallInt {
+public:
+  static constexpr uint32_t MaxWidth = 64;
+
+  SmallInt(uint64_t value, uint32_t width)
+      : value_(value & mask(width)), width_(width) {}
+
+  // Returns std::nullopt if the APInt is wider than 64 bits.
+  static std::optional<SmallInt> from(const llvm::APInt& value) {
+    if (value.getBitWidth() > MaxWidth)
+      return std::nullopt;
+    return SmallInt(value.getZExtValue(), value.getBitWidth());
+  }
+
+  llvm::APInt apint() const {
+    return llvm::APInt(width_, value_);
+  }
+
+  uint64_t value() const {
+    return value_;
+  }
+  int64_t svalue() const {
+    return sign_extend(value_, width_);
+  }
+  uint32_t width() const {
+    return width_;
+  }
+
+  bool operator==(const SmallInt& other) const {
+    return value_ == other.value_ && width_ == other.width_;
+  }
+  bool operator!=(const SmallInt& other) const {
+    return !(*this == other);
+  }
+
+  static uint64_t mask(uint32_t width) {
+    return width >= 64 ? ~UINT64_C(0) : (UINT64_C(1) << width) - 1;
+  }
+  static int64_t sign_extend(uint64_t value, uint32_t width) {
+    unsigned shift = 64 - width;
+    return (int64_t)(value << shift) >> shift;
+  }
+
+  static SmallInt add(SmallInt a, SmallInt b) {
+    return {a.value_ + b.value_, a.width_};
+  }
+  static SmallInt sub(SmallInt a, SmallInt b) {
+    return {a.value_ - b.value_, a.width_};
+  }
+  static SmallInt mul(SmallInt a, SmallInt b) {
+    return {a.value_ * b.value_, a.width_};
+  }
+  static SmallInt bvand(SmallInt a, SmallInt b) {
+    return {a.value_ & b.value_, a.width_};
+  }
+  static SmallInt bvor(SmallInt a, SmallInt b) {
+    return {a.value_ | b.value_, a.width_};
+  }
+  static SmallInt bvxor(SmallInt a, SmallInt b) {
+    return {a.value_ ^ b.value_, a.width_};
+  }
+  static SmallInt bvnot(SmallInt a) {
+    return {~a.value_, a.width_};
+  }
+
+  static SmallInt udiv(SmallInt a, SmallInt b) {
+    if (b.value_ == 0)
+      return {~UINT64_C(0), a.width_};
+    return {a.value_ / b.value_, a.width_};
+  }
+  static SmallInt sdiv(SmallInt a, SmallInt b) {
+    int64_t x = a.svalue(), y = b.svalue();
+    int64_t min = sign_extend(UINT64_C(1) << (a.width_ - 1), a.width_);
+    // Both division by zero and overflow give the signed max value.
+    if (y == 0 || (x == min && y == -1))
+      return {mask(a.width_) >> 1, a.width_};
+    return {(uint64_t)(x / y), a.width_};
+  }
+  static SmallInt urem(SmallInt a, SmallInt b) {
+    if (b.value_ == 0)
+      return a;
+    return {a.value_ % b.value_, a.width_};
+  }
+  static SmallInt srem(SmallInt a, SmallInt b) {
+    int64_t x = a.svalue(), y = b.svalue();
+    if (y == 0)
+      return a;
+    if (y == -1)
+      return {0, a.width_};
+    return {(uint64_t)(x % y), a.width_};
+  }
+
+  // Shifting by at least the bitwidth shifts out every bit.
+  static SmallInt shl(SmallInt a, SmallInt b) {
+    if (b.value_ >= a.width_)
+      return {0, a.width_};
+    return {a.value_ << b.value_, a.width_};
+  }
+  static SmallInt lshr(SmallInt a, SmallInt b) {
+    if (b.value_ >= a.width_)
+      return {0, a.width_};
+    return {a.value_ >> b.value_, a.width_};
+  }
+  static SmallInt ashr(SmallInt a, SmallInt b) {
+    uint64_t amount = std::min<uint64_t>(b.value_, a.width_ - 1);
+    return {(uint64_t)(a.svalue() >> amount), a.width_};
+  }
+
+  static SmallInt trunc(SmallInt a, uint32_t width) {
+    return {a.value_, width};
+  }
+  static SmallInt zext(SmallInt a, uint32_t width) {
+    return {a.value_, width};
+  }
+  static SmallInt sext(SmallInt a, uint32_t width) {
+    return {(uint64_t)a.svalue(), width};
+  }
+
+  static bool icmp(ICmpOpcode cmp, SmallInt a, SmallInt b) {
+    switch (cmp) {
+    case ICmpOpcode::EQ:
+      return a.value_ == b.value_;
+    case ICmpOpcode::NE:
+      return a.value_ != b.value_;
+    case ICmpOpcode::UGT:
+      return a.value_ > b.value_;
+    case ICmpOpcode::UGE:
+      return a.value_ >= b.value_;
+    case ICmpOpcode::ULT:
+      return a.value_ < b.value_;
+    case ICmpOpcode::ULE:
+      return a.value_ <= b.value_;
+    case ICmpOpcode::SGT:
+      return a.svalue() > b.svalue();
+    case ICmpOpcode::SGE:
+      return a.svalue() >= b.svalue();
+    case ICmpOpcode::SLT:
+      return a.svalue() < b.svalue();
+    case ICmpOpcode::SLE:
+      return a.svalue() <= b.svalue();
+    }
+    CAFFEINE_UNREACHABLE("unknown ICmpOpcode");
+  }
+
+private:
+  uint64_t value_;
+  uint32_t width_;
+};
+
+} // namespace caffeine
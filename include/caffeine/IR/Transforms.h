@@ -31,6 +31,8 @@
 
 #include "caffeine/IR/Operation.h"
 #include "caffeine/Interpreter/AssertionList.h"
+#include <llvm/ADT/STLExtras.h>
+#include <unordered_map>
 #include <vector>
 
 namespace caffeine {
@@ -54,11 +56,73 @@ void canonicalize(AssertionList& assertions);
  */
 void simplify(AssertionList& assertions);
 
+/**
+ * Rewrite the unproven assertions using the default rule set of
+ * transforms::Rewriter (see caffeine/IR/Rewriter.h).
+ */
+void rewrite(AssertionList& assertions);
+
+/**
+ * Resolve loads within an expression through stores whose offsets can't be
+ * compared syntactically (see LoadOp::compare_offsets).
+ *
+ * For each such store the oracle is asked whether the store offset and the
+ * load offset are equal or distinct under whatever it knows (usually the
+ * path condition). The oracle is consulted at most max_queries times; once
+ * that runs out or the oracle returns Unknown the load is left in place.
+ */
+OpRef forward_loads(
+    const OpRef& expr,
+    llvm::function_ref<LoadOp::Alias(const OpRef&, const OpRef&)> oracle,
+    size_t max_queries);
+
+/**
+ * Memo table used by rebuild to avoid visiting shared subexpressions more than
+ * once. It maps each expression node that has been visited to the result of
+ * rebuilding it.
+ *
+ * The cache holds a reference to every node it has seen so entries can't be
+ * invalidated by a node being freed and its address being reused. A cache is
+ * only valid for a single visitor: reusing it with a visitor that performs a
+ * different transform will return stale results.
+ */
+class RebuildCache {
+public:
+  RebuildCache() = default;
+
+  const OpRef* lookup(const Operation* expr) const;
+  void insert(const OpRef& expr, const OpRef& result);
+
+  size_t size() const {
+    return entries_.size();
+  }
+  void clear() {
+    entries_.clear();
+  }
+
+private:
+  struct Entry {
+    OpRef expr;
+    OpRef result;
+  };
+
+  std::unordered_map<const Operation*, Entry> entries_;
+};
+
 /**
  * Rebuild an expression tree using the transform applied by the visitor. This
  * will traverse the tree in a depth-first order and apply the transform to each
  * node. If no changes are made then existing expression nodes will be reused.
  *
+ * Expressions are DAGs, not trees, so the visitor is called exactly once for
+ * each distinct node and the result is reused wherever else that node appears.
+ * This makes the cost of a rebuild linear in the number of distinct nodes
+ * instead of the number of paths through the DAG. The traversal uses an
+ * explicit stack so deep expressions can't overflow the call stack.
+ *
+ * Passing the same cache to multiple calls shares work between them as long as
+ * the visitor performs the same transform each time.
+ *
  * This is primarily useful as a building block towards more advanced
  * transformations.
  */
@@ -66,6 +130,8 @@ template <typename Visitor>
 OpRef rebuild(const OpRef& expression, Visitor& visitor);
 template <typename Visitor>
 OpRef rebuild(const OpRef& expression, Visitor&& visitor);
+template <typename Visitor>
+OpRef rebuild(const OpRef& expression, Visitor& visitor, RebuildCache& cache);
 
 } // namespace caffeine::transforms
 
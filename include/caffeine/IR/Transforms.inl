@@ -5,32 +5,74 @@
 
 namespace caffeine::transforms {
 
+inline const OpRef* RebuildCache::lookup(const Operation* expr) const {
+  auto it = entries_.find(expr);
+  if (it == entries_.end())
+    return nullptr;
+  return &it->second.result;
+}
+inline void RebuildCache::insert(const OpRef& expr, const OpRef& result) {
+  entries_.insert_or_assign(expr.get(), Entry{expr, result});
+}
+
 template <typename Visitor>
-OpRef rebuild(const OpRef& expression, Visitor& visitor) {
-  size_t nops = expression->num_operands();
-  llvm::SmallVector<OpRef, 3> ops;
-  ops.reserve(nops);
+OpRef rebuild(const OpRef& expression, Visitor& visitor, RebuildCache& cache) {
+  if (const OpRef* result = cache.lookup(expression.get()))
+    return *result;
 
-  size_t same_count = 0;
+  struct Frame {
+    const OpRef* expr;
+    size_t index = 0;
+    bool changed = false;
+    llvm::SmallVector<OpRef, 3> ops;
 
-  for (size_t i = 0; i < nops; ++i) {
-    const OpRef& operand = expression->operand_at(i);
-    OpRef newexpr = rebuild(operand, visitor);
+    explicit Frame(const OpRef* expr) : expr(expr) {}
 
-    if (newexpr == operand) {
-      same_count += 1;
+    void push(const OpRef& operand, OpRef result) {
+      if (result != operand)
+        changed = true;
+
+      ops.push_back(std::move(result));
+      index += 1;
     }
+  };
 
-    ops.push_back(std::move(newexpr));
-  }
+  // Operand references stay valid while they're on the stack since their
+  // parent nodes are kept alive by the root expression.
+  llvm::SmallVector<Frame, 16> stack;
+  stack.emplace_back(&expression);
+
+  while (true) {
+    Frame& frame = stack.back();
+    const Operation& expr = **frame.expr;
 
-  if (same_count == ops.size()) {
-    return visitor(expression);
-  } else {
-    return visitor(expression->with_new_operands(ops));
+    if (frame.index < expr.num_operands()) {
+      const OpRef& operand = expr.operand_at(frame.index);
+      if (const OpRef* result = cache.lookup(operand.get()))
+        frame.push(operand, *result);
+      else
+        stack.emplace_back(&operand);
+      continue;
+    }
+
+    OpRef result = frame.changed ? visitor(expr.with_new_operands(frame.ops))
+                                 : visitor(*frame.expr);
+    cache.insert(*frame.expr, result);
+
+    const OpRef& original = *frame.expr;
+    stack.pop_back();
+    if (stack.empty())
+      return result;
+
+    stack.back().push(original, std::move(result));
   }
 }
 template <typename Visitor>
+OpRef rebuild(const OpRef& expression, Visitor& visitor) {
+  RebuildCache cache;
+  return rebuild(expression, visitor, cache);
+}
+template <typename Visitor>
 OpRef rebuild(const OpRef& expression, Visitor&& visitor) {
   return rebuild(expression, visitor);
 }
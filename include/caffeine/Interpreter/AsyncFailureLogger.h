@@ -0,0 +1,126 @@
+#pragma once
+
+#include "caffeine/Interpreter/FailureLogger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+class Instruction;
+} // namespace llvm
+
+namespace caffeine {
+
+/**
+ * Write the inputs for a failure as a KTest file (the test case format used by
+ * KLEE). Each input becomes one object. Array inputs are written as their
+ * bytes and integer inputs as their little-endian representation.
+ */
+void write_ktest(std::ostream& os, const FailureInputs& inputs);
+
+/**
+ * Failure logger which does as little work as possible on the thread that
+ * found the failure.
+ *
+ * The worker thread only evaluates the symbolic inputs under the model (since
+ * the model can't outlive the solver that created it) and takes a copy of the
+ * context. Everything else is done by a pool of background threads:
+ * - Each failure is written to the output directory (if there is one) as a
+ *   KTest file named test<N>.ktest.
+ * - Failures are deduplicated by the instruction that failed and the failure
+ *   message. The first failure for each is printed in full to the report
+ *   stream and later ones are only counted.
+ * - Once finish is called a summary of every distinct failure along with how
+ *   many times it occurred is printed to the report stream.
+ *
+ * If the background threads fall too far behind then logging a failure will
+ * block until they catch up so that memory usage stays bounded.
+ */
+class AsyncFailureLogger : public FailureLogger {
+public:
+  struct Options {
+    // Number of background threads.
+    size_t num_threads = 1;
+    // Maximum number of failures waiting to be processed.
+    size_t max_pending = 1024;
+    // Directory to write KTest files to. If empty then no test cases are
+    // written.
+    std::string output_dir;
+  };
+
+  AsyncFailureLogger(std::ostream& report, const Options& options);
+  ~AsyncFailureLogger();
+
+  void log_failure(const Model* model, const Context& context,
+                   const Failure& failure) override;
+
+  /**
+   * Wait for all pending failures to be processed, stop the background threads
+   * and print the summary. No failures may be logged after this is called.
+   */
+  void finish();
+
+  // Number of failures that have been logged so far.
+  uint64_t num_failures() const {
+    return next_id_.load(std::memory_order_relaxed);
+  }
+  // Number of distinct failures among those that have been processed.
+  size_t num_unique() const;
+
+  AsyncFailureLogger(const AsyncFailureLogger&) = delete;
+  AsyncFailureLogger& operator=(const AsyncFailureLogger&) = delete;
+
+private:
+  struct Pending {
+    uint64_t id;
+    std::optional<FailureInputs> inputs;
+    Context context;
+    std::string message;
+  };
+
+  struct Key {
+    const llvm::Instruction* inst;
+    std::string message;
+
+    bool operator<(const Key& other) const;
+  };
+
+  struct Entry {
+    uint64_t count = 0;
+    // Id of the first failure with this key.
+    uint64_t first;
+    std::string location;
+  };
+
+  void run_worker();
+  void process(Pending& pending);
+
+  std::ostream* report_;
+  Options options_;
+
+  std::atomic<uint64_t> next_id_ = 0;
+
+  mutable std::mutex mutex_;
+  std::condition_variable pending_cv_;
+  std::condition_variable space_cv_;
+  std::deque<Pending> pending_;
+  bool done_ = false;
+  bool finished_ = false;
+
+  std::map<Key, Entry> entries_;
+  std::vector<std::thread> threads_;
+
+  // Serializes writes to the report stream.
+  std::mutex report_mutex_;
+};
+
+} // namespace caffeine
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "caffeine/Solver/Solver.h"
+#include "caffeine/Support/Cancellation.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace caffeine {
+
+/**
+ * Limits on how much work an executor will do before stopping. A value of 0
+ * means that there is no limit.
+ */
+struct ExecutionLimits {
+  // Wall-clock time for the whole run.
+  std::chrono::milliseconds time{0};
+  // Number of instructions executed across all paths.
+  uint64_t instructions = 0;
+  // Number of contexts taken from the store and executed.
+  uint64_t paths = 0;
+  // Total time spent in solver queries across all threads.
+  std::chrono::milliseconds solver_time{0};
+
+  constexpr ExecutionLimits() = default;
+};
+
+/**
+ * Tracks the work done by all the interpreters run by an executor and cancels
+ * them once any of the limits has been reached.
+ *
+ * Interpreters poll exhausted() between instructions, and the Z3 solvers
+ * register with token() so that queries in progress are interrupted.
+ */
+class ExecutionBudget {
+public:
+  enum Reason {
+    // The budget has not run out.
+    None,
+    TimeLimit,
+    InstructionLimit,
+    PathLimit,
+    SolverTimeLimit,
+    // The external cancellation token was cancelled.
+    Cancelled
+  };
+
+  /**
+   * Create a budget with the given limits. If external is not null then
+   * cancelling it also cancels the budget.
+   */
+  explicit ExecutionBudget(const ExecutionLimits& limits,
+                           CancellationToken* external = nullptr);
+  ~ExecutionBudget();
+
+  /**
+   * Start the clock for the time limit. This starts a background thread that
+   * cancels the budget once the time limit is reached.
+   */
+  void start();
+  /**
+   * Stop the background thread started by start. This is also done by the
+   * destructor.
+   */
+  void finish();
+
+  CancellationToken& token() {
+    return token_;
+  }
+  bool exhausted() const {
+    return token_.is_cancelled();
+  }
+  // Why the budget ran out. Returns None if it hasn't.
+  Reason reason() const {
+    return reason_.load(std::memory_order_acquire);
+  }
+
+  // Stop execution for the given reason. Only the first reason is kept.
+  void stop(Reason reason);
+
+  // Record that count instructions have been executed.
+  void charge_instructions(uint64_t count);
+  // Record that a path is about to be executed. Returns false if doing so
+  // would exceed the path limit, in which case the path should not be run.
+  bool charge_path();
+  // Record time spent in a solver query.
+  void charge_solver_time(std::chrono::nanoseconds time);
+
+  /**
+   * Wrap a solver so that the time spent in its queries counts against the
+   * solver time limit.
+   */
+  std::shared_ptr<Solver> wrap(std::shared_ptr<Solver> solver);
+
+  static const char* describe(Reason reason);
+
+  ExecutionBudget(const ExecutionBudget&) = delete;
+  ExecutionBudget& operator=(const ExecutionBudget&) = delete;
+
+private:
+  ExecutionLimits limits_;
+
+  CancellationToken token_;
+  CancellationToken::Registration external_;
+  std::atomic<Reason> reason_ = None;
+
+  std::atomic<uint64_t> instructions_ = 0;
+  std::atomic<uint64_t> paths_ = 0;
+  std::atomic<uint64_t> solver_ns_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable condvar_;
+  bool finished_ = false;
+  std::thread watchdog_;
+};
+
+} // namespace caffeine
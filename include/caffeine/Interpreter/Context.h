@@ -3,6 +3,7 @@
 
 #include "caffeine/IR/Assertion.h"
 #include "caffeine/Interpreter/AssertionList.h"
+#include "caffeine/Interpreter/DecisionLog.h"
 #include "caffeine/Interpreter/StackFrame.h"
 #include "caffeine/Memory/MemHeap.h"
 #include "caffeine/Solver/Solver.h"
@@ -21,6 +22,36 @@ class GlobalVariable;
 
 namespace caffeine {
 
+/**
+ * An estimate of how much memory a context is using, in bytes.
+ *
+ * The container fields count the memory used by that part of the context
+ * itself but not the expressions it refers to. Expressions are counted
+ * separately since they are shared between contexts. An expression node is
+ * considered unique to a context when every reference to it comes from within
+ * that context, so it would be freed if the context were dropped.
+ */
+struct ContextFootprint {
+  size_t stack = 0;
+  size_t heap = 0;
+  size_t assertions = 0;
+  // Globals, named constants and the decision log.
+  size_t other = 0;
+
+  size_t unique_exprs = 0;
+  size_t shared_exprs = 0;
+  size_t num_exprs = 0;
+
+  // Memory that would be freed if the context were dropped.
+  size_t unique() const {
+    return stack + heap + assertions + other + unique_exprs;
+  }
+  // All memory reachable from the context.
+  size_t total() const {
+    return unique() + shared_exprs;
+  }
+};
+
 class Context {
 public:
   std::vector<StackFrame> stack;
@@ -31,6 +62,28 @@ public:
 
   llvm::Module* mod;
 
+  /**
+   * Identifies this context among all those created while exploring the
+   * program. This is only assigned by stores that order contexts
+   * deterministically (see DeterministicContextStore) and is 0 otherwise.
+   */
+  uint64_t path_id = 0;
+
+  /**
+   * The choices made at every fork along the path that led to this context.
+   * Replaying these from the entry function rebuilds the context (see
+   * Executor::replay).
+   */
+  DecisionLog decisions;
+
+  /**
+   * The most recent footprint estimate for this context. This is only set
+   * when InterpreterOptions::track_footprint is enabled, in which case it is
+   * updated just before the context is passed to
+   * ExecutionPolicy::should_queue_path.
+   */
+  std::optional<ContextFootprint> footprint;
+
 private:
   uint64_t constant_num_ = 0;
 
@@ -88,6 +141,15 @@ public:
    */
   uint64_t next_constant();
 
+  /**
+   * Estimate how much memory this context is using.
+   *
+   * This walks every expression reachable from the context so it is linear
+   * in the size of the context's state and should not be called for every
+   * instruction.
+   */
+  ContextFootprint estimate_footprint() const;
+
   /**
    * Add a new assertion to this context.
    */
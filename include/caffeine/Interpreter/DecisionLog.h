@@ -0,0 +1,92 @@
+#pragma once
+
+#include <immer/vector.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace caffeine {
+
+/**
+ * The choices that a context made at each point where execution could have
+ * gone more than one way.
+ *
+ * A path through the program is fully determined by its decisions so this is
+ * enough to rebuild a context by running the entry function again and only
+ * following the recorded choices (see Executor::replay). The decisions that
+ * are recorded are
+ * - conditional branches on a non-constant condition: 0 for the true successor
+ *   and 1 for the false one,
+ * - switches on a non-constant condition: the index of the case that was
+ *   taken or the number of cases for the default destination,
+ * - resolving a pointer that wasn't already resolved: the slot of the chosen
+ *   allocation within its heap, and
+ * - calls to malloc or calloc when InterpreterOptions::malloc_can_return_null
+ *   is set: 1 if the call returned null and 0 otherwise.
+ *
+ * Some instructions (e.g. loads through an already resolved pointer) hand the
+ * context back to the store without making a decision. The log also counts how
+ * many times that has happened since the last decision so that a replay can
+ * stop at the same point.
+ *
+ * The decisions are kept in a persistent vector so forking a context doesn't
+ * copy them.
+ */
+class DecisionLog {
+public:
+  DecisionLog() = default;
+
+  void push_back(uint32_t decision);
+
+  /**
+   * Record that the context was put back into the store without making a
+   * decision.
+   */
+  void requeued() {
+    requeues_ += 1;
+  }
+  uint32_t requeues() const {
+    return requeues_;
+  }
+
+  size_t size() const {
+    return decisions_.size();
+  }
+  bool empty() const {
+    return decisions_.empty();
+  }
+
+  uint32_t operator[](size_t idx) const {
+    return decisions_[idx];
+  }
+
+  /**
+   * Whether this log and other made the same decisions from index start up to
+   * the end of the shorter of the two. The requeue counts are not compared.
+   */
+  bool agrees_with(const DecisionLog& other, size_t start = 0) const;
+
+  /**
+   * Append a compact encoding of this log to out. Decisions are written as
+   * LEB128 varints so most of them (and all branch decisions) take up a
+   * single byte.
+   */
+  void serialize(std::string& out) const;
+
+  /**
+   * Decode a log written by serialize from the front of in and advance in
+   * past it. Returns std::nullopt if in does not start with a valid log.
+   */
+  static std::optional<DecisionLog> deserialize(std::string_view& in);
+
+  bool operator==(const DecisionLog& other) const;
+  bool operator!=(const DecisionLog& other) const;
+
+private:
+  immer::vector<uint32_t> decisions_;
+  uint32_t requeues_ = 0;
+};
+
+} // namespace caffeine
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "caffeine/Interpreter/Context.h"
+#include "caffeine/Interpreter/DecisionLog.h"
+#include "caffeine/Interpreter/Executor.h"
+#include "caffeine/Support/Cancellation.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace caffeine {
+
+class ExecutionPolicy;
+
+/**
+ * Explores a program using several worker processes.
+ *
+ * The coordinator owns a frontier of paths that have yet to be explored. Each
+ * path is stored as its DecisionLog rather than as a full context so it only
+ * takes a few bytes and can be sent to any worker that has loaded the same
+ * module. Workers rebuild the context with Executor::replay and then explore
+ * everything below it on their own.
+ *
+ * Whenever a worker is idle and the frontier is empty the coordinator asks a
+ * busy worker to split its work. The busy worker sends back the decisions for
+ * half of the paths in its store and drops them locally.
+ *
+ * Failures are streamed back to the coordinator as they are found. They are
+ * deduplicated by the instruction that failed and the failure message in the
+ * same way as AsyncFailureLogger: the first failure for each is printed in
+ * full and a summary with the number of times each occurred is printed at
+ * the end.
+ *
+ * The coordinator talks to the workers over connected stream sockets (e.g.
+ * one end of a Unix domain socketpair). It is single threaded and does not
+ * care whether the workers are threads or processes.
+ */
+class DistributedCoordinator {
+public:
+  struct Options {
+    // Stop once this much time has passed. Workers are told to stop exploring
+    // and any paths left in the frontier are counted as unexplored. 0 means
+    // no limit.
+    std::chrono::milliseconds time_limit{0};
+
+    // How long to wait before asking a worker to split again after it had
+    // nothing to give.
+    std::chrono::milliseconds split_backoff{20};
+
+    Options() = default;
+  };
+
+  struct Summary {
+    // Number of failures reported by the workers.
+    uint64_t failures = 0;
+    // Number of distinct failures among those.
+    uint64_t unique_failures = 0;
+    // Number of paths handed out to the workers.
+    uint64_t dispatched = 0;
+    // Number of paths that were split off from a worker and sent elsewhere.
+    uint64_t split = 0;
+    // Number of paths that could not be replayed by a worker.
+    uint64_t diverged = 0;
+    // Number of paths that were left unexplored, either because the time
+    // limit was reached or because the worker exploring them exited.
+    uint64_t unexplored = 0;
+    // Number of workers whose connection closed unexpectedly.
+    uint64_t lost_workers = 0;
+
+    bool complete() const {
+      return unexplored == 0 && diverged == 0;
+    }
+  };
+
+  explicit DistributedCoordinator(std::ostream& report);
+  DistributedCoordinator(std::ostream& report, const Options& options);
+  ~DistributedCoordinator();
+
+  /**
+   * Add a worker connected through fd. The coordinator takes ownership of the
+   * file descriptor and closes it once the worker has shut down.
+   */
+  void add_worker(int fd);
+
+  /**
+   * Explore every path below root and then shut down all the workers.
+   *
+   * By default this explores the whole program starting from the entry
+   * context used by the workers.
+   */
+  Summary run(const DecisionLog& root = DecisionLog());
+
+  DistributedCoordinator(const DistributedCoordinator&) = delete;
+  DistributedCoordinator& operator=(const DistributedCoordinator&) = delete;
+
+private:
+  struct Worker {
+    int fd;
+    bool live = true;
+    bool busy = false;
+    // Whether the worker has been told to shut down.
+    bool shutdown = false;
+    // Whether a split request has been sent without a reply yet.
+    bool splitting = false;
+    std::chrono::steady_clock::time_point next_split;
+  };
+
+  struct Entry {
+    uint64_t count = 0;
+    // Index of the first failure with this key.
+    uint64_t first = 0;
+  };
+
+  bool handle_message(Worker& worker, Summary& summary);
+  bool record_failure(std::string_view payload, Summary& summary);
+  void disconnect(Worker& worker, Summary& summary);
+  void shutdown(Worker& worker);
+  void print_summary(const Summary& summary);
+
+  std::ostream* report_;
+  Options options_;
+  std::vector<Worker> workers_;
+  // Encoded decision logs for the paths that have yet to be handed out.
+  std::deque<std::string> frontier_;
+
+  // Distinct failures keyed by location and message.
+  std::map<std::pair<std::string, std::string>, Entry> failures_;
+};
+
+/**
+ * The worker side of distributed exploration.
+ *
+ * A worker waits for the coordinator to send it a path, rebuilds the context
+ * at the end of it using Executor::replay and then runs its executor until
+ * every path below that context has been explored. Failures are sent back to
+ * the coordinator instead of being logged locally.
+ *
+ * The worker owns the store and failure logger used by its executor. The
+ * cancellation token in the executor options is replaced by one that the
+ * worker cancels when the coordinator tells it to stop.
+ */
+class DistributedWorker {
+public:
+  using EntryFn = std::function<Context()>;
+
+  /**
+   * Create a worker which talks to the coordinator through fd. The worker
+   * takes ownership of the file descriptor.
+   *
+   * Every replay starts from a context created by entry so it must return the
+   * same context each time it is called.
+   */
+  DistributedWorker(int fd, ExecutionPolicy* policy,
+                    const ExecutorOptions& options, EntryFn entry);
+  ~DistributedWorker();
+
+  /**
+   * Handle requests from the coordinator until it tells the worker to shut
+   * down. Returns false if the connection was closed before then.
+   */
+  bool run();
+
+  DistributedWorker(const DistributedWorker&) = delete;
+  DistributedWorker& operator=(const DistributedWorker&) = delete;
+
+private:
+  class Store;
+  class Logger;
+
+  bool send(uint8_t kind, std::string_view payload);
+
+  int fd_;
+  EntryFn entry_;
+  CancellationToken shutdown_;
+  // Serializes writes to the socket.
+  std::mutex write_mutex_;
+  // Cleared if the coordinator closes the connection while we are exploring.
+  std::atomic<bool> connected_ = true;
+
+  std::unique_ptr<Store> store_;
+  std::unique_ptr<Logger> logger_;
+  std::unique_ptr<Executor> executor_;
+};
+
+} // namespace caffeine
@@ -1,41 +1,154 @@
 #ifndef CAFFEINE_INTERP_EXECUTOR_H
 #define CAFFEINE_INTERP_EXECUTOR_H
 
+#include <atomic>
 #include <cstdint>
 
+#include "caffeine/ADT/ThreadMap.h"
+#include "caffeine/Interpreter/Budget.h"
 #include "caffeine/Interpreter/Context.h"
+#include "caffeine/Interpreter/DecisionLog.h"
 #include "caffeine/Interpreter/FailureLogger.h"
+#include "caffeine/Interpreter/FunctionSummary.h"
+#include "caffeine/Interpreter/LoopSummary.h"
+#include "caffeine/Interpreter/Options.h"
 #include "caffeine/Interpreter/Store.h"
 
 namespace caffeine {
 
+class CancellationToken;
 class ExecutionPolicy;
 class ExecutionContextStore;
+class QueryLogWriter;
 
 struct ExecutorOptions {
   uint32_t num_threads = 2;
 
+  /**
+   * Options passed to each interpreter created by the executor.
+   */
+  InterpreterOptions interpreter;
+
+  /**
+   * If set, every query made by the interpreters will be recorded to this log.
+   * The log must outlive the executor.
+   */
+  QueryLogWriter* query_log = nullptr;
+
+  /**
+   * Limits on how much work the executor will do. Once any of them is reached
+   * the executor stops executing paths and drains the remaining paths from the
+   * store without running them.
+   */
+  ExecutionLimits limits;
+
+  /**
+   * If set, cancelling this token stops the executor in the same way as
+   * running out of budget. This may be done from any thread. The token must
+   * outlive the call to Executor::run.
+   */
+  CancellationToken* cancel = nullptr;
+
+  /**
+   * Whether to try solving queries by bit-blasting them before falling back
+   * to Z3. See BitBlastSolver.
+   *
+   * This is ignored if caffeine was built without CaDiCaL.
+   */
+  bool bitblast = false;
+
+  /**
+   * Whether to try finding models for floating-point queries by evaluating
+   * them under guessed inputs before handing them to the other solvers. See
+   * FuzzingSolver.
+   */
+  bool fuzz_floats = false;
+
   constexpr ExecutorOptions() = default;
 };
 
+/**
+ * What happened during a call to Executor::run.
+ */
+struct ExecutorSummary {
+  // Why the executor stopped early, or None if every path was explored.
+  ExecutionBudget::Reason stopped = ExecutionBudget::None;
+  // Number of paths that were left unexplored. This counts both the paths
+  // that were still in the store and those that were interrupted partway
+  // through.
+  uint64_t unexplored = 0;
+
+  bool complete() const {
+    return stopped == ExecutionBudget::None;
+  }
+};
+
 class Executor {
 private:
   ExecutionPolicy* policy;
   ExecutionContextStore* store;
   FailureLogger* logger;
   ExecutorOptions options;
+  FunctionSummaryCache summaries;
+  LoopSummaryCache loop_summaries;
+
+  // State for the current call to run
+  ExecutionBudget* budget = nullptr;
+  std::atomic<uint64_t> unexplored = 0;
+  // The solver of the worker running on each thread. Replays done by a
+  // worker (e.g. from ReplayingContextStore) reuse it.
+  ThreadMap<std::shared_ptr<Solver>> worker_solvers;
 
   friend void run_worker(Executor* exec, FailureLogger* logger,
                          ExecutionContextStore* store);
 
+  // Build the solver stack used by a single worker thread.
+  std::shared_ptr<Solver> create_solver(ExecutionBudget& budget) const;
+
 public:
   Executor(ExecutionPolicy* policy, ExecutionContextStore* store,
            FailureLogger* logger, const ExecutorOptions& options = {});
 
   /**
-   * Runs the contexts in its possesion until there are none left
+   * Runs the contexts in its possesion until there are none left or the
+   * limits in the options have been reached.
+   */
+  ExecutorSummary run();
+
+  /**
+   * Summarize the loops within the module ahead of time.
+   *
+   * Loop analysis can't run while other threads are interpreting the module
+   * so when running with more than one thread only the summaries computed by
+   * this are used. Call it before run if the interpreter options enable
+   * summarize_loops.
+   */
+  void summarize_loops(llvm::Module& module);
+
+  /**
+   * Rebuild the context at the end of the path described by decisions by
+   * executing entry again and only following the recorded decisions.
+   *
+   * Unless the interpreter options limit expression sizes, the decisions are
+   * forced (see Interpreter::force_decisions) so rebuilding a context only
+   * needs the solver for the few things that aren't recorded in the log,
+   * such as reading symbolic names.
+   *
+   * This gives back the same context as long as the module, the entry context
+   * and the options are the same as when the decisions were recorded.
+   * Failures found along the way are not logged since they were already
+   * reported when the path was first explored.
+   *
+   * Returns std::nullopt if the path diverges from the log (e.g. because a
+   * query that returned unknown the first time is now found to be
+   * unsatisfiable) or if execution is cancelled.
+   *
+   * When called from within run the replay counts against the executor's
+   * budget. Once that runs out the context reached so far is returned
+   * instead, without executing anything more, so that the worker that asked
+   * for it counts the path as unexplored.
    */
-  void run();
+  std::optional<Context> replay(Context entry, const DecisionLog& decisions);
 };
 
 } // namespace caffeine
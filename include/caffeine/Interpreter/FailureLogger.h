@@ -1,11 +1,19 @@
 #ifndef CAFFEINE_INTERPRETER_FAILURELOGGER_H
 #define CAFFEINE_INTERPRETER_FAILURELOGGER_H
 
+#include "caffeine/IR/Value.h"
 #include "caffeine/Interpreter/Context.h"
 #include "caffeine/Solver/Solver.h"
 
 #include <iosfwd>
 #include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Instruction;
+} // namespace llvm
 
 namespace caffeine {
 
@@ -34,6 +42,30 @@ protected:
   FailureLogger& operator=(FailureLogger&&) = default;
 };
 
+/**
+ * The values that a model assigns to the named symbolic inputs of a context.
+ *
+ * Models are only valid for as long as the solver that produced them so this
+ * is used to keep the inputs for a failure around after the model is gone.
+ */
+using FailureInputs = std::vector<std::pair<std::string, Value>>;
+
+FailureInputs evaluate_inputs(const Model& model, const Context& ctx);
+
+/**
+ * Print a failure in the format used by PrintingFailureLogger. If inputs is
+ * null then the inputs and backtrace are omitted.
+ */
+void print_failure(std::ostream& os, const FailureInputs* inputs,
+                   const Context& ctx, std::string_view message);
+
+/**
+ * Describe where a failure happened for the purposes of grouping failures
+ * together. This uses the debug location of inst if it has one and the
+ * instruction itself otherwise.
+ */
+std::string describe_location(const llvm::Instruction* inst);
+
 class PrintingFailureLogger : public FailureLogger {
 private:
   std::ostream* os;
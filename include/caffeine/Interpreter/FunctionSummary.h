@@ -0,0 +1,78 @@
+#pragma once
+
+#include "caffeine/IR/Operation.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Function.h>
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace caffeine {
+
+/**
+ * A closed-form summary of a pure function.
+ *
+ * The summary is computed once by evaluating the function with a placeholder
+ * constant for each argument. All paths through the function are merged into
+ * a single result expression using select operations so applying a summary
+ * never requires forking.
+ *
+ * Only a restricted set of functions can be summarized. They must
+ *  - take and return only scalar integer or floating-point values,
+ *  - contain no memory accesses, calls, or instructions that can fault, and
+ *  - have an acyclic CFG with a bounded number of paths.
+ */
+class FunctionSummary {
+public:
+  FunctionSummary(llvm::SmallVector<OpRef, 4>&& placeholders,
+                  const OpRef& result);
+
+  /**
+   * Build a summary for the provided function. Returns std::nullopt if the
+   * function cannot be summarized.
+   */
+  static std::optional<FunctionSummary> Create(llvm::Function* func);
+
+  /**
+   * Get the result expression for a call with the provided arguments. The
+   * number of arguments must match the number of function parameters.
+   */
+  OpRef apply(llvm::ArrayRef<OpRef> args) const;
+
+  const OpRef& result() const {
+    return result_;
+  }
+
+private:
+  llvm::SmallVector<OpRef, 4> placeholders_;
+  OpRef result_;
+};
+
+/**
+ * Thread-safe cache of function summaries.
+ *
+ * A single cache is meant to be shared between all the interpreters created by
+ * an executor. Functions which cannot be summarized are also recorded so that
+ * the check is only performed once per function.
+ */
+class FunctionSummaryCache {
+public:
+  FunctionSummaryCache() = default;
+
+  /**
+   * Get the summary for a function, computing it if it hasn't been seen before.
+   * Returns nullptr if the function cannot be summarized.
+   *
+   * The returned pointer remains valid for the lifetime of the cache.
+   */
+  const FunctionSummary* lookup(llvm::Function* func);
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<llvm::Function*, std::optional<FunctionSummary>> cache_;
+};
+
+} // namespace caffeine
@@ -2,11 +2,13 @@
 #define CAFFEINE_INTERP_INTERPRETER_H
 
 #include <memory>
+#include <optional>
 
 #include "caffeine/IR/Assertion.h"
 #include "caffeine/Interpreter/Executor.h"
 #include "caffeine/Interpreter/FailureLogger.h"
 #include "caffeine/Interpreter/Options.h"
+#include "caffeine/Interpreter/Value.h"
 #include "caffeine/Support/Assert.h"
 
 #include <llvm/IR/InstVisitor.h>
@@ -15,6 +17,8 @@ namespace caffeine {
 
 class ExecutionPolicy;
 class ExecutionContextStore;
+class FunctionSummaryCache;
+class LoopSummaryCache;
 
 class ExecutionResult {
 public:
@@ -53,19 +57,56 @@ private:
   FailureLogger* logger;
   InterpreterOptions options;
   std::shared_ptr<Solver> solver;
+  FunctionSummaryCache* summaries;
+  LoopSummaryCache* loop_summaries;
+  // The decisions being replayed, if any (see force_decisions).
+  const DecisionLog* forced = nullptr;
+  bool cancelled_ = false;
 
 public:
   /**
    * The interpreter constructor needs an executor and context as well as a way
    * to log assertion failures.
+   *
+   * If summaries or loop_summaries are not null then they will be used to
+   * cache summaries of pure functions and loops within the program being
+   * executed.
    */
   Interpreter(Context* ctx, ExecutionPolicy* policy,
               ExecutionContextStore* store, FailureLogger* logger,
               const std::shared_ptr<Solver>& solver,
-              const InterpreterOptions& options = InterpreterOptions());
+              const InterpreterOptions& options = InterpreterOptions(),
+              FunctionSummaryCache* summaries = nullptr,
+              LoopSummaryCache* loop_summaries = nullptr);
 
   void execute();
 
+  /**
+   * Whether the last call to execute stopped early because the budget in the
+   * interpreter options was exhausted. If so then the context was left
+   * partway through execution.
+   */
+  bool cancelled() const {
+    return cancelled_;
+  }
+
+  /**
+   * Replay the decisions in log instead of working out which way execution
+   * can go. Branches and switches take the recorded successor and pointers
+   * are resolved to the recorded allocation, all without asking the solver.
+   * Checks for failures are skipped as well since they were already made
+   * when the decisions were recorded. Once the context has made every
+   * decision in the log it continues as normal.
+   *
+   * The log must have been recorded along a path of the same program with
+   * the same options. A decision that doesn't exist (e.g. the third successor
+   * of a branch) kills the path but one that is infeasible is not detected.
+   * The log must outlive the interpreter.
+   */
+  void force_decisions(const DecisionLog* log) {
+    forced = log;
+  }
+
   ExecutionResult visitInstruction(llvm::Instruction& inst);
 
   ExecutionResult visitBinaryOperator(llvm::BinaryOperator& op);
@@ -111,6 +152,22 @@ private:
   void logFailure(Context& ctx, const Assertion& assertion,
                   std::string_view message = "");
   void queueContext(Context&& ctx);
+  void concretizeIfLarge(Context& ctx, llvm::Instruction& inst);
+  // The decision that ctx has to make next when replaying, or std::nullopt if
+  // its decisions are not being forced.
+  std::optional<uint32_t> forcedDecision(const Context& ctx) const;
+  // Resolve a pointer with MemHeapMgr::resolve, or to the recorded allocation
+  // when replaying.
+  llvm::SmallVector<Pointer, 1> resolvePointer(Context& ctx,
+                                               const Pointer& pointer);
+  // Fork off the path where an allocation call returns null. When replaying
+  // a path that took it the null path is returned instead and ctx should not
+  // continue.
+  std::optional<ExecutionResult> forkNullAllocation(llvm::CallInst& call,
+                                                    unsigned address_space);
+  // Resolve loads through aliasing stores with the solver, spending at most
+  // budget queries (see InterpreterOptions::load_alias_queries).
+  LLVMValue forwardLoads(Context& ctx, LLVMValue value, size_t& budget);
   Interpreter cloneWith(Context* ctx);
 
 private:
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "caffeine/IR/Operation.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace caffeine {
+
+class Context;
+
+/**
+ * A closed-form summary of a side-effect free loop.
+ *
+ * Loops with a computable trip count whose only observable effects are the
+ * values they leave behind can be skipped entirely. The summary records, for
+ * every value defined within the loop and used after it, the value that it
+ * will have once the loop exits, expressed in terms of values that are
+ * available before the loop is entered.
+ *
+ * The exit values are computed using LLVM's ScalarEvolution analysis. Values
+ * that are defined outside the loop are represented by placeholder constants
+ * within the summary and get substituted when the summary is applied.
+ */
+class LoopSummary {
+public:
+  struct ExitValue {
+    llvm::Instruction* inst;
+    OpRef value;
+  };
+
+  LoopSummary(llvm::BasicBlock* preheader, llvm::BasicBlock* exiting,
+              llvm::BasicBlock* exit);
+
+  /**
+   * Skip over the loop within the top stack frame of the context.
+   *
+   * This must only be called when branching from the preheader of the loop
+   * into its header. Afterwards, the values used outside the loop will be set
+   * within the current frame and execution will resume at the start of the
+   * exit block.
+   */
+  void apply(Context& ctx) const;
+
+  llvm::BasicBlock* preheader() const {
+    return preheader_;
+  }
+  llvm::BasicBlock* exit() const {
+    return exit_;
+  }
+  llvm::ArrayRef<ExitValue> exit_values() const {
+    return exit_values_;
+  }
+
+private:
+  llvm::BasicBlock* preheader_;
+  llvm::BasicBlock* exiting_;
+  llvm::BasicBlock* exit_;
+  llvm::SmallVector<ExitValue, 4> exit_values_;
+  // Placeholder constants mapped to the values they stand in for.
+  llvm::SmallVector<std::pair<OpRef, llvm::Value*>, 4> inputs_;
+
+  friend class LoopSummaryBuilder;
+};
+
+/**
+ * Thread-safe cache of loop summaries.
+ *
+ * Loop analysis is done once per function the first time one of its loops is
+ * entered. Every loop within that function is then summarized (or marked as
+ * not summarizable) and the analysis results are discarded.
+ *
+ * The analysis itself goes through LLVM's ScalarEvolution which modifies state
+ * shared by the whole LLVMContext. It is not safe to run it while other threads
+ * are interpreting the same module. When interpreting with multiple threads
+ * call analyze(llvm::Module&) before they start and disable lazy analysis.
+ */
+class LoopSummaryCache {
+public:
+  LoopSummaryCache() = default;
+
+  /**
+   * Get the summary for the loop with the given header block. Returns nullptr
+   * if the block is not a loop header or the loop can't be summarized.
+   *
+   * The returned pointer remains valid for the lifetime of the cache.
+   */
+  const LoopSummary* lookup(llvm::BasicBlock* header);
+
+  /**
+   * Summarize the loops in every function defined within the module that
+   * hasn't been analyzed yet.
+   */
+  void analyze(llvm::Module& module);
+
+  /**
+   * Whether lookup may analyze functions that haven't been analyzed yet. When
+   * disabled, lookup returns nullptr for loops within those functions.
+   */
+  void set_lazy(bool lazy);
+
+private:
+  void analyze(llvm::Function* func);
+
+  std::mutex mutex_;
+  bool lazy_ = true;
+  std::unordered_set<llvm::Function*> analyzed_;
+  std::unordered_map<llvm::BasicBlock*, std::optional<LoopSummary>> cache_;
+};
+
+} // namespace caffeine
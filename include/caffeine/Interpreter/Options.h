@@ -1,8 +1,13 @@
 #ifndef CAFFEINE_INTERPRETER_OPTIONS_H
 #define CAFFEINE_INTERPRETER_OPTIONS_H
 
+#include <cstdint>
+
 namespace caffeine {
 
+class ExecutionBudget;
+class InstructionProfiler;
+
 struct InterpreterOptions {
   /**
    * Determines whether it's possible for malloc to ever return nullptr when
@@ -14,6 +19,74 @@ struct InterpreterOptions {
 
   uint64_t malloc_alignment = 16;
 
+  /**
+   * Whether calls to small pure functions should be replaced with a cached
+   * summary of the function instead of being executed directly.
+   *
+   * See FunctionSummary for the exact set of functions that can be summarized.
+   */
+  bool function_summaries = true;
+
+  /**
+   * Whether side-effect free loops with a computable trip count should be
+   * replaced with closed-form expressions for the values they produce instead
+   * of being executed one iteration at a time.
+   *
+   * This uses LLVM's loop analyses so it only works well on code that has been
+   * optimized (or at least had mem2reg and loop-simplify run over it). It is
+   * disabled by default.
+   */
+  bool summarize_loops = false;
+
+  /**
+   * Limits on the size of integer expressions produced by an instruction.
+   * Once an expression's depth or tree size (see Operation::depth and
+   * Operation::tree_size) exceeds these limits the interpreter asks the solver
+   * for a single concrete value, pins the expression to that value, and
+   * continues with the constant instead.
+   *
+   * This bounds the cost of solver queries at the cost of no longer exploring
+   * every value the expression could have taken. A value of 0 disables the
+   * corresponding limit. Both are disabled by default.
+   */
+  uint32_t max_expr_depth = 0;
+  uint32_t max_expr_size = 0;
+
+  /**
+   * If set, the cost of executing each instruction is recorded to this
+   * profiler. The profiler must outlive the interpreter.
+   */
+  InstructionProfiler* profiler = nullptr;
+
+  /**
+   * Whether to estimate the memory footprint of each context before it is
+   * queued (see Context::estimate_footprint). The estimate is stored in
+   * Context::footprint where the execution policy can use it and is also used
+   * to track how much memory the queued contexts are using.
+   *
+   * This walks the whole state of each forked context so it is disabled by
+   * default.
+   */
+  bool track_footprint = false;
+
+  /**
+   * If set, executed instructions are charged to this budget and the
+   * interpreter stops before the next instruction once it has been exhausted.
+   * The Executor sets this when running with limits.
+   */
+  ExecutionBudget* budget = nullptr;
+
+  /**
+   * The maximum number of solver queries the interpreter may make per load
+   * instruction to decide whether a store and the load alias when their
+   * offsets can't be compared syntactically. Loads whose stores are all shown
+   * to be at distinct offsets see through to the older value, which keeps
+   * the expressions passed to the solver smaller.
+   *
+   * Each query is an extra solver call so this is disabled (0) by default.
+   */
+  uint32_t load_alias_queries = 0;
+
   InterpreterOptions() = default;
 };
 
@@ -40,6 +40,9 @@ public:
    *
    * Note that this method does not control whether dead branches continue to
    * execute. Those will be pruned irregardless of what this method returns.
+   *
+   * If InterpreterOptions::track_footprint is enabled then ctx.footprint
+   * holds an estimate of the memory used by the context.
    */
   virtual bool should_queue_path(const Context& ctx) = 0;
 
@@ -56,6 +59,14 @@ public:
   // used for the non-failure path if it is valid.
   virtual void on_path_complete(const Context& ctx, ExitStatus status,
                                 const Assertion& assertion = Assertion());
+  // Called when the interpreter replaces an expression that grew past the
+  // limits in InterpreterOptions with a single concrete value. The equality
+  // between the two has already been added to the context's assertions.
+  //
+  // Concretization drops every other value the expression could have taken so
+  // paths explored afterwards are no longer complete.
+  virtual void on_value_concretized(Context& ctx, const OpRef& expr,
+                                    const OpRef& value);
 
 protected:
   ExecutionPolicy(ExecutionPolicy&&) = default;
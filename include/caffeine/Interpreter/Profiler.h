@@ -0,0 +1,129 @@
+#pragma once
+
+#include "caffeine/Solver/Solver.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Instruction;
+} // namespace llvm
+
+namespace caffeine {
+
+/**
+ * Profiler which attributes the cost of execution to individual LLVM
+ * instructions within the program under test.
+ *
+ * The interpreter opens a Scope around every instruction that it executes.
+ * Anything that happens while the scope is the innermost one on the current
+ * thread (solver queries made through the solver returned by wrap, new
+ * expression nodes) is charged to that instruction.
+ *
+ * Each thread records into its own table so recording never needs to take a
+ * lock. The tables are merged when a report is written, which must only be
+ * done once all threads recording into the profiler have finished.
+ */
+class InstructionProfiler {
+public:
+  struct Counters {
+    // Number of times the instruction was executed.
+    uint64_t executions = 0;
+    // Number of new paths created while executing the instruction.
+    uint64_t forks = 0;
+    // Number of solver queries and the time spent in them.
+    uint64_t solver_calls = 0;
+    uint64_t solver_ns = 0;
+    // Number of new expression nodes created.
+    uint64_t nodes_created = 0;
+    // Time spent executing the instruction. This includes the time spent
+    // executing any nested instructions (e.g. while building a function
+    // summary).
+    uint64_t time_ns = 0;
+
+    Counters& operator+=(const Counters& other);
+  };
+
+  enum class Metric {
+    Executions,
+    Forks,
+    SolverCalls,
+    SolverTime,
+    NodesCreated,
+    Time
+  };
+
+  /**
+   * Attributes costs to an instruction for as long as it is alive. Scopes
+   * must be destroyed in the reverse order that they were created on a
+   * thread.
+   */
+  class Scope {
+  public:
+    Scope(InstructionProfiler* profiler, const llvm::Instruction* inst);
+    ~Scope();
+
+    // Record that executing this instruction forked count new paths.
+    void add_forks(uint64_t count);
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Counters* counters = nullptr;
+    Counters* prev = nullptr;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  InstructionProfiler();
+  ~InstructionProfiler();
+
+  /**
+   * Wrap a solver so that queries made through it are attributed to the
+   * instruction currently being executed on the calling thread.
+   */
+  std::shared_ptr<Solver> wrap(std::shared_ptr<Solver> solver);
+
+  /**
+   * Merge the tables from all threads together.
+   */
+  std::vector<std::pair<const llvm::Instruction*, Counters>> merged() const;
+
+  /**
+   * Write a human-readable table of the most expensive instructions, sorted
+   * by the given metric, along with their source locations.
+   */
+  void write_report(std::ostream& os, Metric metric = Metric::SolverTime,
+                    size_t limit = 50) const;
+
+  /**
+   * Write the profile as folded stacks (one `function;location;instruction
+   * value` line per instruction) weighted by the given metric. This is the
+   * input format used by flamegraph.pl and can be converted to pprof.
+   */
+  void write_folded(std::ostream& os, Metric metric) const;
+
+  InstructionProfiler(const InstructionProfiler&) = delete;
+  InstructionProfiler& operator=(const InstructionProfiler&) = delete;
+
+private:
+  using Table = std::unordered_map<const llvm::Instruction*, Counters>;
+
+  // Get the table for the current thread.
+  Table& local();
+
+  // Unique for every profiler so that stale thread-local caches from a
+  // destroyed profiler are never reused.
+  uint64_t id_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Table>> tables_;
+};
+
+} // namespace caffeine
@@ -54,6 +54,15 @@ public:
    */
   void insert(llvm::Value* value, const OpRef& expr);
   void insert(llvm::Value* value, const LLVMValue& exprs);
+
+  /**
+   * The instruction that this frame is currently executing. This is the one
+   * just before the instruction pointer since the interpreter advances it
+   * before executing each instruction.
+   *
+   * Returns null if the instruction pointer is not in a valid state.
+   */
+  llvm::Instruction* current_instruction() const;
 };
 
 } // namespace caffeine
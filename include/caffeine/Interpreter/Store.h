@@ -3,10 +3,15 @@
 #include "caffeine/ADT/Span.h"
 #include "caffeine/ADT/ThreadMap.h"
 #include "caffeine/Interpreter/Context.h"
+#include "caffeine/Interpreter/FailureLogger.h"
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <variant>
+#include <vector>
 
 namespace caffeine {
 
@@ -94,4 +99,147 @@ private:
   size_t cache_size;
 };
 
+/**
+ * Context store which makes multithreaded execution reproducible.
+ *
+ * Execution proceeds in rounds. At the start of each round up to round_size
+ * contexts are taken from the front of the frontier and handed out to the
+ * workers, which execute them in parallel. Contexts added while executing a
+ * round are held back until every context in that round has finished. They are
+ * then put at the front of the frontier ordered by the position of their
+ * parent within the round and the order in which the parent created them.
+ *
+ * This means that the order in which contexts are executed, and the
+ * Context::path_id assigned to each of them, depends only on the program being
+ * executed and not on the number of threads or how they are scheduled. Since
+ * constant names come from a counter within each context they are stable as
+ * well.
+ *
+ * Failures can still be found in any order within a round. Wrap the failure
+ * logger in an OrderedLogger to have them reported in a reproducible order.
+ *
+ * Workers must call next_context again once they finish executing a context
+ * since that is how the store finds out that the context is done. This is what
+ * the executor already does.
+ */
+class DeterministicContextStore : public ExecutionContextStore {
+public:
+  static constexpr size_t default_round_size = 64;
+
+  /**
+   * Failure logger which forwards failures to another logger in the order in
+   * which the failing contexts were handed out by the store.
+   *
+   * Logging a failure blocks until all contexts that were handed out before
+   * the one being executed on the current thread have finished.
+   */
+  class OrderedLogger : public FailureLogger {
+  public:
+    OrderedLogger(FailureLogger* inner, DeterministicContextStore* store);
+
+    void log_failure(const Model* model, const Context& context,
+                     const Failure& failure) override;
+
+  private:
+    FailureLogger* inner;
+    DeterministicContextStore* store;
+  };
+
+public:
+  explicit DeterministicContextStore(size_t round_size = default_round_size);
+
+  std::optional<Context> next_context() override;
+
+  void add_context(Context&& ctx) override;
+
+  void shutdown();
+
+  /**
+   * Block until all contexts that were handed out earlier in the current round
+   * than the one being executed on this thread have finished.
+   */
+  void wait_for_turn();
+
+private:
+  struct Worker {
+    // Index of the context within the round that this worker is executing.
+    std::optional<size_t> task;
+  };
+
+  void finish_task(Worker& worker);
+  void start_round();
+
+private:
+  std::mutex mutex;
+  std::condition_variable condvar;
+
+  size_t round_size;
+  bool done = false;
+
+  std::deque<Context> frontier;
+  uint64_t next_path_id = 0;
+
+  // State for the current round
+  std::vector<Context> round;
+  std::vector<std::vector<Context>> children;
+  std::vector<bool> finished;
+  size_t next_task = 0;
+  size_t num_finished = 0;
+  size_t first_unfinished = 0;
+
+  ThreadMap<Worker> workers;
+};
+
+/**
+ * Context store which keeps at most max_resident contexts in memory.
+ *
+ * Contexts are handed out in the order in which they were added, like
+ * QueueingContextStore. The contexts added once the limit has been reached are
+ * the ones that will be needed last so they are dropped and only their
+ * DecisionLog is kept. When one of them reaches the front of the queue it is
+ * rebuilt by calling replay, which will usually forward to Executor::replay.
+ * This trades executing the path again for the memory used by a suspended
+ * context.
+ *
+ * Contexts are rebuilt on the thread that asked for them without holding the
+ * store's lock. A context that can't be rebuilt is skipped. Whatever context
+ * replay returns is handed out as is, so once the executor's budget has run
+ * out the partially rebuilt path still reaches the executor and is counted as
+ * unexplored.
+ */
+class ReplayingContextStore : public ExecutionContextStore {
+public:
+  using ReplayFn = std::function<std::optional<Context>(const DecisionLog&)>;
+
+  ReplayingContextStore(size_t num_readers, size_t max_resident,
+                        ReplayFn replay);
+
+  std::optional<Context> next_context() override;
+
+  void add_context(Context&& ctx) override;
+  void add_context_multi(Span<Context> contexts) override;
+
+  void shutdown();
+
+private:
+  using Entry = std::variant<Context, DecisionLog>;
+
+  void enqueue(Context&& ctx);
+
+private:
+  std::mutex mutex;
+  std::condition_variable condvar;
+
+  size_t blocked = 0;
+  size_t num_readers;
+
+  // Number of entries in the queue which hold a full context.
+  size_t resident = 0;
+  size_t max_resident;
+
+  bool done = false;
+  std::queue<Entry> queue;
+  ReplayFn replay;
+};
+
 } // namespace caffeine
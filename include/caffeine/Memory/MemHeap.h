@@ -8,6 +8,7 @@
 #include <llvm/ADT/APInt.h>
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/DataLayout.h>
+#include <optional>
 #include <vector>
 
 namespace caffeine {
@@ -296,6 +297,21 @@ public:
                                         const Pointer& value,
                                         Context& ctx) const;
 
+  /**
+   * Resolve a pointer to the allocation in a known slot without making any
+   * solver calls. This is meant for replaying a path where an earlier call to
+   * resolve picked that allocation (see DecisionLog).
+   *
+   * If the pointer has already been resolved then slot is ignored. Returns
+   * std::nullopt if there is no live allocation in the slot.
+   */
+  std::optional<Pointer> resolve_slot(const Pointer& value, size_t slot) const;
+
+  // All live allocations on this heap.
+  const slot_map<Allocation>& allocations() const {
+    return allocs_;
+  }
+
   void DebugPrint() const;
 
 private:
@@ -338,6 +354,18 @@ public:
   llvm::SmallVector<Pointer, 1> resolve(std::shared_ptr<Solver> solver,
                                         const Pointer& value,
                                         Context& ctx) const;
+  std::optional<Pointer> resolve_slot(const Pointer& value, size_t slot) const;
+
+  using const_iterator =
+      llvm::SmallDenseMap<unsigned, MemHeap>::const_iterator;
+
+  // Iterate over all heaps that have been created so far.
+  const_iterator begin() const {
+    return heaps_.begin();
+  }
+  const_iterator end() const {
+    return heaps_.end();
+  }
 };
 
 } // namespace caffeine
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Protos/operation.capnp.h"
+
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace caffeine {
+
+/**
+ * Thrown when an expression cannot be serialized or when a serialized
+ * expression graph is malformed.
+ */
+class SerializationError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * Builds a serialized ExprGraph out of a set of expressions.
+ *
+ * Each distinct operation is stored only once so shared subexpressions don't
+ * blow up the size of the output. Expressions which refer to things outside
+ * of the expression graph (i.e. FunctionObject) cannot be serialized.
+ */
+class ExprGraphWriter {
+public:
+  ExprGraphWriter() = default;
+
+  /**
+   * Add an expression (and all of its subexpressions) to the graph. Returns
+   * the index of the expression's node.
+   *
+   * Throws SerializationError if the expression cannot be serialized.
+   */
+  uint32_t add(const OpRef& expr);
+
+  size_t size() const {
+    return nodes_.size();
+  }
+
+  void write(protos::ExprGraph::Builder builder) const;
+
+private:
+  std::vector<OpRef> nodes_;
+  std::unordered_map<const Operation*, uint32_t> indices_;
+};
+
+/**
+ * Rebuilds the expressions within a serialized ExprGraph.
+ *
+ * All nodes are recreated using the usual Create methods so the resulting
+ * expressions are interned and constant folded in the same way as expressions
+ * created by the interpreter.
+ */
+class ExprGraphReader {
+public:
+  /**
+   * Throws SerializationError if the graph is malformed.
+   */
+  explicit ExprGraphReader(protos::ExprGraph::Reader reader);
+
+  const OpRef& operator[](uint32_t index) const;
+
+  size_t size() const {
+    return nodes_.size();
+  }
+
+private:
+  OpRef read(protos::Operation::Reader node) const;
+
+  std::vector<OpRef> nodes_;
+};
+
+} // namespace caffeine
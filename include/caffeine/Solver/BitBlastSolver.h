@@ -0,0 +1,56 @@
+#pragma once
+
+#include "caffeine/Solver/Solver.h"
+
+#include <memory>
+
+namespace caffeine {
+
+class CancellationToken;
+
+/**
+ * Solver which bit-blasts integer queries down to a propositional formula and
+ * solves that with an incremental SAT solver.
+ *
+ * Most path conditions are quantifier-free bitvector formulas that don't
+ * involve floats or arrays. For those we can skip the full SMT stack and
+ * translate each operation directly into gates over the bits of its operands.
+ * Gates are structurally hashed so that identical gates are only ever encoded
+ * once and the encoding of each operation is cached across queries. The
+ * constraints defining a gate are valid regardless of which assertions are
+ * active so they (along with anything the SAT solver has learned from them)
+ * are kept around for later queries. Only the roots of each query are passed
+ * in as assumptions.
+ *
+ * Queries that contain anything other than integer operations (floats,
+ * arrays, loads and stores) return Unknown so this solver should be placed in
+ * front of a complete solver (e.g. Z3Solver) within a SequenceSolver.
+ *
+ * The SAT solver underneath is CaDiCaL.
+ */
+class BitBlastSolver : public Solver {
+private:
+  class Impl;
+
+  std::unique_ptr<Impl> impl;
+
+public:
+  /**
+   * If cancel is not null then queries made while it is cancelled return
+   * Unknown without running and a query that is running when it is cancelled
+   * is interrupted. The token must outlive the solver.
+   */
+  explicit BitBlastSolver(CancellationToken* cancel = nullptr);
+  ~BitBlastSolver();
+
+  BitBlastSolver(BitBlastSolver&& solver) noexcept;
+  BitBlastSolver& operator=(BitBlastSolver&& solver) noexcept;
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+};
+
+} // namespace caffeine
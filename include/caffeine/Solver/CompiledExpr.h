@@ -0,0 +1,146 @@
+#pragma once
+
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Value.h"
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace caffeine {
+
+class Model;
+
+/**
+ * An expression that has been lowered to a flat program so that it can be
+ * cheaply evaluated many times under different models.
+ *
+ * Model::evaluate walks the expression tree recursively, creating a Value for
+ * every node it visits and visiting shared subexpressions once for each use.
+ * Compiling the expression instead produces one instruction per distinct node
+ * in topological order which are then run in a single loop. Integer
+ * operations of at most 64 bits (which make up the bulk of most expressions)
+ * work directly on uint64_t registers. Everything else (floats, arrays, wider
+ * integers) goes through Value.
+ *
+ * The batched overloads evaluate the expression for a whole set of models at
+ * once. Each instruction is applied for every model before moving on to the
+ * next one, so the fixed-width instructions become simple loops over arrays
+ * of 64-bit lanes which the compiler is able to vectorize.
+ *
+ * Evaluating a compiled expression gives the same result as Model::evaluate.
+ */
+class CompiledExpr {
+public:
+  explicit CompiledExpr(const OpRef& expr);
+
+  Value evaluate(const Model& model) const;
+  std::vector<Value> evaluate(llvm::ArrayRef<const Model*> models) const;
+
+  /**
+   * Evaluate an integer expression that is at most 64 bits wide. The result
+   * is zero-extended to 64 bits.
+   *
+   * This avoids creating a Value for the result so it is the preferred way to
+   * check boolean expressions (e.g. assertions) against a model.
+   */
+  uint64_t evaluate_int(const Model& model) const;
+  void evaluate_int(llvm::ArrayRef<const Model*> models,
+                    llvm::MutableArrayRef<uint64_t> results) const;
+
+  // Whether the expression is an integer of at most 64 bits.
+  bool is_small_int() const;
+
+  const OpRef& expr() const {
+    return expr_;
+  }
+  // The number of instructions in the compiled program.
+  size_t size() const {
+    return insts_.size();
+  }
+
+private:
+  enum class Op : uint8_t {
+    // Fixed-width instructions. The result is stored zero-extended in an
+    // integer register.
+    Imm,
+    Symbol,
+    Add,
+    Sub,
+    Mul,
+    UDiv,
+    SDiv,
+    URem,
+    SRem,
+    And,
+    Or,
+    Xor,
+    Shl,
+    LShr,
+    AShr,
+    Not,
+    Eq,
+    Ne,
+    Ugt,
+    Uge,
+    Ult,
+    Ule,
+    Sgt,
+    Sge,
+    Slt,
+    Sle,
+    Trunc,
+    ZExt,
+    SExt,
+    Select,
+    Load,
+
+    // Instructions that produce a Value.
+    //
+    // Const copies a value out of the constant pool, Generic applies the
+    // operation of the original node to the values of its operands and
+    // Subtree evaluates the whole subtree rooted at the original node with
+    // Model::evaluate.
+    Const,
+    Generic,
+    Subtree,
+  };
+
+  struct Inst {
+    Op op;
+    uint32_t width;
+    // Index of the register within either the integer or value registers.
+    uint32_t reg;
+    uint32_t operands[3];
+    // Immediate for Imm, constant pool index for Const, and node index for
+    // Symbol, Generic and Subtree.
+    uint64_t imm;
+
+    bool is_small() const {
+      return op < Op::Const;
+    }
+  };
+
+  struct Registers;
+
+  Op select_op(const Operation& op, llvm::ArrayRef<uint32_t> operands) const;
+  void lower(const Operation& op, llvm::ArrayRef<uint32_t> operands);
+
+  void run(llvm::ArrayRef<const Model*> models, Registers& regs) const;
+  void run_fast(const Inst& inst, llvm::ArrayRef<const Model*> models,
+                Registers& regs) const;
+  void run_slow(const Inst& inst, llvm::ArrayRef<const Model*> models,
+                Registers& regs) const;
+
+  Value to_value(const Registers& regs, uint32_t inst, size_t lane) const;
+
+  OpRef expr_;
+  std::vector<Inst> insts_;
+  std::vector<const Operation*> nodes_;
+  std::vector<Value> constants_;
+  uint32_t num_ints_ = 0;
+  uint32_t num_values_ = 0;
+};
+
+} // namespace caffeine
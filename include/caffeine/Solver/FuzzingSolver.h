@@ -0,0 +1,52 @@
+#pragma once
+
+#include "caffeine/Solver/Solver.h"
+
+#include <cstdint>
+#include <random>
+
+namespace caffeine {
+
+/**
+ * Solver which tries to find a model for floating-point queries by guessing
+ * values for their symbols and evaluating the query concretely.
+ *
+ * Z3's floating-point theory is slow but the constraints that come out of
+ * programs using floats are often easy to satisfy once you pick the right
+ * value: a special value (NaN, an infinity, a signed zero, a denormal), one of
+ * the constants that appear in the query, or something close to one of those.
+ * This solver tries a batch of such guesses (along with some random ones) and
+ * then does a short local search starting from whichever guess satisfied the
+ * most assertions.
+ *
+ * Candidates are checked by evaluating the assertions with CompiledExpr. It
+ * compares floats with IEEE semantics, the same as constant folding, so a SAT
+ * result always comes with a model that satisfies the query. If no model is
+ * found within the search budget then this solver returns Unknown. It never
+ * returns UNSAT so it should be placed in front of a complete solver (e.g.
+ * Z3Solver) within a SequenceSolver.
+ *
+ * Queries that don't contain any floating-point operations, or that contain
+ * operations which can't be evaluated concretely (e.g. symbolic arrays), are
+ * immediately returned as Unknown.
+ */
+class FuzzingSolver : public Solver {
+public:
+  /**
+   * Candidates are evaluated in batches of batch_size and the search gives up
+   * after max_rounds batches. The seed makes the sequence of guesses for a
+   * sequence of queries reproducible.
+   */
+  explicit FuzzingSolver(uint32_t max_rounds = 16, uint32_t batch_size = 32,
+                         uint64_t seed = 0);
+
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+
+private:
+  uint32_t max_rounds;
+  uint32_t batch_size;
+  std::mt19937_64 rng;
+};
+
+} // namespace caffeine
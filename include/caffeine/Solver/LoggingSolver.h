@@ -0,0 +1,124 @@
+#pragma once
+
+#include "caffeine/Solver/Solver.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace caffeine {
+
+/**
+ * A single solver query read back from a query log.
+ */
+struct LoggedQuery {
+  enum Method { Check, Resolve };
+
+  AssertionList assertions;
+  Assertion extra;
+  Method method;
+  // The result that was returned when the query was recorded.
+  SolverResult::Kind result;
+  // How long the query took when it was recorded.
+  std::chrono::nanoseconds duration;
+
+  /**
+   * Run this query against a solver. The assertion list is copied so the
+   * query can be replayed multiple times.
+   */
+  SolverResult replay(Solver& solver) const;
+};
+
+/**
+ * Thread-safe writer for solver query logs.
+ *
+ * A query log is a sequence of unpacked capnp SolverQuery messages (see
+ * operation.capnp). Each message is self-contained so a log that was cut off
+ * partway through can still be read up until that point.
+ */
+class QueryLogWriter {
+public:
+  /**
+   * Open a query log for writing. Throws std::runtime_error if the file cannot
+   * be opened.
+   */
+  explicit QueryLogWriter(const std::string& filename);
+  ~QueryLogWriter();
+
+  // Number of queries that were skipped because they could not be serialized.
+  uint64_t skipped() const {
+    return skipped_;
+  }
+
+  QueryLogWriter(const QueryLogWriter&) = delete;
+  QueryLogWriter& operator=(const QueryLogWriter&) = delete;
+
+private:
+  std::mutex mutex_;
+  FILE* file_;
+  std::atomic<uint64_t> skipped_ = 0;
+
+  friend class LoggingSolver;
+};
+
+/**
+ * Reader for logs created by a QueryLogWriter.
+ */
+class QueryLogReader {
+public:
+  /**
+   * Open a query log for reading. Throws std::runtime_error if the file cannot
+   * be opened.
+   */
+  explicit QueryLogReader(const std::string& filename);
+  ~QueryLogReader();
+
+  /**
+   * Read the next query from the log. Returns std::nullopt once the end of the
+   * log has been reached. Throws SerializationError if the log is corrupt.
+   */
+  std::optional<LoggedQuery> next();
+
+  QueryLogReader(const QueryLogReader&) = delete;
+  QueryLogReader& operator=(const QueryLogReader&) = delete;
+
+private:
+  struct Impl;
+
+  std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * Solver adapter which records every query that passes through it.
+ *
+ * The assertions are recorded before they are passed to the inner solver
+ * (which is free to modify them) along with the result and the time that the
+ * inner solver took. Queries containing expressions that cannot be serialized
+ * are passed through without being recorded.
+ *
+ * The log can then be replayed against a different solver configuration using
+ * the bench-solver-replay tool.
+ */
+class LoggingSolver : public Solver {
+public:
+  LoggingSolver(std::shared_ptr<Solver> inner, QueryLogWriter* log);
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+
+private:
+  template <typename F>
+  SolverResult record(LoggedQuery::Method method, AssertionList& assertions,
+                      const Assertion& extra, F&& func);
+
+  std::shared_ptr<Solver> inner;
+  QueryLogWriter* log;
+};
+
+} // namespace caffeine
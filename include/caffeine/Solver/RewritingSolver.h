@@ -0,0 +1,38 @@
+#pragma once
+
+#include "caffeine/IR/Rewriter.h"
+#include "caffeine/Solver/Solver.h"
+
+#include <memory>
+
+namespace caffeine {
+
+/**
+ * Solver that simplifies new assertions using the default rewrite rules (see
+ * transforms::Rewriter) so that later solvers see smaller expressions.
+ *
+ * The extra assertion is rewritten as well. Since it can't be changed in place
+ * the query, with the rewritten extra assertion, is passed on to the inner
+ * solver which should contain the rest of the solver chain.
+ *
+ * The rewriter is kept across queries so that subexpressions shared between
+ * queries are only rewritten once. Like the other solvers this isn't safe to
+ * use from multiple threads at once.
+ */
+class RewritingSolver final : public Solver {
+public:
+  RewritingSolver(std::unique_ptr<Solver>&& inner);
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+
+private:
+  Assertion rewrite(AssertionList& assertions, const Assertion& extra);
+
+  transforms::Rewriter rewriter_;
+  std::unique_ptr<Solver> inner_;
+};
+
+} // namespace caffeine
@@ -15,6 +15,9 @@ namespace caffeine {
  * If any of the solvers in the chain return a result other than Unknown then
  * execution of the sequence stops there and that result is returned. If none of
  * the solvers return a result then Unknown is returned.
+ *
+ * Solvers in the chain may also be held through a std::unique_ptr<Solver>.
+ * This allows putting solvers in front of one that is picked at runtime.
  */
 template <typename... Ts>
 class SequenceSolver final : public Solver {
@@ -28,19 +31,31 @@ public:
   SolverResult check(AssertionList& assertions,
                      const Assertion& extra) override {
     return do_internal<0>(
-        [&](auto& solver) { return solver.check(assertions, extra); });
+        [&](Solver& solver) { return solver.check(assertions, extra); });
   }
 
   SolverResult resolve(AssertionList& assertions,
                        const Assertion& extra) override {
     return do_internal<0>(
-        [&](auto& solver) { return solver.resolve(assertions, extra); });
+        [&](Solver& solver) { return solver.resolve(assertions, extra); });
   }
 
 private:
+  template <typename T>
+  static constexpr bool is_solver_ptr =
+      std::is_same_v<T, std::unique_ptr<Solver>>;
+
+  template <typename T>
+  static Solver& get_solver(T& solver) {
+    if constexpr (is_solver_ptr<T>)
+      return *solver;
+    else
+      return solver;
+  }
+
   template <size_t i, typename F>
   SolverResult do_internal(F&& func) {
-    SolverResult result = func(std::get<i>(solvers));
+    SolverResult result = func(get_solver(std::get<i>(solvers)));
     if (result != SolverResult::Unknown)
       return result;
 
@@ -52,7 +67,7 @@ private:
   }
 
   static_assert(sizeof...(Ts) != 0);
-  static_assert((... && std::is_base_of_v<Solver, Ts>));
+  static_assert((... && (std::is_base_of_v<Solver, Ts> || is_solver_ptr<Ts>)));
 };
 
 template <typename... Ts>
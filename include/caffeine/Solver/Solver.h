@@ -67,6 +67,7 @@ protected:
   Model& operator=(Model&&) = default;
 
   friend class ExprEvaluator;
+  friend class CompiledExpr;
 };
 
 /**
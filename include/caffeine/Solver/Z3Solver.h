@@ -15,6 +15,7 @@ namespace caffeine {
 
 class Model;
 class Assertion;
+class CancellationToken;
 
 class Z3Solver : public Solver {
 private:
@@ -24,7 +25,12 @@ private:
   std::unique_ptr<Impl> impl;
 
 public:
-  Z3Solver();
+  /**
+   * If cancel is not null then queries made while it is cancelled return
+   * Unknown without running and a query that is running when it is cancelled
+   * is interrupted. The token must outlive the solver.
+   */
+  explicit Z3Solver(CancellationToken* cancel = nullptr);
   ~Z3Solver();
 
   Z3Solver(Z3Solver&& solver) noexcept;
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+
+namespace caffeine {
+
+/**
+ * A flag that can be set from any thread to ask long-running work to stop
+ * early.
+ *
+ * Code that runs in a loop should poll is_cancelled. Code that blocks for a
+ * long time without returning control to caffeine (e.g. a solver query) can
+ * instead register a callback with on_cancel. Callbacks are invoked on the
+ * thread that calls cancel.
+ */
+class CancellationToken {
+private:
+  using CallbackList = std::list<std::function<void()>>;
+
+public:
+  /**
+   * Keeps a callback registered for as long as it is alive.
+   */
+  class Registration {
+  public:
+    Registration() = default;
+    ~Registration();
+
+    Registration(Registration&& other) noexcept;
+    Registration& operator=(Registration&& other) noexcept;
+
+    Registration(const Registration&) = delete;
+    Registration& operator=(const Registration&) = delete;
+
+  private:
+    Registration(CancellationToken* token, CallbackList::iterator it);
+
+    void reset();
+
+    CancellationToken* token = nullptr;
+    CallbackList::iterator it;
+
+    friend class CancellationToken;
+  };
+
+public:
+  CancellationToken() = default;
+
+  bool is_cancelled() const {
+    return cancelled_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Cancel the token and invoke all registered callbacks. Returns true if this
+   * call was the one that cancelled the token.
+   */
+  bool cancel();
+
+  /**
+   * Register a callback to be invoked when the token is cancelled. If the
+   * token has already been cancelled then the callback is invoked immediately
+   * instead.
+   *
+   * Callbacks may not register or unregister callbacks on the same token.
+   */
+  [[nodiscard]] Registration on_cancel(std::function<void()> callback);
+
+  CancellationToken(const CancellationToken&) = delete;
+  CancellationToken& operator=(const CancellationToken&) = delete;
+
+private:
+  std::atomic<bool> cancelled_ = false;
+
+  std::mutex mutex_;
+  CallbackList callbacks_;
+};
+
+} // namespace caffeine
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace llvm::json {
+class OStream;
+}
+
+namespace caffeine::stats {
+
+/**
+ * Base class for all statistics.
+ *
+ * Statistics are meant to be declared as static variables within the
+ * translation unit that updates them. They register themselves in a global
+ * registry when constructed so that they can be reported without the reporter
+ * needing to know about them. Names are dotted paths with the first component
+ * being the subsystem (e.g. "solver.z3.queries").
+ *
+ * All statistics are sharded by thread so that updating them is a single
+ * uncontended relaxed atomic operation in the common case. Reading a statistic
+ * sums over all shards and so is comparatively expensive.
+ */
+class Statistic {
+public:
+  enum class Kind { Counter, Gauge, Histogram };
+
+  Statistic(Kind kind, std::string_view name, std::string_view desc);
+  virtual ~Statistic();
+
+  Kind kind() const {
+    return kind_;
+  }
+  std::string_view name() const {
+    return name_;
+  }
+  std::string_view desc() const {
+    return desc_;
+  }
+
+  virtual void write_json(llvm::json::OStream& os) const = 0;
+
+  Statistic(const Statistic&) = delete;
+  Statistic& operator=(const Statistic&) = delete;
+
+protected:
+  static constexpr size_t NUM_SHARDS = 32;
+
+  // Index of the shard that the current thread should update.
+  static size_t shard_index();
+
+private:
+  Kind kind_;
+  std::string name_;
+  std::string desc_;
+};
+
+/**
+ * A monotonically increasing count of events.
+ */
+class Counter final : public Statistic {
+public:
+  Counter(std::string_view name, std::string_view desc);
+
+  void add(uint64_t value = 1) {
+    shards_[shard_index()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+  Counter& operator++() {
+    add();
+    return *this;
+  }
+  Counter& operator+=(uint64_t value) {
+    add(value);
+    return *this;
+  }
+
+  uint64_t value() const;
+
+  void write_json(llvm::json::OStream& os) const override;
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value = 0;
+  };
+
+  std::array<Shard, NUM_SHARDS> shards_;
+};
+
+/**
+ * A value which can go both up and down, such as the number of queued paths.
+ *
+ * Gauges only support relative updates so that they can be sharded the same
+ * way as counters.
+ */
+class Gauge final : public Statistic {
+public:
+  Gauge(std::string_view name, std::string_view desc);
+
+  void add(int64_t value = 1) {
+    shards_[shard_index()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+  void sub(int64_t value = 1) {
+    add(-value);
+  }
+
+  int64_t value() const;
+
+  void write_json(llvm::json::OStream& os) const override;
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value = 0;
+  };
+
+  std::array<Shard, NUM_SHARDS> shards_;
+};
+
+/**
+ * A distribution of recorded values.
+ *
+ * Values are stored in log-linear buckets in the style of HDR histograms:
+ * every power of two is split into 8 equally sized buckets. This means that
+ * reported percentiles are within 12.5% of the actual value across the whole
+ * range of uint64_t while using a fixed amount of memory.
+ */
+class Histogram final : public Statistic {
+public:
+  static constexpr size_t SUB_BUCKETS = 8;
+  static constexpr size_t NUM_BUCKETS = 62 * SUB_BUCKETS;
+
+  struct Summary {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::array<uint64_t, NUM_BUCKETS> buckets = {};
+
+    double mean() const;
+    // Get the approximate value at the given percentile (0 to 100).
+    uint64_t percentile(double p) const;
+  };
+
+  Histogram(std::string_view name, std::string_view desc);
+
+  void record(uint64_t value);
+  Summary summary() const;
+
+  void write_json(llvm::json::OStream& os) const override;
+
+  static size_t bucket_index(uint64_t value);
+  static uint64_t bucket_lower_bound(size_t index);
+
+private:
+  // Histograms are much larger than counters so use fewer shards.
+  static constexpr size_t NUM_HISTOGRAM_SHARDS = 8;
+
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> sum = 0;
+    std::atomic<uint64_t> max = 0;
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets = {};
+  };
+
+  std::unique_ptr<std::array<Shard, NUM_HISTOGRAM_SHARDS>> shards_;
+};
+
+/**
+ * Records the time between its construction and destruction into a
+ * histogram, in nanoseconds.
+ */
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Histogram& hist)
+      : hist_(hist), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    hist_.record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  Histogram& hist_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Look up a registered statistic by name. Returns nullptr if there is no
+ * statistic with that name.
+ */
+const Statistic* find(std::string_view name);
+
+/**
+ * Write all registered statistics as a JSON object keyed by name.
+ */
+void write_json(std::ostream& os);
+
+/**
+ * Periodically print a one-line status summary.
+ *
+ * The status line contains the elapsed time and the current value of each of
+ * the named statistics. Counters are also shown with their rate over the last
+ * interval. Histograms are assumed to contain durations in nanoseconds (as
+ * recorded by ScopedTimer) and are shown as the total time in seconds. Names
+ * which don't refer to a registered statistic are skipped.
+ *
+ * Reporting stops when the reporter is destroyed.
+ */
+class StatusReporter {
+public:
+  StatusReporter(std::ostream& os, std::chrono::milliseconds interval,
+                 std::vector<std::string> names);
+  ~StatusReporter();
+
+  // Print a status line immediately.
+  void report();
+
+  StatusReporter(const StatusReporter&) = delete;
+  StatusReporter& operator=(const StatusReporter&) = delete;
+
+private:
+  void run();
+
+  std::ostream& os_;
+  std::chrono::milliseconds interval_;
+  std::vector<std::string> names_;
+  std::vector<uint64_t> last_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point last_report_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+} // namespace caffeine::stats
@@ -9,6 +9,10 @@ namespace caffeine::tracing {
 
 class TraceSink;
 
+namespace detail {
+  struct TraceEvent;
+}
+
 /**
  * Open a new tracing context.
  *
@@ -67,6 +71,13 @@ public:
  * are stubbed out and should be completely optimized away, making it zero-cost.
  * Otherwise, there is a runtime check when creating the block.
  *
+ * When tracing is enabled, spans are recorded into fixed-size events taken
+ * from a per-thread pool. Span names and annotation keys are interned so
+ * recording a span doesn't allocate in the common case. Completed spans are
+ * pushed into a per-thread ring buffer which is drained by a background thread
+ * that does all the serialization and IO. If a ring buffer fills up then new
+ * spans are dropped (and counted) instead of blocking the thread.
+ *
  * If creating an annotation would be expensive then you can use is_enabled to
  * check whether this block will record anything and only emit the annotation if
  * it would.
@@ -83,14 +94,13 @@ public:
 class AutoTraceBlock {
 private:
 #if CAFFEINE_ENABLE_TRACING
-  struct Impl;
-
-  std::unique_ptr<Impl> impl;
+  detail::TraceEvent* event = nullptr;
 #endif
 
 public:
   // Limit annotation size to 32KB to keep the annotation file size from
-  // exploding.
+  // exploding. Small annotations are stored inline within the trace event,
+  // larger ones spill over into a separate heap allocation.
   //
   // Note that chrome can only load at most 256MB of trace data so raising this
   // limit can cause problems for traces with large annotations.
@@ -179,10 +189,6 @@ public:
   AutoTraceBlock& operator=(const AutoTraceBlock&) = delete;
 };
 
-namespace detail {
-  void annotate_tid(AutoTraceBlock& block);
-}
-
 /**
  * Open a trace block and record some common trace metadata.
  *
@@ -195,7 +201,6 @@ namespace detail {
              .annotate("line", CAFFEINE_STRINGIFY(__LINE__))                   \
              .annotate("file", __FILE__)                                       \
              .annotate("func", CAFFEINE_FUNCTION)                              \
-             .annotate_func(::caffeine::tracing::detail::annotate_tid)         \
        : ::caffeine::tracing::AutoTraceBlock::empty())
 
 } // namespace caffeine::tracing
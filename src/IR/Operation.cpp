@@ -3,6 +3,7 @@
 #include "caffeine/IR/Type.h"
 #include "caffeine/IR/Value.h"
 #include "caffeine/Support/Macros.h"
+#include "caffeine/Support/Stats.h"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/container_hash/hash.hpp>
@@ -26,9 +27,13 @@ namespace caffeine {
 Operation::Operation() : opcode_(Invalid), type_(Type::void_ty()) {}
 
 Operation::Operation(Opcode op, Type t, const Inner& inner)
-    : opcode_(static_cast<uint16_t>(op)), type_(t), inner_(inner) {}
+    : opcode_(static_cast<uint16_t>(op)), type_(t), inner_(inner) {
+  compute_metrics();
+}
 Operation::Operation(Opcode op, Type t, Inner&& inner)
-    : opcode_(static_cast<uint16_t>(op)), type_(t), inner_(std::move(inner)) {}
+    : opcode_(static_cast<uint16_t>(op)), type_(t), inner_(std::move(inner)) {
+  compute_metrics();
+}
 
 Operation::Operation(Opcode op, Type t)
     : opcode_(static_cast<uint16_t>(op)), type_(t), inner_(std::monostate()) {}
@@ -43,6 +48,7 @@ Operation::Operation(Opcode op, Type t, const OpRef* operands)
   CAFFEINE_ASSERT(op != Invalid);
   // No opcodes have > 3 operands
   CAFFEINE_ASSERT(num_operands() <= 3, "Invalid opcode");
+  compute_metrics();
 }
 
 Operation::Operation(Opcode op, Type t, const OpRef& op0)
@@ -50,12 +56,14 @@ Operation::Operation(Opcode op, Type t, const OpRef& op0)
   CAFFEINE_ASSERT(detail::opcode_base(opcode_) != 1,
                   "Tried to create a constant with operands");
   CAFFEINE_ASSERT(num_operands() == 1);
+  compute_metrics();
 }
 Operation::Operation(Opcode op, Type t, const OpRef& op0, const OpRef& op1)
     : opcode_(static_cast<uint16_t>(op)), type_(t), inner_(OpVec{op0, op1}) {
   CAFFEINE_ASSERT(detail::opcode_base(opcode_) != 1,
                   "Tried to create a constant with operands");
   CAFFEINE_ASSERT(num_operands() == 2);
+  compute_metrics();
 }
 Operation::Operation(Opcode op, Type t, const OpRef& op0, const OpRef& op1,
                      const OpRef& op2)
@@ -64,19 +72,41 @@ Operation::Operation(Opcode op, Type t, const OpRef& op0, const OpRef& op1,
   CAFFEINE_ASSERT(detail::opcode_base(opcode_) != 1,
                   "Tried to create a constant with operands");
   CAFFEINE_ASSERT(num_operands() == 3);
+  compute_metrics();
 }
 
 Operation::Operation(const Operation& op)
     : std::enable_shared_from_this<Operation>(), opcode_(op.opcode_),
-      type_(op.type_), inner_(op.inner_) {
+      depth_(op.depth_), tree_size_(op.tree_size_), type_(op.type_),
+      inner_(op.inner_) {
   copy_vtable(op);
 }
 Operation::Operation(Operation&& op) noexcept
     : std::enable_shared_from_this<Operation>(), opcode_(op.opcode_),
-      type_(op.type_), inner_(std::move(op.inner_)) {
+      depth_(op.depth_), tree_size_(op.tree_size_), type_(op.type_),
+      inner_(std::move(op.inner_)) {
   copy_vtable(op);
 }
 
+void Operation::compute_metrics() {
+  // Only nodes with regular operands contribute to the metrics. Arrays are
+  // treated as leaves since walking a FixedArray's elements would be too
+  // expensive to do for every node.
+  const OpVec* operands = std::get_if<OpVec>(&inner_);
+  if (!operands)
+    return;
+
+  uint64_t depth = 0;
+  uint64_t tree_size = 1;
+  for (const OpRef& operand : *operands) {
+    depth = std::max<uint64_t>(depth, operand->depth());
+    tree_size += operand->tree_size();
+  }
+
+  depth_ = (uint16_t)std::min<uint64_t>(depth + 1, UINT16_MAX);
+  tree_size_ = (uint32_t)std::min<uint64_t>(tree_size, UINT32_MAX);
+}
+
 Operation::~Operation() {
   if (opcode_ != FixedArray)
     OperationCache::cache.erase(*this);
@@ -87,6 +117,8 @@ Operation& Operation::operator=(const Operation& op) {
   inner_ = op.inner_;
   type_ = op.type_;
   opcode_ = op.opcode_;
+  depth_ = op.depth_;
+  tree_size_ = op.tree_size_;
 
   copy_vtable(op);
 
@@ -96,6 +128,8 @@ Operation& Operation::operator=(Operation&& op) noexcept {
   inner_ = std::move(op.inner_);
   type_ = op.type_;
   opcode_ = op.opcode_;
+  depth_ = op.depth_;
+  tree_size_ = op.tree_size_;
 
   copy_vtable(op);
 
@@ -253,6 +287,19 @@ std::ostream& operator<<(std::ostream& os, Operation::Opcode opcode) {
  ***************************************************/
 OperationCache OperationCache::cache{};
 
+namespace {
+  stats::Counter cache_hits{"ir.opcache.hits",
+                            "Number of operations found in the cache"};
+  stats::Counter cache_misses{"ir.opcache.misses",
+                              "Number of new operations added to the cache"};
+
+  thread_local uint64_t num_created = 0;
+} // namespace
+
+uint64_t Operation::num_created_on_thread() {
+  return num_created;
+}
+
 OpRef OperationCache::find(size_t key, const Operation& op) {
 
   auto [start, end] = map.equal_range(key);
@@ -278,8 +325,12 @@ OpRef OperationCache::intern(Operation&& op) {
 
   std::unique_lock<std::mutex> lock{mutex};
   auto cached = find(key, op);
-  if (cached)
+  if (cached) {
+    ++cache_hits;
     return cached;
+  }
+  ++cache_misses;
+  ++num_created;
 
   auto shared = std::make_shared<Operation>(std::move(op));
   map.emplace(key, shared);
@@ -291,8 +342,12 @@ OpRef OperationCache::intern(const Operation& op) {
 
   std::unique_lock<std::mutex> lock{mutex};
   auto cached = find(key, op);
-  if (cached)
+  if (cached) {
+    ++cache_hits;
     return cached;
+  }
+  ++cache_misses;
+  ++num_created;
 
   auto shared = std::make_shared<Operation>(op);
   map.emplace(key, shared);
@@ -359,7 +414,10 @@ Operation::Opcode Constant::op_for_symbol(const Symbol& symbol) {
 ConstantInt::ConstantInt(const llvm::APInt& iconst)
     : Operation(Opcode::ConstantInt, Type::type_of(iconst), iconst) {}
 ConstantInt::ConstantInt(llvm::APInt&& iconst)
-    : Operation(Opcode::ConstantInt, Type::type_of(iconst), std::move(iconst)) {
+    : Operation(Opcode::ConstantInt, Type::type_of(iconst)) {
+  // The type has to be computed before iconst is moved from. Doing both as
+  // arguments to the same constructor leaves the order unspecified.
+  inner_ = std::move(iconst);
 }
 
 Value ConstantInt::as_value() const {
@@ -370,7 +428,7 @@ OpRef ConstantInt::Create(const llvm::APInt& iconst) {
   return OpRef(new ConstantInt(iconst));
 }
 OpRef ConstantInt::Create(llvm::APInt&& iconst) {
-  return OpRef(new ConstantInt(iconst));
+  return OpRef(new ConstantInt(std::move(iconst)));
 }
 OpRef ConstantInt::Create(bool value) {
   return ConstantInt::Create(llvm::APInt(1, static_cast<uint64_t>(value)));
@@ -845,6 +903,42 @@ OpRef LoadOp::Create(const OpRef& data, const OpRef& offset) {
   return constant_fold(LoadOp(data, offset));
 }
 
+namespace {
+  // Split an offset into a symbolic base (null if the offset is a constant)
+  // and a constant displacement from that base.
+  std::pair<const Operation*, const llvm::APInt*>
+  split_offset(const OpRef& offset, const llvm::APInt& zero) {
+    if (const auto* constant = llvm::dyn_cast<ConstantInt>(offset.get()))
+      return {nullptr, &constant->value()};
+
+    if (offset->opcode() == Operation::Add) {
+      const OpRef& lhs = offset->operand_at(0);
+      const OpRef& rhs = offset->operand_at(1);
+      if (const auto* constant = llvm::dyn_cast<ConstantInt>(rhs.get()))
+        return {lhs.get(), &constant->value()};
+      if (const auto* constant = llvm::dyn_cast<ConstantInt>(lhs.get()))
+        return {rhs.get(), &constant->value()};
+    }
+
+    return {offset.get(), &zero};
+  }
+} // namespace
+
+LoadOp::Alias LoadOp::compare_offsets(const OpRef& a, const OpRef& b) {
+  if (a == b)
+    return Alias::Equal;
+  if (a->type() != b->type())
+    return Alias::Unknown;
+
+  auto zero = llvm::APInt::getNullValue(a->type().bitwidth());
+  auto [abase, aoffset] = split_offset(a, zero);
+  auto [bbase, boffset] = split_offset(b, zero);
+
+  if (abase != bbase)
+    return Alias::Unknown;
+  return *aoffset == *boffset ? Alias::Equal : Alias::Distinct;
+}
+
 /***************************************************
  * StoreOp                                         *
  ***************************************************/
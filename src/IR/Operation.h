@@ -2,6 +2,7 @@
 
 #include "caffeine/IR/Matching.h"
 #include "caffeine/IR/Operation.h"
+#include "caffeine/IR/SmallInt.h"
 #include "caffeine/IR/Value.h"
 #include "caffeine/IR/Visitor.h"
 #include <llvm/Support/MathExtras.h>
@@ -132,6 +133,8 @@ public:
 
   OpRef visit(const Operation& op) {
 #ifdef CAFFEINE_IMPLICIT_CONSTANT_FOLDING
+    if (auto folded = this->try_small_int(op))
+      return folded;
     return ConstOpVisitor<ConstantFolder<move_out>, OpRef>::visit(op);
 #else
     return visitOperation(op);
@@ -527,6 +530,22 @@ public:
     return this->visitArrayBase(op);
   }
   OpRef visitLoadOp(const LoadOp& op) {
+    // Skip over stores that provably don't overlap with the load and read
+    // the value directly out of a store to the same offset.
+    const OpRef* data = &op.data();
+    while (const auto* store = llvm::dyn_cast<StoreOp>(data->get())) {
+      auto alias = LoadOp::compare_offsets(store->offset(), op.offset());
+      if (alias == LoadOp::Alias::Equal)
+        return store->value();
+      if (alias == LoadOp::Alias::Unknown)
+        break;
+
+      data = &store->data();
+    }
+
+    if (data != &op.data())
+      return LoadOp::Create(*data, op.offset());
+
     const auto* fixedarray = llvm::dyn_cast<FixedArray>(op.data().get());
     const auto* offset_int = llvm::dyn_cast<ConstantInt>(op.offset().get());
 
@@ -568,6 +587,81 @@ public:
   }
 
 private:
+  // Fold integer operations whose operands are all constants of at most 64
+  // bits using SmallInt instead of APInt. Wider constants are folded by the
+  // individual visit methods.
+  OpRef try_small_int(const Operation& op) {
+    auto constant = [&](size_t idx) -> std::optional<SmallInt> {
+      const OpRef& operand = op.operand_at(idx);
+      if (const auto* value = llvm::dyn_cast<ConstantInt>(operand.get()))
+        return SmallInt::from(value->value());
+      return std::nullopt;
+    };
+    auto binary = [&](auto&& func) -> OpRef {
+      auto lhs = constant(0);
+      if (!lhs)
+        return nullptr;
+      auto rhs = constant(1);
+      if (!rhs)
+        return nullptr;
+      return ConstantInt::Create(func(*lhs, *rhs).apint());
+    };
+    auto cast = [&](auto&& func) -> OpRef {
+      uint32_t width = op.type().bitwidth();
+      auto value = constant(0);
+      if (!value || width > SmallInt::MaxWidth)
+        return nullptr;
+      return ConstantInt::Create(func(*value, width).apint());
+    };
+
+    switch (op.opcode()) {
+    // clang-format off
+    case Operation::Add:   return binary(SmallInt::add);
+    case Operation::Sub:   return binary(SmallInt::sub);
+    case Operation::Mul:   return binary(SmallInt::mul);
+    case Operation::UDiv:  return binary(SmallInt::udiv);
+    case Operation::SDiv:  return binary(SmallInt::sdiv);
+    case Operation::URem:  return binary(SmallInt::urem);
+    case Operation::SRem:  return binary(SmallInt::srem);
+    case Operation::And:   return binary(SmallInt::bvand);
+    case Operation::Or:    return binary(SmallInt::bvor);
+    case Operation::Xor:   return binary(SmallInt::bvxor);
+    case Operation::Shl:   return binary(SmallInt::shl);
+    case Operation::LShr:  return binary(SmallInt::lshr);
+    case Operation::AShr:  return binary(SmallInt::ashr);
+    case Operation::Trunc: return cast(SmallInt::trunc);
+    case Operation::ZExt:  return cast(SmallInt::zext);
+    case Operation::SExt:  return cast(SmallInt::sext);
+    // clang-format on
+    case Operation::Not:
+      if (auto value = constant(0))
+        return ConstantInt::Create(SmallInt::bvnot(*value).apint());
+      return nullptr;
+    case Operation::ICmpEq:
+    case Operation::ICmpNe:
+    case Operation::ICmpUgt:
+    case Operation::ICmpUge:
+    case Operation::ICmpUlt:
+    case Operation::ICmpUle:
+    case Operation::ICmpSgt:
+    case Operation::ICmpSge:
+    case Operation::ICmpSlt:
+    case Operation::ICmpSle: {
+      auto lhs = constant(0);
+      if (!lhs)
+        return nullptr;
+      auto rhs = constant(1);
+      if (!rhs)
+        return nullptr;
+
+      auto cmp = llvm::cast<ICmpOp>(op).comparison();
+      return ConstantInt::Create(SmallInt::icmp(cmp, *lhs, *rhs));
+    }
+    default:
+      return nullptr;
+    }
+  }
+
   template <typename... Ts>
   std::optional<std::array<const ConstantInt*, sizeof...(Ts)>>
   as_const_int(const Ts&... args) {
@@ -0,0 +1,54 @@
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Transforms.h"
+#include "caffeine/Support/Stats.h"
+
+namespace caffeine::transforms {
+
+namespace {
+  stats::Counter num_alias_queries{
+      "forward_loads.queries",
+      "Number of times the alias oracle was asked about a pair of offsets"};
+  stats::Counter num_forwarded{
+      "forward_loads.resolved",
+      "Number of stores that the alias oracle allowed a load to see through"};
+} // namespace
+
+OpRef forward_loads(
+    const OpRef& expr,
+    llvm::function_ref<LoadOp::Alias(const OpRef&, const OpRef&)> oracle,
+    size_t max_queries) {
+  size_t queries = 0;
+
+  auto visitor = [&](const OpRef& op) -> OpRef {
+    const auto* load = llvm::dyn_cast<LoadOp>(op.get());
+    if (!load)
+      return op;
+
+    const OpRef* data = &load->data();
+    while (const auto* store = llvm::dyn_cast<StoreOp>(data->get())) {
+      auto alias = LoadOp::compare_offsets(store->offset(), load->offset());
+      if (alias == LoadOp::Alias::Unknown && queries < max_queries) {
+        queries += 1;
+        ++num_alias_queries;
+        alias = oracle(store->offset(), load->offset());
+        if (alias != LoadOp::Alias::Unknown)
+          ++num_forwarded;
+      }
+
+      if (alias == LoadOp::Alias::Equal)
+        return store->value();
+      if (alias == LoadOp::Alias::Unknown)
+        break;
+
+      data = &store->data();
+    }
+
+    if (data == &load->data())
+      return op;
+    return LoadOp::Create(*data, load->offset());
+  };
+
+  return rebuild(expr, visitor);
+}
+
+} // namespace caffeine::transforms
@@ -0,0 +1,606 @@
+#include "caffeine/IR/Rewriter.h"
+
+#include "caffeine/ADT/Guard.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Matching.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Stats.h"
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+#include <optional>
+
+namespace caffeine::transforms {
+namespace m = caffeine::matching;
+
+namespace {
+  stats::Counter num_rewrites{"rewrite.rules_applied",
+                              "Number of times a rewrite rule was applied"};
+
+  // Rules producing new nodes cause those nodes to be rewritten in turn. This
+  // bounds how deep that can go in case a set of rules ends up cycling.
+  constexpr size_t max_rewrite_depth = 32;
+
+  const llvm::APInt* as_int(const OpRef& op) {
+    if (const auto* constant = llvm::dyn_cast<ConstantInt>(op.get()))
+      return &constant->value();
+    return nullptr;
+  }
+
+  unsigned bitwidth(const OpRef& op) {
+    return op->type().bitwidth();
+  }
+
+  // Split expr into a non-constant part and a constant part if it is of the
+  // form (op x c), or (op c x) for commutative operations.
+  bool split_const(const OpRef& expr, Operation::Opcode opcode, OpRef& value,
+                   const llvm::APInt*& constant) {
+    if (expr->opcode() != opcode)
+      return false;
+
+    const OpRef& lhs = expr->operand_at(0);
+    const OpRef& rhs = expr->operand_at(1);
+    if ((constant = as_int(rhs))) {
+      value = lhs;
+      return true;
+    }
+    // Only the commutative operations are allowed to have the constant on the
+    // left.
+    if (opcode != Operation::Sub && opcode != Operation::Shl &&
+        opcode != Operation::LShr && opcode != Operation::AShr &&
+        (constant = as_int(lhs))) {
+      value = rhs;
+      return true;
+    }
+    return false;
+  }
+
+  /*************************************************
+   * Casts                                         *
+   *************************************************/
+
+  // (trunc (zext x)) -> x, (trunc x), or (zext x) depending on the widths
+  // involved. Same for sext.
+  OpRef trunc_of_ext(const OpRef& expr) {
+    OpRef value;
+    if (matches(expr, m::Trunc(m::ZExt(value))))
+      return UnaryOp::CreateTruncOrZExt(expr->type(), value);
+    if (matches(expr, m::Trunc(m::SExt(value))))
+      return UnaryOp::CreateTruncOrSExt(expr->type(), value);
+    return nullptr;
+  }
+
+  // (trunc (trunc x)) -> (trunc x)
+  OpRef trunc_of_trunc(const OpRef& expr) {
+    OpRef value;
+    if (matches(expr, m::Trunc(m::Trunc(value))))
+      return UnaryOp::CreateTrunc(expr->type(), value);
+    return nullptr;
+  }
+
+  // (trunc (and x c)) -> (trunc x) if c doesn't mask out any of the low bits.
+  OpRef trunc_of_mask(const OpRef& expr) {
+    OpRef value;
+    const llvm::APInt* mask;
+    if (!split_const(expr->operand_at(0), Operation::And, value, mask))
+      return nullptr;
+
+    if (!mask->trunc(bitwidth(expr)).isAllOnesValue())
+      return nullptr;
+    return UnaryOp::CreateTrunc(expr->type(), value);
+  }
+
+  // Number of low bits of expr that are known to be zero.
+  unsigned known_low_zeros(const OpRef& expr) {
+    if (const llvm::APInt* value = as_int(expr))
+      return value->countTrailingZeros();
+
+    OpRef inner, shift;
+    if (matches(expr, m::Shl(inner, m::ConstantInt(shift)))) {
+      const llvm::APInt& amount = llvm::cast<ConstantInt>(*shift).value();
+      return amount.getLimitedValue(bitwidth(expr));
+    }
+
+    return 0;
+  }
+
+  // (trunc (or x y)) -> (trunc x) if the truncated bits of y are all zero.
+  OpRef trunc_of_or(const OpRef& expr) {
+    OpRef lhs, rhs;
+    if (!matches(expr, m::Trunc(m::Or(lhs, rhs))))
+      return nullptr;
+
+    unsigned width = bitwidth(expr);
+    if (known_low_zeros(rhs) >= width)
+      return UnaryOp::CreateTrunc(expr->type(), lhs);
+    if (known_low_zeros(lhs) >= width)
+      return UnaryOp::CreateTrunc(expr->type(), rhs);
+    return nullptr;
+  }
+
+  // (zext (zext x)) -> (zext x)
+  OpRef zext_of_zext(const OpRef& expr) {
+    OpRef value;
+    if (matches(expr, m::ZExt(m::ZExt(value))))
+      return UnaryOp::CreateZExt(expr->type(), value);
+    return nullptr;
+  }
+
+  // (sext (sext x)) -> (sext x)
+  // (sext (zext x)) -> (zext x) since the sign bit of (zext x) is always 0.
+  OpRef sext_of_ext(const OpRef& expr) {
+    OpRef value;
+    if (matches(expr, m::SExt(m::SExt(value))))
+      return UnaryOp::CreateSExt(expr->type(), value);
+
+    OpRef inner;
+    if (matches(expr, m::SExt(m::Capture(inner, m::ZExt(value)))) &&
+        bitwidth(inner) > bitwidth(value))
+      return UnaryOp::CreateZExt(expr->type(), value);
+    return nullptr;
+  }
+
+  /*************************************************
+   * Shifts and Masks                              *
+   *************************************************/
+
+  // (lshr (shl x c) c) -> (and x low-mask)
+  // (shl (lshr x c) c) -> (and x high-mask)
+  OpRef shift_pair(const OpRef& expr) {
+    OpRef value, outer_amount, inner_amount;
+    bool is_lshr = matches(expr, m::LShr(m::Shl(value, inner_amount),
+                                         m::ConstantInt(outer_amount)));
+    if (!is_lshr && !matches(expr, m::Shl(m::LShr(value, inner_amount),
+                                          m::ConstantInt(outer_amount))))
+      return nullptr;
+
+    if (*inner_amount != *outer_amount)
+      return nullptr;
+
+    unsigned width = bitwidth(expr);
+    const llvm::APInt& amount = llvm::cast<ConstantInt>(*outer_amount).value();
+    if (amount.uge(width))
+      return nullptr;
+
+    unsigned kept = width - amount.getZExtValue();
+    auto mask = is_lshr ? llvm::APInt::getLowBitsSet(width, kept)
+                        : llvm::APInt::getHighBitsSet(width, kept);
+    return BinaryOp::CreateAnd(value, ConstantInt::Create(mask));
+  }
+
+  // (and (zext x) c) -> (zext x) if c covers all the bits of x.
+  // (and (lshr x c1) c2) -> (lshr x c1) if c2 covers all the shifted bits.
+  OpRef redundant_mask(const OpRef& expr) {
+    OpRef value;
+    const llvm::APInt* mask;
+    if (!split_const(expr, Operation::And, value, mask))
+      return nullptr;
+
+    OpRef inner, amount;
+    unsigned width = bitwidth(expr);
+    unsigned significant;
+    if (matches(value, m::ZExt(inner))) {
+      significant = bitwidth(inner);
+    } else if (matches(value, m::LShr(inner, m::ConstantInt(amount)))) {
+      const auto& shift = llvm::cast<ConstantInt>(*amount).value();
+      significant = width - std::min<uint64_t>(shift.getLimitedValue(), width);
+    } else {
+      return nullptr;
+    }
+
+    if (mask->countTrailingOnes() >= significant)
+      return value;
+    return nullptr;
+  }
+
+  /**
+   * Describes a term of an or expression as a range of bits taken from some
+   * source expression and moved to a (possibly) different position.
+   */
+  struct BitField {
+    OpRef source;
+    unsigned lo;
+    unsigned len;
+    unsigned pos;
+  };
+
+  // Try to describe an expression of the form
+  //   (shl (and (lshr source lo) low-mask) pos)
+  // where any of the shl, and, or lshr may be missing.
+  std::optional<BitField> describe_field(const OpRef& expr) {
+    unsigned width = bitwidth(expr);
+    BitField field{expr, 0, width, 0};
+
+    OpRef inner, amount;
+    if (matches(field.source, m::Shl(inner, m::ConstantInt(amount)))) {
+      const auto& shift = llvm::cast<ConstantInt>(*amount).value();
+      if (shift.uge(width))
+        return std::nullopt;
+      field.pos = shift.getZExtValue();
+      field.source = inner;
+    }
+
+    OpRef value;
+    const llvm::APInt* mask;
+    if (split_const(field.source, Operation::And, value, mask)) {
+      if (!mask->isMask())
+        return std::nullopt;
+      field.len = mask->countTrailingOnes();
+      field.source = value;
+    }
+
+    if (matches(field.source, m::LShr(inner, m::ConstantInt(amount)))) {
+      const auto& shift = llvm::cast<ConstantInt>(*amount).value();
+      if (shift.uge(width))
+        return std::nullopt;
+      field.lo = shift.getZExtValue();
+      field.len = std::min(field.len, width - field.lo);
+      field.source = inner;
+    }
+
+    // Bits shifted past the top are dropped.
+    field.len = std::min(field.len, width - field.pos);
+    return field;
+  }
+
+  void collect_or_terms(const OpRef& expr, llvm::SmallVectorImpl<OpRef>& terms,
+                        size_t limit) {
+    llvm::SmallVector<const OpRef*, 8> stack{&expr};
+    while (!stack.empty() && terms.size() + stack.size() <= limit) {
+      const OpRef& term = *stack.pop_back_val();
+      if (term->opcode() == Operation::Or) {
+        stack.push_back(&term->operand_at(1));
+        stack.push_back(&term->operand_at(0));
+      } else {
+        terms.push_back(term);
+      }
+    }
+
+    // Anything left over once we hit the limit is kept as-is.
+    while (!stack.empty())
+      terms.push_back(*stack.pop_back_val());
+  }
+
+  // Reading a value back out of memory produces
+  //   (or (and x 0xFF) (shl (and (lshr x 8) 0xFF) 8) ...)
+  // Terms taking bits from the same source without moving them get merged
+  // into a single (and x mask) which is just x if every bit is covered.
+  OpRef reassemble_fields(const OpRef& expr) {
+    llvm::SmallVector<OpRef, 8> terms;
+    collect_or_terms(expr, terms, 64);
+
+    struct Group {
+      OpRef source;
+      llvm::APInt mask;
+      unsigned count;
+    };
+
+    unsigned width = bitwidth(expr);
+    llvm::SmallVector<Group, 4> groups;
+    llvm::SmallVector<OpRef, 8> rest;
+    bool merged = false;
+
+    for (const OpRef& term : terms) {
+      auto field = describe_field(term);
+      if (!field || field->lo != field->pos) {
+        rest.push_back(term);
+        continue;
+      }
+
+      auto mask = llvm::APInt::getBitsSet(width, field->lo,
+                                          field->lo + field->len);
+      auto it = std::find_if(groups.begin(), groups.end(), [&](const auto& g) {
+        return g.source == field->source;
+      });
+      if (it == groups.end()) {
+        groups.push_back(Group{field->source, mask, 1});
+      } else {
+        it->mask |= mask;
+        it->count += 1;
+        merged = true;
+      }
+    }
+
+    if (!merged)
+      return nullptr;
+
+    OpRef result = nullptr;
+    auto append = [&](OpRef term) {
+      result = result ? BinaryOp::CreateOr(result, term) : std::move(term);
+    };
+
+    // Constant folding takes care of the mask if it covers every bit.
+    for (const Group& group : groups)
+      append(
+          BinaryOp::CreateAnd(group.source, ConstantInt::Create(group.mask)));
+    for (const OpRef& term : rest)
+      append(term);
+
+    return result;
+  }
+
+  /*************************************************
+   * Comparisons                                   *
+   *************************************************/
+
+  ICmpOpcode swapped(ICmpOpcode cmp) {
+    switch (cmp) {
+    case ICmpOpcode::EQ:
+    case ICmpOpcode::NE:
+      return cmp;
+    case ICmpOpcode::UGT:
+      return ICmpOpcode::ULT;
+    case ICmpOpcode::UGE:
+      return ICmpOpcode::ULE;
+    case ICmpOpcode::ULT:
+      return ICmpOpcode::UGT;
+    case ICmpOpcode::ULE:
+      return ICmpOpcode::UGE;
+    case ICmpOpcode::SGT:
+      return ICmpOpcode::SLT;
+    case ICmpOpcode::SGE:
+      return ICmpOpcode::SLE;
+    case ICmpOpcode::SLT:
+      return ICmpOpcode::SGT;
+    case ICmpOpcode::SLE:
+      return ICmpOpcode::SGE;
+    }
+    CAFFEINE_UNREACHABLE("unknown ICmpOpcode");
+  }
+
+  ICmpOpcode inverted(ICmpOpcode cmp) {
+    switch (cmp) {
+    case ICmpOpcode::EQ:
+      return ICmpOpcode::NE;
+    case ICmpOpcode::NE:
+      return ICmpOpcode::EQ;
+    case ICmpOpcode::UGT:
+      return ICmpOpcode::ULE;
+    case ICmpOpcode::UGE:
+      return ICmpOpcode::ULT;
+    case ICmpOpcode::ULT:
+      return ICmpOpcode::UGE;
+    case ICmpOpcode::ULE:
+      return ICmpOpcode::UGT;
+    case ICmpOpcode::SGT:
+      return ICmpOpcode::SLE;
+    case ICmpOpcode::SGE:
+      return ICmpOpcode::SLT;
+    case ICmpOpcode::SLT:
+      return ICmpOpcode::SGE;
+    case ICmpOpcode::SLE:
+      return ICmpOpcode::SGT;
+    }
+    CAFFEINE_UNREACHABLE("unknown ICmpOpcode");
+  }
+
+  bool is_equality(ICmpOpcode cmp) {
+    return cmp == ICmpOpcode::EQ || cmp == ICmpOpcode::NE;
+  }
+
+  // (icmp c x) -> (icmp' x c) so constants are always on the right.
+  OpRef icmp_constant_rhs(const OpRef& expr) {
+    const auto& icmp = llvm::cast<ICmpOp>(*expr);
+    if (!as_int(icmp.lhs()) || as_int(icmp.rhs()))
+      return nullptr;
+
+    return ICmpOp::CreateICmp(swapped(icmp.comparison()), icmp.rhs(),
+                              icmp.lhs());
+  }
+
+  // (eq (zext x) c) -> (eq x (trunc c)) or false if c doesn't fit in x.
+  // (eq (add x c1) c2) -> (eq x (c2 - c1)), same for sub and xor.
+  OpRef icmp_equality(const OpRef& expr) {
+    const auto& icmp = llvm::cast<ICmpOp>(*expr);
+    const llvm::APInt* rhs = as_int(icmp.rhs());
+    if (!rhs || !is_equality(icmp.comparison()))
+      return nullptr;
+
+    ICmpOpcode cmp = icmp.comparison();
+    bool is_eq = cmp == ICmpOpcode::EQ;
+
+    OpRef value;
+    if (matches(icmp.lhs(), m::ZExt(value)) ||
+        matches(icmp.lhs(), m::SExt(value))) {
+      unsigned width = bitwidth(value);
+      llvm::APInt truncated = rhs->trunc(width);
+      llvm::APInt extended = icmp.lhs()->opcode() == Operation::ZExt
+                                 ? truncated.zext(rhs->getBitWidth())
+                                 : truncated.sext(rhs->getBitWidth());
+
+      if (extended != *rhs)
+        return ConstantInt::Create(!is_eq);
+      return ICmpOp::CreateICmp(cmp, value, ConstantInt::Create(truncated));
+    }
+
+    const llvm::APInt* c;
+    if (split_const(icmp.lhs(), Operation::Add, value, c))
+      return ICmpOp::CreateICmp(cmp, value, ConstantInt::Create(*rhs - *c));
+    if (split_const(icmp.lhs(), Operation::Sub, value, c))
+      return ICmpOp::CreateICmp(cmp, value, ConstantInt::Create(*rhs + *c));
+    if (split_const(icmp.lhs(), Operation::Xor, value, c))
+      return ICmpOp::CreateICmp(cmp, value, ConstantInt::Create(*rhs ^ *c));
+
+    // (eq x:i1 true) -> x, (eq x:i1 false) -> (not x)
+    if (rhs->getBitWidth() == 1)
+      return rhs->isOneValue() == is_eq ? icmp.lhs()
+                                        : UnaryOp::CreateNot(icmp.lhs());
+
+    return nullptr;
+  }
+
+  // Comparisons against the ends of the range are either trivial or can be
+  // turned into equalities.
+  OpRef icmp_range(const OpRef& expr) {
+    const auto& icmp = llvm::cast<ICmpOp>(*expr);
+    const llvm::APInt* rhs = as_int(icmp.rhs());
+    if (!rhs)
+      return nullptr;
+
+    unsigned width = rhs->getBitWidth();
+    auto zero = ConstantInt::Create(llvm::APInt::getNullValue(width));
+
+    switch (icmp.comparison()) {
+    case ICmpOpcode::ULT:
+      if (rhs->isNullValue())
+        return ConstantInt::Create(false);
+      if (rhs->isOneValue())
+        return ICmpOp::CreateICmp(ICmpOpcode::EQ, icmp.lhs(), zero);
+      break;
+    case ICmpOpcode::UGE:
+      if (rhs->isNullValue())
+        return ConstantInt::Create(true);
+      if (rhs->isOneValue())
+        return ICmpOp::CreateICmp(ICmpOpcode::NE, icmp.lhs(), zero);
+      break;
+    case ICmpOpcode::UGT:
+      if (rhs->isMaxValue())
+        return ConstantInt::Create(false);
+      if (rhs->isNullValue())
+        return ICmpOp::CreateICmp(ICmpOpcode::NE, icmp.lhs(), zero);
+      break;
+    case ICmpOpcode::ULE:
+      if (rhs->isMaxValue())
+        return ConstantInt::Create(true);
+      if (rhs->isNullValue())
+        return ICmpOp::CreateICmp(ICmpOpcode::EQ, icmp.lhs(), zero);
+      break;
+    case ICmpOpcode::SLT:
+      if (rhs->isMinSignedValue())
+        return ConstantInt::Create(false);
+      break;
+    case ICmpOpcode::SGE:
+      if (rhs->isMinSignedValue())
+        return ConstantInt::Create(true);
+      break;
+    case ICmpOpcode::SGT:
+      if (rhs->isMaxSignedValue())
+        return ConstantInt::Create(false);
+      break;
+    case ICmpOpcode::SLE:
+      if (rhs->isMaxSignedValue())
+        return ConstantInt::Create(true);
+      break;
+    default:
+      break;
+    }
+
+    return nullptr;
+  }
+
+  // (not (icmp x y)) -> (icmp' x y)
+  OpRef not_of_icmp(const OpRef& expr) {
+    const auto* icmp = llvm::dyn_cast<ICmpOp>(expr->operand_at(0).get());
+    if (!icmp)
+      return nullptr;
+
+    return ICmpOp::CreateICmp(inverted(icmp->comparison()), icmp->lhs(),
+                              icmp->rhs());
+  }
+
+  // clang-format off
+  const RewriteRule default_rule_table[] = {
+    {"trunc-of-ext",      Operation::Trunc,  trunc_of_ext},
+    {"trunc-of-trunc",    Operation::Trunc,  trunc_of_trunc},
+    {"trunc-of-mask",     Operation::Trunc,  trunc_of_mask},
+    {"trunc-of-or",       Operation::Trunc,  trunc_of_or},
+    {"zext-of-zext",      Operation::ZExt,   zext_of_zext},
+    {"sext-of-ext",       Operation::SExt,   sext_of_ext},
+    {"shift-pair",        Operation::LShr,   shift_pair},
+    {"shift-pair",        Operation::Shl,    shift_pair},
+    {"redundant-mask",    Operation::And,    redundant_mask},
+    {"reassemble-fields", Operation::Or,     reassemble_fields},
+    {"icmp-constant-rhs", Operation::ICmpEq, icmp_constant_rhs},
+    {"icmp-equality",     Operation::ICmpEq, icmp_equality},
+    {"icmp-range",        Operation::ICmpEq, icmp_range},
+    {"not-of-icmp",       Operation::Not,    not_of_icmp},
+  };
+  // clang-format on
+} // namespace
+
+llvm::ArrayRef<RewriteRule> Rewriter::default_rules() {
+  return default_rule_table;
+}
+
+Rewriter::RuleTable::RuleTable(llvm::ArrayRef<RewriteRule> rules)
+    : by_opcode(Operation::OpLast) {
+  for (const RewriteRule& rule : rules) {
+    if (rule.opcode == Operation::Invalid)
+      generic.push_back(rule);
+    else
+      by_opcode.at(rule.opcode).push_back(rule);
+  }
+}
+
+Rewriter::Rewriter() {
+  // Building the table means allocating a vector per opcode, which costs more
+  // than rewriting a typical query. Every default rewriter shares this one.
+  static const auto default_table =
+      std::make_shared<const RuleTable>(default_rules());
+  rules_ = default_table;
+}
+Rewriter::Rewriter(llvm::ArrayRef<RewriteRule> rules)
+    : rules_(std::make_shared<const RuleTable>(rules)) {}
+
+OpRef Rewriter::apply_rules(const OpRef& expr) const {
+  uint16_t opcode = expr->opcode();
+  if (llvm::isa<ICmpOp>(expr.get()))
+    opcode = Operation::ICmpEq;
+
+  for (const RewriteRule& rule : rules_->by_opcode[opcode]) {
+    if (OpRef result = rule.apply(expr))
+      return result;
+  }
+  for (const RewriteRule& rule : rules_->generic) {
+    if (OpRef result = rule.apply(expr))
+      return result;
+  }
+
+  return nullptr;
+}
+
+OpRef Rewriter::rewrite_node(const OpRef& expr) {
+  OpRef result = apply_rules(expr);
+  if (!result || result == expr)
+    return expr;
+
+  ++num_rewrites;
+  if (depth_ >= max_rewrite_depth)
+    return result;
+
+  // The rule may have created new nodes that haven't been rewritten yet.
+  // Most of the operands of those nodes will already be in the cache so this
+  // is usually cheap.
+  depth_ += 1;
+  auto guard = make_guard([&] { depth_ -= 1; });
+  return rebuild(result, *this, cache_);
+}
+
+OpRef Rewriter::rewrite(const OpRef& expr) {
+  return rebuild(expr, *this, cache_);
+}
+
+bool Rewriter::rewrite(AssertionList& assertions) {
+  llvm::SmallVector<Assertion, 16> changed;
+
+  auto unproven = assertions.unproven();
+  for (auto it = unproven.begin(); it != unproven.end(); ++it) {
+    OpRef result = rewrite(it->value());
+    if (result == it->value())
+      continue;
+
+    assertions.erase(it);
+    changed.push_back(Assertion(std::move(result)));
+  }
+
+  assertions.insert(changed);
+  return !changed.empty();
+}
+
+void rewrite(AssertionList& assertions) {
+  Rewriter rewriter;
+  rewriter.rewrite(assertions);
+}
+
+} // namespace caffeine::transforms
@@ -26,20 +26,26 @@ namespace {
   void replace_all(const Assertion* exception, const Constant* constant,
                    const OpRef& value, AssertionList& assertions,
                    llvm::SmallVectorImpl<Assertion>& output) {
+    auto substitute = [&](const OpRef& op) {
+      const auto* cnst = llvm::dyn_cast<Constant>(op.get());
+      if (!cnst)
+        return op;
+
+      if (cnst->symbol() != constant->symbol())
+        return op;
+
+      return value;
+    };
+
+    // Assertions tend to share most of their subexpressions (e.g. the array
+    // behind every load from the same allocation) so use one cache for the
+    // whole list.
+    RebuildCache cache;
     for (auto it = assertions.begin(); it != assertions.end(); ++it) {
       if (&*it == exception)
         continue;
 
-      auto changed = rebuild(it->value(), [&](const OpRef& op) {
-        const auto* cnst = llvm::dyn_cast<Constant>(op.get());
-        if (!cnst)
-          return op;
-
-        if (cnst->symbol() != constant->symbol())
-          return op;
-
-        return value;
-      });
+      auto changed = rebuild(it->value(), substitute, cache);
 
       if (changed == it->value())
         continue;
@@ -0,0 +1,256 @@
+#include "caffeine/Interpreter/AsyncFailureLogger.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Stats.h"
+
+#include <boost/algorithm/string/trim.hpp>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/DebugLoc.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <tuple>
+
+namespace caffeine {
+
+namespace {
+  stats::Counter num_ktests{"failures.ktests_written",
+                            "Number of KTest files written"};
+  stats::Gauge num_pending{"failures.pending",
+                           "Number of failures waiting to be processed"};
+
+  void write_u32(std::ostream& os, uint32_t value) {
+    // KTest files store integers in big-endian order
+    char bytes[4] = {(char)(value >> 24), (char)(value >> 16),
+                     (char)(value >> 8), (char)value};
+    os.write(bytes, sizeof(bytes));
+  }
+
+  void write_string(std::ostream& os, std::string_view value) {
+    write_u32(os, value.size());
+    os.write(value.data(), value.size());
+  }
+
+  void append_apint(std::vector<char>& bytes, const llvm::APInt& value) {
+    for (unsigned i = 0; i < value.getBitWidth(); i += 8)
+      bytes.push_back((char)value.extractBitsAsZExtValue(
+          std::min(8u, value.getBitWidth() - i), i));
+  }
+
+  void append_bytes(std::vector<char>& bytes, const Value& value) {
+    switch (value.kind()) {
+    case Value::Empty:
+      break;
+    case Value::Int:
+      append_apint(bytes, value.apint());
+      break;
+    case Value::Float:
+      append_apint(bytes, value.apfloat().bitcastToAPInt());
+      break;
+    case Value::Array:
+      for (uint8_t byte : value.array())
+        bytes.push_back((char)byte);
+      break;
+    case Value::Vector:
+      for (const Value& element : value.vector())
+        append_bytes(bytes, element);
+      break;
+    }
+  }
+} // namespace
+
+std::string describe_location(const llvm::Instruction* inst) {
+  if (!inst)
+    return "<unknown>";
+
+  const llvm::Function* func = inst->getFunction();
+  std::string name = func ? func->getName().str() : "<unknown>";
+
+  if (const auto& loc = inst->getDebugLoc()) {
+    return fmt::format(FMT_STRING("{} at {}:{}:{}"), name,
+                       loc->getFilename().str(), loc->getLine(),
+                       loc->getColumn());
+  }
+
+  std::string text;
+  llvm::raw_string_ostream ss{text};
+  ss << *inst;
+  ss.flush();
+  boost::algorithm::trim(text);
+  return fmt::format(FMT_STRING("{}: {}"), name, text);
+}
+
+void write_ktest(std::ostream& os, const FailureInputs& inputs) {
+  os.write("KTEST", 5);
+  write_u32(os, 3); // version
+  write_u32(os, 0); // number of arguments
+  write_u32(os, 0); // symbolic argvs
+  write_u32(os, 0); // symbolic argv length
+
+  write_u32(os, inputs.size());
+  std::vector<char> bytes;
+  for (const auto& [name, value] : inputs) {
+    bytes.clear();
+    append_bytes(bytes, value);
+
+    write_string(os, name);
+    write_string(os, std::string_view(bytes.data(), bytes.size()));
+  }
+}
+
+bool AsyncFailureLogger::Key::operator<(const Key& other) const {
+  return std::tie(inst, message) < std::tie(other.inst, other.message);
+}
+
+AsyncFailureLogger::AsyncFailureLogger(std::ostream& report,
+                                       const Options& options)
+    : report_(&report), options_(options) {
+  CAFFEINE_ASSERT(options_.num_threads != 0);
+  CAFFEINE_ASSERT(options_.max_pending != 0);
+
+  for (size_t i = 0; i < options_.num_threads; ++i)
+    threads_.emplace_back([this] { run_worker(); });
+}
+AsyncFailureLogger::~AsyncFailureLogger() {
+  finish();
+}
+
+void AsyncFailureLogger::log_failure(const Model* model, const Context& ctx,
+                                     const Failure& failure) {
+  std::optional<FailureInputs> inputs;
+  if (model)
+    inputs = evaluate_inputs(*model, ctx);
+
+  uint64_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
+  Pending pending{id, std::move(inputs), ctx, std::string(failure.message)};
+
+  auto lock = std::unique_lock(mutex_);
+  CAFFEINE_ASSERT(!done_, "logged a failure after calling finish");
+
+  while (pending_.size() >= options_.max_pending)
+    space_cv_.wait(lock);
+
+  pending_.push_back(std::move(pending));
+  num_pending.add();
+  lock.unlock();
+
+  pending_cv_.notify_one();
+}
+
+void AsyncFailureLogger::finish() {
+  {
+    auto lock = std::unique_lock(mutex_);
+    if (finished_)
+      return;
+    finished_ = true;
+    done_ = true;
+  }
+  pending_cv_.notify_all();
+
+  for (auto& thread : threads_)
+    thread.join();
+  threads_.clear();
+
+  auto lock = std::unique_lock(mutex_);
+  fmt::print(*report_,
+             FMT_STRING("Failure summary: {} failures, {} distinct\n"),
+             num_failures(), entries_.size());
+
+  // Print the summary in the order that the failures were found.
+  std::vector<std::pair<const Key*, const Entry*>> sorted;
+  for (const auto& [key, entry] : entries_)
+    sorted.emplace_back(&key, &entry);
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a.second->first < b.second->first;
+  });
+
+  for (const auto& [key, entry] : sorted) {
+    fmt::print(*report_, FMT_STRING("  {:>6}x {}"), entry->count,
+               entry->location);
+    if (!key->message.empty())
+      fmt::print(*report_, FMT_STRING(" ({})"), key->message);
+    if (!options_.output_dir.empty())
+      fmt::print(*report_, FMT_STRING(" [test{:06}.ktest]"), entry->first + 1);
+    *report_ << '\n';
+  }
+  *report_ << std::flush;
+}
+
+size_t AsyncFailureLogger::num_unique() const {
+  auto lock = std::unique_lock(mutex_);
+  return entries_.size();
+}
+
+void AsyncFailureLogger::run_worker() {
+  while (true) {
+    auto lock = std::unique_lock(mutex_);
+    while (pending_.empty() && !done_)
+      pending_cv_.wait(lock);
+
+    if (pending_.empty())
+      return;
+
+    Pending pending = std::move(pending_.front());
+    pending_.pop_front();
+    num_pending.sub();
+    lock.unlock();
+    space_cv_.notify_one();
+
+    process(pending);
+  }
+}
+
+void AsyncFailureLogger::process(Pending& pending) {
+  const llvm::Instruction* inst = nullptr;
+  if (!pending.context.empty())
+    inst = pending.context.stack_top().current_instruction();
+
+  bool first;
+  {
+    auto lock = std::unique_lock(mutex_);
+    auto [it, inserted] = entries_.try_emplace(Key{inst, pending.message});
+    Entry& entry = it->second;
+    if (inserted) {
+      entry.first = pending.id;
+      entry.location = describe_location(inst);
+    } else if (pending.id < entry.first) {
+      // With multiple background threads failures can be processed out of
+      // order. Keep the summary pointing at the earliest one.
+      entry.first = pending.id;
+    }
+    entry.count += 1;
+    first = inserted;
+  }
+
+  if (!options_.output_dir.empty() && pending.inputs) {
+    std::string path = fmt::format(FMT_STRING("{}/test{:06}.ktest"),
+                                   options_.output_dir, pending.id + 1);
+    std::ofstream file{path, std::ios::binary};
+    if (file)
+      write_ktest(file, *pending.inputs);
+
+    if (file) {
+      ++num_ktests;
+    } else {
+      auto lock = std::unique_lock(report_mutex_);
+      fmt::print(*report_, FMT_STRING("warning: unable to write {}\n"), path);
+    }
+  }
+
+  if (first) {
+    std::stringstream ss;
+    print_failure(ss, pending.inputs ? &*pending.inputs : nullptr,
+                  pending.context, pending.message);
+
+    auto lock = std::unique_lock(report_mutex_);
+    *report_ << ss.str() << std::flush;
+  }
+}
+
+} // namespace caffeine
@@ -0,0 +1,124 @@
+#include "caffeine/Interpreter/Budget.h"
+#include "caffeine/Support/Assert.h"
+
+namespace caffeine {
+
+namespace {
+  class BudgetedSolver : public Solver {
+  public:
+    BudgetedSolver(std::shared_ptr<Solver> inner, ExecutionBudget* budget)
+        : inner(std::move(inner)), budget(budget) {}
+
+    SolverResult check(AssertionList& assertions,
+                       const Assertion& extra) override {
+      return record([&] { return inner->check(assertions, extra); });
+    }
+    SolverResult resolve(AssertionList& assertions,
+                         const Assertion& extra) override {
+      return record([&] { return inner->resolve(assertions, extra); });
+    }
+
+  private:
+    template <typename F>
+    SolverResult record(F&& func) {
+      auto start = std::chrono::steady_clock::now();
+      SolverResult result = func();
+      budget->charge_solver_time(std::chrono::steady_clock::now() - start);
+      return result;
+    }
+
+    std::shared_ptr<Solver> inner;
+    ExecutionBudget* budget;
+  };
+} // namespace
+
+ExecutionBudget::ExecutionBudget(const ExecutionLimits& limits,
+                                 CancellationToken* external)
+    : limits_(limits) {
+  if (external)
+    external_ = external->on_cancel([this] { stop(Cancelled); });
+}
+ExecutionBudget::~ExecutionBudget() {
+  finish();
+}
+
+void ExecutionBudget::start() {
+  if (limits_.time.count() == 0 || watchdog_.joinable())
+    return;
+
+  auto deadline = std::chrono::steady_clock::now() + limits_.time;
+  watchdog_ = std::thread([this, deadline] {
+    auto lock = std::unique_lock(mutex_);
+    if (!condvar_.wait_until(lock, deadline, [&] { return finished_; }))
+      stop(TimeLimit);
+  });
+}
+void ExecutionBudget::finish() {
+  {
+    auto lock = std::unique_lock(mutex_);
+    finished_ = true;
+  }
+  condvar_.notify_all();
+
+  if (watchdog_.joinable())
+    watchdog_.join();
+}
+
+void ExecutionBudget::stop(Reason reason) {
+  CAFFEINE_ASSERT(reason != None);
+
+  Reason expected = None;
+  reason_.compare_exchange_strong(expected, reason, std::memory_order_acq_rel);
+  token_.cancel();
+}
+
+void ExecutionBudget::charge_instructions(uint64_t count) {
+  uint64_t total = instructions_.fetch_add(count, std::memory_order_relaxed);
+  if (limits_.instructions != 0 && total + count >= limits_.instructions)
+    stop(InstructionLimit);
+}
+
+bool ExecutionBudget::charge_path() {
+  uint64_t total = paths_.fetch_add(1, std::memory_order_relaxed);
+  if (limits_.paths != 0 && total >= limits_.paths) {
+    stop(PathLimit);
+    return false;
+  }
+  return true;
+}
+
+void ExecutionBudget::charge_solver_time(std::chrono::nanoseconds time) {
+  uint64_t ns = time.count();
+  uint64_t total = solver_ns_.fetch_add(ns, std::memory_order_relaxed) + ns;
+
+  auto limit = std::chrono::nanoseconds(limits_.solver_time).count();
+  if (limit != 0 && total >= (uint64_t)limit)
+    stop(SolverTimeLimit);
+}
+
+std::shared_ptr<Solver> ExecutionBudget::wrap(std::shared_ptr<Solver> solver) {
+  if (limits_.solver_time.count() == 0)
+    return solver;
+  return std::make_shared<BudgetedSolver>(std::move(solver), this);
+}
+
+const char* ExecutionBudget::describe(Reason reason) {
+  switch (reason) {
+  case None:
+    return "not exhausted";
+  case TimeLimit:
+    return "time limit reached";
+  case InstructionLimit:
+    return "instruction limit reached";
+  case PathLimit:
+    return "path limit reached";
+  case SolverTimeLimit:
+    return "solver time limit reached";
+  case Cancelled:
+    return "cancelled";
+  }
+
+  CAFFEINE_UNREACHABLE();
+}
+
+} // namespace caffeine
@@ -35,21 +35,7 @@ void Context::print_backtrace(std::ostream& OS) const {
   size_t index = 0;
 
   for (const StackFrame& frame : boost::adaptors::reverse(stack)) {
-    llvm::Instruction* current = nullptr;
-    if (!frame.current_block || frame.current == frame.current_block->end()) {
-      // We don't have a valid iterator.
-      current = nullptr;
-    } else if (frame.current == frame.current_block->begin()) {
-      // This case probably shouldn't happen but this method gets called when
-      // things are going wrong so we need to handle all possibilities.
-      if (frame.prev_block) {
-        current = &frame.prev_block->back();
-      } else {
-        current = &*frame.current;
-      }
-    } else {
-      current = &*std::prev(frame.current);
-    }
+    llvm::Instruction* current = frame.current_instruction();
 
     std::string prefix = fmt::format(FMT_STRING("#{}"), index);
     llvm::StringRef name = "<unknown>";
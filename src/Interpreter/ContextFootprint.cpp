@@ -0,0 +1,211 @@
+#include "caffeine/Interpreter/Context.h"
+#include "caffeine/IR/Operation.h"
+
+#include <llvm/Support/Casting.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace caffeine {
+
+namespace {
+  // Approximate size of the control block that std::make_shared allocates
+  // alongside each operation (two reference counts and a vtable pointer).
+  constexpr size_t control_block_size = 2 * sizeof(long) + sizeof(void*);
+
+  // Approximate overhead of a single node in a std::unordered_map or
+  // std::unordered_set on top of the value stored in it.
+  constexpr size_t hash_node_overhead = 2 * sizeof(void*);
+
+  template <typename Map>
+  size_t hash_table_bytes(const Map& map) {
+    size_t node_size = sizeof(typename Map::value_type) + hash_node_overhead;
+    return map.bucket_count() * sizeof(void*) + map.size() * node_size;
+  }
+
+  size_t node_bytes(const Operation& op) {
+    size_t bytes = sizeof(Operation) + control_block_size;
+
+    if (const auto* constant = llvm::dyn_cast<ConstantInt>(&op)) {
+      const llvm::APInt& value = constant->value();
+      if (!value.isSingleWord())
+        bytes += value.getNumWords() * sizeof(uint64_t);
+    } else if (llvm::isa<FixedArray>(op)) {
+      // FixedArray reports the elements of its data() as its operands so
+      // the walkers below also visit each element.
+      bytes += op.num_operands() * sizeof(OpRef);
+    }
+
+    return bytes;
+  }
+
+  /**
+   * Walks the expression DAGs reachable from a context and works out which
+   * nodes are only referenced from within that context.
+   *
+   * A node is only visited once no matter how many times it is referenced so
+   * the walk is linear in the number of distinct nodes. The walk uses an
+   * explicit worklist since expressions can be deep enough to overflow the
+   * stack.
+   */
+  class ExprWalker {
+  public:
+    // Visit an expression that is referenced refs times from the context.
+    void visit(const OpRef& op, long refs = 1) {
+      if (!op)
+        return;
+
+      auto [it, inserted] = nodes.try_emplace(op.get());
+      it->second.refs += refs;
+      if (inserted) {
+        it->second.uses = op.use_count();
+        worklist.push_back(op.get());
+      }
+
+      while (!worklist.empty()) {
+        const Operation* node = worklist.back();
+        worklist.pop_back();
+
+        for (size_t i = 0; i < node->num_operands(); ++i) {
+          const OpRef& operand = node->operand_at(i);
+          if (!operand)
+            continue;
+
+          auto [it, inserted] = nodes.try_emplace(operand.get());
+          it->second.refs += 1;
+          if (inserted) {
+            it->second.uses = operand.use_count();
+            worklist.push_back(operand.get());
+          }
+        }
+      }
+    }
+
+    void visit(const LLVMValue& value) {
+      if (value.is_aggregate()) {
+        for (const LLVMValue& member : value.members())
+          visit(member);
+        return;
+      }
+
+      for (const LLVMScalar& scalar : value.elements()) {
+        if (scalar.is_expr())
+          visit(scalar.expr());
+        else
+          visit(scalar.pointer().offset());
+      }
+    }
+
+    void finish(ContextFootprint& footprint) {
+      // A node that is referenced from outside the context keeps everything
+      // below it alive as well so those nodes are also shared.
+      for (const auto& [op, node] : nodes) {
+        if (node.refs < node.uses)
+          worklist.push_back(op);
+      }
+
+      while (!worklist.empty()) {
+        const Operation* op = worklist.back();
+        worklist.pop_back();
+
+        Node& node = nodes.at(op);
+        if (node.shared)
+          continue;
+        node.shared = true;
+
+        for (size_t i = 0; i < op->num_operands(); ++i) {
+          if (const OpRef& operand = op->operand_at(i))
+            worklist.push_back(operand.get());
+        }
+      }
+
+      for (const auto& [op, node] : nodes) {
+        size_t bytes = node_bytes(*op);
+        if (node.shared)
+          footprint.shared_exprs += bytes;
+        else
+          footprint.unique_exprs += bytes;
+      }
+      footprint.num_exprs = nodes.size();
+    }
+
+  private:
+    struct Node {
+      // Number of references from the context and from other nodes within
+      // the context.
+      long refs = 0;
+      // Total number of references to the node.
+      long uses = 0;
+      bool shared = false;
+    };
+
+    std::unordered_map<const Operation*, Node> nodes;
+    std::vector<const Operation*> worklist;
+  };
+
+  size_t value_bytes(const LLVMValue& value) {
+    if (!value.is_aggregate())
+      return sizeof(LLVMValue);
+
+    size_t bytes = sizeof(LLVMValue);
+    for (const LLVMValue& member : value.members())
+      bytes += value_bytes(member);
+    return bytes;
+  }
+} // namespace
+
+ContextFootprint Context::estimate_footprint() const {
+  ContextFootprint footprint;
+  ExprWalker walker;
+
+  footprint.stack += stack.capacity() * sizeof(StackFrame);
+  for (const StackFrame& frame : stack) {
+    footprint.stack += hash_table_bytes(frame.variables);
+    footprint.stack += frame.allocations.capacity() * sizeof(StackAllocation);
+
+    for (const auto& [_, value] : frame.variables) {
+      footprint.stack += value_bytes(value) - sizeof(LLVMValue);
+      walker.visit(value);
+    }
+  }
+
+  for (const auto& entry : heaps) {
+    footprint.heap += sizeof(MemHeap);
+
+    for (const Allocation& alloc : entry.second.allocations()) {
+      // Each slot_map entry stores the value along with its generation.
+      footprint.heap += sizeof(Allocation) + sizeof(uint64_t);
+      walker.visit(alloc.address());
+      walker.visit(alloc.size());
+      walker.visit(alloc.data());
+    }
+  }
+
+  footprint.assertions += assertions.backing().size() * sizeof(Assertion);
+  // The assertion list also keeps a hash set of its assertions for lookup so
+  // each assertion is referenced twice.
+  footprint.assertions +=
+      assertions.size() * (sizeof(Assertion) + hash_node_overhead);
+  for (const Assertion& assertion : assertions)
+    walker.visit(assertion.value(), 2);
+
+  footprint.other += hash_table_bytes(globals);
+  for (const auto& [_, value] : globals) {
+    footprint.other += value_bytes(value) - sizeof(LLVMValue);
+    walker.visit(value);
+  }
+
+  for (const auto& [name, value] : constants) {
+    footprint.other += sizeof(std::pair<std::string, OpRef>) + name.capacity();
+    walker.visit(value);
+  }
+
+  // The decisions are kept in a persistent vector which shares its nodes with
+  // the other forks of this context. This counts them as if they weren't.
+  footprint.other += decisions.size() * sizeof(uint32_t);
+
+  walker.finish(footprint);
+  return footprint;
+}
+
+} // namespace caffeine
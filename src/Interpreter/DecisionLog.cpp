@@ -0,0 +1,88 @@
+#include "caffeine/Interpreter/DecisionLog.h"
+
+#include <algorithm>
+
+namespace caffeine {
+
+namespace {
+  void write_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+      out.push_back((char)(0x80 | (value & 0x7F)));
+      value >>= 7;
+    }
+    out.push_back((char)value);
+  }
+
+  std::optional<uint64_t> read_varint(std::string_view& in) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (in.empty())
+        return std::nullopt;
+
+      uint8_t byte = (uint8_t)in.front();
+      in.remove_prefix(1);
+
+      value |= (uint64_t)(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        return value;
+    }
+
+    return std::nullopt;
+  }
+} // namespace
+
+void DecisionLog::push_back(uint32_t decision) {
+  decisions_ = std::move(decisions_).push_back(decision);
+  requeues_ = 0;
+}
+
+bool DecisionLog::agrees_with(const DecisionLog& other, size_t start) const {
+  size_t end = std::min(size(), other.size());
+  for (size_t i = start; i < end; ++i) {
+    if (decisions_[i] != other.decisions_[i])
+      return false;
+  }
+  return true;
+}
+
+void DecisionLog::serialize(std::string& out) const {
+  write_varint(out, size());
+  for (uint32_t decision : decisions_)
+    write_varint(out, decision);
+  write_varint(out, requeues_);
+}
+
+std::optional<DecisionLog> DecisionLog::deserialize(std::string_view& in) {
+  auto count = read_varint(in);
+  // Every decision takes at least one byte so this also rejects counts that
+  // are too large before we try to read them.
+  if (!count || *count > in.size())
+    return std::nullopt;
+
+  auto decisions = immer::vector<uint32_t>().transient();
+  for (uint64_t i = 0; i < *count; ++i) {
+    auto decision = read_varint(in);
+    if (!decision || *decision > UINT32_MAX)
+      return std::nullopt;
+    decisions.push_back((uint32_t)*decision);
+  }
+
+  auto requeues = read_varint(in);
+  if (!requeues || *requeues > UINT32_MAX)
+    return std::nullopt;
+
+  DecisionLog log;
+  log.decisions_ = decisions.persistent();
+  log.requeues_ = (uint32_t)*requeues;
+  return log;
+}
+
+bool DecisionLog::operator==(const DecisionLog& other) const {
+  return size() == other.size() && requeues_ == other.requeues_ &&
+         agrees_with(other);
+}
+bool DecisionLog::operator!=(const DecisionLog& other) const {
+  return !(*this == other);
+}
+
+} // namespace caffeine
@@ -0,0 +1,616 @@
+#include "caffeine/Interpreter/Distributed.h"
+#include "caffeine/Interpreter/FailureLogger.h"
+#include "caffeine/Interpreter/Store.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Stats.h"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <iostream>
+#include <optional>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace caffeine {
+
+namespace {
+  stats::Counter num_paths_sent{"distributed.paths_sent",
+                                "Number of paths given away when splitting"};
+  stats::Counter num_failures_sent{
+      "distributed.failures_sent",
+      "Number of failures sent back to the coordinator"};
+
+  /**
+   * Messages are a one byte kind followed by a 4 byte little-endian payload
+   * length and then the payload itself.
+   */
+  enum MessageKind : uint8_t {
+    // Coordinator to worker. The payload is an encoded DecisionLog for the
+    // path to explore.
+    Explore = 1,
+    // Coordinator to worker. Asks the worker to give away some of its paths.
+    // The worker always replies with a Paths message, which may be empty.
+    Split,
+    // Coordinator to worker. The worker stops exploring and exits.
+    Shutdown,
+
+    // Worker to coordinator. The payload is a sequence of encoded decision
+    // logs.
+    Paths,
+    // Worker to coordinator. The payload is the location, message and full
+    // report for a failure as length-prefixed strings.
+    FailureFound,
+    // Worker to coordinator. The worker has finished exploring the last path
+    // it was given. The payload is a byte which is nonzero if the path could
+    // not be replayed followed by the number of paths left unexplored as an
+    // 8 byte little-endian integer.
+    Idle,
+  };
+
+  struct Message {
+    MessageKind kind;
+    std::string payload;
+  };
+
+  void append_int(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i)
+      out.push_back((char)(value >> (8 * i)));
+  }
+
+  std::optional<uint64_t> read_int(std::string_view& in, size_t bytes) {
+    if (in.size() < bytes)
+      return std::nullopt;
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+      value |= (uint64_t)(uint8_t)in[i] << (8 * i);
+    in.remove_prefix(bytes);
+    return value;
+  }
+
+  void append_string(std::string& out, std::string_view value) {
+    append_int(out, value.size(), 4);
+    out.append(value.data(), value.size());
+  }
+
+  std::optional<std::string_view> read_string(std::string_view& in) {
+    auto size = read_int(in, 4);
+    if (!size || *size > in.size())
+      return std::nullopt;
+
+    std::string_view value = in.substr(0, *size);
+    in.remove_prefix(*size);
+    return value;
+  }
+
+  bool write_all(int fd, const char* data, size_t size) {
+    while (size != 0) {
+      // MSG_NOSIGNAL makes writing to a closed socket return an error instead
+      // of killing the process with SIGPIPE.
+      ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+
+      data += written;
+      size -= written;
+    }
+
+    return true;
+  }
+
+  bool read_all(int fd, char* data, size_t size) {
+    while (size != 0) {
+      ssize_t count = ::read(fd, data, size);
+      if (count < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      if (count == 0)
+        return false;
+
+      data += count;
+      size -= count;
+    }
+
+    return true;
+  }
+
+  bool send_message(int fd, MessageKind kind, std::string_view payload) {
+    std::string buffer;
+    buffer.reserve(payload.size() + 5);
+    buffer.push_back((char)kind);
+    append_int(buffer, payload.size(), 4);
+    buffer.append(payload.data(), payload.size());
+
+    return write_all(fd, buffer.data(), buffer.size());
+  }
+
+  std::optional<Message> recv_message(int fd) {
+    char header[5];
+    if (!read_all(fd, header, sizeof(header)))
+      return std::nullopt;
+
+    std::string_view view{header + 1, 4};
+    size_t size = *read_int(view, 4);
+
+    Message message{(MessageKind)header[0], std::string(size, '\0')};
+    if (!read_all(fd, message.payload.data(), size))
+      return std::nullopt;
+    return message;
+  }
+} // namespace
+
+/***************************************************
+ * DistributedWorker                               *
+ ***************************************************/
+
+/**
+ * Queue of contexts for the worker's executor which also handles split and
+ * shutdown requests that arrive from the coordinator while exploring.
+ *
+ * Like QueueingContextStore, next_context returns std::nullopt once every
+ * reader is waiting on an empty queue.
+ */
+class DistributedWorker::Store : public ExecutionContextStore {
+public:
+  Store(DistributedWorker* worker, size_t num_readers)
+      : worker(worker), num_readers(num_readers) {}
+
+  std::optional<Context> next_context() override {
+    auto lock = std::unique_lock(mutex);
+    poll_coordinator();
+
+    while (queue.empty()) {
+      if (done)
+        return std::nullopt;
+
+      if (blocked + 1 == num_readers) {
+        done = true;
+        condvar.notify_all();
+        return std::nullopt;
+      }
+
+      ++blocked;
+      condvar.wait(lock);
+      --blocked;
+    }
+
+    Context ctx = std::move(queue.front());
+    queue.pop_front();
+    return ctx;
+  }
+
+  void add_context(Context&& ctx) override {
+    {
+      auto lock = std::unique_lock(mutex);
+      queue.push_back(std::move(ctx));
+    }
+    condvar.notify_one();
+  }
+
+  // Prepare the store for another call to Executor::run.
+  void reset() {
+    auto lock = std::unique_lock(mutex);
+    CAFFEINE_ASSERT(blocked == 0);
+    queue.clear();
+    done = false;
+  }
+
+private:
+  // Handle any messages from the coordinator that are waiting on the socket.
+  // Must be called with the mutex held.
+  void poll_coordinator() {
+    pollfd pfd{worker->fd_, POLLIN, 0};
+    while (!worker->shutdown_.is_cancelled() && ::poll(&pfd, 1, 0) > 0) {
+      auto message = recv_message(worker->fd_);
+      if (!message || message->kind == Shutdown) {
+        if (!message)
+          worker->connected_ = false;
+        worker->shutdown_.cancel();
+        return;
+      }
+
+      CAFFEINE_ASSERT(message->kind == Split,
+                      "unexpected message from the coordinator");
+      split();
+    }
+  }
+
+  // Give away half the queued paths. Those at the front of the queue are the
+  // oldest and so usually have the most left to explore below them.
+  void split() {
+    size_t count = queue.size() / 2;
+
+    std::string payload;
+    for (size_t i = 0; i < count; ++i) {
+      queue.front().decisions.serialize(payload);
+      queue.pop_front();
+    }
+
+    num_paths_sent += count;
+    if (!worker->send(Paths, payload)) {
+      worker->connected_ = false;
+      worker->shutdown_.cancel();
+    }
+  }
+
+  DistributedWorker* worker;
+
+  std::mutex mutex;
+  std::condition_variable condvar;
+  std::deque<Context> queue;
+
+  size_t num_readers;
+  size_t blocked = 0;
+  bool done = false;
+};
+
+class DistributedWorker::Logger : public FailureLogger {
+public:
+  explicit Logger(DistributedWorker* worker) : worker(worker) {}
+
+  void log_failure(const Model* model, const Context& ctx,
+                   const Failure& failure) override {
+    const llvm::Instruction* inst = nullptr;
+    if (!ctx.empty())
+      inst = ctx.stack_top().current_instruction();
+
+    std::stringstream report;
+    if (model) {
+      FailureInputs inputs = evaluate_inputs(*model, ctx);
+      print_failure(report, &inputs, ctx, failure.message);
+    } else {
+      print_failure(report, nullptr, ctx, failure.message);
+    }
+
+    std::string payload;
+    append_string(payload, describe_location(inst));
+    append_string(payload, failure.message);
+    append_string(payload, report.str());
+
+    ++num_failures_sent;
+    worker->send(FailureFound, payload);
+  }
+
+private:
+  DistributedWorker* worker;
+};
+
+DistributedWorker::DistributedWorker(int fd, ExecutionPolicy* policy,
+                                     const ExecutorOptions& options,
+                                     EntryFn entry)
+    : fd_(fd), entry_(std::move(entry)) {
+  ExecutorOptions exec_options = options;
+  exec_options.cancel = &shutdown_;
+
+  store_ = std::make_unique<Store>(this, exec_options.num_threads);
+  logger_ = std::make_unique<Logger>(this);
+  executor_ = std::make_unique<Executor>(policy, store_.get(), logger_.get(),
+                                         exec_options);
+
+  if (exec_options.interpreter.summarize_loops)
+    executor_->summarize_loops(*entry_().mod);
+}
+DistributedWorker::~DistributedWorker() {
+  ::close(fd_);
+}
+
+bool DistributedWorker::send(uint8_t kind, std::string_view payload) {
+  auto lock = std::unique_lock(write_mutex_);
+  return send_message(fd_, (MessageKind)kind, payload);
+}
+
+bool DistributedWorker::run() {
+  while (!shutdown_.is_cancelled()) {
+    auto message = recv_message(fd_);
+    if (!message)
+      return false;
+
+    switch (message->kind) {
+    case Explore: {
+      std::string_view payload = message->payload;
+      auto decisions = DecisionLog::deserialize(payload);
+      CAFFEINE_ASSERT(decisions.has_value(),
+                      "coordinator sent an invalid decision log");
+
+      bool diverged = true;
+      uint64_t unexplored = 0;
+      if (auto ctx = executor_->replay(entry_(), *decisions)) {
+        diverged = false;
+        store_->reset();
+        store_->add_context(std::move(*ctx));
+        unexplored = executor_->run().unexplored;
+      }
+
+      std::string reply;
+      append_int(reply, diverged, 1);
+      append_int(reply, unexplored, 8);
+      if (!send(Idle, reply))
+        return false;
+      break;
+    }
+    case Split:
+      // We're not exploring anything so there's nothing to give away.
+      if (!send(Paths, ""))
+        return false;
+      break;
+    case Shutdown:
+      return true;
+    default:
+      CAFFEINE_ABORT("unexpected message from the coordinator");
+    }
+  }
+
+  return connected_;
+}
+
+/***************************************************
+ * DistributedCoordinator                          *
+ ***************************************************/
+
+DistributedCoordinator::DistributedCoordinator(std::ostream& report)
+    : DistributedCoordinator(report, Options()) {}
+DistributedCoordinator::DistributedCoordinator(std::ostream& report,
+                                               const Options& options)
+    : report_(&report), options_(options) {}
+DistributedCoordinator::~DistributedCoordinator() {
+  for (Worker& worker : workers_) {
+    if (worker.live)
+      ::close(worker.fd);
+  }
+}
+
+void DistributedCoordinator::add_worker(int fd) {
+  Worker worker;
+  worker.fd = fd;
+  workers_.push_back(worker);
+}
+
+DistributedCoordinator::Summary
+DistributedCoordinator::run(const DecisionLog& root) {
+  using clock = std::chrono::steady_clock;
+
+  Summary summary;
+  auto start = clock::now();
+  bool stopping = false;
+
+  std::string encoded;
+  root.serialize(encoded);
+  frontier_.push_back(std::move(encoded));
+
+  auto stop = [&] {
+    stopping = true;
+    summary.unexplored += frontier_.size();
+    frontier_.clear();
+
+    for (Worker& worker : workers_) {
+      if (worker.live)
+        shutdown(worker);
+    }
+  };
+
+  std::vector<pollfd> pfds;
+  std::vector<Worker*> polled;
+
+  while (true) {
+    auto now = clock::now();
+    if (!stopping && options_.time_limit.count() != 0 &&
+        now - start >= options_.time_limit)
+      stop();
+
+    for (Worker& worker : workers_) {
+      if (stopping || frontier_.empty())
+        break;
+      if (!worker.live || worker.busy)
+        continue;
+
+      if (!send_message(worker.fd, Explore, frontier_.front())) {
+        disconnect(worker, summary);
+        continue;
+      }
+
+      frontier_.pop_front();
+      worker.busy = true;
+      summary.dispatched += 1;
+    }
+
+    bool any_live = false;
+    bool any_idle = false;
+    bool any_busy = false;
+    for (const Worker& worker : workers_) {
+      if (!worker.live)
+        continue;
+
+      any_live = true;
+      if (worker.busy || worker.splitting)
+        any_busy = true;
+      else
+        any_idle = true;
+    }
+
+    if (!any_live)
+      break;
+    if (!stopping && frontier_.empty() && !any_busy)
+      stop();
+
+    // Keep the idle workers fed by taking paths from the busy ones.
+    bool want_split = !stopping && frontier_.empty() && any_idle;
+    if (want_split) {
+      for (Worker& worker : workers_) {
+        if (!worker.live || !worker.busy || worker.splitting ||
+            now < worker.next_split)
+          continue;
+
+        worker.splitting = true;
+        if (!send_message(worker.fd, Split, ""))
+          disconnect(worker, summary);
+      }
+    }
+
+    int timeout = -1;
+    if (want_split)
+      timeout = options_.split_backoff.count();
+    if (!stopping && options_.time_limit.count() != 0) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          options_.time_limit - (now - start));
+      int limit = std::max<int>(remaining.count(), 0) + 1;
+      timeout = timeout < 0 ? limit : std::min(timeout, limit);
+    }
+
+    pfds.clear();
+    polled.clear();
+    for (Worker& worker : workers_) {
+      if (!worker.live)
+        continue;
+      pfds.push_back(pollfd{worker.fd, POLLIN, 0});
+      polled.push_back(&worker);
+    }
+
+    int ready = ::poll(pfds.data(), pfds.size(), timeout);
+    if (ready < 0) {
+      CAFFEINE_ASSERT(errno == EINTR, "poll failed");
+      continue;
+    }
+
+    for (size_t i = 0; i < pfds.size(); ++i) {
+      if (pfds[i].revents == 0)
+        continue;
+      if (!handle_message(*polled[i], summary))
+        disconnect(*polled[i], summary);
+    }
+  }
+
+  summary.unexplored += frontier_.size();
+  frontier_.clear();
+  summary.unique_failures = failures_.size();
+  print_summary(summary);
+  return summary;
+}
+
+bool DistributedCoordinator::handle_message(Worker& worker,
+                                            Summary& summary) {
+  auto message = recv_message(worker.fd);
+  if (!message)
+    return false;
+
+  std::string_view payload = message->payload;
+  switch (message->kind) {
+  case Paths: {
+    size_t count = 0;
+    while (!payload.empty()) {
+      std::string_view start = payload;
+      if (!DecisionLog::deserialize(payload))
+        return false;
+
+      frontier_.emplace_back(start.substr(0, start.size() - payload.size()));
+      count += 1;
+    }
+
+    worker.splitting = false;
+    if (count == 0)
+      worker.next_split =
+          std::chrono::steady_clock::now() + options_.split_backoff;
+    summary.split += count;
+    return true;
+  }
+  case FailureFound:
+    return record_failure(payload, summary);
+  case Idle: {
+    auto diverged = read_int(payload, 1);
+    auto unexplored = read_int(payload, 8);
+    if (!diverged || !unexplored)
+      return false;
+
+    worker.busy = false;
+    summary.diverged += *diverged != 0;
+    summary.unexplored += *unexplored;
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+bool DistributedCoordinator::record_failure(std::string_view payload,
+                                            Summary& summary) {
+  auto location = read_string(payload);
+  auto message = read_string(payload);
+  auto report = read_string(payload);
+  if (!location || !message || !report)
+    return false;
+
+  auto [it, inserted] = failures_.try_emplace(
+      std::make_pair(std::string(*location), std::string(*message)));
+  if (inserted) {
+    it->second.first = summary.failures;
+    *report_ << *report << std::flush;
+  }
+
+  it->second.count += 1;
+  summary.failures += 1;
+  return true;
+}
+
+void DistributedCoordinator::disconnect(Worker& worker, Summary& summary) {
+  if (!worker.live)
+    return;
+
+  if (!worker.shutdown) {
+    summary.lost_workers += 1;
+    // Whatever the worker was exploring is gone.
+    summary.unexplored += worker.busy;
+  }
+
+  ::close(worker.fd);
+  worker.live = false;
+  worker.busy = false;
+  worker.splitting = false;
+}
+
+void DistributedCoordinator::shutdown(Worker& worker) {
+  if (worker.shutdown)
+    return;
+
+  worker.shutdown = true;
+  // If this fails then the worker is already gone, which we will find out
+  // about when reading from it.
+  send_message(worker.fd, Shutdown, "");
+}
+
+void DistributedCoordinator::print_summary(const Summary& summary) {
+  fmt::print(*report_,
+             FMT_STRING("Failure summary: {} failures, {} distinct\n"),
+             summary.failures, summary.unique_failures);
+
+  // Print the summary in the order that the failures were found.
+  using Item = std::pair<const std::pair<std::string, std::string>, Entry>;
+  std::vector<const Item*> sorted;
+  for (const Item& item : failures_)
+    sorted.push_back(&item);
+  std::sort(sorted.begin(), sorted.end(), [](const Item* a, const Item* b) {
+    return a->second.first < b->second.first;
+  });
+
+  for (const Item* item : sorted) {
+    const auto& [location, message] = item->first;
+    fmt::print(*report_, FMT_STRING("  {:>6}x {}"), item->second.count,
+               location);
+    if (!message.empty())
+      fmt::print(*report_, FMT_STRING(" ({})"), message);
+    *report_ << '\n';
+  }
+  *report_ << std::flush;
+}
+
+} // namespace caffeine
@@ -1,11 +1,22 @@
 #include "caffeine/Interpreter/Executor.h"
+#include "caffeine/ADT/Guard.h"
+#include "caffeine/Config.h"
 #include "caffeine/Interpreter/Interpreter.h"
+#include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Interpreter/Profiler.h"
 #include "caffeine/Interpreter/Store.h"
+#if CAFFEINE_ENABLE_BITBLAST
+#include "caffeine/Solver/BitBlastSolver.h"
+#endif
 #include "caffeine/Solver/CanonicalizingSolver.h"
+#include "caffeine/Solver/FuzzingSolver.h"
+#include "caffeine/Solver/LoggingSolver.h"
+#include "caffeine/Solver/RewritingSolver.h"
 #include "caffeine/Solver/SequenceSolver.h"
 #include "caffeine/Solver/SimplifyingSolver.h"
 #include "caffeine/Solver/SlicingSolver.h"
 #include "caffeine/Solver/Z3Solver.h"
+#include "caffeine/Support/Stats.h"
 #include "caffeine/Support/UnsupportedOperation.h"
 
 #include <thread>
@@ -13,17 +24,132 @@
 
 namespace caffeine {
 
+namespace {
+  stats::Counter num_paths_started{
+      "executor.paths_started", "Number of paths taken from the store"};
+  stats::Histogram execute_time{
+      "executor.execute_ns",
+      "Time spent executing each path segment (including solver time)"};
+  stats::Gauge active_workers{"executor.active_workers",
+                              "Number of workers currently executing a path"};
+  stats::Counter num_paths_unexplored{
+      "executor.paths_unexplored",
+      "Number of paths left unexplored because the executor stopped early"};
+  stats::Counter num_replays{"executor.replays",
+                             "Number of contexts rebuilt from their decisions"};
+  stats::Counter num_replays_diverged{
+      "executor.replays_diverged",
+      "Number of replayed paths that did not follow their decisions"};
+
+  /**
+   * Store used by Executor::replay which only keeps the contexts whose
+   * decisions agree with the ones being replayed.
+   */
+  class ReplayStore : public ExecutionContextStore {
+  public:
+    explicit ReplayStore(const DecisionLog* target) : target(target) {}
+
+    std::optional<Context> next_context() override {
+      std::optional<Context> ctx = std::move(next);
+      next.reset();
+      if (ctx)
+        verified = std::min(ctx->decisions.size(), target->size());
+      return ctx;
+    }
+
+    void add_context(Context&& ctx) override {
+      // Every context added here descends from the last one handed out so
+      // only the decisions made since then need to be checked.
+      if (next || !ctx.decisions.agrees_with(*target, verified))
+        return;
+      next = std::move(ctx);
+    }
+
+  private:
+    const DecisionLog* target;
+    size_t verified = 0;
+    std::optional<Context> next;
+  };
+
+  class DiscardingFailureLogger : public FailureLogger {
+  public:
+    void log_failure(const Model*, const Context&, const Failure&) override {}
+  };
+} // namespace
+
+std::shared_ptr<Solver>
+Executor::create_solver(ExecutionBudget& budget) const {
+  std::unique_ptr<Solver> backend =
+      std::make_unique<caffeine::Z3Solver>(&budget.token());
+#if CAFFEINE_ENABLE_BITBLAST
+  if (options.bitblast) {
+    backend = std::make_unique<
+        caffeine::SequenceSolver<caffeine::BitBlastSolver, caffeine::Z3Solver>>(
+        caffeine::BitBlastSolver(&budget.token()),
+        caffeine::Z3Solver(&budget.token()));
+  }
+#endif
+  if (options.fuzz_floats) {
+    backend = std::make_unique<
+        caffeine::SequenceSolver<caffeine::FuzzingSolver,
+                                 std::unique_ptr<Solver>>>(
+        caffeine::FuzzingSolver(), std::move(backend));
+  }
+
+  // The rewriting solver passes the rewritten query on to the rest of the
+  // chain so that the extra assertion is rewritten too.
+  std::shared_ptr<Solver> solver = caffeine::make_sequence_solver(
+      caffeine::SimplifyingSolver(),
+      caffeine::RewritingSolver(
+          std::make_unique<caffeine::SequenceSolver<
+              caffeine::CanonicalizingSolver, caffeine::SlicingSolver>>(
+              caffeine::CanonicalizingSolver(),
+              caffeine::SlicingSolver(std::move(backend)))));
+  if (auto* profiler = options.interpreter.profiler)
+    solver = profiler->wrap(solver);
+  solver = budget.wrap(solver);
+  if (options.query_log)
+    solver = std::make_shared<LoggingSolver>(solver, options.query_log);
+  return solver;
+}
+
 void run_worker(Executor* exec, FailureLogger* logger,
                 ExecutionContextStore* store) {
-  auto solver = caffeine::make_sequence_solver(
-      caffeine::SimplifyingSolver(), caffeine::CanonicalizingSolver(),
-      caffeine::SlicingSolver(std::make_unique<caffeine::Z3Solver>()));
+  ExecutionBudget* budget = exec->budget;
+  std::shared_ptr<Solver> solver = exec->create_solver(*budget);
+
+  // The solver is registered with this run's budget so it mustn't be reused
+  // once the run is over.
+  *exec->worker_solvers = solver;
+  auto solver_guard = make_guard([&] { *exec->worker_solvers = nullptr; });
+
+  InterpreterOptions options = exec->options.interpreter;
+  options.budget = budget;
+
   while (auto ctx = store->next_context()) {
+    // Once the budget has run out we keep taking paths from the store so that
+    // it drains and the other workers see that there is nothing left to do.
+    if (budget->exhausted() || !budget->charge_path()) {
+      ++exec->unexplored;
+      ++num_paths_unexplored;
+      continue;
+    }
+
     auto guard_ = UnsupportedOperation::SetCurrentContext(&ctx.value());
+    ++num_paths_started;
+    active_workers.add();
+    auto active_guard = make_guard([] { active_workers.sub(); });
+    stats::ScopedTimer timer{execute_time};
 
     try {
-      Interpreter interp(&ctx.value(), exec->policy, store, logger, solver);
+      Interpreter interp(&ctx.value(), exec->policy, store, logger, solver,
+                         options, &exec->summaries, &exec->loop_summaries);
       interp.execute();
+
+      if (interp.cancelled()) {
+        ++exec->unexplored;
+        ++num_paths_unexplored;
+      }
     } catch (UnsupportedOperationException&) {
       // The assert that threw this already printed an error message
       // TODO: We should have a better way to indicate that this failed to the
@@ -40,21 +166,115 @@ Executor::Executor(ExecutionPolicy* policy, ExecutionContextStore* store,
                    FailureLogger* logger, const ExecutorOptions& options)
     : policy(policy), store(store), logger(logger), options(options) {}
 
-void Executor::run() {
+void Executor::summarize_loops(llvm::Module& module) {
+  loop_summaries.analyze(module);
+}
+
+ExecutorSummary Executor::run() {
+  ExecutionBudget budget{options.limits, options.cancel};
+  this->budget = &budget;
+  unexplored = 0;
+
+  auto guard = make_guard([&] { this->budget = nullptr; });
+
+  // Analyzing a function while other threads interpret the module isn't
+  // safe so only the summaries from summarize_loops are used in that case.
+  loop_summaries.set_lazy(options.num_threads == 1);
+
+  budget.start();
+
   if (options.num_threads == 1) {
     run_worker(this, logger, store);
-    return;
+  } else {
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 0; i < options.num_threads; i++) {
+      threads.emplace_back(run_worker, this, logger, store);
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
   }
 
-  std::vector<std::thread> threads;
+  budget.finish();
+
+  // The budget may have run out just as the last path finished. That doesn't
+  // count as stopping early.
+  ExecutorSummary summary;
+  summary.unexplored = unexplored;
+  if (summary.unexplored != 0)
+    summary.stopped = budget.reason();
+  return summary;
+}
 
-  for (uint32_t i = 0; i < options.num_threads; i++) {
-    threads.emplace_back(run_worker, this, logger, store);
+std::optional<Context> Executor::replay(Context entry,
+                                        const DecisionLog& decisions) {
+  // Within run, replays share the budget and the solver of the worker that
+  // asked for them.
+  std::optional<ExecutionBudget> local_budget;
+  ExecutionBudget* budget = this->budget;
+  std::shared_ptr<Solver> solver;
+  if (budget) {
+    if (budget->exhausted())
+      return entry;
+    if (auto* worker_solver = worker_solvers.get())
+      solver = *worker_solver;
+  } else {
+    local_budget.emplace(ExecutionLimits(), options.cancel);
+    local_budget->start();
+    budget = &*local_budget;
   }
 
-  for (auto& thread : threads) {
-    thread.join();
+  if (!solver)
+    solver = create_solver(*budget);
+  ++num_replays;
+
+  InterpreterOptions interp_options = options.interpreter;
+  interp_options.budget = budget;
+
+  AlwaysAllowExecutionPolicy policy;
+  DiscardingFailureLogger logger;
+  ReplayStore store{&decisions};
+  store.add_context(std::move(entry));
+
+  // Values that get concretized aren't recorded in the log and the solver
+  // may pick different ones this time around. With those the decisions are
+  // checked against the solver as the path is executed again.
+  bool force = interp_options.max_expr_depth == 0 &&
+               interp_options.max_expr_size == 0;
+
+  while (auto ctx = store.next_context()) {
+    const DecisionLog& current = ctx->decisions;
+    if (current.size() > decisions.size())
+      break;
+    if (current.size() == decisions.size()) {
+      if (current.requeues() == decisions.requeues())
+        return ctx;
+      if (current.requeues() > decisions.requeues())
+        break;
+    }
+
+    auto guard_ = UnsupportedOperation::SetCurrentContext(&ctx.value());
+    try {
+      Interpreter interp(&ctx.value(), &policy, &store, &logger, solver,
+                         interp_options, &summaries, &loop_summaries);
+      if (force)
+        interp.force_decisions(&decisions);
+      interp.execute();
+
+      if (interp.cancelled()) {
+        if (local_budget)
+          return std::nullopt;
+        return ctx;
+      }
+    } catch (UnsupportedOperationException&) {
+      break;
+    }
   }
+
+  ++num_replays_diverged;
+  return std::nullopt;
 }
 
 } // namespace caffeine
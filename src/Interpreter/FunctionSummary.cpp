@@ -0,0 +1,216 @@
+#include "caffeine/Interpreter/FunctionSummary.h"
+#include "caffeine/IR/Transforms.h"
+#include "caffeine/Interpreter/Context.h"
+#include "caffeine/Interpreter/ExprEval.h"
+#include "caffeine/Support/Assert.h"
+
+#include <fmt/format.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+
+namespace caffeine {
+
+namespace {
+  // The maximum number of paths through a function that will be merged into a
+  // single summary. Each path adds another select to the summary so this keeps
+  // the size of the resulting expression under control.
+  static constexpr size_t MAX_SUMMARY_PATHS = 16;
+
+  bool is_scalar_type(llvm::Type* type) {
+    return type->isIntegerTy() || type->isFloatingPointTy();
+  }
+
+  bool is_summarizable(llvm::Instruction& inst) {
+    if (llvm::isa<llvm::DbgInfoIntrinsic>(inst))
+      return true;
+
+    switch (inst.getOpcode()) {
+    case llvm::Instruction::Br:
+    case llvm::Instruction::Ret:
+      return true;
+
+    // Division can fault so it needs to go through the interpreter.
+    case llvm::Instruction::UDiv:
+    case llvm::Instruction::SDiv:
+    case llvm::Instruction::URem:
+    case llvm::Instruction::SRem:
+      return false;
+
+    default:
+      break;
+    }
+
+    if (!llvm::isa<llvm::BinaryOperator>(inst) &&
+        !llvm::isa<llvm::UnaryOperator>(inst) &&
+        !llvm::isa<llvm::CmpInst>(inst) && !llvm::isa<llvm::CastInst>(inst) &&
+        !llvm::isa<llvm::SelectInst>(inst) && !llvm::isa<llvm::PHINode>(inst))
+      return false;
+
+    // Restricting everything to scalar types rules out pointers (and thus
+    // globals and memory accesses) entirely.
+    if (!is_scalar_type(inst.getType()))
+      return false;
+
+    for (llvm::Value* operand : inst.operand_values()) {
+      if (!is_scalar_type(operand->getType()))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool is_summarizable(llvm::Function* func) {
+    if (func->empty() || func->isVarArg())
+      return false;
+    if (!is_scalar_type(func->getReturnType()))
+      return false;
+
+    for (llvm::Argument& arg : func->args()) {
+      if (!is_scalar_type(arg.getType()))
+        return false;
+    }
+
+    for (llvm::BasicBlock& block : *func) {
+      for (llvm::Instruction& inst : block) {
+        if (!is_summarizable(inst))
+          return false;
+      }
+    }
+
+    return true;
+  }
+
+  class SummaryBuilder {
+  public:
+    llvm::SmallVector<std::pair<OpRef, OpRef>, 4> paths;
+
+    /**
+     * Evaluate all paths starting at block and record the path condition and
+     * return value for each one.
+     *
+     * Returns false if the function has a cycle or too many paths.
+     */
+    bool explore(Context ctx, llvm::BasicBlock* block, llvm::BasicBlock* prev,
+                 OpRef cond, llvm::SmallPtrSet<llvm::BasicBlock*, 8> visited) {
+      if (!visited.insert(block).second)
+        return false;
+
+      auto& frame = ctx.stack_top();
+
+      for (llvm::Instruction& inst : *block) {
+        if (llvm::isa<llvm::DbgInfoIntrinsic>(inst))
+          continue;
+
+        if (auto* phi = llvm::dyn_cast<llvm::PHINode>(&inst)) {
+          CAFFEINE_ASSERT(prev != nullptr);
+          frame.insert(phi, ctx.lookup(phi->getIncomingValueForBlock(prev)));
+          continue;
+        }
+
+        if (auto* ret = llvm::dyn_cast<llvm::ReturnInst>(&inst)) {
+          paths.emplace_back(
+              cond, ctx.lookup(ret->getReturnValue()).scalar().expr());
+          return paths.size() <= MAX_SUMMARY_PATHS;
+        }
+
+        if (auto* br = llvm::dyn_cast<llvm::BranchInst>(&inst)) {
+          if (!br->isConditional())
+            return explore(std::move(ctx), br->getSuccessor(0), block, cond,
+                           visited);
+
+          auto value = ctx.lookup(br->getCondition()).scalar().expr();
+          auto t_cond = BinaryOp::CreateAnd(cond, value);
+          auto f_cond = BinaryOp::CreateAnd(cond, UnaryOp::CreateNot(value));
+
+          if (!is_constant_false(t_cond) &&
+              !explore(ctx, br->getSuccessor(0), block, t_cond, visited))
+            return false;
+          if (!is_constant_false(f_cond) &&
+              !explore(std::move(ctx), br->getSuccessor(1), block, f_cond,
+                       visited))
+            return false;
+          return true;
+        }
+
+        frame.insert(&inst, ExprEvaluator(&ctx).evaluate(inst));
+      }
+
+      CAFFEINE_UNREACHABLE("basic block had no terminator");
+    }
+
+  private:
+    static bool is_constant_false(const OpRef& cond) {
+      auto cnst = llvm::dyn_cast<ConstantInt>(cond.get());
+      return cnst && cnst->value().isNullValue();
+    }
+  };
+} // namespace
+
+FunctionSummary::FunctionSummary(llvm::SmallVector<OpRef, 4>&& placeholders,
+                                 const OpRef& result)
+    : placeholders_(std::move(placeholders)), result_(result) {}
+
+std::optional<FunctionSummary> FunctionSummary::Create(llvm::Function* func) {
+  if (!is_summarizable(func))
+    return std::nullopt;
+
+  llvm::SmallVector<OpRef, 4> placeholders;
+  for (llvm::Argument& arg : func->args()) {
+    placeholders.push_back(Constant::Create(
+        Type::from_llvm(arg.getType()),
+        Symbol(fmt::format("caffeine.summary.arg{}", arg.getArgNo()))));
+  }
+
+  SummaryBuilder builder;
+  try {
+    Context ctx{func, placeholders};
+    if (!builder.explore(std::move(ctx), &func->getEntryBlock(), nullptr,
+                         ConstantInt::Create(true), {}))
+      return std::nullopt;
+  } catch (ExprEvaluator::Unevaluatable&) { return std::nullopt; }
+
+  CAFFEINE_ASSERT(!builder.paths.empty(),
+                  "function summary had no feasible paths");
+
+  // The path conditions are disjoint and cover all inputs so the final path
+  // doesn't need its condition checked.
+  OpRef result = builder.paths.back().second;
+  for (size_t i = builder.paths.size() - 1; i > 0; --i) {
+    const auto& [cond, value] = builder.paths[i - 1];
+    result = SelectOp::Create(cond, value, result);
+  }
+
+  return FunctionSummary(std::move(placeholders), result);
+}
+
+OpRef FunctionSummary::apply(llvm::ArrayRef<OpRef> args) const {
+  CAFFEINE_ASSERT(args.size() == placeholders_.size(),
+                  "function summary applied with wrong number of arguments");
+
+  return transforms::rebuild(result_, [&](const OpRef& expr) {
+    if (!llvm::isa<Constant>(expr.get()))
+      return expr;
+
+    for (auto [placeholder, arg] : llvm::zip(placeholders_, args)) {
+      if (placeholder == expr)
+        return arg;
+    }
+
+    return expr;
+  });
+}
+
+const FunctionSummary* FunctionSummaryCache::lookup(llvm::Function* func) {
+  std::lock_guard lock(mutex_);
+
+  auto it = cache_.find(func);
+  if (it == cache_.end())
+    it = cache_.emplace(func, FunctionSummary::Create(func)).first;
+
+  if (!it->second)
+    return nullptr;
+  return &*it->second;
+}
+
+} // namespace caffeine
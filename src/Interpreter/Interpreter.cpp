@@ -1,11 +1,18 @@
 #include "caffeine/Interpreter/Interpreter.h"
+#include "caffeine/ADT/Guard.h"
+#include "caffeine/IR/Transforms.h"
+#include "caffeine/Interpreter/Budget.h"
 #include "caffeine/Interpreter/ExprEval.h"
+#include "caffeine/Interpreter/FunctionSummary.h"
+#include "caffeine/Interpreter/LoopSummary.h"
 #include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Interpreter/Profiler.h"
 #include "caffeine/Interpreter/StackFrame.h"
 #include "caffeine/Interpreter/Store.h"
 #include "caffeine/Interpreter/Value.h"
 #include "caffeine/Support/Assert.h"
 #include "caffeine/Support/LLVMFmt.h"
+#include "caffeine/Support/Stats.h"
 #include "caffeine/Support/Tracing.h"
 #include "caffeine/Support/UnsupportedOperation.h"
 
@@ -26,6 +33,19 @@ namespace {
   // The maximum size for which a fixed-size symbolic constant will be optimized
   // to a fixed array of smaller constants.
   static uint64_t MAX_FIXED_CONSTANT_SIZE = 10 * 1024 * 1024;
+
+  stats::Counter num_instructions{"interpreter.instructions",
+                                  "Number of instructions executed"};
+  stats::Counter num_forks{"interpreter.forks",
+                           "Number of new paths created by forking"};
+  stats::Counter num_paths_completed{"paths.completed",
+                                     "Number of paths that ran to completion"};
+  stats::Counter num_paths_dead{"paths.dead",
+                                "Number of paths that became infeasible"};
+  stats::Counter num_paths_failed{"paths.failed",
+                                  "Number of paths that ended in a failure"};
+  stats::Counter num_paths_removed{
+      "paths.removed", "Number of paths removed by the execution policy"};
 } // namespace
 
 ExecutionResult::ExecutionResult(Status status) : status_(status) {}
@@ -35,9 +55,11 @@ ExecutionResult::ExecutionResult(llvm::SmallVector<Context, 2>&& contexts)
 Interpreter::Interpreter(Context* ctx, ExecutionPolicy* policy,
                          ExecutionContextStore* store, FailureLogger* logger,
                          const std::shared_ptr<Solver>& solver,
-                         const InterpreterOptions& options)
+                         const InterpreterOptions& options,
+                         FunctionSummaryCache* summaries,
+                         LoopSummaryCache* loop_summaries)
     : policy(policy), store(store), ctx(ctx), logger(logger), options(options),
-      solver(solver) {}
+      solver(solver), summaries(summaries), loop_summaries(loop_summaries) {}
 
 void Interpreter::logFailure(Context& ctx, const Assertion& assertion,
                              std::string_view message) {
@@ -45,18 +67,140 @@ void Interpreter::logFailure(Context& ctx, const Assertion& assertion,
   if (result != SolverResult::SAT)
     return;
 
+  ++num_paths_failed;
   logger->log_failure(result.model(), ctx, Failure(assertion, message));
   policy->on_path_complete(ctx, ExecutionPolicy::Fail, assertion);
 }
 void Interpreter::queueContext(Context&& ctx) {
+  ++num_forks;
   policy->on_path_forked(ctx);
+  if (options.track_footprint)
+    ctx.footprint = ctx.estimate_footprint();
   if (policy->should_queue_path(ctx)) {
     store->add_context(std::move(ctx));
   } else {
+    ++num_paths_removed;
     policy->on_path_complete(ctx, ExecutionPolicy::Removed);
   }
 }
 
+/**
+ * Replace the value of inst with a concrete one if it has grown past the limits
+ * set in the interpreter options.
+ */
+void Interpreter::concretizeIfLarge(Context& ctx, llvm::Instruction& inst) {
+  if (options.max_expr_depth == 0 && options.max_expr_size == 0)
+    return;
+  if (ctx.empty())
+    return;
+
+  auto& frame = ctx.stack_top();
+  auto it = frame.variables.find(&inst);
+  if (it == frame.variables.end() || !it->second.is_scalar())
+    return;
+
+  const LLVMScalar& scalar = it->second.scalar();
+  if (!scalar.is_expr())
+    return;
+
+  OpRef expr = scalar.expr();
+  if (!expr->type().is_int() || llvm::isa<ConstantInt>(expr.get()))
+    return;
+
+  bool too_deep =
+      options.max_expr_depth != 0 && expr->depth() > options.max_expr_depth;
+  bool too_large =
+      options.max_expr_size != 0 && expr->tree_size() > options.max_expr_size;
+  if (!too_deep && !too_large)
+    return;
+
+  auto result = ctx.resolve(solver);
+  if (result != SolverResult::SAT)
+    return;
+
+  OpRef value = ConstantInt::Create(result.evaluate(*expr));
+  ctx.add(ICmpOp::CreateICmpEQ(expr, value));
+  frame.insert(&inst, value);
+
+  policy->on_value_concretized(ctx, expr, value);
+}
+
+/**
+ * Record which allocation a pointer was resolved to. Resolving a pointer that
+ * has already been resolved can only have one outcome so nothing is recorded
+ * for those.
+ */
+static void recordResolve(Context& ctx, const Pointer& pointer,
+                          const Pointer& resolved) {
+  if (pointer.is_resolved())
+    return;
+
+  size_t slot = slot_map<Allocation>::slot(resolved.alloc());
+  CAFFEINE_ASSERT(slot <= UINT32_MAX, "allocation slot too large to record");
+  ctx.decisions.push_back((uint32_t)slot);
+}
+
+std::optional<uint32_t>
+Interpreter::forcedDecision(const Context& ctx) const {
+  if (!forced || ctx.decisions.size() >= forced->size())
+    return std::nullopt;
+  return (*forced)[ctx.decisions.size()];
+}
+
+llvm::SmallVector<Pointer, 1>
+Interpreter::resolvePointer(Context& ctx, const Pointer& pointer) {
+  if (!forced)
+    return ctx.heaps.resolve(solver, pointer, ctx);
+
+  // Resolving an already resolved pointer doesn't record a decision. The
+  // recorded path got past it so it must have been in bounds.
+  size_t slot = 0;
+  if (!pointer.is_resolved()) {
+    auto decision = forcedDecision(ctx);
+    if (!decision)
+      return ctx.heaps.resolve(solver, pointer, ctx);
+    slot = *decision;
+  }
+
+  llvm::SmallVector<Pointer, 1> resolved;
+  if (auto ptr = ctx.heaps.resolve_slot(pointer, slot))
+    resolved.push_back(*ptr);
+  return resolved;
+}
+
+std::optional<ExecutionResult>
+Interpreter::forkNullAllocation(llvm::CallInst& call, unsigned address_space) {
+  if (!options.malloc_can_return_null)
+    return std::nullopt;
+
+  auto decision = forcedDecision(*ctx);
+  if (decision && *decision == 0) {
+    ctx->decisions.push_back(0);
+    return std::nullopt;
+  }
+
+  const llvm::DataLayout& layout = call.getModule()->getDataLayout();
+  auto ptr_width = layout.getPointerSizeInBits(address_space);
+
+  Context forked = ctx->fork_once();
+  forked.stack_top().insert(
+      &call, LLVMValue(Pointer(ConstantInt::Create(llvm::APInt(ptr_width, 0)),
+                               address_space)));
+  forked.decisions.push_back(1);
+
+  // When replaying, the null path is handed back the same way a forced branch
+  // is so that the replay store gets to see it.
+  if (decision) {
+    ExecutionResult::ContextVec forks;
+    forks.push_back(std::move(forked));
+    return ExecutionResult(std::move(forks));
+  }
+
+  queueContext(std::move(forked));
+  ctx->decisions.push_back(0);
+  return std::nullopt;
+}
+
 Interpreter Interpreter::cloneWith(Context* ctx) {
   CAFFEINE_ASSERT(ctx);
 
@@ -69,21 +213,51 @@ void Interpreter::execute() {
   auto frameblock = CAFFEINE_TRACE_SPAN("Interpreter::execute");
   (void)frameblock;
 
+  // Instructions are charged to the budget in batches so that threads aren't
+  // all contending on the same counter.
+  constexpr uint64_t charge_interval = 256;
+  uint64_t uncharged = 0;
+  auto charge_guard = make_guard([&] {
+    if (options.budget && uncharged != 0)
+      options.budget->charge_instructions(uncharged);
+  });
+
+  cancelled_ = false;
+
   while (true) {
+    if (options.budget) {
+      if (options.budget->exhausted()) {
+        cancelled_ = true;
+        return;
+      }
+
+      if (++uncharged == charge_interval) {
+        options.budget->charge_instructions(uncharged);
+        uncharged = 0;
+      }
+    }
+
     StackFrame& frame = ctx->stack_top();
 
     CAFFEINE_ASSERT(frame.current != frame.current_block->end(),
                     "Instruction pointer ran off end of block.");
 
     llvm::Instruction& inst = *frame.current;
-    auto traceblock = CAFFEINE_TRACE_SPAN(fmt::format(FMT_STRING("{}"), inst));
+    auto traceblock = CAFFEINE_TRACE_SPAN(inst.getOpcodeName());
     traceblock.annotate("cat", "instruction");
+    // Formatting the instruction is too expensive to do for every span so the
+    // span is named by opcode instead.
+    if (CAFFEINE_TRACING_EXPENSIVE_ANNOTATIONS && traceblock.is_enabled())
+      traceblock.annotate("inst", fmt::format(FMT_STRING("{}"), inst));
 
     // Note: Need to increment the iterator before actually doing
     //       anything with the instruction since instructions can
     //       modify the current position (e.g. branch, call, etc.)
     ++frame.current;
+    ++num_instructions;
 
+    InstructionProfiler::Scope profile{options.profiler, &inst};
+    size_t num_decisions = ctx->decisions.size();
     ExecutionResult res = visit(inst);
 
     if (traceblock.is_enabled() && !ctx->stack.empty()) {
@@ -102,12 +276,28 @@ void Interpreter::execute() {
 
     if (!res.contexts().empty()) {
       auto& ctxs = res.contexts();
+      // An instruction with a single successor just moves the path into the
+      // store. Only the paths past the first one are new.
+      if (ctxs.size() > 1) {
+        num_forks += ctxs.size() - 1;
+        profile.add_forks(ctxs.size() - 1);
+      }
+
+      for (Context& fork : ctxs) {
+        if (fork.decisions.size() == num_decisions)
+          fork.decisions.requeued();
+        concretizeIfLarge(fork, inst);
+        if (options.track_footprint)
+          fork.footprint = fork.estimate_footprint();
+      }
 
       auto it =
           std::remove_if(ctxs.begin(), ctxs.end(), [&](const Context& ctx) {
             bool prune = !policy->should_queue_path(ctx);
-            if (prune)
+            if (prune) {
+              ++num_paths_removed;
               policy->on_path_complete(ctx, ExecutionPolicy::Removed);
+            }
             return prune;
           });
       ctxs.erase(it, ctxs.end());
@@ -116,12 +306,17 @@ void Interpreter::execute() {
       return;
     }
 
+    if (res.status() == ExecutionResult::Continue)
+      concretizeIfLarge(*ctx, inst);
+
     if (res.status() != ExecutionResult::Continue) {
       switch (res.status()) {
       case ExecutionResult::Dead:
+        ++num_paths_dead;
         policy->on_path_complete(*ctx, ExecutionPolicy::Dead);
         return;
       case ExecutionResult::Stop:
+        ++num_paths_completed;
         policy->on_path_complete(*ctx, ExecutionPolicy::Success);
         return;
 
@@ -171,7 +366,7 @@ ExecutionResult Interpreter::visitUDiv(llvm::BinaryOperator& op) {
   auto result = transform_exprs(
       [&](const auto& lhs, const auto& rhs) {
         Assertion assertion = ICmpOp::CreateICmpNE(rhs, 0);
-        if (ctx->check(solver, !assertion) == SolverResult::SAT)
+        if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT)
           logFailure(*ctx, !assertion, "udiv by 0");
         ctx->add(assertion);
 
@@ -200,7 +395,7 @@ ExecutionResult Interpreter::visitSDiv(llvm::BinaryOperator& op) {
         // lhs == 0 || (lhs == INT_MIN && rhs == -1)
         Assertion assertion =
             BinaryOp::CreateOr(cmp1, BinaryOp::CreateAnd(cmp2, cmp3));
-        if (ctx->check(solver, assertion) == SolverResult::SAT)
+        if (!forced && ctx->check(solver, assertion) == SolverResult::SAT)
           logFailure(*ctx, assertion, "sdiv fault (div by 0 or overflow)");
         ctx->add(!assertion);
 
@@ -229,7 +424,7 @@ ExecutionResult Interpreter::visitSRem(llvm::BinaryOperator& op) {
         // lhs == 0 || (lhs == INT_MIN && rhs == -1)
         Assertion assertion =
             BinaryOp::CreateOr(cmp1, BinaryOp::CreateAnd(cmp2, cmp3));
-        if (ctx->check(solver, assertion) == SolverResult::SAT)
+        if (!forced && ctx->check(solver, assertion) == SolverResult::SAT)
           logFailure(*ctx, assertion, "srem fault (div by 0 or overflow)");
         ctx->add(!assertion);
 
@@ -250,7 +445,7 @@ ExecutionResult Interpreter::visitURem(llvm::BinaryOperator& op) {
   auto result = transform_exprs(
       [&](const auto& lhs, const auto& rhs) {
         Assertion assertion = ICmpOp::CreateICmpNE(rhs, 0);
-        if (ctx->check(solver, !assertion) == SolverResult::SAT)
+        if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT)
           logFailure(*ctx, !assertion, "urem fault (div by 0)");
         ctx->add(assertion);
 
@@ -276,37 +471,60 @@ ExecutionResult Interpreter::visitPHINode(llvm::PHINode& node) {
 }
 ExecutionResult Interpreter::visitBranchInst(llvm::BranchInst& inst) {
   if (!inst.isConditional()) {
-    ctx->stack_top().jump_to(inst.getSuccessor(0));
+    llvm::BasicBlock* target = inst.getSuccessor(0);
+
+    if (options.summarize_loops && loop_summaries) {
+      const LoopSummary* summary = loop_summaries->lookup(target);
+      if (summary && summary->preheader() == inst.getParent()) {
+        summary->apply(*ctx);
+        return ExecutionResult::Continue;
+      }
+    }
+
+    ctx->stack_top().jump_to(target);
     return ExecutionResult::Continue;
   }
 
   auto cond = ctx->lookup(inst.getCondition()).scalar().expr();
   auto assertion = Assertion(cond);
-  auto is_t = ctx->check(solver, assertion);
-  auto is_f = ctx->check(solver, !assertion);
+  bool record = !llvm::isa<ConstantInt>(cond.get());
 
-  size_t count = 0;
-  count += is_t != SolverResult::UNSAT;
-  count += is_f != SolverResult::UNSAT;
+  bool take_t;
+  bool take_f;
+  std::optional<uint32_t> decision;
+  if (record)
+    decision = forcedDecision(*ctx);
 
-  auto forks = ctx->fork(count);
+  if (decision) {
+    take_t = *decision == 0;
+    take_f = *decision == 1;
+  } else {
+    // Note: For the purposes of branching we consider unknown to be
+    //       equivalent to sat. Maybe future branches will bring the
+    //       equation back to being solvable.
+    take_t = ctx->check(solver, assertion) != SolverResult::UNSAT;
+    take_f = ctx->check(solver, !assertion) != SolverResult::UNSAT;
+  }
+
+  auto forks = ctx->fork((size_t)take_t + (size_t)take_f);
   size_t idx = 0;
 
-  // Note: For the purposes of branching we consider unknown to be
-  //       equivalent to sat. Maybe future branches will bring the
-  //       equation back to being solvable.
-  if (is_t != SolverResult::UNSAT) {
+  if (take_t) {
     auto& fork = forks[idx++];
 
     fork.add(assertion);
     fork.stack_top().jump_to(inst.getSuccessor(0));
+    if (record)
+      fork.decisions.push_back(0);
   }
 
-  if (is_f != SolverResult::UNSAT) {
+  if (take_f) {
     auto& fork = forks[idx++];
 
     fork.add(!assertion);
     fork.stack_top().jump_to(inst.getSuccessor(1));
+    if (record)
+      fork.decisions.push_back(1);
   }
 
   return forks;
@@ -333,6 +551,11 @@ ExecutionResult Interpreter::visitReturnInst(llvm::ReturnInst& inst) {
 ExecutionResult Interpreter::visitSwitchInst(llvm::SwitchInst& inst) {
   auto cond = ctx->lookup(inst.getCondition()).scalar().expr();
 
+  bool record = !llvm::isa<ConstantInt>(cond.get());
+  std::optional<uint32_t> decision;
+  if (record)
+    decision = forcedDecision(*ctx);
+
   ExecutionResult::ContextVec forks;
   Context def = ctx->fork_once();
 
@@ -341,18 +564,28 @@ ExecutionResult Interpreter::visitSwitchInst(llvm::SwitchInst& inst) {
         cond, ConstantInt::Create(value.getCaseValue()->getValue())));
     def.add(!assertion);
 
-    if (ctx->check(solver, assertion) == SolverResult::UNSAT)
+    if (decision) {
+      if (*decision != value.getCaseIndex())
+        continue;
+    } else if (ctx->check(solver, assertion) == SolverResult::UNSAT) {
       continue;
+    }
 
     Context fork = ctx->fork_once();
     fork.add(assertion);
     fork.stack_top().jump_to(value.getCaseSuccessor());
+    if (record)
+      fork.decisions.push_back(value.getCaseIndex());
 
     forks.push_back(std::move(fork));
   }
 
-  if (def.check(solver) != SolverResult::UNSAT) {
+  bool take_default = decision ? *decision == inst.getNumCases()
+                               : def.check(solver) != SolverResult::UNSAT;
+  if (take_default) {
     def.stack_top().jump_to(inst.getDefaultDest());
+    if (record)
+      def.decisions.push_back(inst.getNumCases());
     forks.push_back(std::move(def));
   }
 
@@ -371,6 +604,17 @@ ExecutionResult Interpreter::visitCallInst(llvm::CallInst& call) {
   if (func->empty())
     return visitExternFunc(call);
 
+  if (options.function_summaries && summaries) {
+    if (const FunctionSummary* summary = summaries->lookup(func)) {
+      llvm::SmallVector<OpRef, 4> args;
+      for (const llvm::Use& arg : call.args())
+        args.push_back(ctx->lookup(arg.get()).scalar().expr());
+
+      ctx->stack_top().insert(&call, summary->apply(args));
+      return ExecutionResult::Continue;
+    }
+  }
+
   StackFrame callee{func};
   for (auto [arg, val] : llvm::zip(func->args(), call.args())) {
     callee.insert(&arg, ctx->lookup(val.get()));
@@ -410,7 +654,7 @@ ExecutionResult Interpreter::visitIndirectCall(llvm::CallInst& call) {
       "Indirect call instruction called with pointer of wrong type");
 
   auto assertion = ctx->heaps.check_valid(pointer, 1);
-  if (ctx->check(solver, !assertion) == SolverResult::SAT) {
+  if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT) {
     logFailure(*ctx, !assertion, "invalid function pointer");
 
     // If we get an invalid function pointer then there's a pretty good chance
@@ -419,7 +663,7 @@ ExecutionResult Interpreter::visitIndirectCall(llvm::CallInst& call) {
     return ExecutionResult::Dead;
   }
 
-  auto resolved = ctx->heaps.resolve(solver, pointer, *ctx);
+  auto resolved = resolvePointer(*ctx, pointer);
   auto resolved_forks = ctx->fork(resolved.size());
 
   auto newcall = llvm::cast<llvm::CallInst>(call.clone());
@@ -431,6 +675,7 @@ ExecutionResult Interpreter::visitIndirectCall(llvm::CallInst& call) {
     Allocation& alloc = fork.heaps[ptr.heap()][ptr.alloc()];
     fork.add(ICmpOp::CreateICmp(ICmpOpcode::EQ, alloc.address(),
                                 pointer.value(fork.heaps)));
+    recordResolve(fork, pointer, ptr);
     newcall->setCalledFunction(
         llvm::cast<FunctionObject>(*alloc.data()).function());
 
@@ -449,6 +694,39 @@ ExecutionResult Interpreter::visitIndirectCall(llvm::CallInst& call) {
   return forks;
 }
 
+LLVMValue Interpreter::forwardLoads(Context& ctx, LLVMValue value,
+                                    size_t& budget) {
+  auto oracle = [&](const OpRef& a, const OpRef& b) {
+    budget -= 1;
+    auto ne = Assertion(ICmpOp::CreateICmp(ICmpOpcode::NE, a, b));
+    if (ctx.check(solver, ne) == SolverResult::UNSAT)
+      return LoadOp::Alias::Equal;
+    if (ctx.check(solver, !ne) == SolverResult::UNSAT)
+      return LoadOp::Alias::Distinct;
+    return LoadOp::Alias::Unknown;
+  };
+  auto forward = [&](const OpRef& expr) {
+    return transforms::forward_loads(expr, oracle, budget);
+  };
+
+  if (value.is_aggregate()) {
+    for (LLVMValue& member : value.members())
+      member = forwardLoads(ctx, std::move(member), budget);
+    return value;
+  }
+
+  for (LLVMScalar& element : value.elements()) {
+    if (element.is_expr()) {
+      element = forward(element.expr());
+    } else if (!element.pointer().is_resolved()) {
+      const Pointer& ptr = element.pointer();
+      element = Pointer(forward(ptr.offset()), ptr.heap());
+    }
+  }
+
+  return value;
+}
+
 ExecutionResult Interpreter::visitLoadInst(llvm::LoadInst& inst) {
   // Note: This treats atomic loads as regular ones since we only model
   //       single-threaded code. If that ever changes then this will need to be
@@ -462,7 +740,7 @@ ExecutionResult Interpreter::visitLoadInst(llvm::LoadInst& inst) {
 
   auto assertion =
       ctx->heaps.check_valid(pointer, layout.getTypeStoreSize(inst.getType()));
-  if (ctx->check(solver, !assertion) == SolverResult::SAT) {
+  if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT) {
     logFailure(*ctx, !assertion, "invalid pointer load");
 
     // If we're getting an out-of-bounds access then there's a pretty good
@@ -472,15 +750,20 @@ ExecutionResult Interpreter::visitLoadInst(llvm::LoadInst& inst) {
     return ExecutionResult::Dead;
   }
 
-  auto resolved = ctx->heaps.resolve(solver, pointer, *ctx);
+  auto resolved = resolvePointer(*ctx, pointer);
   auto forks = ctx->fork(resolved.size());
 
   for (auto [fork, ptr] : llvm::zip(forks, resolved)) {
     Allocation& alloc = fork.heaps[ptr.heap()][ptr.alloc()];
     fork.add(alloc.check_inbounds(ptr.offset(),
                                   layout.getTypeStoreSize(inst.getType())));
+    recordResolve(fork, pointer, ptr);
 
     auto value = alloc.read(ptr.offset(), inst.getType(), layout);
+    if (options.load_alias_queries != 0) {
+      size_t budget = options.load_alias_queries;
+      value = forwardLoads(fork, std::move(value), budget);
+    }
     fork.stack_top().insert(&inst, value);
 
     if (!pointer.is_resolved()) {
@@ -500,7 +783,7 @@ ExecutionResult Interpreter::visitStoreInst(llvm::StoreInst& inst) {
 
   auto assertion = ctx->heaps.check_valid(
       pointer, layout.getTypeStoreSize(inst.getOperand(0)->getType()));
-  if (ctx->check(solver, !assertion) == SolverResult::SAT) {
+  if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT) {
     logFailure(*ctx, !assertion, "invalid pointer store");
 
     // If we're getting an out-of-bounds access then there's a pretty good
@@ -510,7 +793,7 @@ ExecutionResult Interpreter::visitStoreInst(llvm::StoreInst& inst) {
     return ExecutionResult::Dead;
   }
 
-  auto resolved = ctx->heaps.resolve(solver, pointer, *ctx);
+  auto resolved = resolvePointer(*ctx, pointer);
   auto forks = ctx->fork(resolved.size());
 
   for (auto [fork, ptr] : llvm::zip(forks, resolved)) {
@@ -518,6 +801,7 @@ ExecutionResult Interpreter::visitStoreInst(llvm::StoreInst& inst) {
     fork.add(
         alloc.check_inbounds(ptr.offset(), layout.getTypeStoreSize(op_ty)));
     alloc.write(ptr.offset(), op_ty, value, fork.heaps, layout);
+    recordResolve(fork, pointer, ptr);
 
     if (!pointer.is_resolved()) {
       fork.backprop(pointer, ptr);
@@ -622,7 +906,7 @@ ExecutionResult Interpreter::visitAssert(llvm::CallInst& call) {
   auto cond = ctx->lookup(call.getArgOperand(0));
   auto assertion = Assertion(cond.scalar().expr());
 
-  if (ctx->check(solver, !assertion) == SolverResult::SAT)
+  if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT)
     logFailure(*ctx, !assertion, "assertion failure");
 
   ctx->add(assertion);
@@ -630,10 +914,52 @@ ExecutionResult Interpreter::visitAssert(llvm::CallInst& call) {
   return ExecutionResult::Continue;
 }
 
+namespace {
+  /**
+   * Attempt to read a null-terminated string without involving the solver.
+   *
+   * Names passed to caffeine_make_symbolic are almost always string literals
+   * whose backing allocations are fixed arrays of constant bytes. In that case
+   * we can read the bytes directly. Returns std::nullopt if any byte before the
+   * terminator is not a constant.
+   */
+  std::optional<std::string> readConcreteName(const Allocation& alloc,
+                                              const Pointer& ptr) {
+    const auto* offset = llvm::dyn_cast<ConstantInt>(ptr.offset().get());
+    const auto* size = llvm::dyn_cast<ConstantInt>(alloc.size().get());
+    if (!offset || !size)
+      return std::nullopt;
+
+    uint64_t start = offset->value().getLimitedValue();
+    uint64_t end = size->value().getLimitedValue();
+    unsigned bitwidth = offset->type().bitwidth();
+
+    std::string name;
+    for (uint64_t i = start; i < end; ++i) {
+      auto byte = LoadOp::Create(alloc.data(),
+                                 ConstantInt::Create(llvm::APInt(bitwidth, i)));
+      const auto* value = llvm::dyn_cast<ConstantInt>(byte.get());
+      if (!value)
+        return std::nullopt;
+
+      char c = (char)value->value().getLimitedValue();
+      if (c == '\0')
+        return name;
+      name.push_back(c);
+    }
+
+    // Not null-terminated. Let the solver path report the error.
+    return std::nullopt;
+  }
+} // namespace
+
 std::optional<std::string> readSymbolicName(std::shared_ptr<Solver> solver,
                                             Context* ctx, const Pointer& ptr) {
   const auto& alloc = ctx->heaps[ptr.heap()][ptr.alloc()];
 
+  if (auto name = readConcreteName(alloc, ptr))
+    return name;
+
   auto result = ctx->resolve(solver);
   if (result != SolverResult::SAT) {
     CAFFEINE_UNSUPPORTED("Unable to resolve symbolic name");
@@ -662,12 +988,13 @@ ExecutionResult Interpreter::visitSymbolicAlloca(llvm::CallInst& call) {
   auto size = ctx->lookup(call.getArgOperand(0)).scalar().expr();
   auto name = ctx->lookup(call.getArgOperand(1)).scalar().pointer();
 
-  auto resolved = ctx->heaps.resolve(solver, name, *ctx);
+  auto resolved = resolvePointer(*ctx, name);
 
   CAFFEINE_ASSERT(!resolved.empty(),
                   "caffeine_make_symbolic called with invalid name pointer");
   CAFFEINE_ASSERT(resolved.size() == 1,
                   "caffeine_make_symbolic called with symbolic name");
+  recordResolve(*ctx, name, resolved.front());
 
   auto alloc_name = readSymbolicName(solver, ctx, resolved.front());
   CAFFEINE_UASSERT(alloc_name.has_value(),
@@ -728,13 +1055,8 @@ ExecutionResult Interpreter::visitMalloc(llvm::CallInst& call) {
                       layout.getIndexSizeInBits(address_space),
                   "Invalid malloc signature");
 
-  if (options.malloc_can_return_null) {
-    Context forked = ctx->fork_once();
-    forked.stack_top().insert(
-        &call, LLVMValue(Pointer(ConstantInt::Create(llvm::APInt(ptr_width, 0)),
-                                 address_space)));
-    queueContext(std::move(forked));
-  }
+  if (auto result = forkNullAllocation(call, address_space))
+    return std::move(*result);
 
   auto size_op = UnaryOp::CreateTruncOrZExt(Type::int_ty(ptr_width), size);
   auto alloc = ctx->heaps[address_space].allocate(
@@ -765,13 +1087,8 @@ ExecutionResult Interpreter::visitCalloc(llvm::CallInst& call) {
                       layout.getIndexSizeInBits(address_space),
                   "Invalid calloc signature");
 
-  if (options.malloc_can_return_null) {
-    Context forked = ctx->fork_once();
-    forked.stack_top().insert(
-        &call, LLVMValue(Pointer(ConstantInt::Create(llvm::APInt(ptr_width, 0)),
-                                 address_space)));
-    queueContext(std::move(forked));
-  }
+  if (auto result = forkNullAllocation(call, address_space))
+    return std::move(*result);
 
   auto size_op = UnaryOp::CreateTruncOrZExt(Type::int_ty(ptr_width), size);
   auto alloc = ctx->heaps[address_space].allocate(
@@ -800,13 +1117,13 @@ ExecutionResult Interpreter::visitFree(llvm::CallInst& call) {
   auto memptr = ctx->lookup(call.getArgOperand(0)).scalar().pointer();
 
   auto is_valid_ptr = ctx->heaps.check_starts_allocation(memptr);
-  if (ctx->check(solver, !is_valid_ptr) == SolverResult::SAT) {
+  if (!forced && ctx->check(solver, !is_valid_ptr) == SolverResult::SAT) {
     logFailure(*ctx, !is_valid_ptr, "free called with an invalid pointer");
 
     return ExecutionResult::Dead;
   }
 
-  auto resolved = ctx->heaps.resolve(solver, memptr, *ctx);
+  auto resolved = resolvePointer(*ctx, memptr);
 
   auto err_start =
       std::remove_if(resolved.begin(), resolved.end(), [&](const Pointer& ptr) {
@@ -814,7 +1131,7 @@ ExecutionResult Interpreter::visitFree(llvm::CallInst& call) {
 
         auto assertion = Assertion(
             ICmpOp::CreateICmpEQ(ptr.value(ctx->heaps), alloc.address()));
-        if (ctx->check(solver, !assertion) == SolverResult::SAT) {
+        if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT) {
           logFailure(*ctx, Assertion::constant(true),
                      "free called with a pointer not allocated by malloc");
 
@@ -831,6 +1148,7 @@ ExecutionResult Interpreter::visitFree(llvm::CallInst& call) {
     Allocation& alloc = fork.heaps[ptr.heap()][ptr.alloc()];
     fork.add(ICmpOp::CreateICmpEQ(ptr.value(fork.heaps), alloc.address()));
     fork.heaps[ptr.heap()].deallocate(ptr.alloc());
+    recordResolve(fork, memptr, ptr);
   }
 
   return forks;
@@ -845,7 +1163,7 @@ ExecutionResult Interpreter::visitBuiltinResolve(llvm::CallInst& call) {
       ctx->lookup(call.getArgOperand(1)).scalar().expr());
 
   auto assertion = ctx->heaps.check_valid(mem, size);
-  if (ctx->check(solver, !assertion) == SolverResult::SAT) {
+  if (!forced && ctx->check(solver, !assertion) == SolverResult::SAT) {
     logFailure(*ctx, !assertion, "invalid pointer");
 
     // If we're getting an out-of-bounds access then there's a pretty good
@@ -855,10 +1173,13 @@ ExecutionResult Interpreter::visitBuiltinResolve(llvm::CallInst& call) {
     return ExecutionResult::Dead;
   }
 
-  auto resolved = ctx->heaps.resolve(solver, mem, *ctx);
+  auto resolved = resolvePointer(*ctx, mem);
 
-  if (resolved.size() == 1) {
+  // A replayed context has to go back to the store after making a decision
+  // here in case the recorded path forked.
+  if (resolved.size() == 1 && (!forced || mem.is_resolved())) {
     ctx->stack_top().insert(&call, LLVMValue(resolved[0]));
+    recordResolve(*ctx, mem, resolved[0]);
 
     if (!mem.is_resolved()) {
       ctx->backprop(mem, resolved[0]);
@@ -870,6 +1191,7 @@ ExecutionResult Interpreter::visitBuiltinResolve(llvm::CallInst& call) {
   auto forks = ctx->fork(resolved.size());
   for (auto [fork, ptr] : llvm::zip(forks, resolved)) {
     fork.stack_top().insert(&call, LLVMValue(ptr));
+    recordResolve(fork, mem, ptr);
 
     if (!mem.is_resolved()) {
       fork.backprop(mem, ptr);
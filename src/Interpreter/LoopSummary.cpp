@@ -0,0 +1,288 @@
+#include "caffeine/Interpreter/LoopSummary.h"
+#include "caffeine/IR/Transforms.h"
+#include "caffeine/Interpreter/Context.h"
+#include "caffeine/Support/Assert.h"
+
+#include <fmt/format.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+
+namespace caffeine {
+
+namespace {
+  bool is_pure(llvm::Instruction& inst) {
+    if (llvm::isa<llvm::DbgInfoIntrinsic>(inst))
+      return true;
+
+    switch (inst.getOpcode()) {
+    // Division can fault and the interpreter needs to check for that.
+    case llvm::Instruction::UDiv:
+    case llvm::Instruction::SDiv:
+    case llvm::Instruction::URem:
+    case llvm::Instruction::SRem:
+    case llvm::Instruction::Alloca:
+    case llvm::Instruction::Call:
+    case llvm::Instruction::Invoke:
+      return false;
+    default:
+      break;
+    }
+
+    return !inst.mayHaveSideEffects() && !inst.mayReadFromMemory();
+  }
+} // namespace
+
+class LoopSummaryBuilder {
+public:
+  LoopSummaryBuilder(llvm::ScalarEvolution& SE, llvm::Loop* loop)
+      : SE(SE), loop(loop) {}
+
+  std::optional<LoopSummary> build() {
+    auto preheader = loop->getLoopPreheader();
+    auto exiting = loop->getExitingBlock();
+    auto exit = loop->getExitBlock();
+    if (!preheader || !exiting || !exit)
+      return std::nullopt;
+
+    for (llvm::BasicBlock* block : loop->blocks()) {
+      for (llvm::Instruction& inst : *block) {
+        if (!is_pure(inst))
+          return std::nullopt;
+      }
+    }
+
+    if (llvm::isa<llvm::SCEVCouldNotCompute>(SE.getBackedgeTakenCount(loop)))
+      return std::nullopt;
+
+    LoopSummary summary{preheader, exiting, exit};
+    this->summary = &summary;
+
+    for (llvm::BasicBlock* block : loop->blocks()) {
+      for (llvm::Instruction& inst : *block) {
+        if (!is_used_outside_loop(inst))
+          continue;
+
+        if (!inst.getType()->isIntegerTy() || !SE.isSCEVable(inst.getType()))
+          return std::nullopt;
+
+        auto scev = SE.getSCEVAtScope(SE.getSCEV(&inst), loop->getParentLoop());
+        if (llvm::isa<llvm::SCEVCouldNotCompute>(scev) ||
+            !SE.isLoopInvariant(scev, loop))
+          return std::nullopt;
+
+        auto value = translate(scev);
+        if (!value)
+          return std::nullopt;
+
+        summary.exit_values_.push_back({&inst, value});
+      }
+    }
+
+    return summary;
+  }
+
+private:
+  bool is_used_outside_loop(llvm::Instruction& inst) const {
+    for (llvm::User* user : inst.users()) {
+      auto user_inst = llvm::dyn_cast<llvm::Instruction>(user);
+      if (!user_inst || !loop->contains(user_inst))
+        return true;
+    }
+
+    return false;
+  }
+
+  /**
+   * Convert a SCEV expression to an equivalent caffeine expression. Returns
+   * nullptr if the SCEV expression contains something that isn't supported.
+   */
+  OpRef translate(const llvm::SCEV* scev) {
+    auto it = memo.find(scev);
+    if (it != memo.end())
+      return it->second;
+
+    OpRef result = translate_uncached(scev);
+    memo.emplace(scev, result);
+    return result;
+  }
+
+  OpRef translate_uncached(const llvm::SCEV* scev) {
+    if (!scev->getType()->isIntegerTy())
+      return nullptr;
+
+    Type type = Type::from_llvm(scev->getType());
+
+    if (auto cnst = llvm::dyn_cast<llvm::SCEVConstant>(scev))
+      return ConstantInt::Create(cnst->getAPInt());
+
+    if (auto unknown = llvm::dyn_cast<llvm::SCEVUnknown>(scev)) {
+      llvm::Value* value = unknown->getValue();
+      for (const auto& [placeholder, input] : summary->inputs_) {
+        if (input == value)
+          return placeholder;
+      }
+
+      auto placeholder = Constant::Create(
+          type, Symbol(fmt::format("caffeine.loop.input{}",
+                                   summary->inputs_.size())));
+      summary->inputs_.emplace_back(placeholder, value);
+      return placeholder;
+    }
+
+    if (auto cast = llvm::dyn_cast<llvm::SCEVCastExpr>(scev)) {
+      OpRef operand = translate(cast->getOperand());
+      if (!operand)
+        return nullptr;
+
+      if (llvm::isa<llvm::SCEVTruncateExpr>(cast))
+        return UnaryOp::CreateTrunc(type, operand);
+      if (llvm::isa<llvm::SCEVZeroExtendExpr>(cast))
+        return UnaryOp::CreateZExt(type, operand);
+      if (llvm::isa<llvm::SCEVSignExtendExpr>(cast))
+        return UnaryOp::CreateSExt(type, operand);
+      return nullptr;
+    }
+
+    if (auto udiv = llvm::dyn_cast<llvm::SCEVUDivExpr>(scev)) {
+      // Only allow division by non-zero constants so that we never introduce
+      // a division that could fault.
+      auto rhs = llvm::dyn_cast<llvm::SCEVConstant>(udiv->getRHS());
+      if (!rhs || rhs->getAPInt().isNullValue())
+        return nullptr;
+
+      OpRef lhs = translate(udiv->getLHS());
+      if (!lhs)
+        return nullptr;
+      return BinaryOp::CreateUDiv(lhs, translate(rhs));
+    }
+
+    auto nary = llvm::dyn_cast<llvm::SCEVNAryExpr>(scev);
+    if (!nary || llvm::isa<llvm::SCEVAddRecExpr>(nary))
+      return nullptr;
+
+    OpRef result = nullptr;
+    for (const llvm::SCEV* operand : nary->operands()) {
+      OpRef value = translate(operand);
+      if (!value)
+        return nullptr;
+
+      if (!result) {
+        result = value;
+        continue;
+      }
+
+      if (llvm::isa<llvm::SCEVAddExpr>(nary))
+        result = BinaryOp::CreateAdd(result, value);
+      else if (llvm::isa<llvm::SCEVMulExpr>(nary))
+        result = BinaryOp::CreateMul(result, value);
+      else if (llvm::isa<llvm::SCEVUMaxExpr>(nary))
+        result = select(ICmpOpcode::UGT, result, value);
+      else if (llvm::isa<llvm::SCEVSMaxExpr>(nary))
+        result = select(ICmpOpcode::SGT, result, value);
+      else if (llvm::isa<llvm::SCEVUMinExpr>(nary))
+        result = select(ICmpOpcode::ULT, result, value);
+      else if (llvm::isa<llvm::SCEVSMinExpr>(nary))
+        result = select(ICmpOpcode::SLT, result, value);
+      else
+        return nullptr;
+    }
+
+    return result;
+  }
+
+  static OpRef select(ICmpOpcode cmp, const OpRef& lhs, const OpRef& rhs) {
+    return SelectOp::Create(ICmpOp::CreateICmp(cmp, lhs, rhs), lhs, rhs);
+  }
+
+private:
+  llvm::ScalarEvolution& SE;
+  llvm::Loop* loop;
+  LoopSummary* summary = nullptr;
+  std::unordered_map<const llvm::SCEV*, OpRef> memo;
+};
+
+LoopSummary::LoopSummary(llvm::BasicBlock* preheader,
+                         llvm::BasicBlock* exiting, llvm::BasicBlock* exit)
+    : preheader_(preheader), exiting_(exiting), exit_(exit) {}
+
+void LoopSummary::apply(Context& ctx) const {
+  auto& frame = ctx.stack_top();
+  CAFFEINE_ASSERT(frame.current_block == preheader_,
+                  "loop summary applied outside of the loop preheader");
+
+  llvm::SmallVector<std::pair<OpRef, OpRef>, 4> inputs;
+  for (const auto& [placeholder, value] : inputs_)
+    inputs.emplace_back(placeholder, ctx.lookup(value).scalar().expr());
+
+  auto substitute = [&](const OpRef& expr) {
+    if (!llvm::isa<Constant>(expr.get()))
+      return expr;
+
+    for (const auto& [placeholder, value] : inputs) {
+      if (placeholder == expr)
+        return value;
+    }
+
+    return expr;
+  };
+
+  for (const ExitValue& exit_value : exit_values_)
+    frame.insert(exit_value.inst,
+                 transforms::rebuild(exit_value.value, substitute));
+
+  // PHI nodes in the exit block refer to the exiting block, not the preheader.
+  frame.jump_to(exit_);
+  frame.prev_block = exiting_;
+}
+
+const LoopSummary* LoopSummaryCache::lookup(llvm::BasicBlock* header) {
+  std::lock_guard lock(mutex_);
+
+  llvm::Function* func = header->getParent();
+  if (lazy_ && analyzed_.insert(func).second)
+    analyze(func);
+
+  auto it = cache_.find(header);
+  if (it == cache_.end() || !it->second)
+    return nullptr;
+  return &*it->second;
+}
+
+void LoopSummaryCache::analyze(llvm::Module& module) {
+  std::lock_guard lock(mutex_);
+
+  for (llvm::Function& func : module) {
+    if (func.isDeclaration())
+      continue;
+    if (analyzed_.insert(&func).second)
+      analyze(&func);
+  }
+}
+
+void LoopSummaryCache::set_lazy(bool lazy) {
+  std::lock_guard lock(mutex_);
+  lazy_ = lazy;
+}
+
+void LoopSummaryCache::analyze(llvm::Function* func) {
+  llvm::DominatorTree DT{*func};
+  llvm::LoopInfo LI{DT};
+  llvm::TargetLibraryInfoImpl TLII{
+      llvm::Triple(func->getParent()->getTargetTriple())};
+  llvm::TargetLibraryInfo TLI{TLII};
+  llvm::AssumptionCache AC{*func};
+  llvm::ScalarEvolution SE{*func, TLI, AC, DT, LI};
+
+  for (llvm::Loop* loop : LI.getLoopsInPreorder()) {
+    cache_.emplace(loop->getHeader(), LoopSummaryBuilder(SE, loop).build());
+  }
+}
+
+} // namespace caffeine
@@ -7,6 +7,8 @@ void ExecutionPolicy::on_path_forked(Context&) {}
 void ExecutionPolicy::on_path_dequeued(Context&) {}
 void ExecutionPolicy::on_path_complete(const Context&, ExitStatus,
                                        const Assertion&) {}
+void ExecutionPolicy::on_value_concretized(Context&, const OpRef&,
+                                           const OpRef&) {}
 
 bool AlwaysAllowExecutionPolicy::should_queue_path(const Context&) {
   return true;
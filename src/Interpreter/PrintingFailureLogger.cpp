@@ -51,6 +51,32 @@ namespace {
   }
 } // namespace
 
+FailureInputs evaluate_inputs(const Model& model, const Context& ctx) {
+  FailureInputs inputs;
+  for (const auto& [name, constant] : ctx.constants)
+    inputs.emplace_back(name, model.evaluate(*constant));
+  return inputs;
+}
+
+void print_failure(std::ostream& os, const FailureInputs* inputs,
+                   const Context& ctx, std::string_view message) {
+  os << "Found assertion failure:\n";
+
+  if (inputs) {
+    for (const auto& [name, value] : *inputs) {
+      os << "  " << name << " = ";
+      print_value(os, value);
+      os << '\n';
+    }
+
+    os << "Backtrace:\n";
+    ctx.print_backtrace(os);
+  }
+
+  if (!message.empty())
+    os << "Reason:\n  " << message << '\n';
+}
+
 /***************************************************
  * PrintingFailureLogger                           *
  ***************************************************/
@@ -60,22 +86,14 @@ PrintingFailureLogger::PrintingFailureLogger(std::ostream& os) : os(&os) {}
 void PrintingFailureLogger::log_failure(const Model* model, const Context& ctx,
                                         const Failure& failure) {
   std::stringstream ss;
-  ss << "Found assertion failure:\n";
 
   if (model) {
-    for (const auto& [name, constant] : ctx.constants) {
-      ss << "  " << name << " = ";
-      print_value(ss, model->evaluate(*constant));
-      ss << '\n';
-    }
-
-    ss << "Backtrace:\n";
-    ctx.print_backtrace(ss);
+    FailureInputs inputs = evaluate_inputs(*model, ctx);
+    print_failure(ss, &inputs, ctx, failure.message);
+  } else {
+    print_failure(ss, nullptr, ctx, failure.message);
   }
 
-  if (!failure.message.empty())
-    ss << "Reason:\n  " << failure.message << '\n';
-
   std::unique_lock lock(mtx);
   *os << ss.str() << std::flush;
 }
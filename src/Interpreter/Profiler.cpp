@@ -0,0 +1,298 @@
+#include "caffeine/Interpreter/Profiler.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Support/Assert.h"
+
+#include <boost/algorithm/string/trim.hpp>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/DebugLoc.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string>
+
+namespace caffeine {
+
+namespace {
+  using Counters = InstructionProfiler::Counters;
+  using Metric = InstructionProfiler::Metric;
+
+  // The counters of the innermost scope on this thread.
+  thread_local Counters* current = nullptr;
+  // Value of Operation::num_created_on_thread when nodes were last charged to
+  // a scope.
+  thread_local uint64_t nodes_mark = 0;
+
+  // Charge any nodes created since the last call to the current scope.
+  void charge_nodes() {
+    uint64_t created = Operation::num_created_on_thread();
+    if (current)
+      current->nodes_created += created - nodes_mark;
+    nodes_mark = created;
+  }
+
+  uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  class ProfilingSolver : public Solver {
+  public:
+    explicit ProfilingSolver(std::shared_ptr<Solver> inner)
+        : inner(std::move(inner)) {}
+
+    SolverResult check(AssertionList& assertions,
+                       const Assertion& extra) override {
+      return record([&] { return inner->check(assertions, extra); });
+    }
+    SolverResult resolve(AssertionList& assertions,
+                         const Assertion& extra) override {
+      return record([&] { return inner->resolve(assertions, extra); });
+    }
+
+  private:
+    template <typename F>
+    SolverResult record(F&& func) {
+      auto start = std::chrono::steady_clock::now();
+      SolverResult result = func();
+
+      if (current) {
+        current->solver_calls += 1;
+        current->solver_ns += elapsed_ns(start);
+      }
+
+      return result;
+    }
+
+    std::shared_ptr<Solver> inner;
+  };
+
+  uint64_t metric_value(const Counters& counters, Metric metric) {
+    switch (metric) {
+    case Metric::Executions:
+      return counters.executions;
+    case Metric::Forks:
+      return counters.forks;
+    case Metric::SolverCalls:
+      return counters.solver_calls;
+    case Metric::SolverTime:
+      return counters.solver_ns;
+    case Metric::NodesCreated:
+      return counters.nodes_created;
+    case Metric::Time:
+      return counters.time_ns;
+    }
+
+    CAFFEINE_UNREACHABLE();
+  }
+
+  const char* metric_name(Metric metric) {
+    switch (metric) {
+    case Metric::Executions:
+      return "executions";
+    case Metric::Forks:
+      return "forks";
+    case Metric::SolverCalls:
+      return "solver calls";
+    case Metric::SolverTime:
+      return "solver time";
+    case Metric::NodesCreated:
+      return "nodes created";
+    case Metric::Time:
+      return "time";
+    }
+
+    CAFFEINE_UNREACHABLE();
+  }
+
+  /**
+   * Works out how to describe instructions to the user. Instructions are
+   * identified by their source location if the program has debug info and by
+   * their index within their function otherwise.
+   */
+  class Describer {
+  public:
+    std::string function(const llvm::Instruction* inst) {
+      const llvm::Function* func = inst->getFunction();
+      return func ? func->getName().str() : "<unknown>";
+    }
+
+    std::string location(const llvm::Instruction* inst) {
+      if (const auto& loc = inst->getDebugLoc()) {
+        return fmt::format(FMT_STRING("{}:{}:{}"), loc->getFilename().str(),
+                           loc->getLine(), loc->getColumn());
+      }
+
+      return fmt::format(FMT_STRING("{}+{}"), function(inst), index(inst));
+    }
+
+    std::string text(const llvm::Instruction* inst) {
+      std::string output;
+      llvm::raw_string_ostream ss{output};
+      ss << *inst;
+      ss.flush();
+      boost::algorithm::trim(output);
+      return output;
+    }
+
+  private:
+    size_t index(const llvm::Instruction* inst) {
+      const llvm::Function* func = inst->getFunction();
+      auto it = indices.find(func);
+      if (it == indices.end()) {
+        auto& map = indices[func];
+        size_t next = 0;
+        for (const llvm::BasicBlock& block : *func)
+          for (const llvm::Instruction& other : block)
+            map.emplace(&other, next++);
+        it = indices.find(func);
+      }
+
+      return it->second.at(inst);
+    }
+
+    std::unordered_map<const llvm::Function*,
+                       std::unordered_map<const llvm::Instruction*, size_t>>
+        indices;
+  };
+
+  std::atomic<uint64_t> next_profiler_id = 1;
+} // namespace
+
+InstructionProfiler::Counters&
+InstructionProfiler::Counters::operator+=(const Counters& other) {
+  executions += other.executions;
+  forks += other.forks;
+  solver_calls += other.solver_calls;
+  solver_ns += other.solver_ns;
+  nodes_created += other.nodes_created;
+  time_ns += other.time_ns;
+  return *this;
+}
+
+/***************************************************
+ * Scope                                           *
+ ***************************************************/
+InstructionProfiler::Scope::Scope(InstructionProfiler* profiler,
+                                  const llvm::Instruction* inst) {
+  if (!profiler)
+    return;
+
+  counters = &profiler->local()[inst];
+  counters->executions += 1;
+
+  charge_nodes();
+  prev = current;
+  current = counters;
+
+  start = std::chrono::steady_clock::now();
+}
+InstructionProfiler::Scope::~Scope() {
+  if (!counters)
+    return;
+
+  counters->time_ns += elapsed_ns(start);
+
+  charge_nodes();
+  current = prev;
+}
+
+void InstructionProfiler::Scope::add_forks(uint64_t count) {
+  if (counters)
+    counters->forks += count;
+}
+
+/***************************************************
+ * InstructionProfiler                             *
+ ***************************************************/
+InstructionProfiler::InstructionProfiler() : id_(next_profiler_id++) {}
+InstructionProfiler::~InstructionProfiler() = default;
+
+InstructionProfiler::Table& InstructionProfiler::local() {
+  thread_local uint64_t cached_id = 0;
+  thread_local Table* cached = nullptr;
+
+  if (cached_id != id_) {
+    std::lock_guard lock(mutex_);
+    tables_.push_back(std::make_unique<Table>());
+    cached = tables_.back().get();
+    cached_id = id_;
+  }
+
+  return *cached;
+}
+
+std::shared_ptr<Solver>
+InstructionProfiler::wrap(std::shared_ptr<Solver> solver) {
+  return std::make_shared<ProfilingSolver>(std::move(solver));
+}
+
+std::vector<std::pair<const llvm::Instruction*, InstructionProfiler::Counters>>
+InstructionProfiler::merged() const {
+  Table merged;
+
+  {
+    std::lock_guard lock(mutex_);
+    for (const auto& table : tables_)
+      for (const auto& [inst, counters] : *table)
+        merged[inst] += counters;
+  }
+
+  return {merged.begin(), merged.end()};
+}
+
+void InstructionProfiler::write_report(std::ostream& os, Metric metric,
+                                       size_t limit) const {
+  auto entries = merged();
+  std::sort(entries.begin(), entries.end(), [&](const auto& a, const auto& b) {
+    return metric_value(a.second, metric) > metric_value(b.second, metric);
+  });
+
+  Counters total;
+  for (const auto& entry : entries)
+    total += entry.second;
+
+  fmt::print(os,
+             FMT_STRING("Instruction profile: {} instructions executed, {} "
+                        "solver calls taking {:.3f}s (sorted by {})\n"),
+             total.executions, total.solver_calls, total.solver_ns / 1e9,
+             metric_name(metric));
+  fmt::print(os, FMT_STRING("{:>10} {:>8} {:>8} {:>10} {:>10} {:>10}  {}\n"),
+             "execs", "forks", "queries", "solver ms", "nodes", "time ms",
+             "location");
+
+  Describer describe;
+  for (const auto& [inst, counters] : entries) {
+    if (limit-- == 0)
+      break;
+
+    fmt::print(os,
+               FMT_STRING("{:>10} {:>8} {:>8} {:>10.1f} {:>10} {:>10.1f}  {}\n"
+                          "{:>63}| {}\n"),
+               counters.executions, counters.forks, counters.solver_calls,
+               counters.solver_ns / 1e6, counters.nodes_created,
+               counters.time_ns / 1e6, describe.location(inst), "",
+               describe.text(inst));
+  }
+}
+
+void InstructionProfiler::write_folded(std::ostream& os, Metric metric) const {
+  Describer describe;
+
+  for (const auto& [inst, counters] : merged()) {
+    uint64_t value = metric_value(counters, metric);
+    if (value == 0)
+      continue;
+
+    fmt::print(os, FMT_STRING("{};{} ({}) {}\n"), describe.function(inst),
+               describe.location(inst), inst->getOpcodeName(), value);
+  }
+}
+
+} // namespace caffeine
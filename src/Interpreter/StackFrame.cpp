@@ -25,4 +25,20 @@ void StackFrame::insert(llvm::Value* value, const LLVMValue& exprs) {
   variables.insert_or_assign(value, exprs);
 }
 
+llvm::Instruction* StackFrame::current_instruction() const {
+  // We don't have a valid iterator.
+  if (!current_block || current == current_block->end())
+    return nullptr;
+
+  // This case probably shouldn't happen but this method gets called when
+  // things are going wrong so we need to handle all possibilities.
+  if (current == current_block->begin()) {
+    if (prev_block)
+      return &prev_block->back();
+    return &*current;
+  }
+
+  return &*std::prev(current);
+}
+
 } // namespace caffeine
@@ -3,9 +3,35 @@
 #include "caffeine/ADT/Guard.h"
 #include "caffeine/Interpreter/Context.h"
 #include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Stats.h"
 
 namespace caffeine {
 
+namespace {
+  stats::Gauge num_queued{"store.queued",
+                          "Number of paths waiting to be executed"};
+  stats::Gauge queue_bytes{
+      "store.queue_bytes",
+      "Estimated memory used by paths in the shared queue (only tracked "
+      "with InterpreterOptions::track_footprint)"};
+  stats::Gauge local_bytes{
+      "store.local_bytes",
+      "Estimated memory used by paths in per-thread queues (only tracked "
+      "with InterpreterOptions::track_footprint)"};
+
+  stats::Counter num_evicted{
+      "store.evicted",
+      "Number of queued paths that were only kept as their decisions"};
+  stats::Counter num_rebuild_failures{
+      "store.rebuild_failures",
+      "Number of paths that were dropped because they could not be rebuilt"};
+
+  // Memory that will be freed once the context has been executed.
+  int64_t resident_bytes(const Context& ctx) {
+    return ctx.footprint ? ctx.footprint->unique() : 0;
+  }
+} // namespace
+
 void ExecutionContextStore::add_context_multi(Span<Context> contexts) {
   for (Context& ctx : contexts) {
     add_context(std::move(ctx));
@@ -39,16 +65,26 @@ std::optional<Context> QueueingContextStore::next_context() {
 }
 
 void QueueingContextStore::add_context(Context&& ctx) {
+  int64_t bytes = resident_bytes(ctx);
+
   auto lock = std::unique_lock(mutex);
   queue.push(std::move(ctx));
   lock.unlock();
+  num_queued.add();
+  queue_bytes.add(bytes);
   condvar.notify_one();
 }
 void QueueingContextStore::add_context_multi(Span<Context> ctxs) {
+  int64_t bytes = 0;
+  for (const Context& ctx : ctxs)
+    bytes += resident_bytes(ctx);
+
   auto lock = std::unique_lock(mutex);
   for (Context& ctx : ctxs)
     queue.push(std::move(ctx));
   lock.unlock();
+  num_queued.add(ctxs.size());
+  queue_bytes.add(bytes);
 
   if (ctxs.size() == 1)
     condvar.notify_one();
@@ -68,6 +104,8 @@ Context QueueingContextStore::dequeue() {
 
   Context ctx = std::move(queue.front());
   queue.pop();
+  num_queued.sub();
+  queue_bytes.sub(resident_bytes(ctx));
   return ctx;
 }
 
@@ -80,6 +118,8 @@ std::optional<Context> ThreadQueuedContextStore::next_context() {
   if (!queue.empty()) {
     Context ctx = std::move(queue.back());
     queue.pop_back();
+    num_queued.sub();
+    local_bytes.sub(resident_bytes(ctx));
     return ctx;
   }
 
@@ -92,11 +132,15 @@ void ThreadQueuedContextStore::add_context(Context&& ctx) {
     return QueueingContextStore::add_context(std::move(ctx));
 
   if (queue->size() >= cache_size) {
+    num_queued.sub();
+    local_bytes.sub(resident_bytes(queue->front()));
     QueueingContextStore::add_context(std::move(queue->front()));
     queue->pop_front();
   }
 
+  local_bytes.add(resident_bytes(ctx));
   queue->push_back(std::move(ctx));
+  num_queued.add();
 }
 void ThreadQueuedContextStore::add_context_multi(Span<Context> ctxs) {
   auto* queue = locals.get();
@@ -104,12 +148,229 @@ void ThreadQueuedContextStore::add_context_multi(Span<Context> ctxs) {
     return QueueingContextStore::add_context_multi(ctxs);
 
   while (queue->size() < cache_size && !ctxs.empty()) {
+    local_bytes.add(resident_bytes(ctxs.front()));
     queue->push_back(std::move(ctxs.front()));
     ctxs = ctxs.subslice(1);
+    num_queued.add();
   }
 
   if (!ctxs.empty())
     QueueingContextStore::add_context_multi(ctxs);
 }
 
+/***************************************************
+ * DeterministicContextStore                       *
+ ***************************************************/
+DeterministicContextStore::DeterministicContextStore(size_t round_size)
+    : round_size(round_size) {
+  CAFFEINE_ASSERT(round_size != 0);
+}
+
+std::optional<Context> DeterministicContextStore::next_context() {
+  Worker& worker = workers.get_or_insert();
+
+  auto lock = std::unique_lock(mutex);
+  if (worker.task)
+    finish_task(worker);
+
+  while (!done) {
+    if (next_task < round.size()) {
+      size_t task = next_task++;
+      worker.task = task;
+
+      num_queued.sub();
+      queue_bytes.sub(resident_bytes(round[task]));
+      return std::move(round[task]);
+    }
+
+    if (num_finished == round.size()) {
+      start_round();
+      continue;
+    }
+
+    condvar.wait(lock);
+  }
+
+  return std::nullopt;
+}
+
+void DeterministicContextStore::add_context(Context&& ctx) {
+  num_queued.add();
+  queue_bytes.add(resident_bytes(ctx));
+
+  // Each worker only ever touches the children of the context that it is
+  // executing so this doesn't need to take the lock.
+  Worker* worker = workers.get();
+  if (worker && worker->task) {
+    children[*worker->task].push_back(std::move(ctx));
+    return;
+  }
+
+  auto lock = std::unique_lock(mutex);
+  ctx.path_id = next_path_id++;
+  frontier.push_back(std::move(ctx));
+}
+
+void DeterministicContextStore::shutdown() {
+  auto lock = std::unique_lock(mutex);
+  done = true;
+  lock.unlock();
+  condvar.notify_all();
+}
+
+void DeterministicContextStore::wait_for_turn() {
+  Worker* worker = workers.get();
+  if (!worker || !worker->task)
+    return;
+
+  auto lock = std::unique_lock(mutex);
+  while (first_unfinished < *worker->task && !done)
+    condvar.wait(lock);
+}
+
+void DeterministicContextStore::finish_task(Worker& worker) {
+  finished[*worker.task] = true;
+  worker.task = std::nullopt;
+  num_finished += 1;
+
+  while (first_unfinished < finished.size() && finished[first_unfinished])
+    first_unfinished += 1;
+
+  condvar.notify_all();
+}
+
+void DeterministicContextStore::start_round() {
+  CAFFEINE_ASSERT(num_finished == round.size());
+
+  // Number the new contexts in order and then put them at the front of the
+  // frontier so that exploration stays close to depth-first. This keeps the
+  // frontier from growing too large on programs with many paths.
+  for (auto& ctxs : children) {
+    for (Context& ctx : ctxs)
+      ctx.path_id = next_path_id++;
+  }
+  for (auto it = children.rbegin(); it != children.rend(); ++it) {
+    for (auto ctx = it->rbegin(); ctx != it->rend(); ++ctx)
+      frontier.push_front(std::move(*ctx));
+  }
+
+  round.clear();
+  while (round.size() < round_size && !frontier.empty()) {
+    round.push_back(std::move(frontier.front()));
+    frontier.pop_front();
+  }
+
+  children.clear();
+  children.resize(round.size());
+  finished.assign(round.size(), false);
+  next_task = 0;
+  num_finished = 0;
+  first_unfinished = 0;
+
+  if (round.empty())
+    done = true;
+
+  condvar.notify_all();
+}
+
+/***************************************************
+ * DeterministicContextStore::OrderedLogger        *
+ ***************************************************/
+DeterministicContextStore::OrderedLogger::OrderedLogger(
+    FailureLogger* inner, DeterministicContextStore* store)
+    : inner(inner), store(store) {}
+
+void DeterministicContextStore::OrderedLogger::log_failure(
+    const Model* model, const Context& context, const Failure& failure) {
+  store->wait_for_turn();
+  inner->log_failure(model, context, failure);
+}
+
+/***************************************************
+ * ReplayingContextStore                           *
+ ***************************************************/
+ReplayingContextStore::ReplayingContextStore(size_t num_readers,
+                                             size_t max_resident,
+                                             ReplayFn replay)
+    : num_readers(num_readers), max_resident(max_resident),
+      replay(std::move(replay)) {}
+
+std::optional<Context> ReplayingContextStore::next_context() {
+  while (true) {
+    auto lock = std::unique_lock(mutex);
+    if (done)
+      return std::nullopt;
+
+    if (queue.empty()) {
+      blocked += 1;
+      auto guard = make_guard([&] { blocked -= 1; });
+
+      if (blocked == num_readers) {
+        done = true;
+        condvar.notify_all();
+      }
+
+      while (queue.empty() && !done)
+        condvar.wait(lock);
+
+      if (done)
+        return std::nullopt;
+    }
+
+    Entry entry = std::move(queue.front());
+    queue.pop();
+    num_queued.sub();
+
+    if (auto* ctx = std::get_if<Context>(&entry)) {
+      resident -= 1;
+      queue_bytes.sub(resident_bytes(*ctx));
+      return std::move(*ctx);
+    }
+
+    lock.unlock();
+
+    if (auto ctx = replay(std::get<DecisionLog>(entry)))
+      return ctx;
+    ++num_rebuild_failures;
+  }
+}
+
+void ReplayingContextStore::add_context(Context&& ctx) {
+  auto lock = std::unique_lock(mutex);
+  enqueue(std::move(ctx));
+  lock.unlock();
+  condvar.notify_one();
+}
+void ReplayingContextStore::add_context_multi(Span<Context> ctxs) {
+  auto lock = std::unique_lock(mutex);
+  for (Context& ctx : ctxs)
+    enqueue(std::move(ctx));
+  lock.unlock();
+
+  if (ctxs.size() == 1)
+    condvar.notify_one();
+  else
+    condvar.notify_all();
+}
+
+void ReplayingContextStore::shutdown() {
+  auto lock = std::unique_lock(mutex);
+  done = true;
+  lock.unlock();
+  condvar.notify_all();
+}
+
+void ReplayingContextStore::enqueue(Context&& ctx) {
+  num_queued.add();
+
+  if (resident < max_resident) {
+    resident += 1;
+    queue_bytes.add(resident_bytes(ctx));
+    queue.emplace(std::in_place_type<Context>, std::move(ctx));
+  } else {
+    ++num_evicted;
+    queue.emplace(std::in_place_type<DecisionLog>, std::move(ctx.decisions));
+  }
+}
+
 } // namespace caffeine
@@ -4,6 +4,7 @@
 #include "caffeine/Interpreter/Value.h"
 #include "caffeine/Solver/Solver.h"
 #include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Stats.h"
 #include "caffeine/Support/UnsupportedOperation.h"
 
 #include <llvm/ADT/SmallVector.h>
@@ -12,6 +13,16 @@
 
 namespace caffeine {
 
+namespace {
+  stats::Counter num_resolves{"memory.resolve.calls",
+                              "Number of pointers resolved to allocations"};
+  stats::Histogram resolve_candidates{
+      "memory.resolve.candidates",
+      "Number of allocations that a symbolic pointer could point to"};
+  stats::Histogram resolve_time{"memory.resolve.time_ns",
+                                "Time spent resolving pointers"};
+} // namespace
+
 /***************************************************
  * Allocation                                      *
  ***************************************************/
@@ -454,6 +465,8 @@ llvm::SmallVector<Pointer, 1> MemHeap::resolve(std::shared_ptr<Solver> solver,
                                                const Pointer& ptr,
                                                Context& ctx) const {
   llvm::SmallVector<Pointer, 1> results;
+  stats::ScopedTimer timer{resolve_time};
+  ++num_resolves;
 
   if (ptr.is_resolved()) {
     CAFFEINE_UASSERT(ptr.heap() == index_,
@@ -487,8 +500,26 @@ llvm::SmallVector<Pointer, 1> MemHeap::resolve(std::shared_ptr<Solver> solver,
     }
   }
 
+  resolve_candidates.record(results.size());
   return results;
 }
+std::optional<Pointer> MemHeap::resolve_slot(const Pointer& ptr,
+                                             size_t slot) const {
+  if (ptr.is_resolved()) {
+    CAFFEINE_UASSERT(ptr.heap() == index_,
+                     "Attempted to resolve a pointer using the wrong heap");
+    if (!check_live(ptr.alloc()))
+      return std::nullopt;
+    return ptr;
+  }
+
+  auto it = allocs_.find_slot(slot);
+  if (it == allocs_.end())
+    return std::nullopt;
+
+  return Pointer(it.key(), BinaryOp::CreateSub(ptr.value(*this), it->address()),
+                 ptr.heap());
+}
 OpRef MemHeap::alloc_addr(const OpRef& size, const OpRef& align, Context& ctx) {
   if (allocator_.index() == Symbolic)
     goto symbolic;
@@ -556,5 +587,9 @@ MemHeapMgr::resolve(std::shared_ptr<Solver> solver, const Pointer& value,
                     Context& ctx) const {
   return (*this)[value.heap()].resolve(std::move(solver), value, ctx);
 }
+std::optional<Pointer> MemHeapMgr::resolve_slot(const Pointer& value,
+                                                size_t slot) const {
+  return (*this)[value.heap()].resolve_slot(value, slot);
+}
 
 } // namespace caffeine
@@ -0,0 +1,282 @@
+#include "caffeine/Serialization/ExprGraph.h"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+
+namespace caffeine {
+
+namespace {
+  bool is_serializable(const Type& type) {
+    switch (type.kind()) {
+    case Type::Void:
+    case Type::Integer:
+    case Type::FloatingPoint:
+    case Type::Array:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void write_type(protos::Type::Builder builder, const Type& type) {
+    switch (type.kind()) {
+    case Type::Void:
+      builder.setNone();
+      return;
+    case Type::Integer:
+      builder.setInteger(type.bitwidth());
+      return;
+    case Type::FloatingPoint: {
+      auto fp = builder.initFloatingPoint();
+      fp.setExponent(type.exponent_bits());
+      fp.setMantissa(type.mantissa_bits());
+      return;
+    }
+    case Type::Array:
+      builder.setArray(type.bitwidth());
+      return;
+    default:
+      CAFFEINE_UNREACHABLE("type should have been checked when it was added");
+    }
+  }
+
+  Type read_type(protos::Type::Reader reader) {
+    // Values here come from outside the program so they need to be validated
+    // before they reach the assertions within the Type constructors.
+    constexpr uint32_t MAX_BITWIDTH = (UINT32_C(1) << 24) - 1;
+    constexpr uint32_t MAX_FLOAT_BITS = (UINT32_C(1) << 12) - 1;
+
+    switch (reader.which()) {
+    case protos::Type::NONE:
+      return Type::void_ty();
+    case protos::Type::INTEGER:
+      if (reader.getInteger() == 0 || reader.getInteger() > MAX_BITWIDTH)
+        break;
+      return Type::int_ty(reader.getInteger());
+    case protos::Type::FLOATING_POINT: {
+      auto fp = reader.getFloatingPoint();
+      if (fp.getExponent() == 0 || fp.getExponent() > MAX_FLOAT_BITS ||
+          fp.getMantissa() == 0 || fp.getMantissa() > MAX_FLOAT_BITS)
+        break;
+      return Type::float_ty(fp.getExponent(), fp.getMantissa());
+    }
+    case protos::Type::ARRAY:
+      if (reader.getArray() == 0 || reader.getArray() > MAX_BITWIDTH)
+        break;
+      return Type::array_ty(reader.getArray());
+    }
+
+    throw SerializationError("invalid type in expression graph");
+  }
+
+  void write_symbol(protos::Symbol::Builder builder, const Symbol& symbol) {
+    if (symbol.is_numbered()) {
+      builder.setNumber(symbol.number());
+      return;
+    }
+
+    std::string_view name = symbol.name();
+    auto text = builder.initName(name.size());
+    std::copy(name.begin(), name.end(), text.begin());
+  }
+
+  Symbol read_symbol(protos::Symbol::Reader reader) {
+    if (reader.isNumber())
+      return Symbol(reader.getNumber());
+
+    auto name = reader.getName();
+    return Symbol(std::string_view(name.begin(), name.size()));
+  }
+
+  void write_words(capnp::List<uint64_t>::Builder builder,
+                   const llvm::APInt& value) {
+    for (unsigned i = 0; i < value.getNumWords(); ++i)
+      builder.set(i, value.getRawData()[i]);
+  }
+
+  llvm::APInt read_words(capnp::List<uint64_t>::Reader reader,
+                         unsigned bitwidth) {
+    llvm::SmallVector<uint64_t, 2> words{reader.begin(), reader.end()};
+    if (words.size() != llvm::APInt::getNumWords(bitwidth))
+      throw SerializationError("constant has the wrong number of words");
+
+    return llvm::APInt(bitwidth, words);
+  }
+} // namespace
+
+uint32_t ExprGraphWriter::add(const OpRef& expr) {
+  CAFFEINE_ASSERT(expr, "tried to serialize a null expression");
+
+  auto it = indices_.find(expr.get());
+  if (it != indices_.end())
+    return it->second;
+
+  // Do a post-order traversal with an explicit stack since expressions can be
+  // far deeper than the native stack would allow.
+  //
+  // FixedArray reports the elements of its data() as its operands so they
+  // are written out here like any other operand and the reader rebuilds the
+  // array from them.
+  llvm::SmallVector<std::pair<const OpRef*, size_t>, 16> stack;
+  stack.emplace_back(&expr, 0);
+
+  while (!stack.empty()) {
+    auto& [op, next] = stack.back();
+
+    if (next < (*op)->num_operands()) {
+      const OpRef& operand = (*op)->operand_at(next++);
+      if (!indices_.count(operand.get()))
+        stack.emplace_back(&operand, 0);
+      continue;
+    }
+
+    if (llvm::isa<FunctionObject>(**op))
+      throw SerializationError("unable to serialize a function object");
+    if (!is_serializable((*op)->type()))
+      throw SerializationError(fmt::format(
+          "unable to serialize expression of type {}", (*op)->type()));
+
+    indices_.emplace(op->get(), (uint32_t)nodes_.size());
+    nodes_.push_back(*op);
+    stack.pop_back();
+  }
+
+  return indices_.at(expr.get());
+}
+
+void ExprGraphWriter::write(protos::ExprGraph::Builder builder) const {
+  auto nodes = builder.initNodes(nodes_.size());
+
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const Operation* op = nodes_[i].get();
+    auto node = nodes[i];
+
+    node.setOpcode(op->opcode());
+    write_type(node.initType(), op->type());
+
+    auto operands = node.initOperands(op->num_operands());
+    for (size_t j = 0; j < op->num_operands(); ++j)
+      operands.set(j, indices_.at(op->operand_at(j).get()));
+
+    if (const auto* constant = llvm::dyn_cast<Constant>(op)) {
+      write_symbol(node.initSymbol(), constant->symbol());
+    } else if (const auto* array = llvm::dyn_cast<ConstantArray>(op)) {
+      write_symbol(node.initSymbol(), array->symbol());
+    } else if (const auto* cint = llvm::dyn_cast<ConstantInt>(op)) {
+      const llvm::APInt& value = cint->value();
+      write_words(node.initIntValue(value.getNumWords()), value);
+    } else if (const auto* cfloat = llvm::dyn_cast<ConstantFloat>(op)) {
+      llvm::APInt value = cfloat->value().bitcastToAPInt();
+      write_words(node.initFloatValue(value.getNumWords()), value);
+    } else {
+      node.setNone();
+    }
+  }
+}
+
+ExprGraphReader::ExprGraphReader(protos::ExprGraph::Reader reader) {
+  auto nodes = reader.getNodes();
+  nodes_.reserve(nodes.size());
+
+  for (auto node : nodes)
+    nodes_.push_back(read(node));
+}
+
+const OpRef& ExprGraphReader::operator[](uint32_t index) const {
+  if (index >= nodes_.size())
+    throw SerializationError(
+        fmt::format("expression index {} is out of bounds", index));
+  return nodes_[index];
+}
+
+OpRef ExprGraphReader::read(protos::Operation::Reader node) const {
+  auto opcode = static_cast<Operation::Opcode>(node.getOpcode());
+  if (Operation::opcode_name(opcode) == "Unknown")
+    throw SerializationError(fmt::format("unknown opcode {}", node.getOpcode()));
+
+  Type type = read_type(node.getType());
+
+  llvm::SmallVector<OpRef, 3> operands;
+  for (uint32_t index : node.getOperands())
+    operands.push_back((*this)[index]);
+
+  if (opcode != Operation::FixedArray &&
+      operands.size() != detail::opcode_nargs(opcode))
+    throw SerializationError(
+        fmt::format("wrong number of operands for {}",
+                    Operation::opcode_name(opcode)));
+
+  auto expect_payload = [&](protos::Operation::Which which) {
+    if (node.which() != which)
+      throw SerializationError(
+          fmt::format("missing payload for {}", Operation::opcode_name(opcode)));
+  };
+
+  switch (opcode) {
+  case Operation::ConstantNamed:
+  case Operation::ConstantNumbered:
+    expect_payload(protos::Operation::SYMBOL);
+    return Constant::Create(type, read_symbol(node.getSymbol()));
+  case Operation::ConstantArray:
+    expect_payload(protos::Operation::SYMBOL);
+    return ConstantArray::Create(read_symbol(node.getSymbol()), operands[0]);
+  case Operation::ConstantInt:
+    expect_payload(protos::Operation::INT_VALUE);
+    if (!type.is_int())
+      break;
+    return ConstantInt::Create(read_words(node.getIntValue(), type.bitwidth()));
+  case Operation::ConstantFloat: {
+    expect_payload(protos::Operation::FLOAT_VALUE);
+    const llvm::fltSemantics* semantics = type.llvm_flt_semantics();
+    if (!semantics)
+      break;
+    unsigned bits = llvm::APFloat::getSizeInBits(*semantics);
+    return ConstantFloat::Create(
+        llvm::APFloat(*semantics, read_words(node.getFloatValue(), bits)));
+  }
+  case Operation::FunctionObject:
+    break;
+  case Operation::Undef:
+    return Undef::Create(type);
+  case Operation::Select:
+    return SelectOp::Create(operands[0], operands[1], operands[2]);
+  case Operation::FixedArray:
+    if (!type.is_array())
+      break;
+    return FixedArray::Create(
+        Type::int_ty(type.bitwidth()),
+        PersistentArray<OpRef>(
+            std::vector<OpRef>(operands.begin(), operands.end())));
+  case Operation::Alloc:
+    return AllocOp::Create(operands[0], operands[1]);
+  case Operation::Load:
+    return LoadOp::Create(operands[0], operands[1]);
+  case Operation::Store:
+    return StoreOp::Create(operands[0], operands[1], operands[2]);
+  default:
+    switch (detail::opcode_base(opcode)) {
+    case CAFFEINE_ICMP_BASE:
+      return ICmpOp::CreateICmp(
+          static_cast<ICmpOpcode>(detail::opcode_aux(opcode)), operands[0],
+          operands[1]);
+    case CAFFEINE_FCMP_BASE:
+      return FCmpOp::CreateFCmp(
+          static_cast<FCmpOpcode>(detail::opcode_aux(opcode)), operands[0],
+          operands[1]);
+    }
+
+    if (operands.size() == 2)
+      return BinaryOp::Create(opcode, operands[0], operands[1]);
+    if (operands.size() == 1)
+      return UnaryOp::Create(opcode, operands[0], type);
+    break;
+  }
+
+  throw SerializationError(fmt::format("invalid {} node in expression graph",
+                                       Operation::opcode_name(opcode)));
+}
+
+} // namespace caffeine
@@ -0,0 +1,745 @@
+#include "caffeine/Solver/BitBlastSolver.h"
+#include "caffeine/ADT/Guard.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Value.h"
+#include "caffeine/IR/Visitor.h"
+#include "caffeine/Interpreter/AssertionList.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Cancellation.h"
+#include "caffeine/Support/Stats.h"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <cadical.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace caffeine {
+
+namespace {
+  stats::Counter num_queries{"solver.bitblast.queries",
+                             "Number of queries sent to the bit-blaster"};
+  stats::Counter num_sat{"solver.bitblast.sat",
+                         "Number of SAT results from the bit-blaster"};
+  stats::Counter num_unsat{"solver.bitblast.unsat",
+                           "Number of UNSAT results from the bit-blaster"};
+  stats::Counter num_unknown{"solver.bitblast.unknown",
+                             "Number of unknown results from the bit-blaster"};
+  stats::Counter num_unsupported{
+      "solver.bitblast.unsupported",
+      "Number of queries containing operations that can't be bit-blasted"};
+  stats::Counter num_gates{"solver.bitblast.gates",
+                           "Number of gates encoded into the SAT solver"};
+  stats::Histogram query_time{"solver.bitblast.time_ns",
+                              "Time taken to bit-blast and solve queries"};
+
+  /**
+   * A literal within the SAT instance. The low bit is set if the literal is
+   * negated. Variable 0 is always true so literal 0 is true and literal 1 is
+   * false.
+   */
+  using Lit = uint32_t;
+  constexpr Lit True = 0;
+  constexpr Lit False = 1;
+
+  // Result codes of CaDiCaL::Solver::solve.
+  constexpr int Satisfiable = 10;
+  constexpr int Unsatisfiable = 20;
+
+  Lit negate(Lit lit) {
+    return lit ^ 1;
+  }
+  uint32_t var_of(Lit lit) {
+    return lit >> 1;
+  }
+
+  // The bits of an integer, least significant bit first.
+  using Bits = std::vector<Lit>;
+
+  // Thrown when an operation in the query can't be bit-blasted.
+  struct Unsupported {};
+
+  /**
+   * The inputs bits for a symbol are always consecutive variables.
+   */
+  struct InputRange {
+    uint32_t first;
+    uint32_t width;
+  };
+  using SymbolMap = std::unordered_map<Symbol, InputRange>;
+
+  /**
+   * A propositional circuit along with the SAT solver it is fed into.
+   *
+   * Gates are structurally hashed: asking for a gate that has already been
+   * built returns the existing output instead of encoding a new one. Gates
+   * with constant inputs are folded away.
+   *
+   * Each gate gets a variable of its own and is Tseitin-encoded into CaDiCaL.
+   * Those clauses hold no matter which assertions are active, so they (and
+   * anything CaDiCaL learns from them) stay in the solver across queries.
+   */
+  class Circuit {
+  public:
+    Circuit() {
+      // Variable 0 is always true.
+      add_clause({input()});
+    }
+
+    Lit input() {
+      return num_vars_++ << 1;
+    }
+
+    Lit land(Lit a, Lit b) {
+      if (a == False || b == False || a == negate(b))
+        return False;
+      if (a == True || a == b)
+        return b;
+      if (b == True)
+        return a;
+      if (a > b)
+        std::swap(a, b);
+
+      auto [it, inserted] = ands_.try_emplace({a, b}, True);
+      if (!inserted)
+        return it->second;
+
+      Lit out = gate();
+      add_clause({negate(out), a});
+      add_clause({negate(out), b});
+      add_clause({out, negate(a), negate(b)});
+      it->second = out;
+      return out;
+    }
+
+    Lit lor(Lit a, Lit b) {
+      return negate(land(negate(a), negate(b)));
+    }
+
+    Lit lxor(Lit a, Lit b) {
+      // Pull the negations out to the output so that xor(a, b) and
+      // xor(!a, b) share the same gate.
+      Lit parity = (a ^ b) & 1;
+      a &= ~Lit(1);
+      b &= ~Lit(1);
+
+      if (a == b)
+        return False ^ parity;
+      if (a == True)
+        return negate(b) ^ parity;
+      if (b == True)
+        return negate(a) ^ parity;
+      if (a > b)
+        std::swap(a, b);
+
+      auto [it, inserted] = xors_.try_emplace({a, b}, True);
+      if (!inserted)
+        return it->second ^ parity;
+
+      Lit out = gate();
+      add_clause({negate(out), a, b});
+      add_clause({negate(out), negate(a), negate(b)});
+      add_clause({out, negate(a), b});
+      add_clause({out, a, negate(b)});
+      it->second = out;
+      return out ^ parity;
+    }
+
+    Lit mux(Lit cond, Lit t, Lit f) {
+      if (cond == True || t == f)
+        return t;
+      if (cond == False)
+        return f;
+      if (t == negate(f))
+        return lxor(cond, f);
+      return lor(land(cond, t), land(negate(cond), f));
+    }
+
+    /**
+     * Solve under the given assumptions. Returns Satisfiable, Unsatisfiable
+     * or 0 if the solver was interrupted.
+     */
+    int solve(llvm::ArrayRef<Lit> assumptions,
+              CaDiCaL::Terminator* terminator) {
+      if (terminator)
+        solver_.connect_terminator(terminator);
+      auto guard = make_guard([&] { solver_.disconnect_terminator(); });
+
+      for (Lit lit : assumptions)
+        solver_.assume(dimacs(lit));
+      return solver_.solve();
+    }
+
+    /**
+     * The value of a variable in the last satisfying assignment. Only valid
+     * right after solve returned Satisfiable.
+     */
+    bool value(uint32_t var) {
+      // Inputs which don't appear in any clause are unknown to the solver.
+      int lit = dimacs(var << 1);
+      if (lit > solver_.vars())
+        return false;
+      return solver_.val(lit) > 0;
+    }
+
+    size_t num_vars() const {
+      return num_vars_;
+    }
+
+  private:
+    static int dimacs(Lit lit) {
+      int var = (int)var_of(lit) + 1;
+      return (lit & 1) ? -var : var;
+    }
+
+    void add_clause(std::initializer_list<Lit> lits) {
+      for (Lit lit : lits)
+        solver_.add(dimacs(lit));
+      solver_.add(0);
+    }
+
+    Lit gate() {
+      ++num_gates;
+      return input();
+    }
+
+    CaDiCaL::Solver solver_;
+    uint32_t num_vars_ = 0;
+    llvm::DenseMap<std::pair<Lit, Lit>, Lit> ands_;
+    llvm::DenseMap<std::pair<Lit, Lit>, Lit> xors_;
+  };
+
+  /**
+   * Translates operations into bits within a circuit.
+   *
+   * The bits of each operation are cached across queries. Entries are keyed
+   * by address and hold a weak reference to the operation so that an entry is
+   * never used for a different operation that ends up at the same address. An
+   * empty entry records that the operation can't be bit-blasted.
+   */
+  class BitBlaster : public ConstOpVisitor<BitBlaster, Bits> {
+  public:
+    // Multiplication and division generate a quadratic number of gates.
+    static constexpr uint32_t MaxArithWidth = 128;
+
+    BitBlaster() = default;
+
+    Lit blast_bool(const Operation& op) {
+      const Bits& bits = visit(op);
+      CAFFEINE_ASSERT(bits.size() == 1);
+      return bits[0];
+    }
+
+    Circuit& circuit() {
+      return circuit_;
+    }
+
+    // The input bits for every symbol that has been seen.
+    const SymbolMap& symbols() const {
+      return symbols_;
+    }
+
+    void maybe_sweep() {
+      if (cache_.size() < next_sweep_)
+        return;
+
+      for (auto it = cache_.begin(); it != cache_.end();) {
+        if (it->second.op.expired())
+          it = cache_.erase(it);
+        else
+          ++it;
+      }
+      next_sweep_ = std::max<size_t>(4096, cache_.size() * 2);
+    }
+
+    Bits visit(const Operation& op) {
+      auto it = cache_.find(&op);
+      if (it != cache_.end() && !it->second.op.expired()) {
+        if (it->second.bits.empty())
+          throw Unsupported();
+        return it->second.bits;
+      }
+
+      auto weak = op.weak_from_this();
+      Bits bits;
+      try {
+        bits = ConstOpVisitor<BitBlaster, Bits>::visit(op);
+      } catch (const Unsupported&) {
+        if (!weak.expired())
+          cache_.insert_or_assign(&op, Entry{std::move(weak), Bits()});
+        throw;
+      }
+
+      if (!weak.expired())
+        cache_.insert_or_assign(&op, Entry{std::move(weak), bits});
+      return bits;
+    }
+
+    Bits visitOperation(const Operation&) {
+      throw Unsupported();
+    }
+
+    Bits visitConstant(const Constant& op) {
+      if (!op.type().is_int())
+        throw Unsupported();
+      uint32_t width = op.type().bitwidth();
+
+      auto it = symbols_.find(op.symbol());
+      if (it == symbols_.end() || it->second.width != width) {
+        uint32_t first = var_of(circuit_.input());
+        for (uint32_t i = 1; i < width; ++i)
+          circuit_.input();
+        it = symbols_.insert_or_assign(op.symbol(), InputRange{first, width})
+                 .first;
+      }
+
+      Bits bits(width);
+      for (uint32_t i = 0; i < width; ++i)
+        bits[i] = (it->second.first + i) << 1;
+      return bits;
+    }
+    Bits visitConstantInt(const ConstantInt& op) {
+      const llvm::APInt& value = op.value();
+      Bits bits(value.getBitWidth());
+      for (uint32_t i = 0; i < bits.size(); ++i)
+        bits[i] = value[i] ? True : False;
+      return bits;
+    }
+    Bits visitUndef(const Undef& op) {
+      // Same as Z3Solver, undef is always zero.
+      if (!op.type().is_int())
+        throw Unsupported();
+      return Bits(op.type().bitwidth(), False);
+    }
+
+    Bits visitAdd(const BinaryOp& op) {
+      return add(visit(*op.lhs()), visit(*op.rhs()));
+    }
+    Bits visitSub(const BinaryOp& op) {
+      return sub(visit(*op.lhs()), visit(*op.rhs()));
+    }
+    Bits visitMul(const BinaryOp& op) {
+      check_arith_width(op);
+      return mul(visit(*op.lhs()), visit(*op.rhs()));
+    }
+    Bits visitUDiv(const BinaryOp& op) {
+      check_arith_width(op);
+      return udivrem(visit(*op.lhs()), visit(*op.rhs())).first;
+    }
+    Bits visitURem(const BinaryOp& op) {
+      check_arith_width(op);
+      return udivrem(visit(*op.lhs()), visit(*op.rhs())).second;
+    }
+    Bits visitSDiv(const BinaryOp& op) {
+      check_arith_width(op);
+      Bits lhs = visit(*op.lhs());
+      Bits rhs = visit(*op.rhs());
+      Lit lsign = lhs.back();
+      Lit rsign = rhs.back();
+
+      // The same as the SMT-LIB definition of bvsdiv. This includes division
+      // by zero and INT_MIN / -1.
+      Bits quot = udivrem(abs(lhs), abs(rhs)).first;
+      return mux(circuit_.lxor(lsign, rsign), neg(quot), quot);
+    }
+    Bits visitSRem(const BinaryOp& op) {
+      check_arith_width(op);
+      Bits lhs = visit(*op.lhs());
+      Bits rhs = visit(*op.rhs());
+      Lit lsign = lhs.back();
+
+      // The sign of the result follows the dividend, as in bvsrem.
+      Bits rem = udivrem(abs(lhs), abs(rhs)).second;
+      return mux(lsign, neg(rem), rem);
+    }
+
+#define CAFFEINE_BITWISE_IMPL(name, gate)                                      \
+  Bits visit##name(const BinaryOp& op) {                                       \
+    Bits lhs = visit(*op.lhs());                                               \
+    Bits rhs = visit(*op.rhs());                                               \
+    for (size_t i = 0; i < lhs.size(); ++i)                                    \
+      lhs[i] = circuit_.gate(lhs[i], rhs[i]);                                  \
+    return lhs;                                                                \
+  }                                                                            \
+  static_assert(true)
+
+    CAFFEINE_BITWISE_IMPL(And, land);
+    CAFFEINE_BITWISE_IMPL(Or, lor);
+    CAFFEINE_BITWISE_IMPL(Xor, lxor);
+#undef CAFFEINE_BITWISE_IMPL
+
+    Bits visitShl(const BinaryOp& op) {
+      return shift(visit(*op.lhs()), visit(*op.rhs()), Shl);
+    }
+    Bits visitLShr(const BinaryOp& op) {
+      return shift(visit(*op.lhs()), visit(*op.rhs()), LShr);
+    }
+    Bits visitAShr(const BinaryOp& op) {
+      return shift(visit(*op.lhs()), visit(*op.rhs()), AShr);
+    }
+
+    Bits visitNot(const UnaryOp& op) {
+      Bits bits = visit(*op.operand());
+      for (Lit& lit : bits)
+        lit = negate(lit);
+      return bits;
+    }
+    Bits visitTrunc(const UnaryOp& op) {
+      Bits bits = visit(*op.operand());
+      bits.resize(op.type().bitwidth());
+      return bits;
+    }
+    Bits visitZExt(const UnaryOp& op) {
+      Bits bits = visit(*op.operand());
+      bits.resize(op.type().bitwidth(), False);
+      return bits;
+    }
+    Bits visitSExt(const UnaryOp& op) {
+      Bits bits = visit(*op.operand());
+      bits.resize(op.type().bitwidth(), bits.back());
+      return bits;
+    }
+    Bits visitBitcast(const UnaryOp& op) {
+      if (!op.type().is_int() || !op.operand()->type().is_int())
+        throw Unsupported();
+      return visit(*op.operand());
+    }
+
+    Bits visitICmp(const ICmpOp& op) {
+      Bits lhs = visit(*op.lhs());
+      Bits rhs = visit(*op.rhs());
+
+      switch (op.comparison()) {
+      case ICmpOpcode::EQ:
+        return {eq(lhs, rhs)};
+      case ICmpOpcode::NE:
+        return {negate(eq(lhs, rhs))};
+      case ICmpOpcode::UGT:
+        return {ult(rhs, lhs)};
+      case ICmpOpcode::UGE:
+        return {negate(ult(lhs, rhs))};
+      case ICmpOpcode::ULT:
+        return {ult(lhs, rhs)};
+      case ICmpOpcode::ULE:
+        return {negate(ult(rhs, lhs))};
+      case ICmpOpcode::SGT:
+        return {slt(rhs, lhs)};
+      case ICmpOpcode::SGE:
+        return {negate(slt(lhs, rhs))};
+      case ICmpOpcode::SLT:
+        return {slt(lhs, rhs)};
+      case ICmpOpcode::SLE:
+        return {negate(slt(rhs, lhs))};
+      }
+
+      CAFFEINE_ABORT("Unknown ICmpOpcode");
+    }
+
+    Bits visitSelectOp(const SelectOp& op) {
+      if (!op.type().is_int())
+        throw Unsupported();
+      Lit cond = blast_bool(*op.condition());
+      return mux(cond, visit(*op.true_value()), visit(*op.false_value()));
+    }
+
+  private:
+    enum ShiftKind { Shl, LShr, AShr };
+
+    void check_arith_width(const Operation& op) {
+      if (op.type().bitwidth() > MaxArithWidth)
+        throw Unsupported();
+    }
+
+    // Adds a and b along with an incoming carry. If carry_out is not null then
+    // the outgoing carry is stored there.
+    Bits add(const Bits& a, const Bits& b, Lit carry = False,
+             Lit* carry_out = nullptr) {
+      Bits sum(a.size());
+      for (size_t i = 0; i < a.size(); ++i) {
+        Lit half = circuit_.lxor(a[i], b[i]);
+        sum[i] = circuit_.lxor(half, carry);
+        carry = circuit_.lor(circuit_.land(a[i], b[i]),
+                             circuit_.land(carry, half));
+      }
+      if (carry_out)
+        *carry_out = carry;
+      return sum;
+    }
+    Bits bvnot(Bits bits) {
+      for (Lit& lit : bits)
+        lit = negate(lit);
+      return bits;
+    }
+    Bits sub(const Bits& a, const Bits& b, Lit* no_borrow = nullptr) {
+      return add(a, bvnot(b), True, no_borrow);
+    }
+    Bits neg(const Bits& a) {
+      return add(bvnot(a), Bits(a.size(), False), True);
+    }
+    Bits abs(const Bits& a) {
+      return mux(a.back(), neg(a), a);
+    }
+    Bits mux(Lit cond, const Bits& t, const Bits& f) {
+      Bits bits(t.size());
+      for (size_t i = 0; i < t.size(); ++i)
+        bits[i] = circuit_.mux(cond, t[i], f[i]);
+      return bits;
+    }
+
+    Bits mul(const Bits& a, const Bits& b) {
+      size_t width = a.size();
+      Bits acc(width, False);
+      for (size_t i = 0; i < width; ++i) {
+        if (b[i] == False)
+          continue;
+
+        Bits partial(width, False);
+        for (size_t j = i; j < width; ++j)
+          partial[j] = circuit_.land(a[j - i], b[i]);
+        acc = add(acc, partial);
+      }
+      return acc;
+    }
+
+    // Restoring division. Division by zero gives a quotient of all ones and
+    // leaves the dividend as the remainder, which matches bvudiv and bvurem.
+    std::pair<Bits, Bits> udivrem(const Bits& a, const Bits& b) {
+      size_t width = a.size();
+      Bits quot(width, False);
+      Bits rem(width, False);
+      Bits divisor = b;
+      divisor.push_back(False);
+
+      for (size_t i = width; i-- > 0;) {
+        // The shifted remainder needs one more bit since it can be as large
+        // as 2 * b - 1.
+        Bits shifted;
+        shifted.reserve(width + 1);
+        shifted.push_back(a[i]);
+        shifted.insert(shifted.end(), rem.begin(), rem.end());
+
+        Lit fits;
+        Bits diff = sub(shifted, divisor, &fits);
+        quot[i] = fits;
+        rem = mux(fits, diff, shifted);
+        rem.pop_back();
+      }
+
+      return {std::move(quot), std::move(rem)};
+    }
+
+    Lit eq(const Bits& a, const Bits& b) {
+      Lit result = True;
+      for (size_t i = 0; i < a.size(); ++i)
+        result = circuit_.land(result, negate(circuit_.lxor(a[i], b[i])));
+      return result;
+    }
+    Lit ult(const Bits& a, const Bits& b) {
+      Lit no_borrow;
+      sub(a, b, &no_borrow);
+      return negate(no_borrow);
+    }
+    Lit slt(Bits a, Bits b) {
+      // Flipping the sign bits turns a signed comparison into an unsigned one.
+      a.back() = negate(a.back());
+      b.back() = negate(b.back());
+      return ult(a, b);
+    }
+
+    // Barrel shifter. Shifting by at least the width shifts out every bit.
+    Bits shift(Bits value, const Bits& amount, ShiftKind kind) {
+      size_t width = value.size();
+      Lit fill = kind == AShr ? value.back() : False;
+
+      Lit overflow = False;
+      for (size_t k = 0; k < amount.size(); ++k) {
+        if (k >= 32 || (size_t(1) << k) >= width) {
+          overflow = circuit_.lor(overflow, amount[k]);
+          continue;
+        }
+
+        size_t dist = size_t(1) << k;
+        Bits shifted(width);
+        for (size_t i = 0; i < width; ++i) {
+          if (kind == Shl)
+            shifted[i] = i >= dist ? value[i - dist] : False;
+          else
+            shifted[i] = i + dist < width ? value[i + dist] : fill;
+        }
+        value = mux(amount[k], shifted, value);
+      }
+
+      return mux(overflow, Bits(width, fill), value);
+    }
+
+    struct Entry {
+      std::weak_ptr<const Operation> op;
+      Bits bits;
+    };
+
+    Circuit circuit_;
+    std::unordered_map<const Operation*, Entry> cache_;
+    SymbolMap symbols_;
+    size_t next_sweep_ = 4096;
+  };
+
+  /**
+   * Model holding the values of the input bits from a satisfying assignment.
+   * The SAT solver only keeps the assignment until the next query so the
+   * values are copied out when the model is created.
+   */
+  class BitBlastModel : public Model {
+  public:
+    BitBlastModel(Circuit& circuit, const SymbolMap& symbols) {
+      values.reserve(symbols.size());
+      for (const auto& [symbol, range] : symbols) {
+        llvm::APInt value(range.width, 0);
+        for (uint32_t i = 0; i < range.width; ++i) {
+          if (circuit.value(range.first + i))
+            value.setBit(i);
+        }
+        values.emplace(symbol, std::move(value));
+      }
+    }
+
+    Value lookup(const Symbol& symbol, std::optional<size_t>) const override {
+      auto it = values.find(symbol);
+      if (it == values.end())
+        return Value();
+      return Value(it->second);
+    }
+
+  private:
+    std::unordered_map<Symbol, llvm::APInt> values;
+  };
+
+  // Interrupts CaDiCaL once the token is cancelled. CaDiCaL polls this
+  // regularly while solving.
+  class CancelTerminator : public CaDiCaL::Terminator {
+  public:
+    explicit CancelTerminator(CancellationToken* cancel) : cancel(cancel) {}
+
+    bool terminate() override {
+      return cancel->is_cancelled();
+    }
+
+  private:
+    CancellationToken* cancel;
+  };
+} // namespace
+
+class BitBlastSolver::Impl {
+public:
+  // Once the circuit has this many variables it is thrown away and rebuilt
+  // from scratch for the next query. CaDiCaL keeps every clause it has been
+  // given (and those it learned from them) so this keeps gates left behind by
+  // old paths from slowing down new queries.
+  static constexpr size_t MaxVars = size_t(1) << 18;
+
+  CancellationToken* cancel;
+  std::unique_ptr<BitBlaster> blaster;
+
+  Impl(CancellationToken* cancel)
+      : cancel(cancel), blaster(std::make_unique<BitBlaster>()) {}
+
+  SolverResult solve(AssertionList& assertions, const Assertion& extra,
+                     bool want_model);
+};
+
+SolverResult BitBlastSolver::Impl::solve(AssertionList& assertions,
+                                         const Assertion& extra,
+                                         bool want_model) {
+  if (extra.is_constant_value(false))
+    return SolverResult::UNSAT;
+  if (cancel && cancel->is_cancelled())
+    return SolverResult::Unknown;
+
+  stats::ScopedTimer timer{query_time};
+  ++num_queries;
+
+  if (blaster->circuit().num_vars() >= MaxVars)
+    blaster = std::make_unique<BitBlaster>();
+  blaster->maybe_sweep();
+
+  llvm::SmallVector<Lit, 16> roots;
+  try {
+    for (Assertion assertion : assertions) {
+      if (assertion.is_empty())
+        continue;
+      roots.push_back(blaster->blast_bool(*assertion.value()));
+    }
+
+    if (!extra.is_constant_value(true))
+      roots.push_back(blaster->blast_bool(*extra.value()));
+  } catch (const Unsupported&) {
+    ++num_unsupported;
+    return SolverResult::Unknown;
+  }
+
+  if (llvm::is_contained(roots, False)) {
+    ++num_unsat;
+    return SolverResult::UNSAT;
+  }
+  roots.erase(std::remove(roots.begin(), roots.end(), True), roots.end());
+
+  CancelTerminator terminator{cancel};
+  int result = blaster->circuit().solve(roots, cancel ? &terminator : nullptr);
+  switch (result) {
+  case Satisfiable:
+    ++num_sat;
+    if (!want_model)
+      return SolverResult::SAT;
+    return SolverResult(SolverResult::SAT,
+                        std::make_unique<BitBlastModel>(blaster->circuit(),
+                                                        blaster->symbols()));
+
+  case Unsatisfiable:
+    ++num_unsat;
+    return SolverResult::UNSAT;
+
+  default:
+    ++num_unknown;
+    return SolverResult::Unknown;
+  }
+}
+
+BitBlastSolver::BitBlastSolver(CancellationToken* cancel)
+    : impl(std::make_unique<Impl>(cancel)) {}
+
+BitBlastSolver::BitBlastSolver(BitBlastSolver&& solver) noexcept
+    : impl(std::move(solver.impl)) {}
+BitBlastSolver& BitBlastSolver::operator=(BitBlastSolver&& solver) noexcept {
+  impl = std::move(solver.impl);
+  return *this;
+}
+
+BitBlastSolver::~BitBlastSolver() {}
+
+SolverResult BitBlastSolver::check(AssertionList& assertions,
+                                   const Assertion& extra) {
+  if (assertions.unproven().empty() && extra.is_constant_value(true))
+    return SolverResult::SAT;
+  if (extra.is_constant_value(false))
+    return SolverResult::UNSAT;
+
+  size_t checkpoint = assertions.checkpoint();
+  auto guard = make_guard([&]() { assertions.restore(checkpoint); });
+  assertions.insert(extra);
+
+  if (assertions.unproven().empty())
+    return SolverResult::SAT;
+  return impl->solve(assertions, Assertion(), false);
+}
+
+SolverResult BitBlastSolver::resolve(AssertionList& assertions,
+                                     const Assertion& extra) {
+  return impl->solve(assertions, extra, true);
+}
+
+} // namespace caffeine
@@ -3,6 +3,7 @@
 #include "caffeine/IR/Assertion.h"
 #include "caffeine/IR/Operation.h"
 #include "caffeine/IR/Transforms.h"
+#include "caffeine/Support/Stats.h"
 
 #include <llvm/ADT/SmallVector.h>
 
@@ -10,8 +11,15 @@
 
 namespace caffeine {
 
+namespace {
+  stats::Histogram canonicalize_time{
+      "solver.canonicalize.time_ns",
+      "Time spent canonicalizing solver queries"};
+} // namespace
+
 SolverResult CanonicalizingSolver::resolve(AssertionList& assertions,
                                            const Assertion&) {
+  stats::ScopedTimer timer{canonicalize_time};
   transforms::canonicalize(assertions);
   return SolverResult::Unknown;
 }
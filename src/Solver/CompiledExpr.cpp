@@ -0,0 +1,592 @@
+#include "caffeine/Solver/CompiledExpr.h"
+#include "caffeine/IR/SmallInt.h"
+#include "caffeine/IR/Type.h"
+#include "caffeine/Solver/Solver.h"
+#include "caffeine/Support/Assert.h"
+#include "IR/Operation.h"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+namespace caffeine {
+
+namespace {
+  bool is_small_int_ty(const Type& type) {
+    return type.is_int() && type.bitwidth() <= 64;
+  }
+
+  int64_t sext(uint64_t value, uint32_t width) {
+    return SmallInt::sign_extend(value, width);
+  }
+
+  template <typename F>
+  void map_lanes(uint64_t* out, size_t lanes, F&& func) {
+    for (size_t lane = 0; lane < lanes; ++lane)
+      out[lane] = func(lane);
+  }
+
+  // Operations that can be applied to the values of their operands by
+  // apply_generic. Everything else is evaluated by Model::evaluate.
+  bool has_generic_lowering(uint16_t opcode) {
+    switch (opcode) {
+    case Operation::Add:
+    case Operation::Sub:
+    case Operation::Mul:
+    case Operation::UDiv:
+    case Operation::SDiv:
+    case Operation::URem:
+    case Operation::SRem:
+    case Operation::And:
+    case Operation::Or:
+    case Operation::Xor:
+    case Operation::Shl:
+    case Operation::LShr:
+    case Operation::AShr:
+    case Operation::FAdd:
+    case Operation::FSub:
+    case Operation::FMul:
+    case Operation::FDiv:
+    case Operation::FRem:
+    case Operation::ICmpEq:
+    case Operation::ICmpNe:
+    case Operation::ICmpUgt:
+    case Operation::ICmpUge:
+    case Operation::ICmpUlt:
+    case Operation::ICmpUle:
+    case Operation::ICmpSgt:
+    case Operation::ICmpSge:
+    case Operation::ICmpSlt:
+    case Operation::ICmpSle:
+    case Operation::FCmpEq:
+    case Operation::FCmpGt:
+    case Operation::FCmpGe:
+    case Operation::FCmpLt:
+    case Operation::FCmpLe:
+    case Operation::FCmpNe:
+    case Operation::Not:
+    case Operation::FNeg:
+    case Operation::FIsNaN:
+    case Operation::Trunc:
+    case Operation::SExt:
+    case Operation::ZExt:
+    case Operation::Bitcast:
+    case Operation::Select:
+    case Operation::Load:
+    case Operation::Store:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  Value apply_generic(const Operation& op, const std::array<Value, 3>& args) {
+    switch (op.opcode()) {
+    case Operation::Add:
+      return Value::bvadd(args[0], args[1]);
+    case Operation::Sub:
+      return Value::bvsub(args[0], args[1]);
+    case Operation::Mul:
+      return Value::bvmul(args[0], args[1]);
+    case Operation::UDiv:
+      return Value::bvudiv(args[0], args[1]);
+    case Operation::SDiv:
+      return Value::bvsdiv(args[0], args[1]);
+    case Operation::URem:
+      return Value::bvurem(args[0], args[1]);
+    case Operation::SRem:
+      return Value::bvsrem(args[0], args[1]);
+    case Operation::And:
+      return Value::bvand(args[0], args[1]);
+    case Operation::Or:
+      return Value::bvor(args[0], args[1]);
+    case Operation::Xor:
+      return Value::bvxor(args[0], args[1]);
+    case Operation::Shl:
+      return Value::bvshl(args[0], args[1]);
+    case Operation::LShr:
+      return Value::bvlshr(args[0], args[1]);
+    case Operation::AShr:
+      return Value::bvashr(args[0], args[1]);
+    case Operation::FAdd:
+      return Value::fadd(args[0], args[1]);
+    case Operation::FSub:
+      return Value::fsub(args[0], args[1]);
+    case Operation::FMul:
+      return Value::fmul(args[0], args[1]);
+    case Operation::FDiv:
+      return Value::fdiv(args[0], args[1]);
+    case Operation::FRem:
+      return Value::frem(args[0], args[1]);
+    case Operation::ICmpEq:
+    case Operation::ICmpNe:
+    case Operation::ICmpUgt:
+    case Operation::ICmpUge:
+    case Operation::ICmpUlt:
+    case Operation::ICmpUle:
+    case Operation::ICmpSgt:
+    case Operation::ICmpSge:
+    case Operation::ICmpSlt:
+    case Operation::ICmpSle:
+      return Value(llvm::APInt(
+          1, constant_int_compare(llvm::cast<ICmpOp>(op).comparison(),
+                                  args[0].apint(), args[1].apint())));
+    case Operation::FCmpEq:
+    case Operation::FCmpGt:
+    case Operation::FCmpGe:
+    case Operation::FCmpLt:
+    case Operation::FCmpLe:
+    case Operation::FCmpNe:
+      // Same IEEE semantics as constant folding: comparisons involving NaN
+      // are unordered so only NE is true.
+      return Value(llvm::APInt(
+          1, constant_float_compare(llvm::cast<FCmpOp>(op).comparison(),
+                                    args[0].apfloat(), args[1].apfloat())));
+    case Operation::Not:
+      return Value::bvnot(args[0]);
+    case Operation::FNeg:
+      return Value::fneg(args[0]);
+    case Operation::FIsNaN:
+      return Value::FIsNaN(args[0]);
+    case Operation::Trunc:
+      return Value::trunc(args[0], op.type().bitwidth());
+    case Operation::SExt:
+      return Value::sext(args[0], op.type().bitwidth());
+    case Operation::ZExt:
+      return Value::zext(args[0], op.type().bitwidth());
+    case Operation::Bitcast:
+      return Value::bitcast(args[0], op.type());
+    case Operation::Select:
+      return Value::select(args[0], args[1], args[2]);
+    case Operation::Load:
+      return Value::load(args[0], args[1]);
+    case Operation::Store:
+      return Value::store(args[0], args[1], args[2]);
+    default:
+      CAFFEINE_UNREACHABLE();
+    }
+  }
+} // namespace
+
+struct CompiledExpr::Registers {
+  size_t lanes;
+  // Registers are stored register-major so that all the lanes of one
+  // register are contiguous.
+  llvm::SmallVector<uint64_t, 64> ints;
+  std::vector<Value> values;
+
+  Registers(const CompiledExpr& expr, size_t lanes)
+      : lanes(lanes), ints(expr.num_ints_ * lanes),
+        values(expr.num_values_ * lanes) {}
+
+  uint64_t* ints_for(const Inst& inst) {
+    return &ints[inst.reg * lanes];
+  }
+  Value* values_for(const Inst& inst) {
+    return &values[inst.reg * lanes];
+  }
+};
+
+CompiledExpr::CompiledExpr(const OpRef& expr) : expr_(expr) {
+  struct Frame {
+    const Operation* op;
+    bool expanded;
+  };
+
+  std::unordered_map<const Operation*, uint32_t> indices;
+  std::vector<Frame> stack{{expr.get(), false}};
+  llvm::SmallVector<uint32_t, 3> operands;
+
+  while (!stack.empty()) {
+    Frame& frame = stack.back();
+    const Operation* op = frame.op;
+
+    if (indices.count(op) != 0) {
+      stack.pop_back();
+      continue;
+    }
+
+    bool lower_operands = has_generic_lowering(op->opcode());
+    if (!frame.expanded && lower_operands) {
+      frame.expanded = true;
+      for (const Operation& operand : op->operands()) {
+        if (indices.count(&operand) == 0)
+          stack.push_back({&operand, false});
+      }
+      continue;
+    }
+
+    stack.pop_back();
+
+    operands.clear();
+    if (lower_operands) {
+      for (const Operation& operand : op->operands())
+        operands.push_back(indices.at(&operand));
+    }
+
+    lower(*op, operands);
+    indices.emplace(op, insts_.size() - 1);
+  }
+}
+
+CompiledExpr::Op
+CompiledExpr::select_op(const Operation& op,
+                        llvm::ArrayRef<uint32_t> operands) const {
+  if (!is_small_int_ty(op.type())) {
+    switch (op.opcode()) {
+    case Operation::ConstantInt:
+    case Operation::ConstantFloat:
+      return Op::Const;
+    default:
+      return has_generic_lowering(op.opcode()) ? Op::Generic : Op::Subtree;
+    }
+  }
+
+  switch (op.opcode()) {
+  case Operation::ConstantInt:
+    return Op::Imm;
+  case Operation::ConstantNamed:
+  case Operation::ConstantNumbered:
+    return Op::Symbol;
+  case Operation::Load:
+    // The array operand is never a small integer so only the index matters.
+    return insts_[operands[1]].is_small() ? Op::Load : Op::Generic;
+  default:
+    break;
+  }
+
+  bool small = llvm::all_of(
+      operands, [&](uint32_t operand) { return insts_[operand].is_small(); });
+  if (!small)
+    return has_generic_lowering(op.opcode()) ? Op::Generic : Op::Subtree;
+
+  switch (op.opcode()) {
+    // clang-format off
+  case Operation::Add:     return Op::Add;
+  case Operation::Sub:     return Op::Sub;
+  case Operation::Mul:     return Op::Mul;
+  case Operation::UDiv:    return Op::UDiv;
+  case Operation::SDiv:    return Op::SDiv;
+  case Operation::URem:    return Op::URem;
+  case Operation::SRem:    return Op::SRem;
+  case Operation::And:     return Op::And;
+  case Operation::Or:      return Op::Or;
+  case Operation::Xor:     return Op::Xor;
+  case Operation::Shl:     return Op::Shl;
+  case Operation::LShr:    return Op::LShr;
+  case Operation::AShr:    return Op::AShr;
+  case Operation::Not:     return Op::Not;
+  case Operation::ICmpEq:  return Op::Eq;
+  case Operation::ICmpNe:  return Op::Ne;
+  case Operation::ICmpUgt: return Op::Ugt;
+  case Operation::ICmpUge: return Op::Uge;
+  case Operation::ICmpUlt: return Op::Ult;
+  case Operation::ICmpUle: return Op::Ule;
+  case Operation::ICmpSgt: return Op::Sgt;
+  case Operation::ICmpSge: return Op::Sge;
+  case Operation::ICmpSlt: return Op::Slt;
+  case Operation::ICmpSle: return Op::Sle;
+  case Operation::Trunc:   return Op::Trunc;
+  case Operation::ZExt:    return Op::ZExt;
+  case Operation::SExt:    return Op::SExt;
+  case Operation::Select:  return Op::Select;
+  // clang-format on
+  default:
+    return has_generic_lowering(op.opcode()) ? Op::Generic : Op::Subtree;
+  }
+}
+
+void CompiledExpr::lower(const Operation& op,
+                         llvm::ArrayRef<uint32_t> operands) {
+  CAFFEINE_ASSERT(operands.size() <= 3);
+
+  Inst inst{};
+  inst.op = select_op(op, operands);
+  inst.width = op.type().is_int() ? op.type().bitwidth() : 0;
+  std::copy(operands.begin(), operands.end(), inst.operands);
+
+  switch (inst.op) {
+  case Op::Imm:
+    inst.imm = llvm::cast<ConstantInt>(op).value().getZExtValue();
+    break;
+  case Op::Const:
+    inst.imm = constants_.size();
+    if (const auto* constant = llvm::dyn_cast<ConstantInt>(&op))
+      constants_.emplace_back(constant->value());
+    else
+      constants_.emplace_back(llvm::cast<ConstantFloat>(op).value());
+    break;
+  case Op::Symbol:
+  case Op::Generic:
+  case Op::Subtree:
+    inst.imm = nodes_.size();
+    nodes_.push_back(&op);
+    break;
+  default:
+    break;
+  }
+
+  inst.reg = inst.is_small() ? num_ints_++ : num_values_++;
+  insts_.push_back(inst);
+}
+
+bool CompiledExpr::is_small_int() const {
+  return is_small_int_ty(expr_->type());
+}
+
+Value CompiledExpr::evaluate(const Model& model) const {
+  const Model* models[] = {&model};
+  Registers regs{*this, 1};
+  run(models, regs);
+  return to_value(regs, insts_.size() - 1, 0);
+}
+
+std::vector<Value>
+CompiledExpr::evaluate(llvm::ArrayRef<const Model*> models) const {
+  Registers regs{*this, models.size()};
+  run(models, regs);
+
+  std::vector<Value> results;
+  results.reserve(models.size());
+  for (size_t lane = 0; lane < models.size(); ++lane)
+    results.push_back(to_value(regs, insts_.size() - 1, lane));
+  return results;
+}
+
+uint64_t CompiledExpr::evaluate_int(const Model& model) const {
+  uint64_t result;
+  const Model* models[] = {&model};
+  evaluate_int(models, result);
+  return result;
+}
+
+void CompiledExpr::evaluate_int(llvm::ArrayRef<const Model*> models,
+                                llvm::MutableArrayRef<uint64_t> results) const {
+  CAFFEINE_ASSERT(is_small_int(),
+                  "evaluate_int called on an expression that doesn't fit "
+                  "within 64 bits");
+  CAFFEINE_ASSERT(models.size() == results.size());
+
+  Registers regs{*this, models.size()};
+  run(models, regs);
+
+  const Inst& root = insts_.back();
+  if (root.is_small()) {
+    const uint64_t* values = regs.ints_for(root);
+    std::copy(values, values + models.size(), results.begin());
+    return;
+  }
+
+  // The root may still need the slow path if one of its operands did.
+  const Value* values = regs.values_for(root);
+  for (size_t lane = 0; lane < models.size(); ++lane)
+    results[lane] = values[lane].apint().getZExtValue();
+}
+
+void CompiledExpr::run(llvm::ArrayRef<const Model*> models,
+                       Registers& regs) const {
+  for (const Inst& inst : insts_) {
+    if (inst.is_small())
+      run_fast(inst, models, regs);
+    else
+      run_slow(inst, models, regs);
+  }
+}
+
+void CompiledExpr::run_fast(const Inst& inst,
+                            llvm::ArrayRef<const Model*> models,
+                            Registers& regs) const {
+  const size_t lanes = regs.lanes;
+  const uint64_t m = SmallInt::mask(inst.width);
+  uint64_t* out = regs.ints_for(inst);
+
+  auto operand = [&](unsigned i) -> const Inst& {
+    return insts_[inst.operands[i]];
+  };
+  auto in = [&](unsigned i) -> const uint64_t* {
+    return regs.ints_for(operand(i));
+  };
+
+  switch (inst.op) {
+  case Op::Imm:
+    std::fill_n(out, lanes, inst.imm);
+    break;
+  case Op::Symbol: {
+    const auto& symbol = llvm::cast<Constant>(nodes_[inst.imm])->symbol();
+    map_lanes(out, lanes, [&](size_t lane) -> uint64_t {
+      Value value = models[lane]->lookup(symbol);
+      // Symbols that don't appear in the model get a default value. This
+      // matches what Model::evaluate does.
+      if (value.type().is_void())
+        return 0;
+      return value.apint().getZExtValue();
+    });
+    break;
+  }
+
+  case Op::Add: {
+    const uint64_t *a = in(0), *b = in(1);
+    map_lanes(out, lanes, [&](size_t l) { return (a[l] + b[l]) & m; });
+    break;
+  }
+  case Op::Sub: {
+    const uint64_t *a = in(0), *b = in(1);
+    map_lanes(out, lanes, [&](size_t l) { return (a[l] - b[l]) & m; });
+    break;
+  }
+  case Op::Mul: {
+    const uint64_t *a = in(0), *b = in(1);
+    map_lanes(out, lanes, [&](size_t l) { return (a[l] * b[l]) & m; });
+    break;
+  }
+
+  // Division, remainder and shifts have edge cases (division by zero, signed
+  // overflow, oversized shifts) so they go through SmallInt.
+#define CAFFEINE_SMALLINT_OP(name, func)                                       \
+  case Op::name: {                                                             \
+    const uint64_t *a = in(0), *b = in(1);                                     \
+    const uint32_t w = inst.width;                                             \
+    map_lanes(out, lanes, [&](size_t l) {                                      \
+      return SmallInt::func(SmallInt(a[l], w), SmallInt(b[l], w)).value();     \
+    });                                                                        \
+    break;                                                                     \
+  }                                                                            \
+    static_assert(true)
+
+    CAFFEINE_SMALLINT_OP(UDiv, udiv);
+    CAFFEINE_SMALLINT_OP(SDiv, sdiv);
+    CAFFEINE_SMALLINT_OP(URem, urem);
+    CAFFEINE_SMALLINT_OP(SRem, srem);
+    CAFFEINE_SMALLINT_OP(Shl, shl);
+    CAFFEINE_SMALLINT_OP(LShr, lshr);
+    CAFFEINE_SMALLINT_OP(AShr, ashr);
+
+#undef CAFFEINE_SMALLINT_OP
+
+  case Op::And: {
+    const uint64_t *a = in(0), *b = in(1);
+    map_lanes(out, lanes, [&](size_t l) { return a[l] & b[l]; });
+    break;
+  }
+  case Op::Or: {
+    const uint64_t *a = in(0), *b = in(1);
+    map_lanes(out, lanes, [&](size_t l) { return a[l] | b[l]; });
+    break;
+  }
+  case Op::Xor: {
+    const uint64_t *a = in(0), *b = in(1);
+    map_lanes(out, lanes, [&](size_t l) { return a[l] ^ b[l]; });
+    break;
+  }
+  case Op::Not: {
+    const uint64_t* a = in(0);
+    map_lanes(out, lanes, [&](size_t l) { return ~a[l] & m; });
+    break;
+  }
+
+#define CAFFEINE_ICMP(name, expr)                                              \
+  case Op::name: {                                                             \
+    const uint64_t *a = in(0), *b = in(1);                                     \
+    const uint32_t w = operand(0).width;                                       \
+    (void)w;                                                                   \
+    map_lanes(out, lanes, [&](size_t l) -> uint64_t { return expr; });         \
+    break;                                                                     \
+  }                                                                            \
+    static_assert(true)
+
+    CAFFEINE_ICMP(Eq, a[l] == b[l]);
+    CAFFEINE_ICMP(Ne, a[l] != b[l]);
+    CAFFEINE_ICMP(Ugt, a[l] > b[l]);
+    CAFFEINE_ICMP(Uge, a[l] >= b[l]);
+    CAFFEINE_ICMP(Ult, a[l] < b[l]);
+    CAFFEINE_ICMP(Ule, a[l] <= b[l]);
+    CAFFEINE_ICMP(Sgt, sext(a[l], w) > sext(b[l], w));
+    CAFFEINE_ICMP(Sge, sext(a[l], w) >= sext(b[l], w));
+    CAFFEINE_ICMP(Slt, sext(a[l], w) < sext(b[l], w));
+    CAFFEINE_ICMP(Sle, sext(a[l], w) <= sext(b[l], w));
+
+#undef CAFFEINE_ICMP
+
+  case Op::Trunc: {
+    const uint64_t* a = in(0);
+    map_lanes(out, lanes, [&](size_t l) { return a[l] & m; });
+    break;
+  }
+  case Op::ZExt:
+    std::copy_n(in(0), lanes, out);
+    break;
+  case Op::SExt: {
+    const uint64_t* a = in(0);
+    const uint32_t w = operand(0).width;
+    map_lanes(out, lanes,
+              [&](size_t l) { return (uint64_t)sext(a[l], w) & m; });
+    break;
+  }
+
+  case Op::Select: {
+    const uint64_t *c = in(0), *a = in(1), *b = in(2);
+    map_lanes(out, lanes, [&](size_t l) { return c[l] ? a[l] : b[l]; });
+    break;
+  }
+
+  case Op::Load: {
+    const Value* data = regs.values_for(operand(0));
+    const uint64_t* index = in(1);
+    map_lanes(out, lanes, [&](size_t l) -> uint64_t {
+      const SharedArray& array = data[l].array();
+      CAFFEINE_ASSERT(index[l] < array.size(),
+                      "attempted to load from out of bounds index");
+      return (uint8_t)array[index[l]];
+    });
+    break;
+  }
+
+  default:
+    CAFFEINE_UNREACHABLE();
+  }
+}
+
+void CompiledExpr::run_slow(const Inst& inst,
+                            llvm::ArrayRef<const Model*> models,
+                            Registers& regs) const {
+  Value* out = regs.values_for(inst);
+
+  switch (inst.op) {
+  case Op::Const:
+    std::fill_n(out, regs.lanes, constants_[inst.imm]);
+    break;
+
+  case Op::Subtree:
+    for (size_t lane = 0; lane < regs.lanes; ++lane)
+      out[lane] = models[lane]->evaluate(*nodes_[inst.imm]);
+    break;
+
+  case Op::Generic: {
+    const Operation& op = *nodes_[inst.imm];
+    std::array<Value, 3> args;
+    for (size_t lane = 0; lane < regs.lanes; ++lane) {
+      for (size_t i = 0; i < op.num_operands(); ++i)
+        args[i] = to_value(regs, inst.operands[i], lane);
+      out[lane] = apply_generic(op, args);
+    }
+    break;
+  }
+
+  default:
+    CAFFEINE_UNREACHABLE();
+  }
+}
+
+Value CompiledExpr::to_value(const Registers& regs, uint32_t index,
+                             size_t lane) const {
+  const Inst& inst = insts_[index];
+  size_t reg = inst.reg * regs.lanes + lane;
+  if (inst.is_small())
+    return Value(llvm::APInt(inst.width, regs.ints[reg]));
+  return regs.values[reg];
+}
+
+} // namespace caffeine
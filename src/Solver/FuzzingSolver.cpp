@@ -0,0 +1,436 @@
+#include "caffeine/Solver/FuzzingSolver.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Type.h"
+#include "caffeine/Interpreter/AssertionList.h"
+#include "caffeine/Solver/CompiledExpr.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Stats.h"
+
+#include <llvm/ADT/APFloat.h>
+
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace caffeine {
+
+namespace {
+  stats::Counter num_queries{
+      "solver.fuzz.queries",
+      "Number of floating-point queries the fuzzing solver searched"};
+  stats::Counter num_sat{"solver.fuzz.sat",
+                         "Number of queries the fuzzing solver found a "
+                         "model for"};
+  stats::Counter num_candidates{
+      "solver.fuzz.candidates",
+      "Number of candidate models evaluated by the fuzzing solver"};
+  stats::Histogram query_time{
+      "solver.fuzz.time_ns",
+      "Time spent searching for a model in the fuzzing solver"};
+
+  // Only this many of the constants of each type in a query are kept around
+  // as guesses. Queries involving large fixed arrays can contain thousands.
+  constexpr size_t MaxConstantsPerType = 64;
+
+  using SymbolIndex = std::unordered_map<Symbol, uint32_t>;
+
+  class CandidateModel : public Model {
+  public:
+    std::vector<Value> values;
+
+    explicit CandidateModel(std::shared_ptr<const SymbolIndex> index)
+        : index(std::move(index)) {}
+
+  protected:
+    Value lookup(const Symbol& symbol, std::optional<size_t>) const override {
+      auto it = index->find(symbol);
+      if (it == index->end())
+        return Value();
+      return values[it->second];
+    }
+
+  private:
+    std::shared_ptr<const SymbolIndex> index;
+  };
+
+  // Operations that can be evaluated concretely without needing a value for
+  // a symbolic array.
+  bool is_evaluable(const Operation& op) {
+    switch (op.opcode()) {
+    case Operation::ConstantNamed:
+    case Operation::ConstantNumbered:
+      return op.type().is_int() ||
+             (op.type().is_float() && op.type().llvm_flt_semantics());
+    case Operation::ConstantInt:
+    case Operation::ConstantFloat:
+    case Operation::FixedArray:
+    case Operation::Add:
+    case Operation::Sub:
+    case Operation::Mul:
+    case Operation::UDiv:
+    case Operation::SDiv:
+    case Operation::URem:
+    case Operation::SRem:
+    case Operation::And:
+    case Operation::Or:
+    case Operation::Xor:
+    case Operation::Shl:
+    case Operation::LShr:
+    case Operation::AShr:
+    case Operation::FAdd:
+    case Operation::FSub:
+    case Operation::FMul:
+    case Operation::FDiv:
+    case Operation::FRem:
+    case Operation::ICmpEq:
+    case Operation::ICmpNe:
+    case Operation::ICmpUgt:
+    case Operation::ICmpUge:
+    case Operation::ICmpUlt:
+    case Operation::ICmpUle:
+    case Operation::ICmpSgt:
+    case Operation::ICmpSge:
+    case Operation::ICmpSlt:
+    case Operation::ICmpSle:
+    case Operation::FCmpEq:
+    case Operation::FCmpGt:
+    case Operation::FCmpGe:
+    case Operation::FCmpLt:
+    case Operation::FCmpLe:
+    case Operation::FCmpNe:
+    case Operation::Not:
+    case Operation::FNeg:
+    case Operation::FIsNaN:
+    case Operation::Trunc:
+    case Operation::SExt:
+    case Operation::ZExt:
+    case Operation::Bitcast:
+    case Operation::Select:
+    case Operation::Load:
+    case Operation::Store:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  /**
+   * The symbols within a query along with the constants that appear in it.
+   */
+  struct QueryInfo {
+    std::vector<Type> types;
+    std::shared_ptr<SymbolIndex> index = std::make_shared<SymbolIndex>();
+    std::unordered_map<Type, std::vector<Value>> constants;
+    bool has_float = false;
+
+    // Returns false if the query can't be evaluated concretely.
+    bool analyze(llvm::ArrayRef<OpRef> roots) {
+      std::unordered_set<const Operation*> seen;
+      std::vector<const Operation*> stack;
+      for (const OpRef& root : roots)
+        stack.push_back(root.get());
+
+      while (!stack.empty()) {
+        const Operation* op = stack.back();
+        stack.pop_back();
+        if (!seen.insert(op).second)
+          continue;
+
+        if (!is_evaluable(*op))
+          return false;
+        has_float |= op->type().is_float();
+
+        if (const auto* constant = llvm::dyn_cast<Constant>(op)) {
+          auto [it, inserted] =
+              index->emplace(constant->symbol(), (uint32_t)types.size());
+          if (inserted)
+            types.push_back(op->type());
+          else if (types[it->second] != op->type())
+            return false;
+        } else if (const auto* cint = llvm::dyn_cast<ConstantInt>(op)) {
+          add_constant(op->type(), cint->value());
+        } else if (const auto* cfloat = llvm::dyn_cast<ConstantFloat>(op)) {
+          add_constant(op->type(), cfloat->value());
+        }
+
+        // This also walks the elements of a FixedArray since it reports its
+        // data() as its operands.
+        for (size_t i = 0; i < op->num_operands(); ++i)
+          stack.push_back(op->operand_at(i).get());
+      }
+
+      return true;
+    }
+
+  private:
+    void add_constant(const Type& type, Value value) {
+      auto& list = constants[type];
+      if (list.size() < MaxConstantsPerType)
+        list.push_back(std::move(value));
+    }
+  };
+
+  /**
+   * Generates guesses for the value of a symbol.
+   */
+  class Guesser {
+  public:
+    Guesser(std::mt19937_64& rng, const QueryInfo& info)
+        : rng(&rng), info(&info) {}
+
+    Value fresh(const Type& type) {
+      switch (uniform(4)) {
+      case 0:
+        return special(type);
+      case 1:
+        if (auto value = from_query(type))
+          return *value;
+        return special(type);
+      default:
+        return random(type);
+      }
+    }
+
+    // Make a small change to an existing guess.
+    Value mutate(const Value& value, const Type& type) {
+      if (type.is_int()) {
+        llvm::APInt result = value.apint();
+        switch (uniform(4)) {
+        case 0:
+          return Value(result + 1);
+        case 1:
+          return Value(result - 1);
+        case 2:
+          result.flipBit((unsigned)uniform(result.getBitWidth()));
+          return Value(std::move(result));
+        default:
+          return fresh(type);
+        }
+      }
+
+      llvm::APFloat result = value.apfloat();
+      switch (uniform(5)) {
+      case 0:
+        result.next(uniform(2) == 0);
+        return Value(std::move(result));
+      case 1:
+        result.changeSign();
+        return Value(std::move(result));
+      case 2:
+        // Double or halve the value
+        return Value(llvm::scalbn(result, uniform(2) == 0 ? 1 : -1,
+                                  llvm::APFloat::rmNearestTiesToEven));
+      default:
+        return fresh(type);
+      }
+    }
+
+  private:
+    uint64_t uniform(uint64_t n) {
+      return (*rng)() % n;
+    }
+
+    // Boundary values, which is where programs tend to have edge cases.
+    Value special(const Type& type) {
+      if (type.is_int()) {
+        uint32_t width = type.bitwidth();
+        switch (uniform(5)) {
+        case 0:
+          return Value(llvm::APInt::getNullValue(width));
+        case 1:
+          return Value(llvm::APInt(width, 1));
+        case 2:
+          return Value(llvm::APInt::getAllOnesValue(width));
+        case 3:
+          return Value(llvm::APInt::getSignedMinValue(width));
+        default:
+          return Value(llvm::APInt::getSignedMaxValue(width));
+        }
+      }
+
+      const llvm::fltSemantics& sem = *type.llvm_flt_semantics();
+      bool negative = uniform(2) == 0;
+      switch (uniform(7)) {
+      case 0:
+        return Value(llvm::APFloat::getZero(sem, negative));
+      case 1:
+        return Value(llvm::APFloat::getInf(sem, negative));
+      case 2:
+        return Value(llvm::APFloat::getQNaN(sem, negative));
+      case 3:
+        // The smallest denormal
+        return Value(llvm::APFloat::getSmallest(sem, negative));
+      case 4: {
+        // The largest denormal
+        auto value = llvm::APFloat::getSmallestNormalized(sem, negative);
+        value.next(!negative);
+        return Value(std::move(value));
+      }
+      case 5:
+        return Value(llvm::APFloat::getLargest(sem, negative));
+      default: {
+        llvm::APFloat one(sem, 1);
+        if (negative)
+          one.changeSign();
+        return Value(std::move(one));
+      }
+      }
+    }
+
+    // A constant from the query or one of its immediate neighbours.
+    std::optional<Value> from_query(const Type& type) {
+      auto it = info->constants.find(type);
+      if (it == info->constants.end())
+        return std::nullopt;
+
+      const Value& value = it->second[uniform(it->second.size())];
+      switch (uniform(3)) {
+      case 0:
+        return value;
+      case 1:
+        return mutate_neighbour(value, true);
+      default:
+        return mutate_neighbour(value, false);
+      }
+    }
+
+    static Value mutate_neighbour(const Value& value, bool down) {
+      if (value.is_int())
+        return Value(down ? value.apint() - 1 : value.apint() + 1);
+
+      llvm::APFloat result = value.apfloat();
+      result.next(down);
+      return Value(std::move(result));
+    }
+
+    Value random(const Type& type) {
+      if (type.is_int())
+        return Value(random_bits(type.bitwidth()));
+
+      const llvm::fltSemantics& sem = *type.llvm_flt_semantics();
+      // Uniformly random bit patterns are mostly huge or tiny values so half
+      // the time pick something of a more typical magnitude instead.
+      if (uniform(2) == 0) {
+        return Value(llvm::APFloat(
+            sem, random_bits(llvm::APFloat::semanticsSizeInBits(sem))));
+      }
+
+      double magnitude = std::ldexp(1.0 + (double)uniform(1 << 20) / (1 << 20),
+                                    (int)uniform(41) - 20);
+      if (uniform(2) == 0)
+        magnitude = -magnitude;
+
+      bool loses_info;
+      llvm::APFloat value(magnitude);
+      value.convert(sem, llvm::APFloat::rmNearestTiesToEven, &loses_info);
+      return Value(std::move(value));
+    }
+
+    llvm::APInt random_bits(uint32_t width) {
+      std::vector<uint64_t> words((width + 63) / 64);
+      for (auto& word : words)
+        word = (*rng)();
+      return llvm::APInt(width, words);
+    }
+
+    std::mt19937_64* rng;
+    const QueryInfo* info;
+  };
+} // namespace
+
+FuzzingSolver::FuzzingSolver(uint32_t max_rounds, uint32_t batch_size,
+                             uint64_t seed)
+    : max_rounds(max_rounds), batch_size(batch_size), rng(seed) {
+  CAFFEINE_ASSERT(batch_size != 0);
+}
+
+SolverResult FuzzingSolver::resolve(AssertionList& assertions,
+                                    const Assertion& extra) {
+  std::vector<OpRef> roots;
+  auto add_root = [&](const Assertion& assertion) {
+    if (!assertion.is_empty() && !assertion.is_constant_value(true))
+      roots.push_back(assertion.value());
+  };
+  for (const Assertion& assertion : assertions)
+    add_root(assertion);
+  add_root(extra);
+
+  QueryInfo info;
+  if (roots.empty() || !info.analyze(roots) || !info.has_float)
+    return SolverResult::Unknown;
+
+  stats::ScopedTimer timer{query_time};
+  ++num_queries;
+
+  std::vector<CompiledExpr> exprs;
+  exprs.reserve(roots.size());
+  for (const OpRef& root : roots)
+    exprs.emplace_back(root);
+
+  const size_t num_symbols = info.types.size();
+  Guesser guesser{rng, info};
+
+  std::vector<CandidateModel> batch(batch_size, CandidateModel(info.index));
+  std::vector<const Model*> models;
+  for (const auto& model : batch)
+    models.push_back(&model);
+  std::vector<uint64_t> results(batch_size);
+  std::vector<size_t> scores(batch_size);
+
+  std::vector<Value> best;
+  size_t best_score = 0;
+
+  for (uint32_t round = 0; round < max_rounds; ++round) {
+    for (size_t lane = 0; lane < batch_size; ++lane) {
+      auto& values = batch[lane].values;
+
+      // Most of the batch explores around the best candidate so far while
+      // the rest keeps making fresh guesses.
+      if (best.empty() || lane % 4 == 0 || num_symbols == 0) {
+        values.clear();
+        for (const Type& type : info.types)
+          values.push_back(guesser.fresh(type));
+        continue;
+      }
+
+      values = best;
+      do {
+        size_t symbol = rng() % num_symbols;
+        values[symbol] = guesser.mutate(values[symbol], info.types[symbol]);
+      } while (rng() % 2 == 0);
+    }
+
+    std::fill(scores.begin(), scores.end(), 0);
+    for (const auto& expr : exprs) {
+      expr.evaluate_int(models, results);
+      for (size_t lane = 0; lane < batch_size; ++lane)
+        scores[lane] += results[lane] & 1;
+    }
+    num_candidates += batch_size;
+
+    size_t best_lane = 0;
+    for (size_t lane = 0; lane < batch_size; ++lane) {
+      if (scores[lane] == roots.size()) {
+        ++num_sat;
+        auto model = std::make_unique<CandidateModel>(std::move(batch[lane]));
+        return SolverResult(SolverResult::SAT, std::move(model));
+      }
+
+      if (scores[lane] > scores[best_lane])
+        best_lane = lane;
+    }
+
+    // Ties move the search along instead of staying put.
+    if (best.empty() || scores[best_lane] >= best_score) {
+      best = batch[best_lane].values;
+      best_score = scores[best_lane];
+    }
+  }
+
+  return SolverResult::Unknown;
+}
+
+} // namespace caffeine
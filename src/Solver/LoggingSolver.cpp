@@ -0,0 +1,201 @@
+#include "caffeine/Solver/LoggingSolver.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/Protos/operation.capnp.h"
+#include "caffeine/Serialization/ExprGraph.h"
+
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+#include <kj/io.h>
+
+#include <limits>
+#include <stdexcept>
+
+namespace caffeine {
+
+namespace {
+  protos::SolverQuery::Result to_proto(SolverResult::Kind kind) {
+    switch (kind) {
+    case SolverResult::UNSAT:
+      return protos::SolverQuery::Result::UNSAT;
+    case SolverResult::SAT:
+      return protos::SolverQuery::Result::SAT;
+    case SolverResult::Unknown:
+      return protos::SolverQuery::Result::UNKNOWN;
+    }
+
+    CAFFEINE_UNREACHABLE();
+  }
+
+  SolverResult::Kind from_proto(protos::SolverQuery::Result result) {
+    switch (result) {
+    case protos::SolverQuery::Result::UNSAT:
+      return SolverResult::UNSAT;
+    case protos::SolverQuery::Result::SAT:
+      return SolverResult::SAT;
+    case protos::SolverQuery::Result::UNKNOWN:
+      return SolverResult::Unknown;
+    }
+
+    throw SerializationError("invalid solver result in query log");
+  }
+
+  void write_assertions(capnp::List<uint32_t>::Builder builder,
+                        llvm::ArrayRef<uint32_t> indices) {
+    for (size_t i = 0; i < indices.size(); ++i)
+      builder.set(i, indices[i]);
+  }
+} // namespace
+
+SolverResult LoggedQuery::replay(Solver& solver) const {
+  AssertionList copy = assertions;
+  if (method == Check)
+    return solver.check(copy, extra);
+  return solver.resolve(copy, extra);
+}
+
+/***************************************************
+ * QueryLogWriter                                  *
+ ***************************************************/
+QueryLogWriter::QueryLogWriter(const std::string& filename)
+    : file_(fopen(filename.c_str(), "wb")) {
+  if (!file_)
+    throw std::runtime_error("Unable to open query log file");
+}
+QueryLogWriter::~QueryLogWriter() {
+  fclose(file_);
+}
+
+/***************************************************
+ * QueryLogReader                                  *
+ ***************************************************/
+struct QueryLogReader::Impl {
+  FILE* file;
+  kj::FdInputStream input;
+  kj::BufferedInputStreamWrapper buffered;
+
+  Impl(FILE* file) : file(file), input(fileno(file)), buffered(input) {}
+  ~Impl() {
+    fclose(file);
+  }
+};
+
+QueryLogReader::QueryLogReader(const std::string& filename) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file)
+    throw std::runtime_error("Unable to open query log file");
+
+  impl_ = std::make_unique<Impl>(file);
+}
+QueryLogReader::~QueryLogReader() = default;
+
+std::optional<LoggedQuery> QueryLogReader::next() {
+  if (impl_->buffered.tryGetReadBuffer().size() == 0)
+    return std::nullopt;
+
+  // Queries can get very large so the default traversal limit (64MB) is not
+  // enough. The log is produced by us so there is little point in limiting it.
+  capnp::ReaderOptions options;
+  options.traversalLimitInWords = std::numeric_limits<uint64_t>::max();
+
+  capnp::InputStreamMessageReader message{impl_->buffered, options};
+  auto query = message.getRoot<protos::SolverQuery>();
+  ExprGraphReader graph{query.getGraph()};
+
+  LoggedQuery result;
+  for (uint32_t index : query.getProven())
+    result.assertions.insert(Assertion(graph[index]));
+  result.assertions.mark_sat();
+  for (uint32_t index : query.getUnproven())
+    result.assertions.insert(Assertion(graph[index]));
+
+  if (query.getExtra().isNode())
+    result.extra = Assertion(graph[query.getExtra().getNode()]);
+
+  result.method = query.getMethod() == protos::SolverQuery::Method::CHECK
+                      ? LoggedQuery::Check
+                      : LoggedQuery::Resolve;
+  result.result = from_proto(query.getResult());
+  result.duration = std::chrono::nanoseconds(query.getDurationNs());
+
+  return result;
+}
+
+/***************************************************
+ * LoggingSolver                                   *
+ ***************************************************/
+LoggingSolver::LoggingSolver(std::shared_ptr<Solver> inner,
+                             QueryLogWriter* log)
+    : inner(std::move(inner)), log(log) {
+  CAFFEINE_ASSERT(this->inner);
+  CAFFEINE_ASSERT(this->log);
+}
+
+SolverResult LoggingSolver::check(AssertionList& assertions,
+                                  const Assertion& extra) {
+  return record(LoggedQuery::Check, assertions, extra,
+                [&] { return inner->check(assertions, extra); });
+}
+SolverResult LoggingSolver::resolve(AssertionList& assertions,
+                                    const Assertion& extra) {
+  return record(LoggedQuery::Resolve, assertions, extra,
+                [&] { return inner->resolve(assertions, extra); });
+}
+
+template <typename F>
+SolverResult LoggingSolver::record(LoggedQuery::Method method,
+                                   AssertionList& assertions,
+                                   const Assertion& extra, F&& func) {
+  capnp::MallocMessageBuilder message;
+  auto query = message.initRoot<protos::SolverQuery>();
+
+  // The inner solver may modify the assertions so they need to be serialized
+  // before running the query.
+  try {
+    ExprGraphWriter graph;
+    llvm::SmallVector<uint32_t, 16> proven;
+    llvm::SmallVector<uint32_t, 16> unproven;
+
+    for (const Assertion& assertion : assertions.proven()) {
+      if (!assertion.is_empty())
+        proven.push_back(graph.add(assertion.value()));
+    }
+    for (const Assertion& assertion : assertions.unproven()) {
+      if (!assertion.is_empty())
+        unproven.push_back(graph.add(assertion.value()));
+    }
+
+    if (!extra.is_empty())
+      query.getExtra().setNode(graph.add(extra.value()));
+    else
+      query.getExtra().setNone();
+
+    graph.write(query.initGraph());
+    write_assertions(query.initProven(proven.size()), proven);
+    write_assertions(query.initUnproven(unproven.size()), unproven);
+  } catch (SerializationError&) {
+    log->skipped_ += 1;
+    return func();
+  }
+
+  query.setMethod(method == LoggedQuery::Check
+                      ? protos::SolverQuery::Method::CHECK
+                      : protos::SolverQuery::Method::RESOLVE);
+
+  auto start = std::chrono::steady_clock::now();
+  SolverResult result = func();
+  auto duration = std::chrono::steady_clock::now() - start;
+
+  query.setResult(to_proto(result.kind()));
+  query.setDurationNs(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+
+  auto words = capnp::messageToFlatArray(message);
+  auto bytes = words.asBytes();
+
+  std::lock_guard lock(log->mutex_);
+  fwrite(bytes.begin(), bytes.size(), 1, log->file_);
+
+  return result;
+}
+
+} // namespace caffeine
@@ -0,0 +1,44 @@
+#include "caffeine/Solver/RewritingSolver.h"
+
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/Support/Stats.h"
+
+namespace caffeine {
+
+namespace {
+  stats::Histogram rewrite_time{"solver.rewrite.time_ns",
+                                "Time spent rewriting solver queries"};
+
+  // The memoized rewrites keep their expressions alive so they are dropped
+  // once there are this many of them.
+  constexpr size_t max_cached_rewrites = 1 << 20;
+} // namespace
+
+RewritingSolver::RewritingSolver(std::unique_ptr<Solver>&& inner)
+    : inner_(std::move(inner)) {}
+
+SolverResult RewritingSolver::check(AssertionList& assertions,
+                                    const Assertion& extra) {
+  Assertion rewritten = rewrite(assertions, extra);
+  return inner_->check(assertions, rewritten);
+}
+
+SolverResult RewritingSolver::resolve(AssertionList& assertions,
+                                      const Assertion& extra) {
+  Assertion rewritten = rewrite(assertions, extra);
+  return inner_->resolve(assertions, rewritten);
+}
+
+Assertion RewritingSolver::rewrite(AssertionList& assertions,
+                                   const Assertion& extra) {
+  stats::ScopedTimer timer{rewrite_time};
+  if (rewriter_.cache_size() > max_cached_rewrites)
+    rewriter_.clear();
+
+  rewriter_.rewrite(assertions);
+  if (extra.is_empty())
+    return extra;
+  return Assertion(rewriter_.rewrite(extra.value()));
+}
+
+} // namespace caffeine
@@ -3,6 +3,7 @@
 #include "caffeine/IR/Assertion.h"
 #include "caffeine/IR/Operation.h"
 #include "caffeine/IR/Transforms.h"
+#include "caffeine/Support/Stats.h"
 
 #include <llvm/ADT/SmallVector.h>
 
@@ -10,8 +11,14 @@
 
 namespace caffeine {
 
+namespace {
+  stats::Histogram simplify_time{"solver.simplify.time_ns",
+                                 "Time spent simplifying solver queries"};
+} // namespace
+
 SolverResult SimplifyingSolver::resolve(AssertionList& assertions,
                                         const Assertion&) {
+  stats::ScopedTimer timer{simplify_time};
   transforms::simplify(assertions);
   return SolverResult::Unknown;
 }
@@ -3,6 +3,7 @@
 #include "caffeine/IR/Value.h"
 #include "caffeine/IR/Visitor.h"
 #include "caffeine/Interpreter/Context.h"
+#include "IR/Operation.h"
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -53,6 +54,19 @@ public:
   Value visitConstantFloat(const ConstantFloat& op) {
     return op.value();
   }
+  Value visitUndef(const Undef& op) {
+    // Any value is valid for an undef, so pick the same defaults as for
+    // symbols that aren't in the model.
+    const Type& type = op.type();
+    if (type.is_int())
+      return Value(llvm::APInt::getNullValue(type.bitwidth()));
+    if (type.is_float()) {
+      if (auto semantics = type.llvm_flt_semantics())
+        return Value(llvm::APFloat::getZero(*semantics));
+    }
+
+    CAFFEINE_ABORT("Unable to evaluate undef of a non-scalar type");
+  }
   Value visitFixedArray(const FixedArray& op) {
     auto size_val = op.size();
     uint64_t size = visit(*size_val).apint().getLimitedValue();
@@ -112,6 +126,17 @@ public:
     return Value::FIsNaN(visit(op[0]));
   }
 
+  Value visitICmpOp(const ICmpOp& op) {
+    bool result = constant_int_compare(op.comparison(), visit(op[0]).apint(),
+                                       visit(op[1]).apint());
+    return Value(llvm::APInt(1, result));
+  }
+  Value visitFCmpOp(const FCmpOp& op) {
+    bool result = constant_float_compare(
+        op.comparison(), visit(op[0]).apfloat(), visit(op[1]).apfloat());
+    return Value(llvm::APInt(1, result));
+  }
+
   Value visitSelectOp(const SelectOp& select) {
     return visit(select[0]).apint() == 1 ? visit(select[1]) : visit(select[2]);
   }
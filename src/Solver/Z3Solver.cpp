@@ -2,6 +2,8 @@
 #include "caffeine/ADT/Guard.h"
 #include "caffeine/IR/Type.h"
 #include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Cancellation.h"
+#include "caffeine/Support/Stats.h"
 #include "caffeine/Support/Tracing.h"
 
 #include "Z3Solver.h"
@@ -15,6 +17,25 @@
 
 namespace caffeine {
 
+namespace {
+  stats::Counter num_queries{"solver.z3.queries",
+                             "Number of queries sent to Z3"};
+  stats::Counter num_sat{"solver.z3.sat", "Number of SAT results from Z3"};
+  stats::Counter num_unsat{"solver.z3.unsat",
+                           "Number of UNSAT results from Z3"};
+  stats::Counter num_unknown{"solver.z3.unknown",
+                             "Number of unknown results from Z3"};
+  stats::Histogram query_time{"solver.z3.time_ns",
+                              "Time taken to translate and solve queries"};
+  stats::Counter cache_hits{"solver.z3.cache.hits",
+                            "Operations whose translation was already cached"};
+  stats::Counter cache_misses{"solver.z3.cache.misses",
+                              "Operations that had to be translated"};
+  stats::Counter cache_evicted{
+      "solver.z3.cache.evicted",
+      "Cached translations dropped after their operation was destroyed"};
+} // namespace
+
 llvm::APInt z3_to_apint(const z3::expr& expr) {
   CAFFEINE_ASSERT(expr.is_bv());
 
@@ -157,14 +178,12 @@ static z3::sort type_to_sort(z3::context& ctx, const Type& type) {
 /***************************************************
  * Z3Model                                         *
  ***************************************************/
-Z3Model::Z3Model(const z3::model& model, const ConstMap& map)
-    : model(model), constants(map) {}
-Z3Model::Z3Model(const z3::model& model, ConstMap&& map)
+Z3Model::Z3Model(const z3::model& model, std::shared_ptr<const ConstMap> map)
     : model(model), constants(std::move(map)) {}
 
 Value Z3Model::lookup(const Symbol& symbol, std::optional<size_t> size) const {
-  auto it = constants.find(op_name(symbol));
-  if (it == constants.end()) {
+  auto it = constants->find(op_name(symbol));
+  if (it == constants->end()) {
     return Value();
   }
 
@@ -197,10 +216,98 @@ Value Z3Model::lookup(const Symbol& symbol, std::optional<size_t> size) const {
   }
 }
 
+/***************************************************
+ * Z3TranslationCache                              *
+ ***************************************************/
+Z3TranslationCache::Z3TranslationCache(z3::context& ctx)
+    : ctx_(&ctx), constants_(std::make_shared<ConstMap>()) {}
+
+const z3::expr* Z3TranslationCache::find(const Operation& op) {
+  auto it = entries_.find(&op);
+  if (it == entries_.end())
+    return nullptr;
+
+  // The operation this entry was created for has been destroyed and op is a
+  // different one that happens to have the same address.
+  if (it->second.op.expired()) {
+    entries_.erase(it);
+    ++cache_evicted;
+    return nullptr;
+  }
+
+  return &it->second.expr;
+}
+
+bool Z3TranslationCache::insert(const Operation& op, const z3::expr& expr) {
+  auto weak = op.weak_from_this();
+  if (weak.expired())
+    return false;
+
+  entries_.insert_or_assign(&op, Entry{std::move(weak), expr});
+  return true;
+}
+
+z3::expr Z3TranslationCache::constant(const Z3Model::SymbolName& name,
+                                      const z3::sort& sort) {
+  auto it = constants_->find(name);
+  if (it != constants_->end() && z3::eq(it->second.get_sort(), sort))
+    return it->second;
+
+  // Models may still hold on to the current map so we can't modify it.
+  if (constants_.use_count() > 1)
+    constants_ = std::make_shared<ConstMap>(*constants_);
+
+  // If the symbol was previously used with a different sort then the newest
+  // one wins. Within a single query every use should have the same sort.
+  auto expr = ctx_->constant(name_to_symbol(*ctx_, name), sort);
+  constants_->insert_or_assign(name, expr);
+  return expr;
+}
+
+z3::expr Z3TranslationCache::next_const(const z3::sort& sort) {
+  CAFFEINE_ASSERT(tmp_const_num_ != TmpConstMax,
+                  "ran out of temporary constant names");
+
+  unsigned const_num = tmp_const_num_++;
+  return ctx_->constant(ctx_->int_symbol(const_num), sort);
+}
+
+void Z3TranslationCache::sweep() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.op.expired()) {
+      it = entries_.erase(it);
+      ++cache_evicted;
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Z3TranslationCache::maybe_sweep() {
+  if (entries_.size() < next_sweep_)
+    return;
+
+  sweep();
+  if (entries_.size() >= MaxSize) {
+    cache_evicted += entries_.size();
+    clear();
+  }
+
+  next_sweep_ = std::max(MinSweepSize, entries_.size() * 2);
+}
+
+void Z3TranslationCache::clear() {
+  entries_.clear();
+  // None of the temporary constants are referenced by a cached expression
+  // anymore so their names can be reused.
+  tmp_const_num_ = (1u << 30) / 2;
+}
+
 /***************************************************
  * Z3Solver                                        *
  ***************************************************/
-Z3Solver::Z3Solver() : impl(std::make_unique<Impl>()) {}
+Z3Solver::Z3Solver(CancellationToken* cancel)
+    : impl(std::make_unique<Impl>(cancel)) {}
 
 Z3Solver::Z3Solver(Z3Solver&& solver) noexcept : impl(std::move(solver.impl)) {}
 Z3Solver& Z3Solver::operator=(Z3Solver&& solver) noexcept {
@@ -230,13 +337,17 @@ SolverResult Z3Solver::resolve(AssertionList& assertions,
                                const Assertion& extra) {
   if (extra.is_constant_value(false))
     return SolverResult::UNSAT;
+  if (impl->cancel && impl->cancel->is_cancelled())
+    return SolverResult::Unknown;
 
   auto block = CAFFEINE_TRACE_SPAN("Z3Solver::resolve");
+  stats::ScopedTimer timer{query_time};
+  ++num_queries;
 
   z3::solver solver = impl->tactic.mk_solver();
-  Z3Model::ConstMap constMap;
 
-  Z3OpVisitor visitor{&solver, constMap};
+  impl->cache.maybe_sweep();
+  Z3OpVisitor visitor{impl->cache};
   for (Assertion assertion : assertions) {
     if (assertion.is_empty()) {
       continue;
@@ -251,7 +362,19 @@ SolverResult Z3Solver::resolve(AssertionList& assertions,
     solver.add(normalize_to_bool(exp));
   }
 
+  // Check for cancellation again after registering so that one which happens
+  // while translating the query isn't missed.
+  CancellationToken::Registration interrupt;
+  if (impl->cancel) {
+    interrupt = impl->cancel->on_cancel([&] { impl->ctx.interrupt(); });
+    if (impl->cancel->is_cancelled()) {
+      ++num_unknown;
+      return SolverResult::Unknown;
+    }
+  }
+
   auto result = solver.check();
+  interrupt = CancellationToken::Registration();
 
   if (block.is_enabled()) {
     std::stringstream ss;
@@ -275,14 +398,18 @@ SolverResult Z3Solver::resolve(AssertionList& assertions,
 
   switch (result) {
   case z3::sat:
+    ++num_sat;
     return SolverResult(
         SolverResult::SAT,
-        std::make_unique<Z3Model>(solver.get_model(), std::move(constMap)));
+        std::make_unique<Z3Model>(solver.get_model(),
+                                  impl->cache.constants()));
 
   case z3::unsat:
+    ++num_unsat;
     return SolverResult::UNSAT;
 
   default:
+    ++num_unknown;
     return SolverResult::Unknown;
   }
 }
@@ -292,8 +419,7 @@ z3::context& Z3Solver::context() {
 }
 z3::expr Z3Solver::evaluate(const OpRef& expr, z3::solver& solver) {
   CAFFEINE_ASSERT(&solver.ctx() == &context());
-  Z3Model::ConstMap constMap;
-  Z3OpVisitor visitor{&solver, constMap};
+  Z3OpVisitor visitor{impl->cache};
 
   return normalize_to_bool(visitor.visit(*expr));
 }
@@ -301,17 +427,23 @@ z3::expr Z3Solver::evaluate(const OpRef& expr, z3::solver& solver) {
 /***************************************************
  * Z3OpVisitor                                     *
  ***************************************************/
-Z3OpVisitor::Z3OpVisitor(z3::solver* solver, Z3Model::ConstMap& constMap)
-    : ctx(&solver->ctx()), solver(solver), constMap(constMap) {}
+Z3OpVisitor::Z3OpVisitor(Z3TranslationCache& shared)
+    : ctx(&shared.ctx()), shared(shared) {}
 
 z3::expr Z3OpVisitor::visit(const Operation& op) {
   // Memoize visited expressions to avoid combinatorial explosion
+  if (const z3::expr* expr = shared.find(op)) {
+    ++cache_hits;
+    return *expr;
+  }
   auto it = cache.find(&op);
   if (it != cache.end())
     return it->second;
 
+  ++cache_misses;
   z3::expr value = ConstOpVisitor<Z3OpVisitor, z3::expr>::visit(op);
-  cache.emplace(&op, value);
+  if (!shared.insert(op, value))
+    cache.emplace(&op, value);
   return value;
 }
 
@@ -321,33 +453,10 @@ z3::expr Z3OpVisitor::visitOperation(const Operation& op) {
 }
 
 z3::expr Z3OpVisitor::visitConstant(const Constant& op) {
-  auto type = op.type();
-  auto name = op_name(op.symbol());
-
-  // Reuse already created constants (otherwise Z3 will view them as different?)
-  auto it = constMap.find(name);
-  if (it != constMap.end()) {
-    // TODO: Ensure that they're the same type?
-    return it->second;
-  }
-
-  auto sort = type_to_sort(*ctx, type);
-  auto expr = ctx->constant(name_to_symbol(*ctx, name), sort);
-  constMap.insert({name, expr});
-  return expr;
+  return shared.constant(op_name(op.symbol()), type_to_sort(*ctx, op.type()));
 }
 z3::expr Z3OpVisitor::visitConstantArray(const ConstantArray& op) {
-  auto name = op_name(op.symbol());
-
-  auto it = constMap.find(name);
-  if (it != constMap.end()) {
-    return it->second;
-  }
-
-  auto sort = type_to_sort(*ctx, op.type());
-  auto expr = ctx->constant(name_to_symbol(*ctx, name), sort);
-  constMap.insert({std::move(name), expr});
-  return expr;
+  return shared.constant(op_name(op.symbol()), type_to_sort(*ctx, op.type()));
 }
 z3::expr Z3OpVisitor::visitConstantInt(const ConstantInt& op) {
   if (op.value().getBitWidth() <= 64) {
@@ -399,17 +508,42 @@ z3::expr Z3OpVisitor::visitUndef(const Undef& op) {
 }
 z3::expr Z3OpVisitor::visitFixedArray(const FixedArray& op) {
   const auto& data = op.data();
-
-  z3::expr array = next_const(
-      ctx->array_sort(ctx->bv_sort((op.type().bitwidth())), ctx->bv_sort(8)));
-
-  for (size_t i = 0; i < data.size(); ++i) {
-    z3::expr value = visit(*data[i]);
-    solver->add(z3::select(array, ctx->bv_val(i, op.type().bitwidth())) ==
-                value);
-  }
-
-  return array;
+  unsigned width = op.type().bitwidth();
+
+  // Elements past the end are left unconstrained. The array is built up as a
+  // term (instead of asserting the value of each element) so that the
+  // translation can be cached and reused by later queries.
+  //
+  // A chain of stores would be the obvious term here but z3 handles a
+  // symbolic read from a long store chain poorly. Instead the array is a
+  // lambda over a balanced tree of comparisons on the index which only ends
+  // up being log(n) deep.
+  z3::expr base = next_const(ctx->array_sort(ctx->bv_sort(width),
+                                             ctx->bv_sort(8)));
+  if (data.empty())
+    return base;
+
+  std::vector<z3::expr> values;
+  values.reserve(data.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    values.push_back(visit(*data[i]));
+
+  z3::expr index = next_const(ctx->bv_sort(width));
+  auto select_range = [&](auto& self, size_t lo, size_t hi) -> z3::expr {
+    if (hi - lo == 1)
+      return values[lo];
+
+    size_t mid = lo + (hi - lo) / 2;
+    return z3::ite(z3::ult(index, ctx->bv_val(mid, width)),
+                   self(self, lo, mid), self(self, mid, hi));
+  };
+
+  z3::expr body = select_range(select_range, 0, values.size());
+  if (width >= 64 || data.size() < (uint64_t(1) << width))
+    body = z3::ite(z3::uge(index, ctx->bv_val(data.size(), width)),
+                   z3::select(base, index), body);
+
+  return z3::lambda(index, body);
 }
 
 #define CAFFEINE_BINOP_IMPL(name, op_code)                                     \
@@ -426,7 +560,7 @@ CAFFEINE_BINOP_IMPL(Mul, lhs * rhs)
 CAFFEINE_BINOP_IMPL(UDiv, z3::udiv(lhs, rhs))
 CAFFEINE_BINOP_IMPL(SDiv, lhs / rhs)
 CAFFEINE_BINOP_IMPL(URem, z3::urem(lhs, rhs))
-CAFFEINE_BINOP_IMPL(SRem, lhs % rhs)
+CAFFEINE_BINOP_IMPL(SRem, z3::srem(lhs, rhs))
 CAFFEINE_BINOP_IMPL(Xor, lhs ^ rhs)
 CAFFEINE_BINOP_IMPL(Shl, z3::shl(lhs, rhs))
 CAFFEINE_BINOP_IMPL(LShr, z3::lshr(lhs, rhs))
@@ -510,6 +644,11 @@ static z3::expr is_nan(const z3::expr& e) {
   return expr;
 }
 
+static z3::expr fpa_eq(const z3::expr& a, const z3::expr& b) {
+  auto val = z3::expr(a.ctx(), Z3_mk_fpa_eq(a.ctx(), a, b));
+  val.check_error();
+  return val;
+}
 static z3::expr fpa_leq(const z3::expr& a, const z3::expr& b) {
   auto val = z3::expr(a.ctx(), Z3_mk_fpa_leq(a.ctx(), a, b));
   val.check_error();
@@ -537,8 +676,10 @@ z3::expr Z3OpVisitor::visitFCmp(const FCmpOp& op) {
 
   z3::expr expr = z3::expr(lhs.ctx(), nullptr);
   switch (op.comparison()) {
+  // Note that these have to use IEEE equality instead of z3's structural
+  // equality, under which NaN == NaN and +0 != -0.
   case FCmpOpcode::EQ:
-    expr = lhs == rhs;
+    expr = fpa_eq(lhs, rhs);
     break;
   case FCmpOpcode::GT:
     expr = fpa_gt(lhs, rhs);
@@ -553,7 +694,7 @@ z3::expr Z3OpVisitor::visitFCmp(const FCmpOp& op) {
     expr = fpa_leq(lhs, rhs);
     break;
   case FCmpOpcode::NE:
-    expr = lhs != rhs;
+    expr = !fpa_eq(lhs, rhs);
     break;
   default:
     CAFFEINE_ABORT("Unknown FCmpOpcode");
@@ -11,18 +11,125 @@
 #include <z3++.h>
 
 #include <limits>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <variant>
 
 namespace caffeine {
 
+class Z3Model : public Model {
+public:
+  using SymbolName = std::variant<std::string, uint64_t>;
+  using ConstMap = std::unordered_map<SymbolName, z3::expr>;
+
+private:
+  z3::model model;
+  std::shared_ptr<const ConstMap> constants;
+
+public:
+  Z3Model(const z3::model& model, std::shared_ptr<const ConstMap> map);
+
+  Value lookup(const Symbol& symbol, std::optional<size_t> size) const override;
+};
+
+/**
+ * Translations of operations to z3 expressions that are kept around across
+ * queries made within the same z3 context.
+ *
+ * Since operations are hash-consed, most of a query (input bytes, allocation
+ * bases, common arithmetic) has usually already been translated by an earlier
+ * query. Keeping the translations around means that only the new nodes of
+ * each query need to be converted.
+ *
+ * Entries are keyed by the address of the operation and hold a weak reference
+ * to it, the same as OperationCache. An entry whose operation has been
+ * destroyed is never returned, even if a new operation has since been
+ * allocated at the same address. Expired entries are swept out once the cache
+ * has doubled in size since the last sweep.
+ *
+ * Operations not owned by an OpRef are never cached here.
+ */
+class Z3TranslationCache {
+public:
+  using ConstMap = Z3Model::ConstMap;
+
+  explicit Z3TranslationCache(z3::context& ctx);
+
+  z3::context& ctx() const {
+    return *ctx_;
+  }
+
+  const z3::expr* find(const Operation& op);
+  // Returns false if the operation cannot be cached.
+  bool insert(const Operation& op, const z3::expr& expr);
+
+  /**
+   * Get the z3 constant for a symbol. The same expression is returned every
+   * time the symbol is requested with the same sort.
+   */
+  z3::expr constant(const Z3Model::SymbolName& name, const z3::sort& sort);
+
+  /**
+   * A snapshot of all the symbol constants that have been created so far.
+   *
+   * The map is copied on write so it can be handed out to models which may
+   * outlive the current query (or be used from another thread).
+   */
+  std::shared_ptr<const ConstMap> constants() const {
+    return constants_;
+  }
+
+  /**
+   * Create a fresh constant that is used as an implementation detail and isn't
+   * otherwise exposed to clients.
+   *
+   * These have high-integer names that won't collide unless the running
+   * program creates more than 2^29 constant names.
+   */
+  z3::expr next_const(const z3::sort& sort);
+
+  // Remove all entries whose operations have been destroyed.
+  void sweep();
+  // Sweep if enough entries have been added since the last sweep.
+  void maybe_sweep();
+  void clear();
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  // Sweeping is skipped until there are at least this many entries.
+  static constexpr size_t MinSweepSize = 4096;
+  // If there are still this many entries after a sweep then everything is
+  // dropped instead.
+  static constexpr size_t MaxSize = size_t(1) << 22;
+
+private:
+  struct Entry {
+    std::weak_ptr<const Operation> op;
+    z3::expr expr;
+  };
+
+  z3::context* ctx_;
+  std::unordered_map<const Operation*, Entry> entries_;
+  std::shared_ptr<ConstMap> constants_;
+  size_t next_sweep_ = MinSweepSize;
+  unsigned tmp_const_num_ = (1u << 30) / 2;
+
+  static constexpr unsigned TmpConstMax = (1u << 30) - 1;
+};
+
 class Z3Solver::Impl {
 public:
   z3::context ctx;
   z3::tactic tactic;
+  CancellationToken* cancel;
+  // Must come after ctx so that it is destroyed first.
+  Z3TranslationCache cache;
 
-  Impl() : tactic(ctx, "default") {
+  Impl(CancellationToken* cancel)
+      : tactic(ctx, "default"), cancel(cancel), cache(ctx) {
     // We want z3 to generate models
     ctx.set("model", true);
     // Automatically select and configure the solver
@@ -32,37 +139,15 @@ public:
   }
 };
 
-class Z3Model : public Model {
-public:
-  using SymbolName = std::variant<std::string, uint64_t>;
-  using ConstMap = std::unordered_map<SymbolName, z3::expr>;
-
-private:
-  z3::model model;
-  ConstMap constants;
-
-public:
-  Z3Model(const z3::model& model, const ConstMap& map);
-  Z3Model(const z3::model& model, ConstMap&& map);
-
-  Value lookup(const Symbol& symbol, std::optional<size_t> size) const override;
-};
-
 class Z3OpVisitor : public ConstOpVisitor<Z3OpVisitor, z3::expr> {
-public:
 private:
   z3::context* ctx;
-  z3::solver* solver;
-  Z3Model::ConstMap& constMap;
+  Z3TranslationCache& shared;
+  // Translations of operations that can't be put in the shared cache.
   std::unordered_map<const Operation*, z3::expr> cache;
-  // Used for temporary constants that are needed as an implementation detail
-  // but aren't otherwise exposed to clients.
-  unsigned tmpConstNum = (1u << 30) / 2;
-
-  static constexpr unsigned tmpConstMax = (1u << 30) - 1;
 
 public:
-  Z3OpVisitor(z3::solver* ctx, Z3Model::ConstMap& constMap);
+  explicit Z3OpVisitor(Z3TranslationCache& shared);
 
   z3::expr visit(const Operation& op);
   z3::expr visit(const Operation* op) {
@@ -120,18 +205,8 @@ public:
   z3::expr visitFIsNaN(const UnaryOp& op);
   // clang-format on
 
-  /**
-   * When a temporary constant is needed then use this function.
-   *
-   * It explicitly creates constants with high-integer names that won't collide
-   * unless the running program creates more than 2^29 constant names.
-   */
   z3::expr next_const(const z3::sort& sort) {
-    CAFFEINE_ASSERT(tmpConstNum != tmpConstMax,
-                    "ran out of temporary constant names");
-
-    unsigned const_num = tmpConstNum++;
-    return ctx->constant(ctx->int_symbol(const_num), sort);
+    return shared.next_const(sort);
   }
 };
 
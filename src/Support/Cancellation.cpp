@@ -0,0 +1,63 @@
+#include "caffeine/Support/Cancellation.h"
+
+namespace caffeine {
+
+bool CancellationToken::cancel() {
+  auto lock = std::unique_lock(mutex_);
+  if (cancelled_.exchange(true))
+    return false;
+
+  for (auto& callback : callbacks_)
+    callback();
+  return true;
+}
+
+CancellationToken::Registration
+CancellationToken::on_cancel(std::function<void()> callback) {
+  auto lock = std::unique_lock(mutex_);
+  if (is_cancelled()) {
+    lock.unlock();
+    callback();
+    return Registration();
+  }
+
+  callbacks_.push_back(std::move(callback));
+  return Registration(this, std::prev(callbacks_.end()));
+}
+
+/***************************************************
+ * Registration                                    *
+ ***************************************************/
+CancellationToken::Registration::Registration(CancellationToken* token,
+                                              CallbackList::iterator it)
+    : token(token), it(it) {}
+
+CancellationToken::Registration::~Registration() {
+  reset();
+}
+
+CancellationToken::Registration::Registration(Registration&& other) noexcept
+    : token(other.token), it(other.it) {
+  other.token = nullptr;
+}
+CancellationToken::Registration&
+CancellationToken::Registration::operator=(Registration&& other) noexcept {
+  if (this != &other) {
+    reset();
+    token = other.token;
+    it = other.it;
+    other.token = nullptr;
+  }
+  return *this;
+}
+
+void CancellationToken::Registration::reset() {
+  if (!token)
+    return;
+
+  auto lock = std::unique_lock(token->mutex_);
+  token->callbacks_.erase(it);
+  token = nullptr;
+}
+
+} // namespace caffeine
@@ -0,0 +1,278 @@
+#include "caffeine/Support/Stats.h"
+#include "caffeine/Support/Assert.h"
+
+#include <fmt/format.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/raw_os_ostream.h>
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+
+namespace caffeine::stats {
+
+namespace {
+  struct Registry {
+    std::mutex mutex;
+    // Ordered so that reports list statistics grouped by subsystem.
+    std::map<std::string_view, Statistic*> stats;
+
+    static Registry& get() {
+      static Registry registry;
+      return registry;
+    }
+  };
+
+  template <typename T, typename Shards>
+  T sum_shards(const Shards& shards) {
+    T total = 0;
+    for (const auto& shard : shards)
+      total += shard.value.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  void fetch_max(std::atomic<uint64_t>& value, uint64_t candidate) {
+    uint64_t current = value.load(std::memory_order_relaxed);
+    while (current < candidate &&
+           !value.compare_exchange_weak(current, candidate,
+                                        std::memory_order_relaxed))
+      ;
+  }
+} // namespace
+
+/***************************************************
+ * Statistic                                       *
+ ***************************************************/
+Statistic::Statistic(Kind kind, std::string_view name, std::string_view desc)
+    : kind_(kind), name_(name), desc_(desc) {
+  auto& registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+  bool inserted = registry.stats.emplace(name_, this).second;
+  CAFFEINE_ASSERT(inserted, fmt::format("duplicate statistic '{}'", name));
+}
+Statistic::~Statistic() {
+  auto& registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+  registry.stats.erase(name_);
+}
+
+size_t Statistic::shard_index() {
+  static std::atomic<size_t> next_index = 0;
+  thread_local size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index % NUM_SHARDS;
+}
+
+/***************************************************
+ * Counter                                         *
+ ***************************************************/
+Counter::Counter(std::string_view name, std::string_view desc)
+    : Statistic(Kind::Counter, name, desc) {}
+
+uint64_t Counter::value() const {
+  return sum_shards<uint64_t>(shards_);
+}
+
+void Counter::write_json(llvm::json::OStream& os) const {
+  os.value((int64_t)value());
+}
+
+/***************************************************
+ * Gauge                                           *
+ ***************************************************/
+Gauge::Gauge(std::string_view name, std::string_view desc)
+    : Statistic(Kind::Gauge, name, desc) {}
+
+int64_t Gauge::value() const {
+  return sum_shards<int64_t>(shards_);
+}
+
+void Gauge::write_json(llvm::json::OStream& os) const {
+  os.value(value());
+}
+
+/***************************************************
+ * Histogram                                       *
+ ***************************************************/
+Histogram::Histogram(std::string_view name, std::string_view desc)
+    : Statistic(Kind::Histogram, name, desc),
+      shards_(std::make_unique<std::array<Shard, NUM_HISTOGRAM_SHARDS>>()) {}
+
+size_t Histogram::bucket_index(uint64_t value) {
+  if (value < SUB_BUCKETS)
+    return value;
+
+  // Position of the most significant bit. This is at least 3 here.
+  unsigned msb = 63 - llvm::countLeadingZeros(value);
+  size_t sub = (value >> (msb - 3)) & (SUB_BUCKETS - 1);
+  return (msb - 2) * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::bucket_lower_bound(size_t index) {
+  if (index < SUB_BUCKETS)
+    return index;
+
+  unsigned msb = index / SUB_BUCKETS + 2;
+  uint64_t sub = index % SUB_BUCKETS;
+  return (SUB_BUCKETS + sub) << (msb - 3);
+}
+
+void Histogram::record(uint64_t value) {
+  auto& shard = (*shards_)[shard_index() % NUM_HISTOGRAM_SHARDS];
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  shard.buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+  fetch_max(shard.max, value);
+}
+
+Histogram::Summary Histogram::summary() const {
+  Summary summary;
+  for (const Shard& shard : *shards_) {
+    summary.count += shard.count.load(std::memory_order_relaxed);
+    summary.sum += shard.sum.load(std::memory_order_relaxed);
+    summary.max =
+        std::max(summary.max, shard.max.load(std::memory_order_relaxed));
+
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+      summary.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+  }
+  return summary;
+}
+
+double Histogram::Summary::mean() const {
+  if (count == 0)
+    return 0.0;
+  return (double)sum / (double)count;
+}
+
+uint64_t Histogram::Summary::percentile(double p) const {
+  if (count == 0)
+    return 0;
+
+  // The bucket counts and the total count are read separately so they may
+  // disagree slightly if the histogram is being updated concurrently.
+  uint64_t target = (uint64_t)(p / 100.0 * (double)count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    seen += buckets[i];
+    if (seen > target)
+      return std::min(bucket_lower_bound(i), max);
+  }
+
+  return max;
+}
+
+void Histogram::write_json(llvm::json::OStream& os) const {
+  Summary summary = this->summary();
+
+  os.object([&] {
+    os.attribute("count", (int64_t)summary.count);
+    os.attribute("sum", (int64_t)summary.sum);
+    os.attribute("mean", summary.mean());
+    os.attribute("p50", (int64_t)summary.percentile(50));
+    os.attribute("p90", (int64_t)summary.percentile(90));
+    os.attribute("p99", (int64_t)summary.percentile(99));
+    os.attribute("max", (int64_t)summary.max);
+  });
+}
+
+/***************************************************
+ * Reporting                                       *
+ ***************************************************/
+const Statistic* find(std::string_view name) {
+  auto& registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+
+  auto it = registry.stats.find(name);
+  if (it == registry.stats.end())
+    return nullptr;
+  return it->second;
+}
+
+void write_json(std::ostream& os) {
+  auto& registry = Registry::get();
+  std::lock_guard lock(registry.mutex);
+
+  llvm::raw_os_ostream raw{os};
+  llvm::json::OStream json{raw, 2};
+  json.object([&] {
+    for (const auto& [name, stat] : registry.stats) {
+      json.attributeBegin(llvm::StringRef(name.data(), name.size()));
+      stat->write_json(json);
+      json.attributeEnd();
+    }
+  });
+  raw << '\n';
+}
+
+StatusReporter::StatusReporter(std::ostream& os,
+                               std::chrono::milliseconds interval,
+                               std::vector<std::string> names)
+    : os_(os), interval_(interval), names_(std::move(names)),
+      last_(names_.size(), 0), start_(std::chrono::steady_clock::now()),
+      last_report_(start_) {
+  CAFFEINE_ASSERT(interval_.count() > 0);
+
+  thread_ = std::thread([this] { run(); });
+}
+StatusReporter::~StatusReporter() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+void StatusReporter::run() {
+  std::unique_lock lock(mutex_);
+  while (!stopping_) {
+    if (cv_.wait_for(lock, interval_, [&] { return stopping_; }))
+      break;
+
+    lock.unlock();
+    report();
+    lock.lock();
+  }
+}
+
+void StatusReporter::report() {
+  using seconds = std::chrono::duration<double>;
+
+  std::lock_guard lock(mutex_);
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = seconds(now - start_).count();
+  double delta = seconds(now - last_report_).count();
+  last_report_ = now;
+
+  std::string line = fmt::format("[{:.1f}s]", elapsed);
+  for (size_t i = 0; i < names_.size(); ++i) {
+    const Statistic* stat = find(names_[i]);
+    if (!stat)
+      continue;
+
+    switch (stat->kind()) {
+    case Statistic::Kind::Counter: {
+      uint64_t value = static_cast<const Counter*>(stat)->value();
+      double rate = delta > 0 ? (double)(value - last_[i]) / delta : 0.0;
+      line += fmt::format(" {}={} ({:.0f}/s)", names_[i], value, rate);
+      last_[i] = value;
+      break;
+    }
+    case Statistic::Kind::Gauge:
+      line += fmt::format(" {}={}", names_[i],
+                          static_cast<const Gauge*>(stat)->value());
+      break;
+    case Statistic::Kind::Histogram: {
+      auto summary = static_cast<const Histogram*>(stat)->summary();
+      line += fmt::format(" {}={:.2f}s", names_[i], (double)summary.sum / 1e9);
+      break;
+    }
+    }
+  }
+
+  os_ << line << std::endl;
+}
+
+} // namespace caffeine::stats
@@ -1,50 +1,369 @@
 #include "caffeine/Support/Tracing.h"
 #include "caffeine/Protos/tracepoint.capnp.h"
 #include "caffeine/Support/Assert.h"
+#include <algorithm>
+#include <atomic>
 #include <capnp/message.h>
-#include <capnp/orphan.h>
 #include <capnp/serialize-packed.h>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
-#include <fmt/format.h>
-#include <fmt/ostream.h>
+#include <cstring>
+#include <deque>
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
 namespace caffeine::tracing {
 
+#if CAFFEINE_ENABLE_TRACING
+
 namespace detail {
-  void annotate_tid(AutoTraceBlock& block) {
-    block.annotate("tid", fmt::format("{}", std::this_thread::get_id()));
-  }
+  /**
+   * A single completed (or in-progress) span.
+   *
+   * Annotations are encoded back-to-back within the payload as a u32 interned
+   * key, a u32 length, and then the value bytes. Annotations that don't fit
+   * within the payload are appended to the overflow string using the same
+   * encoding. The overflow string is owned by the event.
+   */
+  struct TraceEvent {
+    static constexpr size_t PAYLOAD_SIZE = 224;
+
+    uint64_t start;
+    uint64_t end;
+    uint32_t name;
+    uint32_t size;
+    std::string* overflow;
+    char payload[PAYLOAD_SIZE];
+  };
+
+  static_assert(sizeof(TraceEvent) == 256);
 } // namespace detail
 
-#if CAFFEINE_ENABLE_TRACING
+using detail::TraceEvent;
 
 namespace {
-  static TraceSink* trace_sink = nullptr;
+  static constexpr size_t ANNOTATION_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+  // How often the flusher thread drains the per-thread buffers.
+  static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(50);
+
+  std::atomic<TraceSink*> trace_sink = nullptr;
+
+  uint64_t now() {
+    return std::chrono::system_clock::now().time_since_epoch().count();
+  }
 
   void build_string(capnp::Text::Builder&& builder, std::string_view string) {
     CAFFEINE_ASSERT(builder.size() == string.size());
     std::copy(string.begin(), string.end(), builder.asArray().begin());
   }
+
+  /**
+   * Single-producer single-consumer ring buffer of completed trace events.
+   *
+   * The owning thread is the only producer and the flusher thread is the only
+   * consumer. The buffer also holds the pool of events used by in-progress
+   * spans on the owning thread.
+   */
+  struct ThreadBuffer {
+    static constexpr size_t CAPACITY = 4096;
+
+    const uint32_t tid;
+
+    std::atomic<size_t> head = 0; // Next slot to be written by the producer
+    std::atomic<size_t> tail = 0; // Next slot to be read by the consumer
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<bool> retired = false;
+    std::unique_ptr<TraceEvent[]> slots;
+
+    // Only accessed by the owning thread.
+    std::deque<TraceEvent> storage;
+    std::vector<TraceEvent*> free;
+
+    explicit ThreadBuffer(uint32_t tid)
+        : tid(tid), slots(std::make_unique<TraceEvent[]>(CAPACITY)) {}
+
+    ~ThreadBuffer() {
+      drain([](const TraceEvent&) {});
+    }
+
+    TraceEvent* allocate() {
+      if (free.empty())
+        return &storage.emplace_back();
+
+      TraceEvent* event = free.back();
+      free.pop_back();
+      return event;
+    }
+
+    void release(TraceEvent* event) {
+      free.push_back(event);
+    }
+
+    void push(const TraceEvent& event) {
+      size_t h = head.load(std::memory_order_relaxed);
+      size_t t = tail.load(std::memory_order_acquire);
+
+      if (h - t == CAPACITY) {
+        delete event.overflow;
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      slots[h % CAPACITY] = event;
+      head.store(h + 1, std::memory_order_release);
+    }
+
+    /**
+     * Pass every event in the buffer to func. The consumer takes ownership of
+     * the overflow string of each event.
+     */
+    template <typename F>
+    void drain(F&& func) {
+      size_t t = tail.load(std::memory_order_relaxed);
+      size_t h = head.load(std::memory_order_acquire);
+
+      for (; t != h; ++t) {
+        TraceEvent& event = slots[t % CAPACITY];
+        func(event);
+        delete event.overflow;
+        event.overflow = nullptr;
+      }
+
+      tail.store(h, std::memory_order_release);
+    }
+
+    bool empty() const {
+      return head.load(std::memory_order_acquire) ==
+             tail.load(std::memory_order_relaxed);
+    }
+  };
+
+  /**
+   * Global state shared between all threads: the set of live thread buffers
+   * and the table of interned names.
+   *
+   * Interned ids are never reused so ids cached by a thread remain valid for
+   * the lifetime of the process.
+   */
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::vector<std::string> names;
+    llvm::StringMap<uint32_t> ids;
+    uint32_t next_tid = 0;
+
+    static Registry& get() {
+      static Registry registry;
+      return registry;
+    }
+  };
+
+  struct ThreadState {
+    std::shared_ptr<ThreadBuffer> buffer;
+    llvm::StringMap<uint32_t> names;
+
+    ~ThreadState() {
+      // The registry keeps the buffer alive until the flusher has drained it.
+      if (buffer)
+        buffer->retired.store(true, std::memory_order_release);
+    }
+
+    ThreadBuffer& get_buffer() {
+      if (buffer)
+        return *buffer;
+
+      auto& registry = Registry::get();
+      std::lock_guard lock(registry.mutex);
+      buffer = std::make_shared<ThreadBuffer>(registry.next_tid++);
+      registry.buffers.push_back(buffer);
+      return *buffer;
+    }
+
+    uint32_t intern(std::string_view view) {
+      llvm::StringRef name{view.data(), view.size()};
+      auto it = names.find(name);
+      if (it != names.end())
+        return it->second;
+
+      auto& registry = Registry::get();
+      std::lock_guard lock(registry.mutex);
+      auto [entry, inserted] =
+          registry.ids.try_emplace(name, (uint32_t)registry.names.size());
+      if (inserted)
+        registry.names.emplace_back(view);
+
+      names.try_emplace(name, entry->second);
+      return entry->second;
+    }
+  };
+
+  thread_local ThreadState thread_state;
+
+  void write_annotation(char* dest, uint32_t key, std::string_view value) {
+    uint32_t len = value.size();
+    std::memcpy(dest, &key, sizeof(key));
+    std::memcpy(dest + sizeof(key), &len, sizeof(len));
+    std::memcpy(dest + ANNOTATION_HEADER_SIZE, value.data(), value.size());
+  }
+
+  template <typename F>
+  void read_annotations(const char* data, size_t size, F&& func) {
+    size_t offset = 0;
+    while (offset < size) {
+      uint32_t key;
+      uint32_t len;
+      std::memcpy(&key, data + offset, sizeof(key));
+      std::memcpy(&len, data + offset + sizeof(key), sizeof(len));
+      offset += ANNOTATION_HEADER_SIZE;
+
+      func(key, std::string_view(data + offset, len));
+      offset += len;
+    }
+  }
+
+  template <typename F>
+  void for_each_annotation(const TraceEvent& event, F&& func) {
+    read_annotations(event.payload, event.size, func);
+    if (event.overflow)
+      read_annotations(event.overflow->data(), event.overflow->size(), func);
+  }
 } // namespace
 
 class TraceSink {
 private:
   FILE* output;
+  // Number of interned names that have already been written to the output.
+  size_t names_written = 0;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping = false;
+  std::thread flusher;
 
 public:
   TraceSink(FILE* output) : output(output) {
     CAFFEINE_ASSERT(output);
+
+    flusher = std::thread([this] { run(); });
   }
   ~TraceSink() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    flusher.join();
+
+    // Pick up anything that was recorded after the last flush.
+    flush();
     fclose(output);
   }
 
-  FILE* file() const {
-    return output;
+private:
+  void run() {
+    std::unique_lock lock(mutex);
+    while (!stopping) {
+      cv.wait_for(lock, FLUSH_INTERVAL);
+
+      lock.unlock();
+      flush();
+      lock.lock();
+    }
+  }
+
+  void flush() {
+    auto& registry = Registry::get();
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::vector<std::string> names;
+
+    {
+      std::lock_guard lock(registry.mutex);
+      buffers = registry.buffers;
+      names.assign(registry.names.begin() + names_written,
+                   registry.names.end());
+    }
+
+    std::vector<std::pair<uint32_t, TraceEvent>> events;
+    llvm::SmallVector<std::unique_ptr<std::string>, 8> overflows;
+    uint64_t dropped = 0;
+
+    for (const auto& buffer : buffers) {
+      dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+      buffer->drain([&](TraceEvent& event) {
+        events.emplace_back(buffer->tid, event);
+        // Keep the overflow annotations alive until the batch is written.
+        if (event.overflow) {
+          overflows.emplace_back(event.overflow);
+          event.overflow = nullptr;
+        }
+      });
+    }
+
+    write_batch(names, events, dropped);
+    names_written += names.size();
+
+    // Forget about buffers belonging to threads that have exited once they
+    // have been fully drained.
+    std::lock_guard lock(registry.mutex);
+    auto& all = registry.buffers;
+    all.erase(std::remove_if(all.begin(), all.end(),
+                             [](const auto& buffer) {
+                               return buffer->retired.load(
+                                          std::memory_order_acquire) &&
+                                      buffer->empty();
+                             }),
+              all.end());
+  }
+
+  void write_batch(llvm::ArrayRef<std::string> names,
+                   llvm::ArrayRef<std::pair<uint32_t, TraceEvent>> events,
+                   uint64_t dropped) {
+    if (names.empty() && events.empty() && dropped == 0)
+      return;
+
+    capnp::MallocMessageBuilder message;
+    auto batch = message.initRoot<TraceBatch>();
+    batch.setDropped(dropped);
+
+    auto name_list = batch.initNames(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+      name_list[i].setId(names_written + i);
+      build_string(name_list[i].initValue(names[i].size()), names[i]);
+    }
+
+    auto event_list = batch.initEvents(events.size());
+    for (size_t i = 0; i < events.size(); ++i) {
+      const auto& [tid, event] = events[i];
+      auto builder = event_list[i];
+      builder.setStart(event.start);
+      builder.setEnd(event.end);
+      builder.setName(event.name);
+      builder.setThread(tid);
+
+      size_t count = 0;
+      for_each_annotation(event, [&](uint32_t, std::string_view) { ++count; });
+
+      auto annotations = builder.initAnnotations(count);
+      size_t j = 0;
+      for_each_annotation(event, [&](uint32_t key, std::string_view value) {
+        annotations[j].setName(key);
+        build_string(annotations[j].initValue(value.size()), value);
+        j += 1;
+      });
+    }
+
+    kj::VectorOutputStream stream;
+    capnp::writePackedMessage(stream, message);
+
+    auto data = stream.getArray();
+    fwrite(data.begin(), data.size(), 1, output);
   }
 };
 
@@ -69,97 +388,80 @@ bool TraceContext::is_enabled() const {
 }
 
 bool TraceContext::tracing_enabled() {
-  return !!trace_sink;
+  return trace_sink.load(std::memory_order_relaxed) != nullptr;
 }
 
-struct AutoTraceBlock::Impl {
-  capnp::MallocMessageBuilder message;
-  llvm::SmallVector<
-      std::pair<capnp::Orphan<capnp::Text>, capnp::Orphan<capnp::Text>>, 16>
-      annotations;
-  TraceSpan::Builder span;
-
-  Impl() : span(message.initRoot<TraceSpan>()) {
-    annotations.reserve(16);
-  }
-
-  void emit() {
-    auto sink = trace_sink;
-    if (!sink)
-      return;
-
-    span.setEnd(std::chrono::system_clock::now().time_since_epoch().count());
-
-    auto list = span.initAnnotations(annotations.size());
-    size_t i = 0;
-    for (auto&& [name, value] : annotations) {
-      list[i].adoptName(std::move(name));
-      list[i].adoptValue(std::move(value));
-
-      i += 1;
-    }
-
-    kj::VectorOutputStream stream;
-    capnp::writePackedMessage(stream, message);
-
-    auto data = stream.getArray();
-    fwrite(data.begin(), data.size(), 1, sink->file());
-  }
-};
-
 AutoTraceBlock::AutoTraceBlock() {}
 AutoTraceBlock::AutoTraceBlock(std::string_view name) {
-  if (trace_sink) {
-    impl = std::make_unique<Impl>();
-    build_string(impl->span.initName(name.size()), name);
+  if (!trace_sink.load(std::memory_order_relaxed))
+    return;
 
-    impl->span.setStart(
-        std::chrono::system_clock::now().time_since_epoch().count());
-  }
+  event = thread_state.get_buffer().allocate();
+  event->name = thread_state.intern(name);
+  event->size = 0;
+  event->overflow = nullptr;
+  event->start = now();
 }
 AutoTraceBlock::~AutoTraceBlock() {
-  if (!impl)
-    return;
-
-  impl->emit();
+  close();
 }
 
-AutoTraceBlock::AutoTraceBlock(AutoTraceBlock&& block)
-    : impl(std::move(block.impl)) {}
+AutoTraceBlock::AutoTraceBlock(AutoTraceBlock&& block) : event(block.event) {
+  block.event = nullptr;
+}
 AutoTraceBlock& AutoTraceBlock::operator=(AutoTraceBlock&& block) {
-  impl = std::move(block.impl);
+  if (this != &block) {
+    close();
+    event = block.event;
+    block.event = nullptr;
+  }
   return *this;
 }
 
 bool AutoTraceBlock::is_enabled() const {
-  return impl && trace_sink;
+  return event && trace_sink.load(std::memory_order_relaxed);
 }
 
 void AutoTraceBlock::close() {
-  if (impl)
-    impl->emit();
-  impl = nullptr;
+  if (!event)
+    return;
+
+  ThreadBuffer& buffer = thread_state.get_buffer();
+  if (trace_sink.load(std::memory_order_relaxed)) {
+    event->end = now();
+    buffer.push(*event);
+  } else {
+    delete event->overflow;
+  }
+
+  buffer.release(event);
+  event = nullptr;
 }
 
 void AutoTraceBlock::annotate_detail(std::string_view name,
                                      std::string_view value) {
-  if (!impl)
+  if (!event)
     return;
 
-  auto orphanage = impl->message.getOrphanage();
-
-  if (name.size() > MAX_ANNOTATION_SIZE)
-    name = std::string_view(name.data(), MAX_ANNOTATION_SIZE);
   if (value.size() > MAX_ANNOTATION_SIZE)
     value = std::string_view(value.data(), MAX_ANNOTATION_SIZE);
 
-  auto oname = orphanage.newOrphan<capnp::Text>(name.size());
-  auto ovalue = orphanage.newOrphan<capnp::Text>(value.size());
+  uint32_t key = thread_state.intern(name);
+  size_t needed = ANNOTATION_HEADER_SIZE + value.size();
+
+  if (event->size + needed <= TraceEvent::PAYLOAD_SIZE) {
+    write_annotation(event->payload + event->size, key, value);
+    event->size += needed;
+    return;
+  }
 
-  build_string(oname.get(), name);
-  build_string(ovalue.get(), value);
+  if (!event->overflow)
+    event->overflow = new std::string();
 
-  impl->annotations.emplace_back(std::move(oname), std::move(ovalue));
+  std::string& overflow = *event->overflow;
+  size_t offset = overflow.size();
+  overflow.resize(offset + needed);
+  write_annotation(overflow.data() + offset, key, value);
 }
 
 #endif
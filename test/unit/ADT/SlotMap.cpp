@@ -97,3 +97,23 @@ TEST(slotmap, const_iterate) {
 
   ASSERT_TRUE(success);
 }
+
+TEST(slotmap, find_slot) {
+  slot_map<unsigned> map;
+
+  auto key1 = map.insert(1);
+  auto key2 = map.insert(2);
+
+  auto it = map.find_slot(slot_map<unsigned>::slot(key2));
+  ASSERT_NE(it, map.end());
+  ASSERT_EQ(it.key(), key2);
+  ASSERT_EQ(*it, 2);
+
+  map.remove(key1);
+  ASSERT_EQ(map.find_slot(slot_map<unsigned>::slot(key1)), map.end());
+  ASSERT_EQ(map.find_slot(100), map.end());
+
+  // The slot is reused by the next insert.
+  auto key3 = map.insert(3);
+  ASSERT_EQ(map.find_slot(slot_map<unsigned>::slot(key1)).key(), key3);
+}
@@ -0,0 +1,105 @@
+#include "InputBinding.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Operation.h"
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+class InputBindingTests : public ::testing::Test {
+public:
+  OpRef byte0 = Constant::Create(Type::int_ty(8), "in0");
+  OpRef byte1 = Constant::Create(Type::int_ty(8), "in1");
+  OpRef buffer = FixedArray::Create(Type::int_ty(64), {byte0, byte1});
+};
+
+TEST_F(InputBindingTests, icmp_matching_input) {
+  InputBinding input{"ab"};
+  input.bind(buffer);
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(byte0, 'a')));
+  assertions.insert(Assertion(ICmpOp::CreateICmpULT(byte0, byte1)));
+
+  ASSERT_EQ(input.check_concrete(assertions), std::optional<bool>(true));
+}
+
+TEST_F(InputBindingTests, icmp_diverging_from_input) {
+  InputBinding input{"ab"};
+  input.bind(buffer);
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(byte1, 'a')));
+
+  ASSERT_EQ(input.check_concrete(assertions), std::optional<bool>(false));
+}
+
+TEST_F(InputBindingTests, load_from_symbolic_array) {
+  auto size = ConstantInt::Create(llvm::APInt(64, 2));
+  auto array = ConstantArray::Create(Symbol("input"), size);
+
+  InputBinding input{"ab"};
+  input.bind(array);
+
+  auto load = LoadOp::Create(array, ConstantInt::Create(llvm::APInt(64, 1)));
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(load, 'b')));
+
+  ASSERT_EQ(input.check_concrete(assertions), std::optional<bool>(true));
+}
+
+TEST_F(InputBindingTests, other_symbols_are_not_checked) {
+  InputBinding input{"ab"};
+  input.bind(buffer);
+
+  auto other = Constant::Create(Type::int_ty(8), "other");
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(byte0, other)));
+
+  ASSERT_EQ(input.check_concrete(assertions), std::nullopt);
+}
+
+TEST_F(InputBindingTests, mismatched_size_is_unbound) {
+  InputBinding input{"abc"};
+  input.bind(buffer);
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(byte0, 'a')));
+
+  ASSERT_EQ(input.check_concrete(assertions), std::nullopt);
+}
+
+TEST_F(InputBindingTests, mismatched_array_size_is_unbound) {
+  auto longer = ConstantArray::Create(
+      Symbol("input"), ConstantInt::Create(llvm::APInt(64, 3)));
+  auto symbolic = ConstantArray::Create(
+      Symbol("input"), Constant::Create(Type::int_ty(64), "size"));
+
+  for (const OpRef& array : {longer, symbolic}) {
+    InputBinding input{"ab"};
+    input.bind(array);
+
+    auto load = LoadOp::Create(array, ConstantInt::Create(llvm::APInt(64, 0)));
+    AssertionList assertions;
+    assertions.insert(Assertion(ICmpOp::CreateICmpEQ(load, 'a')));
+
+    ASSERT_EQ(input.check_concrete(assertions), std::nullopt);
+  }
+}
+
+TEST_F(InputBindingTests, repeated_checks) {
+  InputBinding input{"ab"};
+  input.bind(buffer);
+
+  auto matches = Assertion(ICmpOp::CreateICmpEQ(byte0, 'a'));
+  auto diverges = Assertion(ICmpOp::CreateICmpEQ(byte1, 'a'));
+
+  AssertionList first;
+  first.insert(matches);
+  ASSERT_EQ(input.check_concrete(first), std::optional<bool>(true));
+
+  // The first assertion has already been compiled here.
+  AssertionList second = first;
+  second.insert(diverges);
+  ASSERT_EQ(input.check_concrete(second), std::optional<bool>(false));
+  ASSERT_EQ(input.check_concrete(first), std::optional<bool>(true));
+}
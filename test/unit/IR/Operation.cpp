@@ -166,3 +166,18 @@ TEST(OperationTests, float_load_store_simplify_to_noop) {
   ASSERT_EQ((Operation::Opcode)read->opcode(), Operation::ConstantNumbered);
   ASSERT_EQ(value, read) << read;
 }
+
+TEST(OperationTests, depth_and_tree_size_count_shared_operands) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto sum = BinaryOp::CreateAdd(x, x);
+  auto product = BinaryOp::CreateMul(sum, sum);
+
+  ASSERT_EQ(x->depth(), 1);
+  ASSERT_EQ(x->tree_size(), 1u);
+
+  ASSERT_EQ(sum->depth(), 2);
+  ASSERT_EQ(sum->tree_size(), 3u);
+
+  ASSERT_EQ(product->depth(), 3);
+  ASSERT_EQ(product->tree_size(), 7u);
+}
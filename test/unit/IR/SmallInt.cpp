@@ -0,0 +1,92 @@
+#include "caffeine/IR/SmallInt.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Value.h"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+namespace {
+std::vector<llvm::APInt> samples(uint32_t width) {
+  std::mt19937_64 rng{width};
+  std::vector<llvm::APInt> values = {
+      llvm::APInt::getNullValue(width), llvm::APInt(width, 1),
+      llvm::APInt(width, 7), llvm::APInt::getAllOnesValue(width),
+      llvm::APInt::getSignedMinValue(width),
+      llvm::APInt::getSignedMaxValue(width)};
+  for (int i = 0; i < 6; ++i)
+    values.push_back(llvm::APInt(width, rng()));
+  return values;
+}
+} // namespace
+
+TEST(SmallIntTests, matches_value_semantics) {
+  using SmallOp = SmallInt (*)(SmallInt, SmallInt);
+  using ValueOp = Value (*)(const Value&, const Value&);
+  const std::pair<SmallOp, ValueOp> ops[] = {
+      {SmallInt::add, Value::bvadd},    {SmallInt::sub, Value::bvsub},
+      {SmallInt::mul, Value::bvmul},    {SmallInt::udiv, Value::bvudiv},
+      {SmallInt::sdiv, Value::bvsdiv},  {SmallInt::urem, Value::bvurem},
+      {SmallInt::srem, Value::bvsrem},  {SmallInt::bvand, Value::bvand},
+      {SmallInt::bvor, Value::bvor},    {SmallInt::bvxor, Value::bvxor},
+      {SmallInt::shl, Value::bvshl},    {SmallInt::lshr, Value::bvlshr},
+      {SmallInt::ashr, Value::bvashr}};
+
+  for (uint32_t width : {1u, 8u, 17u, 32u, 63u, 64u}) {
+    auto values = samples(width);
+    for (size_t i = 0; i < std::size(ops); ++i) {
+      auto [small_op, value_op] = ops[i];
+      for (const auto& a : values) {
+        for (const auto& b : values) {
+          auto expected = value_op(Value(a), Value(b)).apint();
+          auto actual = small_op(*SmallInt::from(a), *SmallInt::from(b));
+          ASSERT_EQ(actual.apint(), expected)
+              << "op #" << i << " i" << width << " " << a.getZExtValue()
+              << " " << b.getZExtValue();
+        }
+      }
+    }
+  }
+}
+
+TEST(SmallIntTests, casts_and_comparisons) {
+  auto value = SmallInt(0xF0, 8);
+  ASSERT_EQ(SmallInt::sext(value, 16), SmallInt(0xFFF0, 16));
+  ASSERT_EQ(SmallInt::zext(value, 16), SmallInt(0x00F0, 16));
+  ASSERT_EQ(SmallInt::trunc(value, 4), SmallInt(0, 4));
+  ASSERT_EQ(SmallInt::bvnot(value), SmallInt(0x0F, 8));
+
+  auto one = SmallInt(1, 8);
+  ASSERT_TRUE(SmallInt::icmp(ICmpOpcode::UGT, value, one));
+  ASSERT_TRUE(SmallInt::icmp(ICmpOpcode::SLT, value, one));
+  ASSERT_TRUE(SmallInt::icmp(ICmpOpcode::NE, value, one));
+
+  ASSERT_FALSE(SmallInt::from(llvm::APInt(65, 1)).has_value());
+}
+
+TEST(SmallIntTests, constant_folding) {
+  auto i32 = [](uint32_t value) {
+    return ConstantInt::Create(llvm::APInt(32, value));
+  };
+  auto value_of = [](const OpRef& op) {
+    return llvm::cast<ConstantInt>(*op).value();
+  };
+
+  ASSERT_EQ(value_of(BinaryOp::CreateSDiv(i32(0x80000000), i32(-1))),
+            llvm::APInt::getSignedMaxValue(32));
+  ASSERT_EQ(value_of(BinaryOp::CreateUDiv(i32(5), i32(0))),
+            llvm::APInt::getMaxValue(32));
+  ASSERT_EQ(value_of(BinaryOp::CreateShl(i32(1), i32(40))), 0u);
+  ASSERT_EQ(value_of(UnaryOp::CreateSExt(Type::int_ty(64), i32(-2))),
+            llvm::APInt(64, -2, true));
+  ASSERT_EQ(value_of(ICmpOp::CreateICmp(ICmpOpcode::SLT, i32(-2), i32(1))),
+            1u);
+
+  // Wider values still fold through APInt.
+  auto wide = ConstantInt::Create(llvm::APInt::getAllOnesValue(128));
+  auto two = ConstantInt::Create(llvm::APInt(128, 2));
+  auto sum = BinaryOp::CreateAdd(wide, two);
+  ASSERT_EQ(value_of(sum), llvm::APInt(128, 1));
+}
@@ -0,0 +1,93 @@
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Transforms.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+using namespace caffeine::transforms;
+
+namespace {
+OpRef i8(std::string_view name) {
+  return Constant::Create(Type::int_ty(8), std::string(name));
+}
+OpRef i32(std::string_view name) {
+  return Constant::Create(Type::int_ty(32), std::string(name));
+}
+OpRef i32(uint32_t value) {
+  return ConstantInt::Create(llvm::APInt(32, value));
+}
+
+OpRef array() {
+  return AllocOp::Create(i32("size"), ConstantInt::Create(llvm::APInt(8, 0)));
+}
+} // namespace
+
+TEST(ForwardLoadsTests, constant_offsets_fold_on_creation) {
+  auto a = i8("a");
+  auto b = i8("b");
+  auto data = StoreOp::Create(StoreOp::Create(array(), i32(0), a), i32(1), b);
+
+  ASSERT_EQ(LoadOp::Create(data, i32(0)), a);
+  ASSERT_EQ(LoadOp::Create(data, i32(1)), b);
+}
+
+TEST(ForwardLoadsTests, displaced_offsets_fold_on_creation) {
+  auto x = i32("x");
+  auto a = i8("a");
+  auto b = i8("b");
+  auto data = StoreOp::Create(array(), x, a);
+  data = StoreOp::Create(data, BinaryOp::CreateAdd(x, i32(1)), b);
+
+  // x + 1 can never be equal to x so the second store is skipped.
+  ASSERT_EQ(LoadOp::Create(data, x), a);
+}
+
+TEST(ForwardLoadsTests, unrelated_offsets_are_kept) {
+  auto data = StoreOp::Create(array(), i32("x"), i8("a"));
+  auto load = LoadOp::Create(data, i32("y"));
+
+  ASSERT_TRUE(llvm::isa<LoadOp>(load.get()));
+  ASSERT_EQ(llvm::cast<LoadOp>(*load).data(), data);
+}
+
+TEST(ForwardLoadsTests, oracle_resolves_unknown_stores) {
+  auto x = i32("x");
+  auto y = i32("y");
+  auto a = i8("a");
+  auto b = i8("b");
+  auto alloc = array();
+  auto base = StoreOp::Create(alloc, i32("z"), a);
+  auto load = LoadOp::Create(StoreOp::Create(base, x, b), y);
+
+  size_t queries = 0;
+  auto distinct = [&](const OpRef&, const OpRef&) {
+    queries += 1;
+    return LoadOp::Alias::Distinct;
+  };
+  auto equal = [&](const OpRef&, const OpRef&) {
+    queries += 1;
+    return LoadOp::Alias::Equal;
+  };
+
+  auto result = forward_loads(load, distinct, 8);
+  ASSERT_EQ(queries, 2u);
+  // Both stores were skipped so the load reads straight from the allocation.
+  ASSERT_TRUE(llvm::isa<LoadOp>(result.get()));
+  ASSERT_EQ(llvm::cast<LoadOp>(*result).data(), alloc);
+
+  queries = 0;
+  ASSERT_EQ(forward_loads(load, equal, 8), b);
+  ASSERT_EQ(queries, 1u);
+}
+
+TEST(ForwardLoadsTests, oracle_queries_are_bounded) {
+  auto load = LoadOp::Create(StoreOp::Create(array(), i32("x"), i8("a")),
+                             i32("y"));
+
+  auto oracle = [](const OpRef&, const OpRef&) -> LoadOp::Alias {
+    ADD_FAILURE() << "oracle called with no budget";
+    return LoadOp::Alias::Unknown;
+  };
+
+  ASSERT_EQ(forward_loads(load, oracle, 0), load);
+}
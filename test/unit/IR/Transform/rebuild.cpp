@@ -17,4 +17,56 @@ TEST(RebuildTransformTest, unchanged_reuses_expressions) {
   ASSERT_EQ(expression.get(), changed.get());
 }
 
+TEST(RebuildTransformTest, shared_nodes_visited_once) {
+  // Build a chain where each node uses the previous one twice. As a tree this
+  // has 2^64 paths, as a DAG it has 65 nodes.
+  OpRef expression = Constant::Create(Type::type_of<uint32_t>(), "a");
+  for (int i = 0; i < 64; ++i)
+    expression = BinaryOp::CreateMul(expression, expression);
+
+  size_t visits = 0;
+  auto changed = transforms::rebuild(expression, [&](const OpRef& e) {
+    visits += 1;
+    return e;
+  });
+
+  ASSERT_EQ(changed.get(), expression.get());
+  ASSERT_EQ(visits, 65u);
+}
+
+TEST(RebuildTransformTest, substitutes_shared_nodes) {
+  auto a = Constant::Create(Type::type_of<uint32_t>(), "a");
+  auto b = Constant::Create(Type::type_of<uint32_t>(), "b");
+  auto sum = BinaryOp::CreateAdd(a, b);
+  auto expression = BinaryOp::CreateMul(sum, BinaryOp::CreateSub(sum, a));
+
+  auto changed = transforms::rebuild(expression, [&](const OpRef& e) {
+    return e == a ? b : e;
+  });
+
+  auto new_sum = BinaryOp::CreateAdd(b, b);
+  auto expected = BinaryOp::CreateMul(new_sum, BinaryOp::CreateSub(new_sum, b));
+  ASSERT_EQ(*changed, *expected);
+  // Both uses of the rebuilt sum should be the same node.
+  ASSERT_EQ(changed->operand_at(0).get(),
+            changed->operand_at(1)->operand_at(0).get());
+}
+
+TEST(RebuildTransformTest, deep_expressions) {
+  auto a = Constant::Create(Type::type_of<uint32_t>(), "a");
+  auto b = Constant::Create(Type::type_of<uint32_t>(), "b");
+  OpRef expression = a;
+  for (int i = 0; i < 1000; ++i)
+    expression = BinaryOp::CreateAdd(expression, b);
+
+  size_t visits = 0;
+  transforms::rebuild(expression, [&](const OpRef& e) {
+    visits += 1;
+    return e;
+  });
+
+  // a, b, and each of the additions
+  ASSERT_EQ(visits, 1002u);
+}
+
 } // namespace caffeine
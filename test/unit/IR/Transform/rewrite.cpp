@@ -0,0 +1,133 @@
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Rewriter.h"
+#include "caffeine/IR/Transforms.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+using namespace caffeine::transforms;
+
+namespace {
+OpRef i32(std::string_view name) {
+  return Constant::Create(Type::int_ty(32), std::string(name));
+}
+
+OpRef i32(uint32_t value) {
+  return ConstantInt::Create(llvm::APInt(32, value));
+}
+
+// Operation::operator== compares operands by identity and constant integers
+// aren't deduplicated so compare the whole expression instead.
+bool same_expr(const OpRef& a, const OpRef& b) {
+  if (a == b)
+    return true;
+  if (a->num_operands() == 0 || b->num_operands() == 0)
+    return *a == *b;
+  if (a->opcode() != b->opcode() || a->type() != b->type() ||
+      a->num_operands() != b->num_operands())
+    return false;
+
+  for (size_t i = 0; i < a->num_operands(); ++i) {
+    if (!same_expr(a->operand_at(i), b->operand_at(i)))
+      return false;
+  }
+  return true;
+}
+} // namespace
+
+TEST(RewriteTransformTests, bytes_reassemble_to_value) {
+  // This is what writing a 32-bit value to memory and then reading it back
+  // looks like once the loads have been resolved.
+  auto value = i32("x");
+  OpRef result = nullptr;
+  for (uint32_t i = 0; i < 4; ++i) {
+    auto byte = UnaryOp::CreateTrunc(Type::int_ty(8),
+                                     BinaryOp::CreateLShr(value, i * 8));
+    auto extended = BinaryOp::CreateShl(
+        UnaryOp::CreateZExt(Type::int_ty(32), byte), (uint64_t)i * 8);
+    result = result ? BinaryOp::CreateOr(result, extended) : extended;
+  }
+
+  Rewriter rewriter;
+  ASSERT_EQ(rewriter.rewrite(result), value);
+}
+
+TEST(RewriteTransformTests, partial_bytes_become_mask) {
+  auto value = i32("x");
+  auto low = BinaryOp::CreateAnd(value, 0xFF);
+  auto high = BinaryOp::CreateShl(
+      BinaryOp::CreateAnd(BinaryOp::CreateLShr(value, 8), 0xFF), 8);
+
+  Rewriter rewriter;
+  auto expected = BinaryOp::CreateAnd(value, 0xFFFF);
+  ASSERT_TRUE(same_expr(rewriter.rewrite(BinaryOp::CreateOr(low, high)),
+                        expected));
+}
+
+TEST(RewriteTransformTests, load_skips_distinct_stores) {
+  auto array = ConstantArray::Create(Symbol("arr"), i32(16));
+  auto offset = i32("off");
+  auto a = Constant::Create(Type::int_ty(8), "a");
+  auto b = Constant::Create(Type::int_ty(8), "b");
+
+  auto stored = StoreOp::Create(StoreOp::Create(array, offset, a),
+                                BinaryOp::CreateAdd(offset, 1), b);
+
+  Rewriter rewriter;
+  ASSERT_EQ(rewriter.rewrite(LoadOp::Create(stored, offset)), a);
+  ASSERT_EQ(rewriter.rewrite(
+                LoadOp::Create(stored, BinaryOp::CreateAdd(offset, 1))),
+            b);
+
+  auto other = BinaryOp::CreateAdd(offset, 2);
+  ASSERT_TRUE(same_expr(rewriter.rewrite(LoadOp::Create(stored, other)),
+                        LoadOp::Create(array, other)));
+}
+
+TEST(RewriteTransformTests, comparisons) {
+  auto x = i32("x");
+  auto byte = Constant::Create(Type::int_ty(8), "b");
+  Rewriter rewriter;
+
+  // Constants end up on the right.
+  ASSERT_TRUE(same_expr(rewriter.rewrite(ICmpOp::CreateICmpULT(i32(5), x)),
+                        ICmpOp::CreateICmpUGT(x, i32(5))));
+
+  // Constant offsets move to the other side.
+  ASSERT_TRUE(same_expr(rewriter.rewrite(ICmpOp::CreateICmpEQ(
+                            BinaryOp::CreateAdd(x, i32(5)), i32(7))),
+                        ICmpOp::CreateICmpEQ(x, i32(2))));
+
+  // A zero-extended byte can never be 300.
+  auto extended = UnaryOp::CreateZExt(Type::int_ty(32), byte);
+  auto never = ICmpOp::CreateICmpEQ(extended, i32(300));
+  ASSERT_TRUE(Assertion(rewriter.rewrite(never)).is_constant_value(false));
+
+  auto negated = UnaryOp::CreateNot(ICmpOp::CreateICmpULT(x, i32(4)));
+  ASSERT_TRUE(same_expr(rewriter.rewrite(negated),
+                        ICmpOp::CreateICmpUGE(x, i32(4))));
+}
+
+TEST(RewriteTransformTests, casts) {
+  auto byte = Constant::Create(Type::int_ty(8), "b");
+  auto extended = UnaryOp::CreateZExt(Type::int_ty(64), byte);
+
+  Rewriter rewriter;
+  ASSERT_EQ(rewriter.rewrite(UnaryOp::CreateTrunc(Type::int_ty(8), extended)),
+            byte);
+  ASSERT_TRUE(same_expr(
+      rewriter.rewrite(UnaryOp::CreateTrunc(Type::int_ty(16), extended)),
+      UnaryOp::CreateZExt(Type::int_ty(16), byte)));
+}
+
+TEST(RewriteTransformTests, assertion_list) {
+  auto x = i32("x");
+  AssertionList assertions = {
+      Assertion(ICmpOp::CreateICmpEQ(BinaryOp::CreateAdd(x, i32(1)), i32(2)))};
+
+  rewrite(assertions);
+
+  ASSERT_EQ(assertions.size(), 1);
+  ASSERT_TRUE(same_expr(assertions.unproven().begin()->value(),
+                        ICmpOp::CreateICmpEQ(x, i32(1))));
+}
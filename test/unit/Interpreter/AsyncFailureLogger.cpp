@@ -0,0 +1,61 @@
+#include "caffeine/Interpreter/AsyncFailureLogger.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Value.h"
+#include "caffeine/Interpreter/Context.h"
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+TEST(AsyncFailureLoggerTests, ktest_layout) {
+  FailureInputs inputs;
+  inputs.emplace_back("x", Value(llvm::APInt(16, 0x0102)));
+
+  std::stringstream ss;
+  write_ktest(ss, inputs);
+
+  // clang-format off
+  const char expected[] = {
+    'K', 'T', 'E', 'S', 'T',
+    0, 0, 0, 3, // version
+    0, 0, 0, 0, // args
+    0, 0, 0, 0, // sym argvs
+    0, 0, 0, 0, // sym argv len
+    0, 0, 0, 1, // objects
+    0, 0, 0, 1, 'x',
+    0, 0, 0, 2, 0x02, 0x01
+  };
+  // clang-format on
+
+  ASSERT_EQ(ss.str(), std::string(expected, sizeof(expected)));
+}
+
+TEST(AsyncFailureLoggerTests, deduplicates_failures) {
+  llvm::LLVMContext llvm;
+  std::unique_ptr<llvm::Function> function{llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(llvm), false),
+      llvm::GlobalValue::LinkageTypes::PrivateLinkage, 0)};
+  llvm::BasicBlock::Create(llvm, "entry", function.get());
+
+  std::stringstream report;
+  AsyncFailureLogger::Options options;
+  options.num_threads = 2;
+  options.max_pending = 2;
+  AsyncFailureLogger logger{report, options};
+
+  Context ctx{function.get()};
+  for (int i = 0; i < 10; ++i)
+    logger.log_failure(nullptr, ctx, Failure(Assertion(), "first"));
+  logger.log_failure(nullptr, ctx, Failure(Assertion(), "second"));
+  logger.finish();
+
+  ASSERT_EQ(logger.num_failures(), 11u);
+  ASSERT_EQ(logger.num_unique(), 2u);
+  ASSERT_NE(report.str().find("11 failures, 2 distinct"), std::string::npos);
+}
@@ -0,0 +1,68 @@
+#include "caffeine/Interpreter/Budget.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+TEST(ExecutionBudgetTests, instruction_limit) {
+  ExecutionLimits limits;
+  limits.instructions = 100;
+  ExecutionBudget budget{limits};
+
+  budget.charge_instructions(99);
+  ASSERT_FALSE(budget.exhausted());
+  budget.charge_instructions(1);
+  ASSERT_TRUE(budget.exhausted());
+  ASSERT_EQ(budget.reason(), ExecutionBudget::InstructionLimit);
+}
+
+TEST(ExecutionBudgetTests, path_limit) {
+  ExecutionLimits limits;
+  limits.paths = 2;
+  ExecutionBudget budget{limits};
+
+  ASSERT_TRUE(budget.charge_path());
+  ASSERT_TRUE(budget.charge_path());
+  ASSERT_FALSE(budget.exhausted());
+  ASSERT_FALSE(budget.charge_path());
+  ASSERT_EQ(budget.reason(), ExecutionBudget::PathLimit);
+}
+
+TEST(ExecutionBudgetTests, first_reason_wins) {
+  CancellationToken external;
+  ExecutionLimits limits;
+  limits.solver_time = std::chrono::milliseconds(1);
+  ExecutionBudget budget{limits, &external};
+
+  budget.charge_solver_time(std::chrono::milliseconds(2));
+  external.cancel();
+
+  ASSERT_TRUE(budget.exhausted());
+  ASSERT_EQ(budget.reason(), ExecutionBudget::SolverTimeLimit);
+}
+
+TEST(ExecutionBudgetTests, external_cancel) {
+  CancellationToken external;
+  ExecutionBudget budget{ExecutionLimits()};
+  ExecutionBudget linked{ExecutionLimits(), &external};
+
+  external.cancel();
+  ASSERT_FALSE(budget.exhausted());
+  ASSERT_TRUE(linked.exhausted());
+  ASSERT_EQ(linked.reason(), ExecutionBudget::Cancelled);
+}
+
+TEST(ExecutionBudgetTests, time_limit) {
+  ExecutionLimits limits;
+  limits.time = std::chrono::milliseconds(10);
+  ExecutionBudget budget{limits};
+
+  budget.start();
+  for (int i = 0; i < 1000 && !budget.exhausted(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  ASSERT_TRUE(budget.exhausted());
+  ASSERT_EQ(budget.reason(), ExecutionBudget::TimeLimit);
+}
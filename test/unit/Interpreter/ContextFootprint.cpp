@@ -0,0 +1,114 @@
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/Context.h"
+#include "caffeine/Memory/MemHeap.h"
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace caffeine;
+
+class ContextFootprintTests : public ::testing::Test {
+protected:
+  llvm::LLVMContext llvm;
+  std::unique_ptr<llvm::Function> function;
+
+  void SetUp() override {
+    function.reset(llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(llvm), false),
+        llvm::GlobalValue::LinkageTypes::PrivateLinkage, 0));
+    llvm::BasicBlock::Create(llvm, "entry", function.get());
+  }
+
+  // Add an assertion to the context that isn't shared with anything else.
+  void add_assertion(Context& ctx) {
+    auto x = Constant::Create(Type::int_ty(32), ctx.next_constant());
+    auto y = Constant::Create(Type::int_ty(32), ctx.next_constant());
+    ctx.add(Assertion(ICmpOp::CreateICmpSLT(BinaryOp::CreateAdd(x, y), 10)));
+  }
+};
+
+TEST_F(ContextFootprintTests, unique_until_forked) {
+  Context ctx{function.get()};
+  add_assertion(ctx);
+
+  auto before = ctx.estimate_footprint();
+  ASSERT_GT(before.unique_exprs, 0u);
+  ASSERT_EQ(before.shared_exprs, 0u);
+  ASSERT_GT(before.stack, 0u);
+  ASSERT_GT(before.assertions, 0u);
+
+  Context fork = ctx.fork_once();
+
+  auto after = ctx.estimate_footprint();
+  ASSERT_EQ(after.unique_exprs, 0u);
+  ASSERT_EQ(after.shared_exprs, before.unique_exprs);
+  ASSERT_EQ(after.num_exprs, before.num_exprs);
+  ASSERT_EQ(after.total(), before.total());
+}
+
+TEST_F(ContextFootprintTests, new_expressions_are_unique) {
+  Context ctx{function.get()};
+  add_assertion(ctx);
+  Context fork = ctx.fork_once();
+
+  auto shared = fork.estimate_footprint();
+  add_assertion(fork);
+  auto grown = fork.estimate_footprint();
+
+  ASSERT_GT(grown.unique_exprs, 0u);
+  ASSERT_EQ(grown.shared_exprs, shared.shared_exprs);
+  ASSERT_EQ(ctx.estimate_footprint().unique_exprs, 0u);
+}
+
+TEST_F(ContextFootprintTests, counts_nodes_once) {
+  Context ctx{function.get()};
+  auto x = Constant::Create(Type::int_ty(32), ctx.next_constant());
+  auto y = Constant::Create(Type::int_ty(32), ctx.next_constant());
+  auto sum = BinaryOp::CreateAdd(x, y);
+  ctx.add(Assertion(ICmpOp::CreateICmpSLT(sum, x)));
+  ctx.add(Assertion(ICmpOp::CreateICmpULT(y, sum)));
+
+  auto footprint = ctx.estimate_footprint();
+  // x, y, x + y, and the two comparisons
+  ASSERT_EQ(footprint.num_exprs, 5u);
+  // The test still holds references to x, y, and the sum.
+  ASSERT_GT(footprint.shared_exprs, 0u);
+  ASSERT_GT(footprint.unique_exprs, 0u);
+}
+
+TEST_F(ContextFootprintTests, counts_fixed_array_elements) {
+  const size_t num_bytes = 64;
+  auto size = ConstantInt::Create(llvm::APInt(64, num_bytes));
+  auto align = ConstantInt::Create(llvm::APInt(64, 16));
+
+  auto footprint_with = [&](auto make_data) {
+    Context ctx{function.get()};
+    ctx.heaps[0].allocate(size, align, make_data(ctx), AllocationKind::Malloc,
+                          AllocationPermissions::ReadWrite, ctx);
+    return ctx.estimate_footprint();
+  };
+
+  auto uniform = footprint_with([&](Context&) {
+    return AllocOp::Create(size, ConstantInt::Create(llvm::APInt(8, 0)));
+  });
+  // Every byte of the allocation is a distinct symbol that is only
+  // referenced from within the array.
+  auto symbolic = footprint_with([&](Context& ctx) {
+    std::vector<OpRef> bytes;
+    for (size_t i = 0; i < num_bytes; ++i)
+      bytes.push_back(Constant::Create(Type::int_ty(8), ctx.next_constant()));
+    return FixedArray::Create(Type::int_ty(64),
+                              PersistentArray<OpRef>(std::move(bytes)));
+  });
+
+  ASSERT_GE(symbolic.num_exprs, uniform.num_exprs + num_bytes - 1);
+  ASSERT_GE(symbolic.unique_exprs,
+            uniform.unique_exprs +
+                num_bytes * (sizeof(Operation) + sizeof(OpRef)));
+}
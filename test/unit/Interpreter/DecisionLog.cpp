@@ -0,0 +1,259 @@
+#include "caffeine/Interpreter/DecisionLog.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/Executor.h"
+#include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Interpreter/Store.h"
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace caffeine;
+
+namespace {
+  DecisionLog make_log(std::initializer_list<uint32_t> decisions) {
+    DecisionLog log;
+    for (uint32_t decision : decisions)
+      log.push_back(decision);
+    return log;
+  }
+
+  class NullFailureLogger : public FailureLogger {
+  public:
+    void log_failure(const Model*, const Context&, const Failure&) override {}
+  };
+
+  class CountingFailureLogger : public FailureLogger {
+  public:
+    void log_failure(const Model*, const Context&, const Failure&) override {
+      count += 1;
+    }
+
+    std::atomic<uint64_t> count = 0;
+  };
+
+  // Records every context that is added to the store.
+  class RecordingStore : public QueueingContextStore {
+  public:
+    struct Entry {
+      DecisionLog decisions;
+      const llvm::BasicBlock* block;
+    };
+
+    RecordingStore() : QueueingContextStore(1) {}
+
+    void add_context(Context&& ctx) override {
+      record(ctx);
+      QueueingContextStore::add_context(std::move(ctx));
+    }
+    void add_context_multi(Span<Context> contexts) override {
+      for (const Context& ctx : contexts)
+        record(ctx);
+      QueueingContextStore::add_context_multi(contexts);
+    }
+
+    std::vector<Entry> entries;
+
+  private:
+    void record(const Context& ctx) {
+      auto lock = std::unique_lock(mutex);
+      entries.push_back({ctx.decisions, ctx.stack_top().current_block});
+    }
+
+    std::mutex mutex;
+  };
+} // namespace
+
+TEST(DecisionLogTests, serialize_round_trip) {
+  auto first = make_log({0, 1, 300, UINT32_MAX});
+  auto second = make_log({});
+  second.requeued();
+
+  std::string encoded;
+  first.serialize(encoded);
+  second.serialize(encoded);
+
+  std::string_view in = encoded;
+  ASSERT_EQ(DecisionLog::deserialize(in), first);
+  ASSERT_EQ(DecisionLog::deserialize(in), second);
+  ASSERT_TRUE(in.empty());
+
+  // Truncated logs are rejected.
+  std::string_view truncated = std::string_view(encoded).substr(0, 4);
+  ASSERT_EQ(DecisionLog::deserialize(truncated), std::nullopt);
+}
+
+TEST(DecisionLogTests, agrees_with) {
+  auto log = make_log({0, 1, 2});
+
+  ASSERT_TRUE(log.agrees_with(make_log({0, 1})));
+  ASSERT_TRUE(log.agrees_with(make_log({0, 1, 2, 3})));
+  ASSERT_FALSE(log.agrees_with(make_log({0, 0, 2})));
+  ASSERT_TRUE(log.agrees_with(make_log({1, 1, 2}), 1));
+
+  auto requeued = log;
+  requeued.requeued();
+  ASSERT_TRUE(log.agrees_with(requeued));
+  ASSERT_NE(log, requeued);
+
+  requeued.push_back(0);
+  ASSERT_EQ(requeued.requeues(), 0u);
+}
+
+class ReplayTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module;
+
+  void SetUp() override {
+    llvm::SMDiagnostic error;
+    module = llvm::parseIRFile("Interpreter/decision-log.ll", error, context);
+
+    if (!module)
+      error.print("unittest", llvm::errs());
+
+    ASSERT_NE(module, nullptr);
+  }
+
+  Context entry() {
+    auto x = Constant::Create(Type::int_ty(32), "x");
+    return Context(module->getFunction("tree"), {x});
+  }
+};
+
+TEST_F(ReplayTests, replay_rebuilds_every_path) {
+  RecordingStore store;
+  AlwaysAllowExecutionPolicy policy;
+  NullFailureLogger logger;
+
+  ExecutorOptions options;
+  options.num_threads = 1;
+
+  Executor executor{&policy, &store, &logger, options};
+  store.add_context(entry());
+  executor.run();
+
+  // The entry context plus the branch, switch and load forks.
+  ASSERT_GT(store.entries.size(), 10u);
+
+  std::set<std::string> seen;
+  for (const auto& recorded : store.entries) {
+    std::string encoded;
+    recorded.decisions.serialize(encoded);
+    ASSERT_TRUE(seen.insert(encoded).second)
+        << "two contexts in the store have the same decisions";
+
+    auto ctx = executor.replay(entry(), recorded.decisions);
+    ASSERT_TRUE(ctx.has_value());
+    ASSERT_EQ(ctx->decisions, recorded.decisions);
+    ASSERT_EQ(ctx->stack_top().current_block, recorded.block);
+  }
+}
+
+TEST_F(ReplayTests, replaying_store_finds_the_same_failures) {
+  auto count_failures = [&](ExecutionContextStore& store,
+                            Executor*& executor) {
+    AlwaysAllowExecutionPolicy policy;
+    CountingFailureLogger logger;
+
+    ExecutorOptions options;
+    options.num_threads = 1;
+
+    Executor exec{&policy, &store, &logger, options};
+    executor = &exec;
+    store.add_context(entry());
+    exec.run();
+    return logger.count.load();
+  };
+
+  Executor* executor = nullptr;
+  auto replay = [&](const DecisionLog& decisions) {
+    return executor->replay(entry(), decisions);
+  };
+
+  QueueingContextStore queueing{1};
+  // Keep a single context in memory so that most paths have to be rebuilt.
+  ReplayingContextStore replaying{1, 1, replay};
+
+  uint64_t expected = count_failures(queueing, executor);
+  ASSERT_NE(expected, 0u);
+  ASSERT_EQ(count_failures(replaying, executor), expected);
+}
+
+TEST_F(ReplayTests, replaying_store_counts_unexplored_paths) {
+  auto count_unexplored = [&](ExecutionContextStore& store,
+                              Executor*& executor) {
+    AlwaysAllowExecutionPolicy policy;
+    NullFailureLogger logger;
+
+    ExecutorOptions options;
+    options.num_threads = 1;
+    options.limits.paths = 3;
+
+    Executor exec{&policy, &store, &logger, options};
+    executor = &exec;
+    store.add_context(entry());
+    return exec.run().unexplored;
+  };
+
+  Executor* executor = nullptr;
+  auto replay = [&](const DecisionLog& decisions) {
+    return executor->replay(entry(), decisions);
+  };
+
+  QueueingContextStore queueing{1};
+  ReplayingContextStore replaying{1, 1, replay};
+
+  // Paths that are still evicted once the budget runs out must not be
+  // replayed, but they still count as unexplored.
+  uint64_t expected = count_unexplored(queueing, executor);
+  ASSERT_NE(expected, 0u);
+  ASSERT_EQ(count_unexplored(replaying, executor), expected);
+}
+
+TEST_F(ReplayTests, replay_follows_malloc_null_fork) {
+  RecordingStore store;
+  AlwaysAllowExecutionPolicy policy;
+  NullFailureLogger logger;
+
+  ExecutorOptions options;
+  options.num_threads = 1;
+  options.interpreter.malloc_can_return_null = true;
+
+  auto allocate = [&] {
+    auto size = Constant::Create(Type::int_ty(64), "size");
+    return Context(module->getFunction("allocate"), {size});
+  };
+
+  Executor executor{&policy, &store, &logger, options};
+  store.add_context(allocate());
+  executor.run();
+
+  // The entry context, the null path and the branch forks below both the
+  // null and the allocated paths.
+  ASSERT_EQ(store.entries.size(), 6u);
+
+  for (const auto& recorded : store.entries) {
+    auto ctx = executor.replay(allocate(), recorded.decisions);
+    ASSERT_TRUE(ctx.has_value());
+    ASSERT_EQ(ctx->decisions, recorded.decisions);
+    ASSERT_EQ(ctx->stack_top().current_block, recorded.block);
+  }
+}
+
+TEST_F(ReplayTests, diverging_log_is_rejected) {
+  AlwaysAllowExecutionPolicy policy;
+  NullFailureLogger logger;
+  QueueingContextStore store{1};
+
+  Executor executor{&policy, &store, &logger};
+  // The branch only has two successors.
+  ASSERT_EQ(executor.replay(entry(), make_log({2})), std::nullopt);
+}
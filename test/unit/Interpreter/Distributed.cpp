@@ -0,0 +1,158 @@
+#include "caffeine/Interpreter/Distributed.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/Executor.h"
+#include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Interpreter/Store.h"
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include <atomic>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace caffeine;
+
+namespace {
+  class CountingFailureLogger : public FailureLogger {
+  public:
+    void log_failure(const Model*, const Context&, const Failure&) override {
+      count += 1;
+    }
+
+    std::atomic<uint64_t> count = 0;
+  };
+} // namespace
+
+class DistributedTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module;
+
+  void SetUp() override {
+    llvm::SMDiagnostic error;
+    module = llvm::parseIRFile("Interpreter/decision-log.ll", error, context);
+
+    if (!module)
+      error.print("unittest", llvm::errs());
+
+    ASSERT_NE(module, nullptr);
+  }
+
+  Context entry() {
+    auto x = Constant::Create(Type::int_ty(32), "x");
+    return Context(module->getFunction("tree"), {x});
+  }
+
+  uint64_t count_failures() {
+    QueueingContextStore store{1};
+    AlwaysAllowExecutionPolicy policy;
+    CountingFailureLogger logger;
+
+    ExecutorOptions options;
+    options.num_threads = 1;
+
+    Executor executor{&policy, &store, &logger, options};
+    store.add_context(entry());
+    executor.run();
+
+    return logger.count;
+  }
+};
+
+TEST_F(DistributedTests, workers_find_every_failure) {
+  const size_t num_workers = 3;
+
+  std::stringstream report;
+  DistributedCoordinator coordinator{report};
+  AlwaysAllowExecutionPolicy policy;
+
+  ExecutorOptions options;
+  options.num_threads = 1;
+
+  std::vector<std::unique_ptr<DistributedWorker>> workers;
+  for (size_t i = 0; i < num_workers; ++i) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    coordinator.add_worker(fds[0]);
+    workers.push_back(std::make_unique<DistributedWorker>(
+        fds[1], &policy, options, [&] { return entry(); }));
+  }
+
+  std::vector<std::thread> threads;
+  std::atomic<size_t> clean_exits = 0;
+  for (auto& worker : workers) {
+    threads.emplace_back([&, worker = worker.get()] {
+      if (worker->run())
+        clean_exits += 1;
+    });
+  }
+
+  auto summary = coordinator.run();
+  for (auto& thread : threads)
+    thread.join();
+
+  ASSERT_EQ(clean_exits, num_workers);
+  ASSERT_TRUE(summary.complete());
+  ASSERT_EQ(summary.lost_workers, 0u);
+  ASSERT_EQ(summary.unique_failures, 1u);
+  ASSERT_EQ(summary.failures, count_failures());
+}
+
+TEST_F(DistributedTests, worker_processes_find_every_failure) {
+  const size_t num_workers = 2;
+  uint64_t expected = count_failures();
+
+  std::stringstream report;
+  DistributedCoordinator coordinator{report};
+
+  ExecutorOptions options;
+  options.num_threads = 1;
+
+  std::vector<int> coordinator_fds;
+  std::vector<pid_t> children;
+  for (size_t i = 0; i < num_workers; ++i) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+
+    if (pid == 0) {
+      for (int fd : coordinator_fds)
+        close(fd);
+      close(fds[0]);
+
+      AlwaysAllowExecutionPolicy policy;
+      DistributedWorker worker{fds[1], &policy, options,
+                               [&] { return entry(); }};
+      _exit(worker.run() ? 0 : 1);
+    }
+
+    close(fds[1]);
+    coordinator_fds.push_back(fds[0]);
+    coordinator.add_worker(fds[0]);
+    children.push_back(pid);
+  }
+
+  auto summary = coordinator.run();
+
+  for (pid_t pid : children) {
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+  }
+
+  ASSERT_TRUE(summary.complete());
+  ASSERT_EQ(summary.lost_workers, 0u);
+  ASSERT_EQ(summary.unique_failures, 1u);
+  ASSERT_EQ(summary.failures, expected);
+}
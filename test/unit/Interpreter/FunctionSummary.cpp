@@ -0,0 +1,66 @@
+#include "caffeine/Interpreter/FunctionSummary.h"
+#include "caffeine/IR/Operation.h"
+#include <gtest/gtest.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+
+using namespace caffeine;
+
+class FunctionSummaryTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module;
+
+public:
+  void SetUp() override {
+    llvm::SMDiagnostic error;
+    module = llvm::parseIRFile("Interpreter/function-summary.ll", error,
+                               context);
+
+    if (!module)
+      error.print("unittest", llvm::errs());
+
+    ASSERT_NE(module, nullptr);
+  }
+};
+
+TEST_F(FunctionSummaryTests, straight_line_function) {
+  auto summary = FunctionSummary::Create(module->getFunction("fnv"));
+  ASSERT_TRUE(summary.has_value());
+
+  auto x = Constant::Create(Type::int_ty(64), "x");
+  auto expected = BinaryOp::CreateMul(
+      BinaryOp::CreateXor(x, ConstantInt::Create(llvm::APInt(
+                                 64, UINT64_C(14695981039346656037)))),
+      ConstantInt::Create(llvm::APInt(64, UINT64_C(1099511628211))));
+
+  ASSERT_EQ(*summary->apply({x}), *expected);
+}
+
+TEST_F(FunctionSummaryTests, branches_are_merged) {
+  auto summary = FunctionSummary::Create(module->getFunction("abs"));
+  ASSERT_TRUE(summary.has_value());
+
+  auto result = summary->apply({ConstantInt::Create(llvm::APInt(32, -5, true))});
+  auto cnst = llvm::dyn_cast<ConstantInt>(result.get());
+
+  ASSERT_NE(cnst, nullptr);
+  ASSERT_EQ(cnst->value().getLimitedValue(), 5u);
+}
+
+TEST_F(FunctionSummaryTests, rejects_unsupported_functions) {
+  EXPECT_FALSE(FunctionSummary::Create(module->getFunction("divide")));
+  EXPECT_FALSE(FunctionSummary::Create(module->getFunction("count")));
+  EXPECT_FALSE(FunctionSummary::Create(module->getFunction("load")));
+}
+
+TEST_F(FunctionSummaryTests, cache_returns_same_summary) {
+  FunctionSummaryCache cache;
+  auto func = module->getFunction("fnv");
+
+  auto first = cache.lookup(func);
+  ASSERT_NE(first, nullptr);
+  ASSERT_EQ(first, cache.lookup(func));
+  ASSERT_EQ(cache.lookup(module->getFunction("load")), nullptr);
+}
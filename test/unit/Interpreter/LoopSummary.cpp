@@ -0,0 +1,118 @@
+#include "caffeine/Interpreter/LoopSummary.h"
+#include "caffeine/IR/Transforms.h"
+#include "caffeine/Interpreter/Context.h"
+#include <gtest/gtest.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+
+using namespace caffeine;
+
+class LoopSummaryTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module;
+
+public:
+  void SetUp() override {
+    llvm::SMDiagnostic error;
+    module = llvm::parseIRFile("Interpreter/loop-summary.ll", error, context);
+
+    if (!module)
+      error.print("unittest", llvm::errs());
+
+    ASSERT_NE(module, nullptr);
+  }
+
+  static llvm::BasicBlock* block(llvm::Function* func, llvm::StringRef name) {
+    for (llvm::BasicBlock& block : *func) {
+      if (block.getName() == name)
+        return &block;
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(LoopSummaryTests, summarizes_counting_loop) {
+  LoopSummaryCache cache;
+  auto func = module->getFunction("count");
+
+  auto summary = cache.lookup(block(func, "loop"));
+  ASSERT_NE(summary, nullptr);
+  ASSERT_EQ(summary->exit(), block(func, "exit"));
+
+  Context ctx{func, {ConstantInt::Create(llvm::APInt(32, 10))}};
+  summary->apply(ctx);
+
+  ASSERT_EQ(ctx.stack_top().current_block, block(func, "exit"));
+
+  auto& next = *std::next(block(func, "loop")->begin());
+  auto expr = ctx.lookup(&next).scalar().expr();
+  auto value = llvm::dyn_cast<ConstantInt>(expr.get());
+  ASSERT_NE(value, nullptr);
+  ASSERT_EQ(value->value().getLimitedValue(), 10u);
+}
+
+TEST_F(LoopSummaryTests, summarizes_loop_with_symbolic_trip_count) {
+  LoopSummaryCache cache;
+  auto func = module->getFunction("count");
+
+  auto summary = cache.lookup(block(func, "loop"));
+  ASSERT_NE(summary, nullptr);
+
+  auto n = Constant::Create(Type::int_ty(32), "n");
+  Context ctx{func, {n}};
+  summary->apply(ctx);
+
+  ASSERT_EQ(ctx.stack_top().current_block, block(func, "exit"));
+
+  auto& next = *std::next(block(func, "loop")->begin());
+  auto expr = ctx.lookup(&next).scalar().expr();
+  ASSERT_FALSE(llvm::isa<ConstantInt>(expr.get()));
+
+  auto eval = [&](uint64_t value) -> uint64_t {
+    auto result = transforms::rebuild(expr, [&](const OpRef& op) {
+      if (*op == *n)
+        return ConstantInt::Create(llvm::APInt(32, value));
+      return op;
+    });
+
+    auto folded = llvm::dyn_cast<ConstantInt>(result.get());
+    EXPECT_NE(folded, nullptr);
+    return folded ? folded->value().getLimitedValue() : ~0ull;
+  };
+
+  ASSERT_EQ(eval(7), 7u);
+  // The loop body always runs at least once.
+  ASSERT_EQ(eval(0), 1u);
+  ASSERT_EQ(eval(1), 1u);
+}
+
+TEST_F(LoopSummaryTests, only_precomputed_summaries_when_not_lazy) {
+  auto func = module->getFunction("count");
+
+  LoopSummaryCache lazy;
+  lazy.set_lazy(false);
+  ASSERT_EQ(lazy.lookup(block(func, "loop")), nullptr);
+
+  LoopSummaryCache precomputed;
+  precomputed.analyze(*module);
+  precomputed.set_lazy(false);
+  ASSERT_NE(precomputed.lookup(block(func, "loop")), nullptr);
+  ASSERT_EQ(precomputed.lookup(block(module->getFunction("fill"), "loop")),
+            nullptr);
+}
+
+TEST_F(LoopSummaryTests, rejects_loop_with_stores) {
+  LoopSummaryCache cache;
+  auto func = module->getFunction("fill");
+
+  ASSERT_EQ(cache.lookup(block(func, "loop")), nullptr);
+}
+
+TEST_F(LoopSummaryTests, non_header_has_no_summary) {
+  LoopSummaryCache cache;
+  auto func = module->getFunction("count");
+
+  ASSERT_EQ(cache.lookup(block(func, "exit")), nullptr);
+}
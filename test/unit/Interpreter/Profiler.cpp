@@ -0,0 +1,176 @@
+#include "caffeine/Interpreter/Profiler.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/Executor.h"
+#include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Interpreter/Store.h"
+
+#include <gtest/gtest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include <sstream>
+#include <thread>
+
+using namespace caffeine;
+
+namespace {
+  class UnsatSolver : public Solver {
+  public:
+    SolverResult resolve(AssertionList&, const Assertion&) override {
+      return SolverResult::UNSAT;
+    }
+  };
+
+  class NullFailureLogger : public FailureLogger {
+  public:
+    void log_failure(const Model*, const Context&, const Failure&) override {}
+  };
+} // namespace
+
+class ProfilerTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module;
+  llvm::Instruction* add = nullptr;
+  llvm::Instruction* ret = nullptr;
+
+  void SetUp() override {
+    llvm::SMDiagnostic error;
+    module = llvm::parseAssemblyString(R"(
+      define i32 @func(i32 %x) {
+        %y = add i32 %x, 1
+        ret i32 %y
+      }
+    )",
+                                       error, context);
+    ASSERT_NE(module, nullptr);
+
+    auto& block = module->getFunction("func")->getEntryBlock();
+    add = &block.front();
+    ret = &block.back();
+  }
+
+  InstructionProfiler::Counters counters_for(const InstructionProfiler& prof,
+                                             const llvm::Instruction* inst) {
+    for (const auto& [key, counters] : prof.merged()) {
+      if (key == inst)
+        return counters;
+    }
+    return {};
+  }
+};
+
+TEST_F(ProfilerTests, solver_calls_go_to_innermost_scope) {
+  InstructionProfiler profiler;
+  auto solver = profiler.wrap(std::make_shared<UnsatSolver>());
+  AssertionList assertions;
+
+  {
+    InstructionProfiler::Scope outer{&profiler, add};
+    solver->check(assertions, Assertion());
+
+    {
+      InstructionProfiler::Scope inner{&profiler, ret};
+      inner.add_forks(2);
+      solver->check(assertions, Assertion());
+      solver->check(assertions, Assertion());
+    }
+  }
+
+  auto outer = counters_for(profiler, add);
+  auto inner = counters_for(profiler, ret);
+
+  ASSERT_EQ(outer.executions, 1);
+  ASSERT_EQ(outer.solver_calls, 1);
+  ASSERT_EQ(outer.forks, 0);
+  ASSERT_EQ(inner.executions, 1);
+  ASSERT_EQ(inner.solver_calls, 2);
+  ASSERT_EQ(inner.forks, 2);
+
+  // Calls made outside of any scope aren't attributed anywhere.
+  solver->check(assertions, Assertion());
+  ASSERT_EQ(counters_for(profiler, add).solver_calls, 1);
+}
+
+TEST_F(ProfilerTests, counts_nodes_created) {
+  InstructionProfiler profiler;
+
+  {
+    InstructionProfiler::Scope scope{&profiler, add};
+    BinaryOp::CreateAdd(Constant::Create(Type::int_ty(32), "profiler-x"),
+                        Constant::Create(Type::int_ty(32), "profiler-y"));
+  }
+
+  ASSERT_EQ(counters_for(profiler, add).nodes_created, 3);
+}
+
+TEST_F(ProfilerTests, tables_from_all_threads_are_merged) {
+  InstructionProfiler profiler;
+
+  auto run = [&] {
+    for (int i = 0; i < 100; ++i)
+      InstructionProfiler::Scope scope{&profiler, add};
+  };
+
+  std::thread thread{run};
+  run();
+  thread.join();
+
+  ASSERT_EQ(counters_for(profiler, add).executions, 200);
+}
+
+TEST_F(ProfilerTests, folded_output) {
+  InstructionProfiler profiler;
+  { InstructionProfiler::Scope scope{&profiler, add}; }
+
+  std::stringstream ss;
+  profiler.write_folded(ss, InstructionProfiler::Metric::Executions);
+
+  ASSERT_EQ(ss.str(), "func;func+0 (add) 1\n");
+}
+
+TEST_F(ProfilerTests, forks_only_count_new_paths) {
+  llvm::SMDiagnostic error;
+  auto branches = llvm::parseAssemblyString(R"(
+    define void @branches(i32 %x) {
+    entry:
+      %small = icmp ult i32 %x, 10
+      br i1 %small, label %inner, label %exit
+
+    inner:
+      %smaller = icmp ult i32 %x, 20
+      br i1 %smaller, label %exit, label %exit
+
+    exit:
+      ret void
+    }
+  )",
+                                            error, context);
+  ASSERT_NE(branches, nullptr);
+
+  auto* function = branches->getFunction("branches");
+  auto* outer = function->getEntryBlock().getTerminator();
+  auto* inner = std::next(function->begin())->getTerminator();
+
+  InstructionProfiler profiler;
+  QueueingContextStore store{1};
+  AlwaysAllowExecutionPolicy policy;
+  NullFailureLogger logger;
+
+  ExecutorOptions options;
+  options.num_threads = 1;
+  options.interpreter.profiler = &profiler;
+
+  Executor executor{&policy, &store, &logger, options};
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  store.add_context(Context(function, {x}));
+  executor.run();
+
+  // The first branch splits the path in two. The second one can only go one
+  // way so it doesn't create a new path.
+  ASSERT_EQ(counters_for(profiler, outer).forks, 1);
+  ASSERT_EQ(counters_for(profiler, inner).executions, 1);
+  ASSERT_EQ(counters_for(profiler, inner).forks, 0);
+}
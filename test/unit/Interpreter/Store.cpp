@@ -0,0 +1,141 @@
+#include "caffeine/Interpreter/Store.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/Context.h"
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+class DeterministicStoreTests : public ::testing::Test {
+protected:
+  llvm::LLVMContext llvm;
+  std::unique_ptr<llvm::Function> function;
+
+  void SetUp() override {
+    function.reset(llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(llvm), false),
+        llvm::GlobalValue::LinkageTypes::PrivateLinkage, 0));
+    llvm::BasicBlock::Create(llvm, "entry", function.get());
+  }
+};
+
+TEST_F(DeterministicStoreTests, children_follow_their_parents) {
+  DeterministicContextStore store{4};
+  store.add_context(Context{function.get()});
+
+  auto root = store.next_context();
+  ASSERT_TRUE(root.has_value());
+  ASSERT_EQ(root->path_id, 0u);
+
+  store.add_context(root->fork_once());
+  store.add_context(root->fork_once());
+
+  std::vector<uint64_t> ids;
+  while (auto ctx = store.next_context())
+    ids.push_back(ctx->path_id);
+
+  ASSERT_EQ(ids, (std::vector<uint64_t>{1, 2}));
+}
+
+TEST_F(DeterministicStoreTests, rounds_are_bounded) {
+  DeterministicContextStore store{2};
+  for (size_t i = 0; i < 3; ++i)
+    store.add_context(Context{function.get()});
+
+  // The first round only contains the first two contexts. The child of the
+  // first one is executed before the third context.
+  auto first = store.next_context();
+  store.add_context(first->fork_once());
+  auto second = store.next_context();
+
+  std::vector<uint64_t> ids{first->path_id, second->path_id};
+  while (auto ctx = store.next_context())
+    ids.push_back(ctx->path_id);
+
+  ASSERT_EQ(ids, (std::vector<uint64_t>{0, 1, 3, 2}));
+}
+
+TEST_F(DeterministicStoreTests, same_tree_with_multiple_threads) {
+  // Explore a tree where each of the first 50 contexts forks twice and
+  // return the parent of every context, indexed by path id.
+  auto explore = [&](size_t num_threads) {
+    DeterministicContextStore store{3};
+    store.add_context(Context{function.get()});
+
+    std::mutex mutex;
+    std::map<uint64_t, uint64_t> parents;
+
+    auto worker = [&] {
+      while (auto ctx = store.next_context()) {
+        if (ctx->path_id < 50) {
+          for (int i = 0; i < 2; ++i) {
+            Context child = ctx->fork_once();
+            child.constants = child.constants.set(
+                "parent", ConstantInt::Create(llvm::APInt(64, ctx->path_id)));
+            store.add_context(std::move(child));
+          }
+        }
+
+        uint64_t parent = 0;
+        if (const OpRef* value = ctx->constants.find("parent"))
+          parent = llvm::cast<ConstantInt>(**value).value().getZExtValue();
+
+        std::lock_guard lock(mutex);
+        parents.emplace(ctx->path_id, parent);
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; ++i)
+      threads.emplace_back(worker);
+    for (auto& thread : threads)
+      thread.join();
+
+    return parents;
+  };
+
+  auto expected = explore(1);
+  ASSERT_EQ(expected.size(), 101u);
+  ASSERT_EQ(explore(4), expected);
+}
+
+// The replaying store only needs a function to build contexts from.
+class ReplayingStoreTests : public DeterministicStoreTests {};
+
+TEST_F(ReplayingStoreTests, evicted_contexts_are_rebuilt) {
+  std::vector<uint32_t> replayed;
+  auto replay = [&](const DecisionLog& decisions) -> std::optional<Context> {
+    replayed.push_back(decisions[0]);
+    // Pretend that the last context could not be rebuilt.
+    if (decisions[0] == 3)
+      return std::nullopt;
+
+    Context ctx{function.get()};
+    ctx.decisions = decisions;
+    return ctx;
+  };
+
+  // Only the first two contexts are kept in memory.
+  ReplayingContextStore store{1, 2, replay};
+  for (uint32_t i = 0; i < 4; ++i) {
+    Context ctx{function.get()};
+    ctx.decisions.push_back(i);
+    store.add_context(std::move(ctx));
+  }
+
+  std::vector<uint32_t> order;
+  while (auto ctx = store.next_context())
+    order.push_back(ctx->decisions[0]);
+
+  ASSERT_EQ(order, (std::vector<uint32_t>{0, 1, 2}));
+  ASSERT_EQ(replayed, (std::vector<uint32_t>{2, 3}));
+}
@@ -0,0 +1,100 @@
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/Executor.h"
+#include "caffeine/Interpreter/FailureLogger.h"
+#include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Interpreter/Store.h"
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace caffeine;
+
+namespace {
+  // Records the names of the symbolic buffers of every completed path.
+  class RecordingPolicy : public AlwaysAllowExecutionPolicy {
+  public:
+    void on_path_complete(const Context& ctx, ExitStatus,
+                          const Assertion&) override {
+      auto lock = std::unique_lock(mutex);
+      for (const auto& [name, _] : ctx.constants)
+        names.push_back(name);
+    }
+
+    std::vector<std::string> names;
+
+  private:
+    std::mutex mutex;
+  };
+
+  class RecordingFailureLogger : public FailureLogger {
+  public:
+    void log_failure(const Model*, const Context&,
+                     const Failure& failure) override {
+      auto lock = std::unique_lock(mutex);
+      messages.emplace_back(failure.message);
+    }
+
+    std::vector<std::string> messages;
+
+  private:
+    std::mutex mutex;
+  };
+} // namespace
+
+class SymbolicNameTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module;
+
+  RecordingPolicy policy;
+  RecordingFailureLogger logger;
+
+  void SetUp() override {
+    llvm::SMDiagnostic error;
+    module = llvm::parseIRFile("Interpreter/symbolic-name.ll", error, context);
+
+    if (!module)
+      error.print("unittest", llvm::errs());
+
+    ASSERT_NE(module, nullptr);
+  }
+
+  void run(Context&& entry) {
+    QueueingContextStore store{1};
+    ExecutorOptions options;
+    options.num_threads = 1;
+
+    Executor executor{&policy, &store, &logger, options};
+    store.add_context(std::move(entry));
+    executor.run();
+  }
+};
+
+TEST_F(SymbolicNameTests, constant_name) {
+  run(Context(module->getFunction("constant_name")));
+
+  ASSERT_TRUE(logger.messages.empty());
+  ASSERT_EQ(policy.names, std::vector<std::string>{"input"});
+}
+
+TEST_F(SymbolicNameTests, symbolic_name_uses_solver) {
+  auto c = Constant::Create(Type::int_ty(8), "c");
+  run(Context(module->getFunction("symbolic_name"), {c}));
+
+  ASSERT_TRUE(logger.messages.empty());
+  ASSERT_EQ(policy.names, std::vector<std::string>{"x"});
+}
+
+TEST_F(SymbolicNameTests, unterminated_name_is_unsupported) {
+  run(Context(module->getFunction("unterminated_name")));
+
+  ASSERT_TRUE(policy.names.empty());
+  ASSERT_EQ(logger.messages, std::vector<std::string>{
+                                 "internal error: unsupported operation"});
+}
@@ -0,0 +1,65 @@
+source_filename = "manual test"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+declare void @caffeine_assert(i1)
+
+; Forks on a branch, a switch and a load through a pointer that could point
+; to either of two allocations. Every path ends in an assertion that fails.
+define dso_local void @tree(i32 %x) {
+entry:
+  %a = alloca i32
+  %b = alloca i32
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  %bit = and i32 %x, 1
+  %even = icmp eq i32 %bit, 0
+  br i1 %even, label %left, label %right
+
+left:
+  br label %mid
+
+right:
+  br label %mid
+
+mid:
+  %bits = and i32 %x, 6
+  switch i32 %bits, label %other [
+    i32 0, label %zero
+    i32 2, label %two
+  ]
+
+zero:
+  br label %end
+
+two:
+  br label %end
+
+other:
+  br label %end
+
+end:
+  %big = icmp ugt i32 %x, 50
+  %ptr = select i1 %big, i32* %a, i32* %b
+  %value = load i32, i32* %ptr
+  %sum = add i32 %x, %value
+  %ok = icmp ult i32 %sum, 1000
+  call void @caffeine_assert(i1 %ok)
+  ret void
+}
+
+declare i8* @caffeine_malloc(i64)
+
+; Forks on whether malloc returns null and then on a branch after it.
+define dso_local void @allocate(i64 %size) {
+entry:
+  %ptr = call i8* @caffeine_malloc(i64 %size)
+  %big = icmp ugt i64 %size, 100
+  br i1 %big, label %large, label %small
+
+large:
+  ret void
+
+small:
+  ret void
+}
@@ -0,0 +1,49 @@
+source_filename = "manual test"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+define dso_local i64 @fnv(i64 %x) local_unnamed_addr #0 {
+  %1 = xor i64 %x, -3750763034362895579
+  %2 = mul i64 %1, 1099511628211
+  ret i64 %2
+}
+
+define dso_local i32 @abs(i32 %x) local_unnamed_addr #0 {
+entry:
+  %neg = icmp slt i32 %x, 0
+  br i1 %neg, label %negate, label %done
+
+negate:
+  %sub = sub i32 0, %x
+  br label %done
+
+done:
+  %res = phi i32 [ %sub, %negate ], [ %x, %entry ]
+  ret i32 %res
+}
+
+define dso_local i32 @divide(i32 %x, i32 %y) local_unnamed_addr #0 {
+  %1 = sdiv i32 %x, %y
+  ret i32 %1
+}
+
+define dso_local i32 @count(i32 %n) local_unnamed_addr #0 {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %next = add i32 %i, 1
+  %cmp = icmp ult i32 %next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret i32 %next
+}
+
+define dso_local i32 @load(i32* %p) local_unnamed_addr #0 {
+  %1 = load i32, i32* %p
+  ret i32 %1
+}
+
+attributes #0 = { nounwind uwtable }
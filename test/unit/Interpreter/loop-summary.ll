@@ -0,0 +1,36 @@
+source_filename = "manual test"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+define dso_local i32 @count(i32 %n) local_unnamed_addr #0 {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %next = add nuw i32 %i, 1
+  %cmp = icmp ult i32 %next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %res = phi i32 [ %next, %loop ]
+  ret i32 %res
+}
+
+define dso_local void @fill(i8* %p, i64 %n) local_unnamed_addr #0 {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %next, %loop ]
+  %ptr = getelementptr inbounds i8, i8* %p, i64 %i
+  store i8 0, i8* %ptr
+  %next = add nuw i64 %i, 1
+  %cmp = icmp ult i64 %next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+attributes #0 = { nounwind uwtable }
@@ -0,0 +1,38 @@
+source_filename = "manual test"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+declare i8* @caffeine_builtin_symbolic_alloca(i64, i8*)
+declare void @caffeine_assume(i1)
+
+@name = private constant [6 x i8] c"input\00"
+@unterminated = private constant [5 x i8] c"input"
+
+define dso_local void @constant_name() {
+entry:
+  %name = getelementptr [6 x i8], [6 x i8]* @name, i64 0, i64 0
+  %buf = call i8* @caffeine_builtin_symbolic_alloca(i64 4, i8* %name)
+  ret void
+}
+
+; The first byte of the name is symbolic so it can only be read through the
+; solver.
+define dso_local void @symbolic_name(i8 %c) {
+entry:
+  %name = alloca [2 x i8]
+  %first = getelementptr [2 x i8], [2 x i8]* %name, i64 0, i64 0
+  %second = getelementptr [2 x i8], [2 x i8]* %name, i64 0, i64 1
+  store i8 %c, i8* %first
+  store i8 0, i8* %second
+  %is_x = icmp eq i8 %c, 120
+  call void @caffeine_assume(i1 %is_x)
+  %buf = call i8* @caffeine_builtin_symbolic_alloca(i64 4, i8* %first)
+  ret void
+}
+
+define dso_local void @unterminated_name() {
+entry:
+  %name = getelementptr [5 x i8], [5 x i8]* @unterminated, i64 0, i64 0
+  %buf = call i8* @caffeine_builtin_symbolic_alloca(i64 4, i8* %name)
+  ret void
+}
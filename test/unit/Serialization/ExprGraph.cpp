@@ -0,0 +1,84 @@
+#include "caffeine/Serialization/ExprGraph.h"
+
+#include <capnp/message.h>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+class ExprGraphTests : public ::testing::Test {
+protected:
+  // Serialize an expression and read it back.
+  OpRef round_trip(const OpRef& expr) {
+    capnp::MallocMessageBuilder message;
+    auto graph = message.initRoot<protos::ExprGraph>();
+
+    ExprGraphWriter writer;
+    uint32_t index = writer.add(expr);
+    writer.write(graph);
+
+    ExprGraphReader reader{graph.asReader()};
+    return reader[index];
+  }
+};
+
+TEST_F(ExprGraphTests, round_trip_constants) {
+  auto cint = ConstantInt::Create(llvm::APInt(128, 0xDEADBEEF).shl(70));
+  auto named = Constant::Create(Type::int_ty(32), "x");
+  auto numbered = Constant::Create(Type::int_ty(16), 7);
+
+  ASSERT_TRUE(*round_trip(cint) == *cint);
+  ASSERT_TRUE(*round_trip(named) == *named);
+  ASSERT_TRUE(*round_trip(numbered) == *numbered);
+}
+
+TEST_F(ExprGraphTests, round_trip_expression) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto y = Constant::Create(Type::int_ty(32), "y");
+  auto sum = BinaryOp::CreateAdd(x, y);
+  auto expr = SelectOp::Create(ICmpOp::CreateICmp(ICmpOpcode::ULT, sum, x),
+                               BinaryOp::CreateMul(sum, sum), y);
+
+  ASSERT_TRUE(*round_trip(expr) == *expr);
+}
+
+TEST_F(ExprGraphTests, round_trip_fixed_array) {
+  auto x = Constant::Create(Type::int_ty(8), "x");
+  auto y = Constant::Create(Type::int_ty(8), "y");
+  auto array = FixedArray::Create(
+      Type::int_ty(64), {x, BinaryOp::CreateAdd(x, y),
+                         ConstantInt::Create(llvm::APInt(8, 0x7F))});
+  auto load = LoadOp::Create(array, ConstantInt::Create(llvm::APInt(64, 1)));
+
+  auto result = round_trip(load);
+  ASSERT_TRUE(*result == *load);
+
+  const auto& data = llvm::cast<FixedArray>(*result->operand_at(0)).data();
+  ASSERT_EQ(data.size(), 3u);
+  ASSERT_TRUE(*data[0] == *x);
+  ASSERT_TRUE(*data[2] == *ConstantInt::Create(llvm::APInt(8, 0x7F)));
+}
+
+TEST_F(ExprGraphTests, shared_subexpressions_are_written_once) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto sum = BinaryOp::CreateAdd(x, x);
+
+  ExprGraphWriter writer;
+  writer.add(BinaryOp::CreateMul(sum, sum));
+
+  // x, x + x, (x + x) * (x + x)
+  ASSERT_EQ(writer.size(), 3);
+}
+
+TEST_F(ExprGraphTests, out_of_bounds_operand_is_rejected) {
+  capnp::MallocMessageBuilder message;
+  auto graph = message.initRoot<protos::ExprGraph>();
+
+  auto node = graph.initNodes(1)[0];
+  node.setOpcode(Operation::Not);
+  node.initType().setInteger(32);
+  node.initOperands(1).set(0, 5);
+  node.setNone();
+
+  ASSERT_THROW(ExprGraphReader{graph.asReader()}, SerializationError);
+}
@@ -0,0 +1,134 @@
+#include "caffeine/Solver/BitBlastSolver.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/AssertionList.h"
+#include "caffeine/Solver/Z3Solver.h"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+namespace {
+OpRef int_const(const llvm::APInt& value) {
+  return ConstantInt::Create(value);
+}
+
+// Solve for result == expr given the values of x and y and return the value
+// that the solver picked for result.
+Value solve_for(Solver& solver, const OpRef& expr, const OpRef& x,
+                const llvm::APInt& a, const OpRef& y, const llvm::APInt& b) {
+  auto result = Constant::Create(expr->type(), "result");
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(x, int_const(a))));
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(y, int_const(b))));
+
+  auto res =
+      solver.resolve(assertions, Assertion(ICmpOp::CreateICmpEQ(result, expr)));
+  EXPECT_EQ(res, SolverResult::SAT);
+  if (res != SolverResult::SAT)
+    return Value();
+  return res.evaluate(*result);
+}
+} // namespace
+
+TEST(BitBlastSolverTests, matches_z3) {
+  const Operation::Opcode opcodes[] = {
+      Operation::Add,  Operation::Sub,  Operation::Mul, Operation::UDiv,
+      Operation::SDiv, Operation::URem, Operation::SRem, Operation::And,
+      Operation::Or,   Operation::Xor,  Operation::Shl, Operation::LShr,
+      Operation::AShr};
+  const ICmpOpcode predicates[] = {ICmpOpcode::EQ, ICmpOpcode::UGT,
+                                   ICmpOpcode::ULE, ICmpOpcode::SGT,
+                                   ICmpOpcode::SLE};
+
+  BitBlastSolver bitblast;
+  Z3Solver z3;
+  std::mt19937_64 rng{7};
+
+  for (uint32_t width : {1u, 8u, 33u}) {
+    auto x = Constant::Create(Type::int_ty(width), "x");
+    auto y = Constant::Create(Type::int_ty(width), "y");
+    const llvm::APInt samples[] = {
+        llvm::APInt::getNullValue(width), llvm::APInt::getAllOnesValue(width),
+        llvm::APInt::getSignedMinValue(width), llvm::APInt(width, rng())};
+
+    std::vector<OpRef> exprs;
+    for (auto opcode : opcodes)
+      exprs.push_back(BinaryOp::Create(opcode, x, y));
+    for (auto predicate : predicates)
+      exprs.push_back(ICmpOp::CreateICmp(predicate, x, y));
+
+    for (const auto& expr : exprs) {
+      for (const auto& a : samples) {
+        for (const auto& b : samples) {
+          ASSERT_EQ(solve_for(bitblast, expr, x, a, y, b),
+                    solve_for(z3, expr, x, a, y, b))
+              << expr->opcode_name() << " i" << width << " "
+              << a.getZExtValue() << " " << b.getZExtValue();
+        }
+      }
+    }
+  }
+}
+
+TEST(BitBlastSolverTests, incremental_queries) {
+  BitBlastSolver solver;
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto y = Constant::Create(Type::int_ty(32), "y");
+  auto i32 = [](uint64_t value) { return int_const(llvm::APInt(32, value)); };
+
+  // x * y == 391 with 1 < x <= y only has the solution 17 * 23.
+  AssertionList assertions;
+  assertions.insert(Assertion(
+      ICmpOp::CreateICmpEQ(BinaryOp::CreateMul(x, y), i32(391))));
+  assertions.insert(Assertion(ICmpOp::CreateICmpULT(x, i32(1000))));
+  assertions.insert(Assertion(ICmpOp::CreateICmpULT(y, i32(1000))));
+  assertions.insert(Assertion(ICmpOp::CreateICmpUGT(x, i32(1))));
+  assertions.insert(Assertion(ICmpOp::CreateICmpULE(x, y)));
+
+  auto result = solver.resolve(assertions, Assertion());
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_EQ(result.evaluate(*x), Value(llvm::APInt(32, 17)));
+  ASSERT_EQ(result.evaluate(*y), Value(llvm::APInt(32, 23)));
+
+  // Later queries on the same path reuse the encoding of the earlier ones.
+  ASSERT_EQ(
+      solver.check(assertions, Assertion(ICmpOp::CreateICmpNE(x, i32(17)))),
+      SolverResult::UNSAT);
+  ASSERT_EQ(
+      solver.check(assertions, Assertion(ICmpOp::CreateICmpEQ(y, i32(23)))),
+      SolverResult::SAT);
+}
+
+TEST(BitBlastSolverTests, model_outlives_later_queries) {
+  BitBlastSolver solver;
+  auto x = Constant::Create(Type::int_ty(16), "x");
+
+  AssertionList first;
+  first.insert(Assertion(ICmpOp::CreateICmpEQ(x, 1234)));
+  auto result = solver.resolve(first, Assertion());
+  ASSERT_EQ(result, SolverResult::SAT);
+
+  AssertionList second;
+  second.insert(Assertion(ICmpOp::CreateICmpEQ(x, 4321)));
+  ASSERT_EQ(solver.resolve(second, Assertion()), SolverResult::SAT);
+
+  ASSERT_EQ(result.evaluate(*x), Value(llvm::APInt(16, 1234)));
+}
+
+TEST(BitBlastSolverTests, unsupported_is_unknown) {
+  BitBlastSolver solver;
+  auto f = Constant::Create(Type::float_ty(11, 53), "f");
+  auto g = Constant::Create(Type::float_ty(11, 53), "g");
+  auto query = FCmpOp::CreateFCmp(FCmpOpcode::LT, f, g);
+
+  AssertionList assertions;
+  ASSERT_EQ(solver.check(assertions, Assertion(query)),
+            SolverResult::Unknown);
+  // Integer queries still work afterwards.
+  auto y = Constant::Create(Type::int_ty(8), "y");
+  ASSERT_EQ(solver.check(assertions, Assertion(ICmpOp::CreateICmpEQ(y, y))),
+            SolverResult::SAT);
+}
@@ -0,0 +1,168 @@
+#include "caffeine/Solver/CompiledExpr.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Solver/Solver.h"
+
+#include <random>
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+namespace {
+class MapModel : public Model {
+public:
+  std::unordered_map<Symbol, Value> values;
+
+protected:
+  Value lookup(const Symbol& symbol, std::optional<size_t>) const override {
+    auto it = values.find(symbol);
+    if (it == values.end())
+      return Value();
+    return it->second;
+  }
+};
+
+OpRef int_const(uint32_t width, uint64_t value) {
+  return ConstantInt::Create(llvm::APInt(width, value));
+}
+} // namespace
+
+TEST(CompiledExprTests, matches_model_evaluate) {
+  // Every binary operation at a range of widths. This covers the edge cases
+  // for division by zero, signed overflow and oversized shifts.
+  const Operation::Opcode opcodes[] = {
+      Operation::Add,  Operation::Sub,  Operation::Mul, Operation::UDiv,
+      Operation::SDiv, Operation::URem, Operation::SRem, Operation::And,
+      Operation::Or,   Operation::Xor,  Operation::Shl, Operation::LShr,
+      Operation::AShr};
+
+  std::mt19937_64 rng{42};
+  for (uint32_t width : {1u, 8u, 13u, 32u, 64u, 96u}) {
+    auto x = Constant::Create(Type::int_ty(width), "x");
+    auto y = Constant::Create(Type::int_ty(width), "y");
+
+    std::vector<llvm::APInt> samples = {
+        llvm::APInt::getNullValue(width), llvm::APInt(width, 1),
+        llvm::APInt::getAllOnesValue(width),
+        llvm::APInt::getSignedMinValue(width),
+        llvm::APInt::getSignedMaxValue(width)};
+    for (int i = 0; i < 4; ++i)
+      samples.push_back(llvm::APInt(width, rng()));
+
+    for (auto opcode : opcodes) {
+      auto expr = BinaryOp::Create(opcode, x, y);
+      CompiledExpr compiled{expr};
+
+      for (const auto& a : samples) {
+        for (const auto& b : samples) {
+          MapModel model;
+          model.values.emplace(Symbol("x"), Value(a));
+          model.values.emplace(Symbol("y"), Value(b));
+
+          ASSERT_EQ(compiled.evaluate(model), model.evaluate(*expr))
+              << expr->opcode_name() << " i" << width;
+        }
+      }
+    }
+  }
+}
+
+TEST(CompiledExprTests, comparisons) {
+  const ICmpOpcode predicates[] = {
+      ICmpOpcode::EQ,  ICmpOpcode::NE,  ICmpOpcode::UGT, ICmpOpcode::UGE,
+      ICmpOpcode::ULT, ICmpOpcode::ULE, ICmpOpcode::SGT, ICmpOpcode::SGE,
+      ICmpOpcode::SLT, ICmpOpcode::SLE};
+
+  for (uint32_t width : {8u, 64u, 128u}) {
+    auto x = Constant::Create(Type::int_ty(width), "x");
+    auto y = Constant::Create(Type::int_ty(width), "y");
+    const llvm::APInt samples[] = {llvm::APInt::getNullValue(width),
+                                   llvm::APInt::getSignedMinValue(width),
+                                   llvm::APInt::getAllOnesValue(width)};
+
+    for (auto predicate : predicates) {
+      CompiledExpr compiled{ICmpOp::CreateICmp(predicate, x, y)};
+
+      for (const auto& a : samples) {
+        for (const auto& b : samples) {
+          MapModel model;
+          model.values.emplace(Symbol("x"), Value(a));
+          model.values.emplace(Symbol("y"), Value(b));
+
+          // The comparison folds when both operands are constants.
+          auto expected = ICmpOp::CreateICmp(predicate, ConstantInt::Create(a),
+                                             ConstantInt::Create(b));
+          ASSERT_EQ(compiled.evaluate_int(model),
+                    llvm::cast<ConstantInt>(*expected).value().getZExtValue());
+        }
+      }
+    }
+  }
+}
+
+TEST(CompiledExprTests, casts_select_and_loads) {
+  auto x = Constant::Create(Type::int_ty(16), "x");
+  auto arr = ConstantArray::Create("arr", int_const(32, 4));
+  auto byte = LoadOp::Create(arr, int_const(32, 2));
+
+  // select(x <s 0, sext(x), zext(arr[2])) + zext(trunc(x))
+  auto expr = BinaryOp::CreateAdd(
+      SelectOp::Create(
+          ICmpOp::CreateICmp(ICmpOpcode::SLT, x, int_const(16, 0)),
+          UnaryOp::CreateSExt(Type::int_ty(32), x),
+          UnaryOp::CreateZExt(Type::int_ty(32), byte)),
+      UnaryOp::CreateZExt(Type::int_ty(32),
+                          UnaryOp::CreateTrunc(Type::int_ty(8), x)));
+  CompiledExpr compiled{expr};
+
+  MapModel model;
+  model.values.emplace(Symbol("arr"),
+                       Value(SharedArray({1, 2, 3, 4}), Type::int_ty(32)));
+
+  model.values.insert_or_assign(Symbol("x"), Value(llvm::APInt(16, 0x0102)));
+  ASSERT_EQ(compiled.evaluate_int(model), 3u + 0x02u);
+
+  model.values.insert_or_assign(Symbol("x"), Value(llvm::APInt(16, 0xFFF0)));
+  ASSERT_EQ(compiled.evaluate_int(model), (uint32_t)(-16 + 0xF0));
+}
+
+TEST(CompiledExprTests, shared_nodes_compile_once) {
+  auto expr = Constant::Create(Type::int_ty(32), "x");
+  for (int i = 0; i < 64; ++i)
+    expr = BinaryOp::CreateAdd(expr, expr);
+
+  // Without memoization this would be 2^64 nodes.
+  CompiledExpr compiled{expr};
+  ASSERT_EQ(compiled.size(), 65u);
+
+  MapModel model;
+  model.values.emplace(Symbol("x"), Value(llvm::APInt(32, 3)));
+  ASSERT_EQ(compiled.evaluate_int(model), 0u);
+}
+
+TEST(CompiledExprTests, batched) {
+  auto x = Constant::Create(Type::int_ty(64), "x");
+  auto y = Constant::Create(Type::int_ty(64), "y");
+  auto expr =
+      ICmpOp::CreateICmp(ICmpOpcode::ULT, BinaryOp::CreateMul(x, y),
+                         ConstantInt::Create(llvm::APInt(64, 1000)));
+  CompiledExpr compiled{expr};
+
+  std::vector<MapModel> models(100);
+  std::vector<const Model*> pointers;
+  for (size_t i = 0; i < models.size(); ++i) {
+    models[i].values.emplace(Symbol("x"), Value(llvm::APInt(64, i)));
+    models[i].values.emplace(Symbol("y"), Value(llvm::APInt(64, 3 * i)));
+    pointers.push_back(&models[i]);
+  }
+
+  std::vector<uint64_t> results(models.size());
+  compiled.evaluate_int(pointers, results);
+  auto values = compiled.evaluate(pointers);
+
+  for (size_t i = 0; i < models.size(); ++i) {
+    ASSERT_EQ(results[i], 3 * i * i < 1000);
+    ASSERT_EQ(values[i], Value(llvm::APInt(1, 3 * i * i < 1000)));
+  }
+}
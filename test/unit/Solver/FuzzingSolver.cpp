@@ -0,0 +1,112 @@
+#include "caffeine/Solver/FuzzingSolver.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/AssertionList.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+namespace {
+OpRef dbl(double value) {
+  return ConstantFloat::Create(llvm::APFloat(value));
+}
+} // namespace
+
+TEST(FuzzingSolverTests, finds_value_in_range) {
+  FuzzingSolver solver;
+  auto x = Constant::Create(Type::float_ty(11, 53), "x");
+
+  AssertionList assertions;
+  assertions.insert(
+      Assertion(FCmpOp::CreateFCmp(FCmpOpcode::GT, x, dbl(1.5))));
+  auto result = solver.resolve(
+      assertions, Assertion(FCmpOp::CreateFCmp(FCmpOpcode::LT, x, dbl(2.0))));
+
+  ASSERT_EQ(result, SolverResult::SAT);
+  auto value = result.evaluate(*x).apfloat();
+  ASSERT_EQ(value.compare(llvm::APFloat(1.5)), llvm::APFloat::cmpGreaterThan);
+  ASSERT_EQ(value.compare(llvm::APFloat(2.0)), llvm::APFloat::cmpLessThan);
+}
+
+TEST(FuzzingSolverTests, finds_special_values) {
+  FuzzingSolver solver;
+  auto x = Constant::Create(Type::float_ty(11, 53), "x");
+  auto y = Constant::Create(Type::float_ty(11, 53), "y");
+
+  // x + 1.0 == x only holds for infinities and very large values.
+  AssertionList assertions;
+  auto sum = BinaryOp::CreateFAdd(x, dbl(1.0));
+  assertions.insert(Assertion(FCmpOp::CreateFCmp(FCmpOpcode::EQ, sum, x)));
+  assertions.insert(Assertion(UnaryOp::CreateFIsNaN(y)));
+
+  auto result = solver.resolve(assertions, Assertion());
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_TRUE(result.evaluate(*y).apfloat().isNaN());
+
+  auto value = result.evaluate(*x).apfloat();
+  ASSERT_TRUE(value.isInfinity() ||
+              abs(value).compare(llvm::APFloat(1e16)) !=
+                  llvm::APFloat::cmpLessThan);
+}
+
+TEST(FuzzingSolverTests, only_handles_float_queries) {
+  FuzzingSolver solver;
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto f = Constant::Create(Type::float_ty(11, 53), "f");
+
+  AssertionList assertions;
+  ASSERT_EQ(solver.check(assertions, Assertion(ICmpOp::CreateICmpEQ(x, 5))),
+            SolverResult::Unknown);
+
+  // Contradictions are never reported as UNSAT.
+  assertions.insert(
+      Assertion(FCmpOp::CreateFCmp(FCmpOpcode::LT, f, dbl(1.0))));
+  assertions.insert(
+      Assertion(FCmpOp::CreateFCmp(FCmpOpcode::GT, f, dbl(2.0))));
+  ASSERT_EQ(solver.check(assertions), SolverResult::Unknown);
+}
+
+TEST(FuzzingSolverTests, symbolic_fixed_array_element) {
+  FuzzingSolver solver;
+  auto f = Constant::Create(Type::float_ty(11, 53), "f");
+  auto x = Constant::Create(Type::int_ty(8), "x");
+  auto y = Constant::Create(Type::int_ty(8), "y");
+  auto k = Constant::Create(Type::int_ty(8), "k");
+
+  // The index is always in bounds but isn't constant so the load can't be
+  // folded away and x and y are only reachable through the array.
+  auto array = FixedArray::Create(Type::int_ty(64), {x, y});
+  auto index = UnaryOp::CreateZExt(Type::int_ty(64), BinaryOp::CreateAnd(k, 1));
+  auto load = LoadOp::Create(array, index);
+
+  AssertionList assertions;
+  assertions.insert(
+      Assertion(FCmpOp::CreateFCmp(FCmpOpcode::GT, f, dbl(1.5))));
+  assertions.insert(Assertion(ICmpOp::CreateICmpNE(load, 0)));
+
+  auto result = solver.resolve(assertions, Assertion());
+  ASSERT_EQ(result, SolverResult::SAT);
+
+  uint64_t selected = result.evaluate(*k).apint().getZExtValue() & 1;
+  auto element = result.evaluate(*(selected ? y : x)).apint();
+  ASSERT_NE(element.getZExtValue(), 0u);
+}
+
+TEST(FuzzingSolverTests, fixed_array_element_loaded_from_symbolic_array) {
+  FuzzingSolver solver;
+  auto f = Constant::Create(Type::float_ty(11, 53), "f");
+  auto input = ConstantArray::Create(
+      Symbol("input"), ConstantInt::Create(llvm::APInt(64, 4)));
+  auto byte = LoadOp::Create(input, ConstantInt::Create(llvm::APInt(64, 0)));
+  auto array = FixedArray::Create(Type::int_ty(64), {byte, byte});
+  auto load = LoadOp::Create(array, ConstantInt::Create(llvm::APInt(64, 1)));
+
+  AssertionList assertions;
+  assertions.insert(
+      Assertion(FCmpOp::CreateFCmp(FCmpOpcode::GT, f, dbl(1.5))));
+  assertions.insert(Assertion(ICmpOp::CreateICmpULE(load, 0xFF)));
+
+  // The symbolic array can't be evaluated so the query is left to the other
+  // solvers.
+  ASSERT_EQ(solver.check(assertions), SolverResult::Unknown);
+}
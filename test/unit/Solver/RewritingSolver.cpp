@@ -0,0 +1,73 @@
+#include "caffeine/Solver/RewritingSolver.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Interpreter/AssertionList.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+using namespace caffeine;
+
+namespace {
+// Records the queries that make it past the rewriting solver.
+class RecordingSolver : public Solver {
+public:
+  std::vector<Assertion>* extras;
+
+  explicit RecordingSolver(std::vector<Assertion>* extras) : extras(extras) {}
+
+  SolverResult resolve(AssertionList&, const Assertion& extra) override {
+    extras->push_back(extra);
+    return SolverResult::Unknown;
+  }
+};
+
+// What reading back a 32-bit value that was written to memory byte by byte
+// looks like. The rewriter turns this back into the value.
+OpRef reassembled(const OpRef& value) {
+  OpRef result = nullptr;
+  for (uint32_t i = 0; i < 4; ++i) {
+    auto byte = UnaryOp::CreateTrunc(Type::int_ty(8),
+                                     BinaryOp::CreateLShr(value, i * 8));
+    auto extended = BinaryOp::CreateShl(
+        UnaryOp::CreateZExt(Type::int_ty(32), byte), (uint64_t)i * 8);
+    result = result ? BinaryOp::CreateOr(result, extended) : extended;
+  }
+  return result;
+}
+} // namespace
+
+TEST(RewritingSolverTests, rewrites_extra_assertion) {
+  std::vector<Assertion> extras;
+  RewritingSolver solver{std::make_unique<RecordingSolver>(&extras)};
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto five = ConstantInt::Create(llvm::APInt(32, 5));
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpULT(reassembled(x), five)));
+  auto extra = Assertion(ICmpOp::CreateICmpEQ(reassembled(x), five));
+
+  ASSERT_EQ(solver.resolve(assertions, extra), SolverResult::Unknown);
+  ASSERT_EQ(solver.check(assertions, extra), SolverResult::Unknown);
+
+  ASSERT_EQ(extras.size(), 2u);
+  for (const Assertion& seen : extras) {
+    ASSERT_FALSE(seen.is_empty());
+    ASSERT_TRUE(llvm::isa<ICmpOp>(seen.value().get()));
+    ASSERT_EQ(seen.value()->operand_at(0), x);
+  }
+
+  for (const Assertion& assertion : assertions)
+    ASSERT_EQ(assertion.value()->operand_at(0), x);
+}
+
+TEST(RewritingSolverTests, passes_on_empty_extra) {
+  std::vector<Assertion> extras;
+  RewritingSolver solver{std::make_unique<RecordingSolver>(&extras)};
+
+  AssertionList assertions;
+  ASSERT_EQ(solver.resolve(assertions, Assertion()), SolverResult::Unknown);
+
+  ASSERT_EQ(extras.size(), 1u);
+  ASSERT_TRUE(extras[0].is_empty());
+}
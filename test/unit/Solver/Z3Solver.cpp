@@ -1,8 +1,10 @@
 
 #include "src/Solver/Z3Solver.h"
+#include "caffeine/Interpreter/AssertionList.h"
 
 #include <gtest/gtest.h>
 
+using namespace caffeine;
 using caffeine::z3_to_apfloat;
 using caffeine::z3_to_apint;
 
@@ -68,3 +70,120 @@ TEST_F(Z3ConversionTests, dbl_max_to_apfloat) {
   ASSERT_TRUE(val.isFiniteNonZero());
   ASSERT_EQ(val.convertToDouble(), DBL_MAX);
 }
+
+TEST(Z3TranslationCacheTests, reused_across_visitors) {
+  z3::context ctx;
+  Z3TranslationCache cache{ctx};
+
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto expr = BinaryOp::CreateAdd(x, ConstantInt::Create(llvm::APInt(32, 1)));
+
+  auto first = Z3OpVisitor{cache}.visit(*expr);
+  size_t size = cache.size();
+  ASSERT_EQ(size, 3u);
+
+  auto second = Z3OpVisitor{cache}.visit(*expr);
+  ASSERT_TRUE(z3::eq(first, second));
+  ASSERT_EQ(cache.size(), size);
+}
+
+TEST(Z3TranslationCacheTests, destroyed_operations_are_evicted) {
+  z3::context ctx;
+  Z3TranslationCache cache{ctx};
+
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto expr = BinaryOp::CreateMul(x, x);
+  const Operation* address = expr.get();
+  Z3OpVisitor{cache}.visit(*expr);
+  ASSERT_NE(cache.find(*expr), nullptr);
+
+  expr.reset();
+  cache.sweep();
+  ASSERT_EQ(cache.size(), 1u);
+
+  // Even if a new operation ends up with the same address it must not be
+  // given the old translation.
+  auto other = BinaryOp::CreateSub(x, x);
+  if (other.get() == address)
+    ASSERT_EQ(cache.find(*other), nullptr);
+}
+
+TEST(Z3TranslationCacheTests, symbol_sort_can_change) {
+  Z3Solver solver;
+
+  for (uint32_t width : {8u, 32u}) {
+    auto x = Constant::Create(Type::int_ty(width), "x");
+    auto value = ConstantInt::Create(llvm::APInt(width, 5));
+
+    AssertionList assertions;
+    auto result =
+        solver.resolve(assertions, Assertion(ICmpOp::CreateICmpEQ(x, value)));
+    ASSERT_EQ(result, SolverResult::SAT);
+    ASSERT_EQ(result.evaluate(*x), Value(llvm::APInt(width, 5)));
+  }
+}
+
+TEST(Z3TranslationCacheTests, fixed_array_in_later_query) {
+  // Large enough that loads from it aren't folded into a chain of selects.
+  std::vector<OpRef> data;
+  for (uint32_t i = 0; i < 2048; ++i)
+    data.push_back(ConstantInt::Create(llvm::APInt(8, i + 1)));
+
+  auto idx = Constant::Create(Type::int_ty(32), "idx");
+  auto array = FixedArray::Create(Type::int_ty(32),
+                                  PersistentArray<OpRef>(data));
+  auto load = LoadOp::Create(array, idx);
+  auto byte = [](uint8_t value) {
+    return ConstantInt::Create(llvm::APInt(8, value));
+  };
+
+  Z3Solver solver;
+  AssertionList assertions;
+  assertions.insert(Assertion(
+      ICmpOp::CreateICmpULT(idx, ConstantInt::Create(llvm::APInt(32, 2)))));
+
+  // The later queries reuse the cached translation of the array so its
+  // contents have to come along with it.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(solver.check(assertions,
+                           Assertion(ICmpOp::CreateICmpEQ(load, byte(2)))),
+              SolverResult::SAT);
+    ASSERT_EQ(solver.check(assertions,
+                           Assertion(ICmpOp::CreateICmpEQ(load, byte(3)))),
+              SolverResult::UNSAT);
+  }
+}
+
+TEST(Z3SolverTests, srem_truncates_towards_zero) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto rem = BinaryOp::CreateSRem(x, ConstantInt::Create(llvm::APInt(32, 2)));
+
+  Z3Solver solver;
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(x, -7)));
+
+  // srem takes the sign of the dividend, unlike smod.
+  ASSERT_EQ(solver.check(assertions, Assertion(ICmpOp::CreateICmpEQ(rem, -1))),
+            SolverResult::SAT);
+  ASSERT_EQ(solver.check(assertions, Assertion(ICmpOp::CreateICmpEQ(rem, 1))),
+            SolverResult::UNSAT);
+}
+
+TEST(Z3SolverTests, fcmp_uses_ieee_equality) {
+  auto bits = Constant::Create(Type::int_ty(64), "bits");
+  auto x = UnaryOp::CreateBitcast(Type::float_ty(11, 53), bits);
+  auto zero = ConstantFloat::Create(llvm::APFloat(0.0));
+
+  Z3Solver solver;
+  AssertionList assertions;
+  // x is -0.0 which compares equal to +0.0.
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(
+      bits, ConstantInt::Create(llvm::APInt::getSignMask(64)))));
+
+  ASSERT_EQ(solver.check(assertions, Assertion(FCmpOp::CreateFCmp(
+                                         FCmpOpcode::EQ, x, zero))),
+            SolverResult::SAT);
+  ASSERT_EQ(solver.check(assertions, Assertion(FCmpOp::CreateFCmp(
+                                         FCmpOpcode::NE, x, zero))),
+            SolverResult::UNSAT);
+}
@@ -0,0 +1,39 @@
+#include "caffeine/Support/Cancellation.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+TEST(CancellationTests, callbacks_run_once) {
+  CancellationToken token;
+  int calls = 0;
+
+  auto registration = token.on_cancel([&] { calls += 1; });
+  ASSERT_FALSE(token.is_cancelled());
+
+  ASSERT_TRUE(token.cancel());
+  ASSERT_FALSE(token.cancel());
+  ASSERT_TRUE(token.is_cancelled());
+  ASSERT_EQ(calls, 1);
+}
+
+TEST(CancellationTests, unregistered_callbacks_are_not_run) {
+  CancellationToken token;
+  int calls = 0;
+
+  {
+    auto registration = token.on_cancel([&] { calls += 1; });
+  }
+
+  token.cancel();
+  ASSERT_EQ(calls, 0);
+}
+
+TEST(CancellationTests, register_after_cancel_runs_immediately) {
+  CancellationToken token;
+  token.cancel();
+
+  int calls = 0;
+  auto registration = token.on_cancel([&] { calls += 1; });
+  ASSERT_EQ(calls, 1);
+}
@@ -0,0 +1,80 @@
+#include "caffeine/Support/Stats.h"
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace caffeine;
+
+TEST(StatsTests, counter_sums_across_threads) {
+  stats::Counter counter{"test.counter", "A test counter"};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 1000; ++j)
+        ++counter;
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  ASSERT_EQ(counter.value(), 4000);
+}
+
+TEST(StatsTests, gauge_goes_up_and_down) {
+  stats::Gauge gauge{"test.gauge", "A test gauge"};
+
+  gauge.add(5);
+  std::thread([&] { gauge.sub(3); }).join();
+
+  ASSERT_EQ(gauge.value(), 2);
+}
+
+TEST(StatsTests, histogram_bucket_bounds) {
+  using stats::Histogram;
+
+  uint64_t values[] = {0, 1, 7, 8, 15, 16, 17, 1000, UINT64_MAX};
+  for (uint64_t value : values) {
+    size_t index = Histogram::bucket_index(value);
+    ASSERT_LT(index, Histogram::NUM_BUCKETS);
+    ASSERT_LE(Histogram::bucket_lower_bound(index), value);
+    if (index + 1 < Histogram::NUM_BUCKETS)
+      ASSERT_GT(Histogram::bucket_lower_bound(index + 1), value);
+  }
+}
+
+TEST(StatsTests, histogram_percentiles) {
+  stats::Histogram hist{"test.histogram", "A test histogram"};
+
+  for (uint64_t i = 1; i <= 100; ++i)
+    hist.record(i);
+
+  auto summary = hist.summary();
+  ASSERT_EQ(summary.count, 100);
+  ASSERT_EQ(summary.sum, 5050);
+  ASSERT_EQ(summary.max, 100);
+
+  // Percentiles are only accurate to within the bucket size.
+  ASSERT_NEAR(summary.percentile(50), 50, 50 / 8);
+  ASSERT_NEAR(summary.percentile(99), 99, 99 / 8);
+}
+
+TEST(StatsTests, registered_stats_are_reported) {
+  stats::Counter counter{"test.reported", "A test counter"};
+  counter += 3;
+
+  ASSERT_EQ(stats::find("test.reported"), &counter);
+
+  std::stringstream ss;
+  stats::write_json(ss);
+  ASSERT_NE(ss.str().find("\"test.reported\": 3"), std::string::npos)
+      << ss.str();
+}
+
+TEST(StatsTests, stats_are_unregistered_when_destroyed) {
+  { stats::Counter counter{"test.temporary", "A test counter"}; }
+
+  ASSERT_EQ(stats::find("test.temporary"), nullptr);
+}
@@ -0,0 +1,213 @@
+#include "caffeine/Config.h"
+#include "caffeine/Serialization/ExprGraph.h"
+#if CAFFEINE_ENABLE_BITBLAST
+#include "caffeine/Solver/BitBlastSolver.h"
+#endif
+#include "caffeine/Solver/CanonicalizingSolver.h"
+#include "caffeine/Solver/FuzzingSolver.h"
+#include "caffeine/Solver/LoggingSolver.h"
+#include "caffeine/Solver/RewritingSolver.h"
+#include "caffeine/Solver/SequenceSolver.h"
+#include "caffeine/Solver/SimplifyingSolver.h"
+#include "caffeine/Solver/SlicingSolver.h"
+#include "caffeine/Solver/Z3Solver.h"
+
+#include <fmt/format.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/WithColor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace caffeine;
+
+cl::opt<std::string> input_filename{cl::Positional, cl::Required,
+                                    cl::desc("<query log>")};
+cl::opt<std::string> solver_type{
+    "solver",
+    cl::desc("Solver configuration to replay the queries against. Should be "
+             "one of: default, bitblast, fuzz, slicing, z3. default is the "
+             "same solver stack that caffeine uses while bitblast and fuzz "
+             "are that stack with caffeine --bitblast and --fuzz-floats "
+             "respectively. [default = default]"),
+    cl::value_desc("solver"), cl::init("default")};
+cl::opt<size_t> threads{
+    "t", cl::desc("the number of threads to use. [default = 1]"), cl::init(1)};
+cl::opt<unsigned> repeat{
+    "repeat", cl::desc("replay the whole log this many times. [default = 1]"),
+    cl::init(1)};
+
+namespace {
+  // The same solver chain that the executor puts in front of its backend.
+  std::shared_ptr<Solver> make_default_solver(std::unique_ptr<Solver> backend) {
+    auto rest =
+        std::make_unique<SequenceSolver<CanonicalizingSolver, SlicingSolver>>(
+            CanonicalizingSolver(), SlicingSolver(std::move(backend)));
+    return make_sequence_solver(SimplifyingSolver(),
+                                RewritingSolver(std::move(rest)));
+  }
+
+  std::shared_ptr<Solver> make_solver() {
+    if (solver_type == "z3")
+      return std::make_shared<Z3Solver>();
+    if (solver_type == "slicing")
+      return std::make_shared<SlicingSolver>(std::make_unique<Z3Solver>());
+    if (solver_type == "default")
+      return make_default_solver(std::make_unique<Z3Solver>());
+#if CAFFEINE_ENABLE_BITBLAST
+    if (solver_type == "bitblast")
+      return make_default_solver(
+          std::make_unique<SequenceSolver<BitBlastSolver, Z3Solver>>(
+              BitBlastSolver(), Z3Solver()));
+#endif
+    if (solver_type == "fuzz")
+      return make_default_solver(
+          std::make_unique<SequenceSolver<FuzzingSolver, Z3Solver>>(
+              FuzzingSolver(), Z3Solver()));
+    return nullptr;
+  }
+
+  struct ReplayResult {
+    std::chrono::nanoseconds duration;
+    SolverResult::Kind kind;
+  };
+
+  double to_ms(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  const char* result_name(SolverResult::Kind kind) {
+    switch (kind) {
+    case SolverResult::SAT:
+      return "sat";
+    case SolverResult::UNSAT:
+      return "unsat";
+    case SolverResult::Unknown:
+      return "unknown";
+    }
+
+    return "invalid";
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  InitLLVM X(argc, argv);
+
+  cl::ParseCommandLineOptions(argc, argv,
+                              "replay a solver query log and time the queries");
+
+  if (!make_solver()) {
+    WithColor::error() << " unknown solver '" << solver_type << "'\n";
+    return 2;
+  }
+
+  std::vector<LoggedQuery> queries;
+  try {
+    QueryLogReader reader{input_filename};
+    while (auto query = reader.next())
+      queries.push_back(std::move(*query));
+  } catch (SerializationError& e) {
+    WithColor::error() << " malformed query log: " << e.what() << '\n';
+    return 2;
+  } catch (std::exception& e) {
+    WithColor::error() << " unable to read query log '" << input_filename
+                       << "': " << e.what() << '\n';
+    return 2;
+  }
+
+  if (queries.empty()) {
+    WithColor::warning() << " query log contains no queries\n";
+    return 0;
+  }
+
+  size_t num_threads =
+      threads != 0 ? threads.getValue() : std::thread::hardware_concurrency();
+  size_t total = queries.size() * repeat;
+  std::vector<ReplayResult> results(total);
+  std::atomic<size_t> next_index = 0;
+
+  auto worker = [&] {
+    // Solvers are not thread-safe so each thread gets its own.
+    auto solver = make_solver();
+
+    size_t index;
+    while ((index = next_index.fetch_add(1)) < total) {
+      const LoggedQuery& query = queries[index % queries.size()];
+
+      auto start = std::chrono::steady_clock::now();
+      SolverResult result = query.replay(*solver);
+      auto end = std::chrono::steady_clock::now();
+
+      results[index] = {end - start, result.kind()};
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_threads; ++i)
+    workers.emplace_back(worker);
+  for (auto& thread : workers)
+    thread.join();
+  auto wall_time = std::chrono::steady_clock::now() - start;
+
+  std::chrono::nanoseconds recorded{0};
+  for (const LoggedQuery& query : queries)
+    recorded += query.duration;
+  recorded *= repeat;
+
+  size_t mismatches = 0;
+  std::chrono::nanoseconds replayed{0};
+  std::vector<std::chrono::nanoseconds> durations;
+  durations.reserve(total);
+
+  for (size_t i = 0; i < total; ++i) {
+    const LoggedQuery& query = queries[i % queries.size()];
+    const ReplayResult& result = results[i];
+
+    replayed += result.duration;
+    durations.push_back(result.duration);
+
+    // Unknown results depend on timeouts so they are not a real mismatch.
+    if (query.result == SolverResult::Unknown ||
+        result.kind == SolverResult::Unknown)
+      continue;
+    if (query.result != result.kind) {
+      mismatches += 1;
+      WithColor::warning() << fmt::format(
+          " query {} was {} when recorded but {} when replayed\n",
+          i % queries.size(), result_name(query.result),
+          result_name(result.kind));
+    }
+  }
+
+  std::sort(durations.begin(), durations.end());
+  auto percentile = [&](double p) {
+    size_t index = (size_t)(p / 100.0 * (durations.size() - 1));
+    return durations[index];
+  };
+
+  std::cout << fmt::format("queries:          {}\n", total);
+  std::cout << fmt::format("threads:          {}\n", num_threads);
+  std::cout << fmt::format("wall time:        {:.3f} ms\n",
+                           to_ms(wall_time));
+  std::cout << fmt::format("recorded time:    {:.3f} ms\n", to_ms(recorded));
+  std::cout << fmt::format("replayed time:    {:.3f} ms\n", to_ms(replayed));
+  std::cout << fmt::format("mean:             {:.3f} ms\n",
+                           to_ms(replayed) / total);
+  std::cout << fmt::format("p50:              {:.3f} ms\n",
+                           to_ms(percentile(50)));
+  std::cout << fmt::format("p99:              {:.3f} ms\n",
+                           to_ms(percentile(99)));
+  std::cout << fmt::format("max:              {:.3f} ms\n",
+                           to_ms(durations.back()));
+  std::cout << fmt::format("mismatches:       {}\n", mismatches);
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -1,15 +1,22 @@
 
+#include "caffeine/Config.h"
+#include "caffeine/Interpreter/AsyncFailureLogger.h"
 #include "caffeine/Interpreter/Context.h"
+#include "caffeine/Interpreter/Distributed.h"
 #include "caffeine/Interpreter/Interpreter.h"
 #include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Interpreter/Profiler.h"
 #include "caffeine/Interpreter/Store.h"
+#include "caffeine/Solver/LoggingSolver.h"
 #include "caffeine/Support/DiagnosticHandler.h"
 #include "caffeine/Support/Signal.h"
+#include "caffeine/Support/Stats.h"
 #include "caffeine/Support/Tracing.h"
 
 #include <llvm/IR/Module.h>
 #include <llvm/IRReader/IRReader.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/InitLLVM.h>
 #include <llvm/Support/WithColor.h>
 #include <llvm/Support/raw_os_ostream.h>
@@ -17,27 +24,33 @@
 
 #include <atomic>
 #include <exception>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <thread>
+#include <unistd.h>
 
 using namespace llvm;
 using namespace caffeine;
 
-class CountingFailureLogger : public caffeine::PrintingFailureLogger {
+class CountingFailureLogger : public caffeine::FailureLogger {
 public:
   std::atomic<uint64_t> num_failures = 0;
-  llvm::Function* func;
 
-  CountingFailureLogger(std::ostream& os, llvm::Function* func)
-      : PrintingFailureLogger(os), func{func} {}
+  explicit CountingFailureLogger(caffeine::FailureLogger* inner)
+      : inner{inner} {}
 
   void log_failure(const caffeine::Model* model, const caffeine::Context& ctx,
                    const caffeine::Failure& failure) override {
     num_failures += 1;
-    caffeine::PrintingFailureLogger::log_failure(model, ctx, failure);
+    inner->log_failure(model, ctx, failure);
   }
+
+private:
+  caffeine::FailureLogger* inner;
 };
 
 cl::opt<std::string> input_filename{cl::Positional};
@@ -59,18 +72,274 @@ cl::opt<bool> force_symbolic_allocator{
              "the program under test if possible. This option disables that "
              "and forces all allocations to have symbolic addresses. This "
              "may be much slower than allowing concrete addresses.")};
+cl::opt<bool> summarize_loops{
+    "summarize-loops",
+    cl::desc("replace side-effect free loops with a computable trip count by "
+             "closed-form expressions for the values they compute instead of "
+             "executing them one iteration at a time. This requires the "
+             "input to have been optimized so that loops are in a canonical "
+             "form.")};
+cl::opt<uint32_t> max_expr_depth{
+    "max-expr-depth",
+    cl::desc("concretize integer expressions whose depth exceeds this limit. "
+             "This bounds the cost of solver queries but means that not all "
+             "paths will be explored. 0 means no limit. [default = 0]"),
+    cl::init(0)};
+cl::opt<uint32_t> max_expr_size{
+    "max-expr-size",
+    cl::desc("concretize integer expressions with more nodes than this "
+             "limit. This bounds the cost of solver queries but means that "
+             "not all paths will be explored. 0 means no limit. "
+             "[default = 0]"),
+    cl::init(0)};
+cl::opt<uint32_t> load_alias_queries{
+    "load-alias-queries",
+    cl::desc("maximum number of solver queries used per load to check "
+             "whether earlier stores to symbolic offsets overlap with it. "
+             "[default = 0]"),
+    cl::init(0)};
+cl::opt<bool> bitblast{
+    "bitblast",
+    cl::desc("try to solve integer-only queries by bit-blasting them into an "
+             "incremental SAT instance before handing them to Z3. Queries "
+             "involving floats or memory still go to Z3.")};
+cl::opt<bool> fuzz_floats{
+    "fuzz-floats",
+    cl::desc("try to find models for floating-point queries by evaluating "
+             "them under special, random and nearby values before handing "
+             "them to Z3. This never proves a query unsatisfiable so Z3 is "
+             "still used when no model is found.")};
+cl::opt<unsigned> time_limit{
+    "time-limit",
+    cl::desc("stop exploring new paths after this many seconds and report "
+             "the results so far. 0 means no limit. [default = 0]"),
+    cl::value_desc("seconds"), cl::init(0)};
+cl::opt<uint64_t> max_instructions{
+    "max-instructions",
+    cl::desc("stop after executing this many instructions across all paths. "
+             "0 means no limit. [default = 0]"),
+    cl::init(0)};
+cl::opt<uint64_t> max_paths{
+    "max-paths",
+    cl::desc("stop after executing this many paths. 0 means no limit. "
+             "[default = 0]"),
+    cl::init(0)};
+cl::opt<unsigned> max_solver_time{
+    "max-solver-time",
+    cl::desc("stop once this many seconds have been spent in the solver "
+             "across all threads. 0 means no limit. [default = 0]"),
+    cl::value_desc("seconds"), cl::init(0)};
+cl::opt<bool> async_failures{
+    "async-failures",
+    cl::desc("process failures on background threads so that exploration "
+             "isn't slowed down by logging. Only the first failure at each "
+             "location is printed in full and a summary of all failures is "
+             "printed at the end.")};
+cl::opt<unsigned> failure_threads{
+    "failure-threads",
+    cl::desc("number of background threads used by --async-failures. "
+             "[default = 1]"),
+    cl::init(1)};
+cl::opt<std::string> output_dir{
+    "output-dir",
+    cl::desc("write the inputs for each failure to this directory as a KTest "
+             "file. Implies --async-failures."),
+    cl::value_desc("directory")};
+cl::opt<bool> track_memory{
+    "track-memory",
+    cl::desc("estimate how much memory each path uses when it is queued and "
+             "report the total for queued paths in the store.queue_bytes and "
+             "store.local_bytes statistics. This adds some overhead to every "
+             "fork.")};
 cl::opt<std::string> enable_tracing{
     "trace",
     cl::desc("Enable tracing to the output log specified by this flag."),
     cl::value_desc("filename")};
+cl::opt<unsigned> workers{
+    "workers",
+    cl::desc("explore the program using this many worker processes. The "
+             "main process hands out paths to the workers, moves paths from "
+             "busy workers to idle ones and deduplicates the failures they "
+             "find. -t sets the number of threads within each worker. Of the "
+             "limits only --time-limit can be used with this. 0 runs "
+             "everything within this process. [default = 0]"),
+    cl::init(0)};
 cl::opt<std::string> store_type{
     "store",
     cl::desc("Choose which solver caffeine will use. Should be one of: queue, "
-             "thread-queue."),
+             "thread-queue, deterministic, replay. The deterministic store "
+             "explores paths and reports failures in the same order no "
+             "matter how many threads are used. The replay store keeps at "
+             "most --max-resident-paths paths in memory and rebuilds the "
+             "rest from their decisions when they are needed."),
     cl::value_desc("store"), cl::init("thread-queue")};
+cl::opt<size_t> round_size{
+    "round-size",
+    cl::desc("Maximum number of paths executed in parallel before the "
+             "deterministic store waits for all of them to finish. "
+             "[default = 64]"),
+    cl::init(caffeine::DeterministicContextStore::default_round_size)};
+cl::opt<size_t> max_resident_paths{
+    "max-resident-paths",
+    cl::desc("Maximum number of queued paths that the replay store keeps in "
+             "memory. [default = 1024]"),
+    cl::init(1024)};
+
+cl::opt<std::string> stats_file{
+    "stats",
+    cl::desc("Collect execution statistics, periodically print a status line "
+             "to stderr, and write a JSON summary of all statistics to this "
+             "file once execution finishes. Use - to write to stdout."),
+    cl::value_desc("filename")};
+cl::opt<unsigned> stats_interval{
+    "stats-interval",
+    cl::desc("Seconds between status lines when --stats is given. 0 disables "
+             "the status line. [default = 5]"),
+    cl::init(5)};
+
+cl::opt<std::string> query_log_file{
+    "log-queries",
+    cl::desc("Record every solver query to this file so that it can be "
+             "replayed later using bench-solver-replay."),
+    cl::value_desc("filename")};
+
+cl::opt<std::string> profile_file{
+    "profile",
+    cl::desc("Record how much each instruction in the program costs to "
+             "execute and write a profile to this file once execution "
+             "finishes. Use - to write to stdout."),
+    cl::value_desc("filename")};
+cl::opt<std::string> profile_format{
+    "profile-format",
+    cl::desc("Format of the profile written by --profile. Should be one of: "
+             "report, folded. folded can be passed directly to flamegraph.pl. "
+             "[default = report]"),
+    cl::init("report")};
+cl::opt<InstructionProfiler::Metric> profile_metric{
+    "profile-metric",
+    cl::desc("Metric that the profile is sorted or weighted by. "
+             "[default = solver-time]"),
+    cl::values(
+        clEnumValN(InstructionProfiler::Metric::Executions, "executions",
+                   "number of times each instruction was executed"),
+        clEnumValN(InstructionProfiler::Metric::Forks, "forks",
+                   "number of paths forked by each instruction"),
+        clEnumValN(InstructionProfiler::Metric::SolverCalls, "solver-calls",
+                   "number of solver queries made by each instruction"),
+        clEnumValN(InstructionProfiler::Metric::SolverTime, "solver-time",
+                   "time spent in the solver for each instruction"),
+        clEnumValN(InstructionProfiler::Metric::NodesCreated, "nodes",
+                   "number of expression nodes created by each instruction"),
+        clEnumValN(InstructionProfiler::Metric::Time, "time",
+                   "time spent executing each instruction")),
+    cl::init(InstructionProfiler::Metric::SolverTime)};
 
 static ExitOnError exit_on_err;
 
+/**
+ * Explore the program using --workers worker processes. The workers are forked
+ * from this process once the module has been loaded so they all execute the
+ * same module.
+ */
+static int runDistributed(Function* function, ExecutorOptions options) {
+  if (query_log_file.getNumOccurrences() != 0 ||
+      profile_file.getNumOccurrences() != 0 ||
+      stats_file.getNumOccurrences() != 0 ||
+      output_dir.getNumOccurrences() != 0 ||
+      store_type.getNumOccurrences() != 0 ||
+      async_failures.getNumOccurrences() != 0) {
+    WithColor::error() << " --workers cannot be combined with --log-queries, "
+                          "--profile, --stats, --output-dir, --store or "
+                          "--async-failures\n";
+    return 2;
+  }
+
+  // Tracing runs a background thread that the workers would be forked from
+  // underneath.
+  if (enable_tracing.getNumOccurrences() != 0) {
+    WithColor::error() << " --workers cannot be combined with --trace\n";
+    return 2;
+  }
+
+  // Only the time limit is enforced by the coordinator. The others would
+  // apply to each path handed out instead of to the whole run.
+  if (max_paths.getNumOccurrences() != 0 ||
+      max_instructions.getNumOccurrences() != 0 ||
+      max_solver_time.getNumOccurrences() != 0) {
+    WithColor::error() << " --workers cannot be combined with --max-paths, "
+                          "--max-instructions or --max-solver-time\n";
+    return 2;
+  }
+
+  options.num_threads = threads != 0 ? threads : 1;
+
+  DistributedCoordinator::Options coordinator_options;
+  coordinator_options.time_limit = options.limits.time;
+  DistributedCoordinator coordinator{std::cout, coordinator_options};
+
+  std::vector<int> coordinator_fds;
+  std::vector<pid_t> children;
+  for (unsigned i = 0; i < workers; ++i) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+      WithColor::error() << " unable to create a socket for worker " << i
+                         << "\n";
+      return 2;
+    }
+
+    std::cout.flush();
+    pid_t pid = ::fork();
+    if (pid < 0) {
+      WithColor::error() << " unable to start worker " << i << "\n";
+      ::close(fds[0]);
+      ::close(fds[1]);
+      return 2;
+    }
+
+    if (pid == 0) {
+      // Don't keep the other workers' sockets open. Otherwise they wouldn't
+      // see the connection close if the coordinator exits.
+      for (int fd : coordinator_fds)
+        ::close(fd);
+      ::close(fds[0]);
+
+      auto policy = caffeine::AlwaysAllowExecutionPolicy();
+      DistributedWorker worker{fds[1], &policy, options, [&] {
+                                 auto context = Context(function);
+                                 context.heaps.set_concrete(
+                                     !force_symbolic_allocator);
+                                 return context;
+                               }};
+
+      bool ok = worker.run();
+      ::_exit(ok ? 0 : 2);
+    }
+
+    ::close(fds[1]);
+    coordinator_fds.push_back(fds[0]);
+    coordinator.add_worker(fds[0]);
+    children.push_back(pid);
+  }
+
+  auto summary = coordinator.run();
+  for (pid_t pid : children)
+    ::waitpid(pid, nullptr, 0);
+
+  if (summary.lost_workers != 0) {
+    WithColor::warning() << summary.lost_workers
+                         << " workers exited unexpectedly\n";
+  }
+  if (!summary.complete()) {
+    WithColor::warning() << summary.unexplored + summary.diverged
+                         << " paths were not explored\n";
+  }
+
+  int exitcode = summary.failures == 0 ? 0 : 1;
+  if (invert_exitcode)
+    exitcode = !exitcode;
+  return exitcode;
+}
+
 static std::unique_ptr<Module>
 loadFile(const char* argv0, const std::string& filename, LLVMContext& context) {
   llvm::SMDiagnostic error;
@@ -122,30 +391,199 @@ int main(int argc, char** argv) {
     return 2;
   }
 
-  auto logger = CountingFailureLogger{std::cout, function};
-
   caffeine::ExecutorOptions options;
   options.num_threads =
       threads != 0 ? threads : std::thread::hardware_concurrency();
+  options.interpreter.summarize_loops = summarize_loops;
+  options.interpreter.max_expr_depth = max_expr_depth;
+  options.interpreter.max_expr_size = max_expr_size;
+  options.interpreter.load_alias_queries = load_alias_queries;
+  options.interpreter.track_footprint = track_memory;
+#if !CAFFEINE_ENABLE_BITBLAST
+  if (bitblast) {
+    WithColor::error() << " --bitblast is not available since caffeine was "
+                          "built without CaDiCaL\n";
+    return 2;
+  }
+#endif
+  options.bitblast = bitblast;
+  options.fuzz_floats = fuzz_floats;
+  options.limits.time = std::chrono::seconds(time_limit);
+  options.limits.instructions = max_instructions;
+  options.limits.paths = max_paths;
+  options.limits.solver_time = std::chrono::seconds(max_solver_time);
+
+  if (workers != 0)
+    return runDistributed(function, options);
+
+  std::optional<caffeine::PrintingFailureLogger> printing_logger;
+  std::optional<caffeine::AsyncFailureLogger> async_logger;
+  if (async_failures || output_dir.getNumOccurrences() != 0) {
+    if (failure_threads == 0) {
+      WithColor::error() << " --failure-threads must be at least 1\n";
+      return 2;
+    }
+
+    if (!output_dir.empty()) {
+      if (auto ec = llvm::sys::fs::create_directories(output_dir)) {
+        WithColor::error() << " unable to create output directory '"
+                           << output_dir << "': " << ec.message() << "\n";
+        return 2;
+      }
+    }
+
+    caffeine::AsyncFailureLogger::Options async_options;
+    async_options.num_threads = failure_threads;
+    async_options.output_dir = output_dir;
+    async_logger.emplace(std::cout, async_options);
+  } else {
+    printing_logger.emplace(std::cout);
+  }
+
+  auto logger = CountingFailureLogger{
+      async_logger ? static_cast<caffeine::FailureLogger*>(&*async_logger)
+                   : &*printing_logger};
+
+  std::unique_ptr<QueryLogWriter> query_log;
+  if (query_log_file.getNumOccurrences() != 0) {
+    try {
+      query_log = std::make_unique<QueryLogWriter>(query_log_file);
+    } catch (std::runtime_error&) {
+      WithColor::error() << " unable to open query log '" << query_log_file
+                         << "'\n";
+      return 2;
+    }
+    options.query_log = query_log.get();
+  }
+
+  if (profile_format != "report" && profile_format != "folded") {
+    WithColor::error() << " unknown profile format '" << profile_format
+                       << "'\n";
+    return 2;
+  }
+
+  std::unique_ptr<InstructionProfiler> profiler;
+  std::optional<std::ofstream> profile_output;
+  if (profile_file.getNumOccurrences() != 0) {
+    if (profile_file != "-") {
+      profile_output.emplace(profile_file.getValue());
+      if (!*profile_output) {
+        WithColor::error() << " unable to open profile file '" << profile_file
+                           << "'\n";
+        return 2;
+      }
+    }
+
+    profiler = std::make_unique<InstructionProfiler>();
+    options.interpreter.profiler = profiler.get();
+  }
+
+  auto make_entry = [&] {
+    auto context = Context(function);
+    context.heaps.set_concrete(!force_symbolic_allocator);
+    return context;
+  };
+
+  caffeine::FailureLogger* exec_logger = &logger;
+  std::optional<DeterministicContextStore::OrderedLogger> ordered_logger;
+  // The replay store needs the executor, which is created after the store.
+  caffeine::Executor* replayer = nullptr;
 
   std::unique_ptr<ExecutionContextStore> store;
   if (store_type == "queue")
     store = std::make_unique<QueueingContextStore>(options.num_threads);
   else if (store_type == "thread-queue")
     store = std::make_unique<ThreadQueuedContextStore>(options.num_threads, 2);
-  else {
+  else if (store_type == "deterministic") {
+    if (round_size == 0) {
+      WithColor::error() << " --round-size must be at least 1\n";
+      return 2;
+    }
+
+    auto deterministic =
+        std::make_unique<DeterministicContextStore>(round_size);
+    ordered_logger.emplace(&logger, deterministic.get());
+    exec_logger = &*ordered_logger;
+    store = std::move(deterministic);
+  } else if (store_type == "replay") {
+    store = std::make_unique<ReplayingContextStore>(
+        options.num_threads, max_resident_paths,
+        [&](const caffeine::DecisionLog& decisions) {
+          return replayer->replay(make_entry(), decisions);
+        });
+  } else {
     WithColor::error() << " unknown store type '" << store_type << "'\n";
     return 2;
   }
 
   auto policy = caffeine::AlwaysAllowExecutionPolicy();
-  auto exec = caffeine::Executor(&policy, store.get(), &logger, options);
+  auto exec = caffeine::Executor(&policy, store.get(), exec_logger, options);
+  replayer = &exec;
+
+  store->add_context(make_entry());
+
+  // Open the stats file up front so that we don't find out that it can't be
+  // written only after the whole program has been explored.
+  std::optional<std::ofstream> stats_output;
+  if (stats_file.getNumOccurrences() != 0 && stats_file != "-") {
+    stats_output.emplace(stats_file.getValue());
+    if (!*stats_output) {
+      WithColor::error() << " unable to open stats file '" << stats_file
+                         << "'\n";
+      return 2;
+    }
+  }
+
+  std::optional<caffeine::stats::StatusReporter> reporter;
+  if (stats_file.getNumOccurrences() != 0 && stats_interval != 0) {
+    std::vector<std::string> columns{
+        "executor.paths_started", "paths.completed",   "paths.failed",
+        "store.queued",           "interpreter.forks", "solver.z3.queries",
+        "solver.z3.time_ns",      "executor.execute_ns"};
+    if (track_memory) {
+      columns.push_back("store.queue_bytes");
+      columns.push_back("store.local_bytes");
+    }
+
+    reporter.emplace(std::cerr, std::chrono::seconds(stats_interval),
+                     std::move(columns));
+  }
 
-  auto context = Context(function);
-  context.heaps.set_concrete(!force_symbolic_allocator);
-  store->add_context(std::move(context));
+  if (summarize_loops)
+    exec.summarize_loops(*module);
 
-  exec.run();
+  auto summary = exec.run();
+
+  if (!summary.complete()) {
+    WithColor::warning() << "stopped early ("
+                         << ExecutionBudget::describe(summary.stopped)
+                         << "), " << summary.unexplored
+                         << " paths were not explored\n";
+  }
+
+  if (async_logger)
+    async_logger->finish();
+
+  if (query_log && query_log->skipped() != 0) {
+    WithColor::warning() << query_log->skipped()
+                         << " solver queries could not be logged\n";
+  }
+
+  if (reporter) {
+    reporter->report();
+    reporter.reset();
+  }
+
+  if (stats_file.getNumOccurrences() != 0)
+    caffeine::stats::write_json(stats_output ? *stats_output : std::cout);
+
+  if (profiler) {
+    std::ostream& os = profile_output ? *profile_output : std::cout;
+    if (profile_format == "folded")
+      profiler->write_folded(os, profile_metric);
+    else
+      profiler->write_report(os, profile_metric);
+  }
 
   int exitcode = logger.num_failures == 0 ? 0 : 1;
 
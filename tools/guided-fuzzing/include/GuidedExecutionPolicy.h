@@ -6,6 +6,7 @@
 #include "caffeine/Solver/Solver.h"
 
 #include "CaffeineMutator.h"
+#include "InputBinding.h"
 
 extern "C" {
 #include "afl-fuzz.h"
@@ -14,14 +15,22 @@ extern "C" {
 namespace caffeine {
 
 /**
- * This class accepts an AssertionList and makes sure that every Context's
- * assertions combined with the given AssertionList is satisfiable.
+ * This class makes sure that only paths consistent with the current fuzzer
+ * input are explored. Paths which diverge from the input are dropped and a new
+ * test case is generated for each of them instead.
+ *
+ * Path consistency is checked concolically: each byte of the symbolic input
+ * buffer is bound to the corresponding byte of the concrete input and the
+ * assertions of a context are evaluated directly against those values. The
+ * solver is only needed to generate test cases for the paths that diverge or
+ * when an assertion refers to symbols other than the input bytes.
  */
 class GuidedExecutionPolicy : public ExecutionPolicy {
   CaffeineMutator* mutator;
   TestCaseStoragePtr cases;
   std::string data;
   std::string symbol_name;
+  InputBinding input;
 
 public:
   GuidedExecutionPolicy(std::string_view data, std::string symbol_name,
@@ -32,6 +41,9 @@ public:
   void on_path_complete(const Context& ctx, ExitStatus status,
                         const Assertion& assertion = Assertion()) override;
 
+private:
+  bool check_with_solver(const Context& ctx, const OpRef& buffer);
+
 protected:
   GuidedExecutionPolicy(GuidedExecutionPolicy&&) = default;
   GuidedExecutionPolicy(const GuidedExecutionPolicy&) = default;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/Value.h"
+#include "caffeine/Interpreter/AssertionList.h"
+#include "caffeine/Query/ConstraintSlicer.h"
+#include "caffeine/Solver/CompiledExpr.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace caffeine {
+
+/**
+ * Binds the symbolic input buffer of a guided fuzzing run to the bytes of the
+ * concrete fuzzer input so that path conditions can be checked against the
+ * input without going through the solver.
+ *
+ * This is kept separate from GuidedExecutionPolicy so that it doesn't depend
+ * on AFL.
+ */
+class InputBinding {
+private:
+  std::string data;
+
+  // The symbolic buffer that values was built for. This is kept alive so
+  // that its address can't be reused by a different buffer.
+  OpRef buffer;
+  std::unordered_map<Symbol, Value> values;
+  ConstraintSlicer slicer;
+
+  // Most assertions are shared by many contexts so each one is only compiled
+  // once. The compiled expression holds a reference to the assertion so the
+  // address can't be reused while it is in the map.
+  std::unordered_map<const Operation*, CompiledExpr> compiled;
+
+public:
+  explicit InputBinding(std::string_view data);
+
+  /**
+   * Bind the symbols that make up buffer to the bytes of the input. This is
+   * cheap if buffer is the same one that was bound last time.
+   *
+   * Buffers whose size doesn't match the input are left unbound.
+   */
+  void bind(const OpRef& buffer);
+
+  /**
+   * Evaluate the assertions against the bound input. Returns std::nullopt if
+   * the buffer is unbound or any of the assertions depend on something other
+   * than the input.
+   */
+  std::optional<bool> check_concrete(const AssertionList& assertions);
+
+private:
+  const CompiledExpr& compile(const OpRef& expr);
+};
+
+} // namespace caffeine
@@ -14,6 +14,7 @@
 #include "caffeine/Interpreter/Policy.h"
 #include "caffeine/Interpreter/Store.h"
 #include "caffeine/Solver/CanonicalizingSolver.h"
+#include "caffeine/Solver/RewritingSolver.h"
 #include "caffeine/Solver/SequenceSolver.h"
 #include "caffeine/Solver/SimplifyingSolver.h"
 #include "caffeine/Solver/SlicingSolver.h"
@@ -51,8 +52,13 @@ CaffeineMutator::CaffeineMutator(std::string binary_path, afl_state_t* afl) {
   }
 
   solver = caffeine::make_sequence_solver(
-      caffeine::SimplifyingSolver(), caffeine::CanonicalizingSolver(),
-      caffeine::SlicingSolver(std::make_unique<caffeine::Z3Solver>()));
+      caffeine::SimplifyingSolver(),
+      caffeine::RewritingSolver(
+          std::make_unique<caffeine::SequenceSolver<
+              caffeine::CanonicalizingSolver, caffeine::SlicingSolver>>(
+              caffeine::CanonicalizingSolver(),
+              caffeine::SlicingSolver(
+                  std::make_unique<caffeine::Z3Solver>()))));
 }
 
 size_t CaffeineMutator::mutate(caffeine::Span<char> data) {
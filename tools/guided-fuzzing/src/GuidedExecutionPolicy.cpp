@@ -18,7 +18,8 @@ GuidedExecutionPolicy::GuidedExecutionPolicy(std::string_view data,
                                              std::string symbol_name,
                                              CaffeineMutator* mutator,
                                              TestCaseStoragePtr cases)
-    : mutator{mutator}, cases{cases}, data{data}, symbol_name{symbol_name} {
+    : mutator{mutator}, cases{cases}, data{data}, symbol_name{symbol_name},
+      input{data} {
   CAFFEINE_ASSERT(mutator, "Mutator must not be null in GuidedExecutionPolicy");
 }
 
@@ -29,16 +30,24 @@ bool GuidedExecutionPolicy::should_queue_path(const Context& ctx) {
     return true;
   }
 
+  input.bind(*symbolic_buffer);
+  if (auto consistent = input.check_concrete(ctx.assertions))
+    return *consistent;
+
+  return check_with_solver(ctx, *symbolic_buffer);
+}
+
+bool GuidedExecutionPolicy::check_with_solver(const Context& ctx,
+                                              const OpRef& buffer) {
   AssertionList combined = ctx.assertions;
-  combined.insert(create_size_assertion(*symbolic_buffer, data.size()));
+  combined.insert(create_size_assertion(buffer, data.size()));
 
   const llvm::DataLayout& layout = ctx.mod->getDataLayout();
   unsigned bitwidth = layout.getPointerSizeInBits();
 
   for (size_t i = 0; i < data.size(); i++) {
     combined.insert(Assertion(ICmpOp::CreateICmpEQ(
-        LoadOp::Create(*symbolic_buffer,
-                       ConstantInt::Create(llvm::APInt(bitwidth, i))),
+        LoadOp::Create(buffer, ConstantInt::Create(llvm::APInt(bitwidth, i))),
         (uint8_t)data[i])));
   }
 
@@ -0,0 +1,90 @@
+#include "InputBinding.h"
+
+#include "caffeine/Solver/Solver.h"
+
+namespace caffeine {
+
+namespace {
+  /**
+   * Model which only contains the values bound to the fuzzer input.
+   */
+  class InputModel : public Model {
+  private:
+    const std::unordered_map<Symbol, Value>* values;
+
+  public:
+    explicit InputModel(const std::unordered_map<Symbol, Value>* values)
+        : values(values) {}
+
+  protected:
+    Value lookup(const Symbol& symbol, std::optional<size_t>) const override {
+      auto it = values->find(symbol);
+      if (it == values->end())
+        return Value();
+      return it->second;
+    }
+  };
+} // namespace
+
+InputBinding::InputBinding(std::string_view data) : data(data) {}
+
+void InputBinding::bind(const OpRef& buffer) {
+  if (buffer.get() == this->buffer.get())
+    return;
+
+  this->buffer = buffer;
+  values.clear();
+
+  if (auto array = llvm::dyn_cast<FixedArray>(buffer.get())) {
+    // Inputs that are shorter than the buffer can't be bound concretely.
+    // Leaving the map empty makes every check fall back to the solver.
+    if (array->data().size() != data.size())
+      return;
+
+    for (size_t i = 0; i < data.size(); ++i) {
+      auto byte = llvm::dyn_cast<Constant>(array->data()[i].get());
+      if (!byte)
+        continue;
+
+      values.emplace(byte->symbol(), Value(llvm::APInt(8, (uint8_t)data[i])));
+    }
+  } else if (auto array = llvm::dyn_cast<ConstantArray>(buffer.get())) {
+    // The same goes for arrays whose size isn't known to match the input.
+    auto size = llvm::dyn_cast<ConstantInt>(array->size().get());
+    if (!size || size->value() != data.size())
+      return;
+
+    values.emplace(array->symbol(), Value(SharedArray(data.data(), data.size()),
+                                          array->size()->type()));
+  }
+}
+
+std::optional<bool>
+InputBinding::check_concrete(const AssertionList& assertions) {
+  if (values.empty())
+    return std::nullopt;
+
+  for (const Assertion& assertion : assertions) {
+    for (const Symbol& symbol : slicer.contained_constants(assertion.value())) {
+      if (values.count(symbol) == 0)
+        return std::nullopt;
+    }
+  }
+
+  InputModel model{&values};
+  for (const Assertion& assertion : assertions) {
+    if (compile(assertion.value()).evaluate_int(model) == 0)
+      return false;
+  }
+
+  return true;
+}
+
+const CompiledExpr& InputBinding::compile(const OpRef& expr) {
+  auto it = compiled.find(expr.get());
+  if (it == compiled.end())
+    it = compiled.emplace(expr.get(), CompiledExpr(expr)).first;
+  return it->second;
+}
+
+} // namespace caffeine